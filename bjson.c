@@ -1,3 +1,6 @@
+// madvise, mkstemp and friends are outside strict ISO C modes like -std=c11
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,6 +8,26 @@
 #include <regex.h>
 #include <ctype.h>
 #include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+#define BJSON_HAVE_MALLINFO2 1
+#include <malloc.h>  // Heap figures for the benchmark's memory report
+#else
+#define BJSON_HAVE_MALLINFO2 0
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BJSON_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define BJSON_X86_SIMD 0
+#endif
 
 // Better JSON Type System
 typedef enum {
@@ -21,7 +44,10 @@ typedef enum {
     BJSON_SET,
     BJSON_MAP,
     BJSON_REGEX,
-    BJSON_REFERENCE
+    BJSON_REFERENCE,
+    BJSON_DECIMAL,     // Integer literal beyond 64 bits, kept as exact decimal text
+    BJSON_DURATION,
+    BJSON_CUSTOM       // Registered with bjson_register_custom_type; the payload is opaque bytes
 } bjson_type_t;
 
 // Forward declarations
@@ -39,83 +65,253 @@ typedef struct {
     int year, month, day;
 } bjson_date_t;
 
+// UTC offset of a datetime written without one (a floating local time)
+#define BJSON_OFFSET_NONE (-32768)
+
 typedef struct {
     bjson_date_t date;
     int hour, minute, second, millisecond;
     char* timezone;  // e.g., "UTC", "America/New_York"
+    int offset_minutes;  // UTC offset of the fields above ("Z" is 0), or BJSON_OFFSET_NONE
 } bjson_datetime_t;
 
+// Node form of a datetime (see bjson_value_datetime): the instant itself, so
+// datetimes compare and sort without unpacking. The timezone, when present,
+// lives in the node's extension block
+typedef struct {
+    int64_t epoch_ms;        // Since 1970-01-01T00:00:00Z; floating times count as UTC
+    int32_t offset_minutes;  // As written, or BJSON_OFFSET_NONE
+} bjson_datetime_packed_t;
+
+// ISO-8601 duration: calendar months (a year is 12) and exact milliseconds
+// (a day is 24 hours, a week 7 days), both carrying the sign
+typedef struct {
+    int64_t milliseconds;
+    int32_t months;
+} bjson_duration_t;
+
 // Byte array structure
 typedef struct {
     uint8_t* data;
     size_t length;
 } bjson_bytes_t;
 
-// Set structure (unique values)
+// Set structure (unique values, hash-indexed by structural equality)
 typedef struct {
     struct bjson_value** values;
     size_t count;
     size_t capacity;
+    uint64_t* index;         // Slots: entry + 1 in the low 32 bits, hash tag above; 0 when empty
+    size_t index_mask;       // Slot count - 1
 } bjson_set_t;
 
-// Map structure (key-value pairs with flexible keys)
+// Map structure (key-value pairs with flexible keys, hash-indexed by key)
 typedef struct {
     struct bjson_value** keys;
     struct bjson_value** values;
     size_t count;
     size_t capacity;
+    uint64_t* index;         // Same layout as bjson_set_t.index, over keys
+    size_t index_mask;
 } bjson_map_t;
 
-// Regex structure
+// Regex structure; the compiled form lives in the node's extension block
 typedef struct {
     char* pattern;
     char* flags;
-    regex_t compiled;
-    int is_compiled;
 } bjson_regex_t;
 
-// Main value structure
+// Value ownership flags
+#define BJSON_VALUE_ARENA 0x1     // Node lives in a document arena; freed with the document
+#define BJSON_VALUE_BORROWED 0x2  // string_val points into the parsed input; not owned
+#define BJSON_VALUE_HASHED 0x4    // string_hash is valid
+#define BJSON_VALUE_EXTENDED 0x8  // A bjson_value_ext_t sits directly in front of the node
+#define BJSON_VALUE_SHARED 0x10   // Interned key owned by its document's intern table
+
+// Largest array capacity; it is kept in 32 bits to hold nodes at 24 bytes
+#define BJSON_ARRAY_MAX_CAPACITY UINT32_MAX
+
+// Custom payloads up to this size live in the node itself
+#define BJSON_CUSTOM_INLINE 16
+
+// Main value structure: 24 bytes for every type. Data few nodes carry sits
+// out of line: set and map tables in their own blocks (like objects), and
+// metadata, timezones and compiled regexes in the extension block
 typedef struct bjson_value {
-    bjson_type_t type;
+    uint8_t type;        // bjson_type_t
+    uint8_t flags;       // BJSON_VALUE_* bits
+    uint16_t custom_type;  // BJSON_CUSTOM: registry slot of its type
+    union {
+        uint32_t string_hash;     // BJSON_STRING keys: low bits of bjson_hash_bytes when BJSON_VALUE_HASHED
+        uint32_t array_capacity;  // BJSON_ARRAY: allocated item slots
+        uint32_t custom_length;   // BJSON_CUSTOM: payload bytes
+    };
     union {
         int bool_val;
         long long int_val;
         double double_val;
-        char* string_val;
+        struct {
+            char* data;      // NUL-terminated unless BJSON_VALUE_BORROWED
+            size_t length;   // Byte length; may include embedded NULs
+        } string_val;        // Also holds the digits of BJSON_DECIMAL
         struct {
             struct bjson_value** items;
             size_t count;
-            size_t capacity;
         } array_val;
         struct bjson_object* object_val;
         bjson_date_t date_val;
-        bjson_datetime_t datetime_val;
+        bjson_datetime_packed_t datetime_val;
+        bjson_duration_t duration_val;
         bjson_bytes_t bytes_val;
-        bjson_set_t set_val;
-        bjson_map_t map_val;
+        bjson_set_t* set_val;
+        bjson_map_t* map_val;
         bjson_regex_t regex_val;
         bjson_reference_t ref_val;
+        uint8_t custom_inline[BJSON_CUSTOM_INLINE];  // BJSON_CUSTOM payloads that fit
+        uint8_t* custom_data;                        // and the larger ones
     };
-    
-    // Metadata
+} bjson_value_t;
+
+// Shared compiled form of a regex pattern and flags; see bjson_regex_match
+typedef struct bjson_regex_entry bjson_regex_entry_t;
+
+// Extension block for the rare node that needs more than 24 bytes. It is
+// allocated together with the node, directly in front of it, so it costs
+// nothing on every other node; see bjson_value_ext
+typedef struct bjson_value_ext {
     char* type_hint;     // Schema information
     char* comment;       // Associated comment
     char* id;            // For references
-} bjson_value_t;
+    char* timezone;      // BJSON_DATETIME: e.g., "UTC", "America/New_York"
+    bjson_regex_entry_t* compiled;  // BJSON_REGEX: counted cache reference, NULL until bound
+} bjson_value_ext_t;
+
+// Objects with at least this many pairs get a hash index on their string keys
+#define BJSON_OBJECT_INDEX_THRESHOLD 16
 
-// Object key-value pair (supports flexible keys)
-typedef struct bjson_pair {
-    bjson_value_t* key;
-    bjson_value_t* value;
-} bjson_pair_t;
+// Key sequence shared by every object of a document with the same keys in
+// the same order (BJSON_PARSE_SHARE_KEYS); owned by the document
+typedef struct bjson_shape {
+    bjson_value_t** keys;    // Interned keys, in order
+    size_t count;
+    uint32_t* index;         // Key index as in bjson_object_t, or NULL below the threshold
+    size_t index_mask;
+    uint64_t hash;           // Of the key pointers
+} bjson_shape_t;
 
-// Object structure
+// Object structure (supports flexible keys)
 typedef struct bjson_object {
-    bjson_pair_t* pairs;
+    bjson_value_t** keys;    // Insertion order; the shape's keys when shape is set,
+                             // otherwise one block holding keys then values
+    bjson_value_t** values;  // values[i] belongs to keys[i]
     size_t count;
-    size_t capacity;
+    size_t capacity;         // Slots for each of keys and values
+    uint32_t* index;         // Open-addressing slots holding pair index + 1, or 0 when empty
+    size_t index_mask;       // Slot count - 1
+    size_t index_count;      // Pairs covered by the index; later pairs are scanned
+    const bjson_shape_t* shape;  // Shared keys and index, or NULL when the object owns them
 } bjson_object_t;
 
+// Remembers where a key sat in the last object looked up, so objects of the
+// same shape answer bjson_object_get_cached without hashing; zero-initialize
+typedef struct {
+    const bjson_shape_t* shape;
+    size_t slot;             // Pair index, or SIZE_MAX when the shape lacks the key
+} bjson_key_cache_t;
+
+// Arena chunk; the payload follows the header
+typedef struct bjson_arena_chunk {
+    struct bjson_arena_chunk* next;
+    size_t size;
+    size_t used;
+} bjson_arena_chunk_t;
+
+// Regex cache reference held by an arena node, dropped with the arena
+typedef struct bjson_regex_ref {
+    struct bjson_regex_ref* next;
+    bjson_regex_entry_t* entry;
+} bjson_regex_ref_t;
+
+// Arena allocator: carves nodes, strings and buffers for a whole document out
+// of large chunks that are all released together
+typedef struct bjson_arena {
+    bjson_arena_chunk_t* head;
+    bjson_arena_chunk_t* spare;  // Emptied by bjson_arena_reset, reused before malloc
+    size_t chunk_size;       // Size of the next regular chunk
+    size_t chunk_count;      // Number of underlying malloc calls
+    size_t bytes_used;       // Bytes handed out to callers
+    bjson_regex_ref_t* regexes;  // Released by bjson_arena_reset and bjson_arena_destroy
+} bjson_arena_t;
+
+// Parse options
+typedef enum {
+    BJSON_PARSE_DEFAULT = 0,
+    BJSON_PARSE_ARENA = 1 << 0,          // Allocate the whole tree from a document arena
+    BJSON_PARSE_BORROW_STRINGS = 1 << 1, // Escape-free strings view the input, which must outlive the document
+    BJSON_PARSE_BIG_DECIMALS = 1 << 2,   // Out-of-range integers become BJSON_DECIMAL instead of double
+    BJSON_PARSE_PRESIZE = 1 << 3,        // Count container sizes in a pre-pass so containers never reallocate
+    BJSON_PARSE_TWO_STAGE = 1 << 4,      // Index the structural characters first, then build the tree from the index (documents only)
+    BJSON_PARSE_SHARE_KEYS = 1 << 5      // Intern object keys and share key vectors between objects with the same keys (documents only)
+} bjson_parse_flags_t;
+
+typedef struct bjson_intern bjson_intern_t;
+
+// Parsed document: owns the root value and, in arena mode, all of its memory
+typedef struct bjson_document {
+    bjson_value_t* root;
+    bjson_arena_t* arena;    // NULL when nodes were individually malloc'ed
+    void* source;            // Input kept alive for borrowed strings (bjson_parse_file)
+    size_t source_length;
+    int source_mapped;       // source is an mmap'ed file rather than a heap buffer
+    bjson_intern_t* intern;  // Interned keys and shapes (BJSON_PARSE_SHARE_KEYS), or NULL
+} bjson_document_t;
+
+// Event callbacks for bjson_parse_sax. Every callback is optional and returns
+// nonzero to stop parsing. Strings and buffers are only valid during the call.
+// Inside objects and maps the events alternate key, value: string keys arrive
+// through key(), any other key as an ordinary value event.
+typedef struct bjson_sax_handler {
+    int (*start_object)(void* ctx);
+    int (*end_object)(void* ctx, size_t count);
+    int (*start_array)(void* ctx);
+    int (*end_array)(void* ctx, size_t count);
+    int (*start_set)(void* ctx);
+    int (*end_set)(void* ctx, size_t count);
+    int (*start_map)(void* ctx);
+    int (*end_map)(void* ctx, size_t count);
+    int (*key)(void* ctx, const char* data, size_t length);
+    int (*null_value)(void* ctx);
+    int (*bool_value)(void* ctx, int value);
+    int (*int_value)(void* ctx, long long value);
+    int (*double_value)(void* ctx, double value);
+    int (*decimal_value)(void* ctx, const char* digits, size_t length);
+    int (*string_value)(void* ctx, const char* data, size_t length);
+    int (*date_value)(void* ctx, const bjson_date_t* date);
+    int (*datetime_value)(void* ctx, const bjson_datetime_t* datetime);
+    int (*bytes_value)(void* ctx, const uint8_t* data, size_t length);
+    int (*regex_value)(void* ctx, const char* pattern, const char* flags);
+    int (*ref_value)(void* ctx, const char* path);
+    int (*duration_value)(void* ctx, const bjson_duration_t* duration);
+    int (*custom_value)(void* ctx, unsigned type, const uint8_t* payload, size_t length);  // See bjson_custom_type_name
+} bjson_sax_handler_t;
+
+// Parses the payload of a custom @name(...) type registered with
+// bjson_register_type: the text between its parentheses, delimited as for
+// every other type. It reports exactly one value through handler, whose
+// members may be NULL, and returns 0 to continue, a positive value when an
+// event asked to stop, or -1 when the payload is invalid.
+typedef int (*bjson_type_parse_fn)(void* user, const char* payload, size_t length,
+                                   const bjson_sax_handler_t* handler, void* ctx);
+
+// Longest extended type name
+#define BJSON_TYPE_NAME_MAX 31
+
+// Element count of the container opening at pos (BJSON_PARSE_PRESIZE)
+typedef struct {
+    size_t pos;
+    size_t count;
+} bjson_size_hint_t;
+
 // Parser state and error handling
 typedef struct {
     const char* input;
@@ -127,6 +323,19 @@ typedef struct {
     bjson_value_t* root;
     bjson_value_t** id_map;  // For reference resolution
     size_t id_count;
+    bjson_arena_t* arena;    // Allocation source; NULL means malloc
+    bjson_intern_t* intern;  // Key intern table of the document being built, or NULL
+    unsigned flags;          // BJSON_PARSE_* options
+    char* scratch;           // Unescape buffer reused across strings
+    size_t scratch_capacity;
+    bjson_size_hint_t* size_hints;  // Sorted by position
+    size_t size_hint_count;
+    size_t size_hint_next;
+    const bjson_sax_handler_t* sax;  // Receives the token events
+    void* sax_ctx;
+    int sax_stopped;         // A callback asked to stop
+    const uint32_t* index;   // Structural positions for stage 2 (BJSON_PARSE_TWO_STAGE)
+    size_t index_count;
 } bjson_parser_t;
 
 // Error codes
@@ -136,68 +345,823 @@ typedef enum {
     BJSON_ERROR_MEMORY,
     BJSON_ERROR_TYPE,
     BJSON_ERROR_REFERENCE,
-    BJSON_ERROR_PARTIAL
+    BJSON_ERROR_PARTIAL,
+    BJSON_ERROR_IO
 } bjson_error_t;
 
+// Output sink for bjson_serialize_to: receives the output in order, in chunks
+// of up to BJSON_WRITER_CHUNK bytes; return nonzero to stop serialization
+typedef int (*bjson_write_fn)(void* ctx, const char* data, size_t length);
+
+// Hooks of a custom extended type (bjson_register_custom_type). Its values
+// are BJSON_CUSTOM nodes holding an opaque payload, inside the node when it
+// fits in BJSON_CUSTOM_INLINE bytes, so such types cost no allocation per
+// value. Only parse and serialize are required; built-in types never go
+// through hooks.
+typedef struct bjson_type_hooks {
+    // Payload of @name(text): writes up to capacity bytes and returns the
+    // payload length, which may exceed capacity to ask for a second call
+    // with that much room, or -1 when text is invalid
+    long (*parse)(void* user, const char* text, size_t length, uint8_t* payload, size_t capacity);
+    // Text between the parentheses; nonzero from write must be returned
+    int (*serialize)(void* user, const uint8_t* payload, size_t length, bjson_write_fn write, void* ctx);
+    // Binary form of a payload and its inverse, called like serialize and
+    // parse; the payload is stored as it is when they are NULL
+    int (*encode)(void* user, const uint8_t* payload, size_t length, bjson_write_fn write, void* ctx);
+    long (*decode)(void* user, const uint8_t* data, size_t length, uint8_t* payload, size_t capacity);
+    // Payload equality and hash, which must agree; byte comparison and
+    // bjson_hash_bytes when NULL
+    int (*equals)(void* user, const uint8_t* a, size_t a_length, const uint8_t* b, size_t b_length);
+    uint64_t (*hash)(void* user, const uint8_t* payload, size_t length);
+    void* user;
+} bjson_type_hooks_t;
+
+// Incremental parser fed with bjson_parser_feed
+typedef struct bjson_push_parser bjson_push_parser_t;
+
+// Newline-delimited record reader
+typedef struct bjson_record_stream bjson_record_stream_t;
+
+// One record of a stream (bjson_record_stream_next)
+typedef struct {
+    bjson_value_t* value;    // NULL for a bad record; owned by the stream
+    size_t offset;           // Byte offset of the record's line in the stream
+    size_t length;           // Line length without the line terminator
+    size_t line;             // 1-based line number
+    bjson_error_t error;
+    const char* error_msg;   // Why a bad record failed, NULL otherwise
+} bjson_record_t;
+
+// Receives the records of bjson_parse_records_parallel in input order;
+// return nonzero to stop
+typedef int (*bjson_record_fn)(void* ctx, const bjson_record_t* record);
+
+// Indexed input navigated on demand (bjson_ondemand_parse)
+typedef struct bjson_ondemand bjson_ondemand_t;
+
+// Position of one value in an on-demand document
+typedef struct {
+    bjson_ondemand_t* doc;
+    size_t at;               // Index entry where the value starts
+} bjson_cursor_t;
+
+// Flat immutable document of tagged 64-bit words (bjson_tape_parse)
+typedef struct bjson_tape {
+    uint64_t* words;
+    size_t count;            // Words in use; the root value starts at 0
+    size_t capacity;
+    char* text;              // Length-prefixed text records referenced by the words
+    size_t text_length;
+    size_t text_capacity;
+} bjson_tape_t;
+
+// Returned by bjson_tape_find for a missing key
+#define BJSON_TAPE_NONE ((size_t)-1)
+
 // Function prototypes
 bjson_value_t* bjson_create_value(bjson_type_t type);
+bjson_value_t* bjson_create_value_ext(bjson_type_t type);
 void bjson_free_value(bjson_value_t* value);
+bjson_value_ext_t* bjson_value_ext(const bjson_value_t* value);
+void bjson_value_datetime(const bjson_value_t* value, bjson_datetime_t* datetime);
+int64_t bjson_value_epoch_ms(const bjson_value_t* value);
 bjson_value_t* bjson_parse(const char* input, bjson_error_t* error);
 char* bjson_serialize(bjson_value_t* value, int pretty);
+bjson_error_t bjson_serialize_to(const bjson_value_t* value, int pretty, bjson_write_fn sink, void* ctx);
+uint8_t* bjson_binary_encode(const bjson_value_t* value, size_t* length);
+bjson_document_t* bjson_binary_decode(const uint8_t* data, size_t length, unsigned flags, bjson_error_t* error);
+bjson_document_t* bjson_binary_decode_value(const uint8_t* value, size_t length, unsigned flags, bjson_error_t* error);
+const char* bjson_error_message(void);
+const uint8_t* bjson_binary_object_get(const uint8_t* object, size_t length, const char* key,
+                                       size_t key_length, size_t* value_length);
 bjson_error_t bjson_validate_schema(bjson_value_t* value, bjson_value_t* schema);
 bjson_value_t* bjson_resolve_reference(bjson_parser_t* parser, const char* path);
+bjson_document_t* bjson_parse_document(const char* input, size_t length, unsigned flags, bjson_error_t* error);
+void bjson_document_free(bjson_document_t* doc);
+bjson_document_t* bjson_parse_file(const char* path, unsigned flags, bjson_error_t* error);
+bjson_error_t bjson_parse_sax(const char* input, size_t length, unsigned flags,
+                              const bjson_sax_handler_t* handler, void* ctx);
+bjson_push_parser_t* bjson_push_parser_create(unsigned flags, const bjson_sax_handler_t* handler, void* ctx);
+bjson_error_t bjson_parser_feed(bjson_push_parser_t* parser, const char* chunk, size_t length);
+bjson_error_t bjson_parser_finish(bjson_push_parser_t* parser, bjson_document_t** doc);
+const char* bjson_parser_error_message(const bjson_push_parser_t* parser);
+void bjson_push_parser_free(bjson_push_parser_t* parser);
+bjson_record_stream_t* bjson_record_stream_open(const char* data, size_t length, unsigned flags);
+bjson_record_stream_t* bjson_record_stream_open_fd(int fd, unsigned flags);
+int bjson_record_stream_next(bjson_record_stream_t* stream, bjson_record_t* record);
+void bjson_record_stream_close(bjson_record_stream_t* stream);
+bjson_error_t bjson_parse_records_parallel(const char* data, size_t length, unsigned flags, int threads,
+                                           bjson_record_fn callback, void* ctx);
+bjson_ondemand_t* bjson_ondemand_parse(const char* input, size_t length, unsigned flags, bjson_error_t* error);
+bjson_cursor_t bjson_ondemand_root(bjson_ondemand_t* doc);
+int bjson_cursor_find(const bjson_cursor_t* cursor, const char* key, bjson_cursor_t* out);
+int bjson_cursor_at(const bjson_cursor_t* cursor, size_t i, bjson_cursor_t* out);
+int bjson_cursor_type(const bjson_cursor_t* cursor, bjson_type_t* type);
+bjson_value_t* bjson_cursor_value(const bjson_cursor_t* cursor);
+const char* bjson_ondemand_error_message(const bjson_ondemand_t* doc);
+void bjson_ondemand_free(bjson_ondemand_t* doc);
+bjson_tape_t* bjson_tape_parse(const char* input, size_t length, unsigned flags, bjson_error_t* error);
+bjson_tape_t* bjson_tape_from_value(const bjson_value_t* value);
+bjson_document_t* bjson_tape_to_document(const bjson_tape_t* tape, size_t at, unsigned flags, bjson_error_t* error);
+void bjson_tape_free(bjson_tape_t* tape);
+bjson_type_t bjson_tape_type(const bjson_tape_t* tape, size_t at);
+size_t bjson_tape_next(const bjson_tape_t* tape, size_t at);
+size_t bjson_tape_end(const bjson_tape_t* tape, size_t at);
+size_t bjson_tape_count(const bjson_tape_t* tape, size_t at);
+size_t bjson_tape_find(const bjson_tape_t* tape, size_t object, const char* key, size_t length);
+int bjson_tape_bool(const bjson_tape_t* tape, size_t at);
+long long bjson_tape_int(const bjson_tape_t* tape, size_t at);
+double bjson_tape_double(const bjson_tape_t* tape, size_t at);
+const char* bjson_tape_string(const bjson_tape_t* tape, size_t at, size_t* length);
+bjson_value_t* bjson_object_get(const bjson_value_t* object, const char* key);
+bjson_value_t* bjson_object_get_n(const bjson_value_t* object, const char* key, size_t length);
+bjson_value_t* bjson_object_get_cached(const bjson_value_t* object, const char* key, size_t length,
+                                       bjson_key_cache_t* cache);
+uint64_t bjson_hash_bytes(const char* data, size_t length);
+uint64_t bjson_value_hash(const bjson_value_t* value);
+int bjson_value_equals(const bjson_value_t* a, const bjson_value_t* b);
+int bjson_set_add(bjson_value_t* set, bjson_value_t* value);
+int bjson_set_contains(const bjson_value_t* set, const bjson_value_t* value);
+int bjson_map_put(bjson_value_t* map, bjson_value_t* key, bjson_value_t* value);
+int bjson_regex_match(const bjson_value_t* regex, const char* text);
+int bjson_register_type(const char* name, bjson_type_parse_fn parse, void* user);
+int bjson_register_custom_type(const char* name, const bjson_type_hooks_t* hooks);
+const char* bjson_custom_type_name(unsigned type);
+const uint8_t* bjson_custom_payload(const bjson_value_t* value, size_t* length);
+bjson_value_t* bjson_create_custom_value(const char* name, const void* payload, size_t length);
+void bjson_regex_cache_trim(void);
+bjson_value_t* bjson_map_get(const bjson_value_t* map, const bjson_value_t* key);
+bjson_arena_t* bjson_arena_create(size_t chunk_size);
+void* bjson_arena_alloc(bjson_arena_t* arena, size_t size);
+void* bjson_arena_realloc(bjson_arena_t* arena, void* ptr, size_t old_size, size_t new_size);
+void bjson_arena_reset(bjson_arena_t* arena);
+void bjson_arena_destroy(bjson_arena_t* arena);
 
 // Utility functions
 static void skip_whitespace_and_comments(bjson_parser_t* parser);
-static bjson_value_t* parse_value(bjson_parser_t* parser);
-static bjson_value_t* parse_string(bjson_parser_t* parser);
-static bjson_value_t* parse_number(bjson_parser_t* parser);
-static bjson_value_t* parse_array(bjson_parser_t* parser);
-static bjson_value_t* parse_object(bjson_parser_t* parser);
-static bjson_value_t* parse_extended_type(bjson_parser_t* parser, const char* type_name);
-
-// Create a new Better JSON value
-bjson_value_t* bjson_create_value(bjson_type_t type) {
-    bjson_value_t* value = malloc(sizeof(bjson_value_t));
-    if (!value) return NULL;
+static int parse_value(bjson_parser_t* parser);
+static void release_source(void* data, size_t length, int mapped);
+static int parse_string(bjson_parser_t* parser, int is_key);
+static int parse_number(bjson_parser_t* parser);
+static int parse_array(bjson_parser_t* parser, int is_set);
+static int parse_object(bjson_parser_t* parser, int is_map);
+static int parse_extended_type(bjson_parser_t* parser, const char* name, size_t length);
+static int parse_temporal(bjson_parser_t* parser, bjson_type_t type);
+static int parse_bytes(bjson_parser_t* parser);
+static bjson_value_t* parse_tree(bjson_parser_t* parser);
+static void compute_size_hints(bjson_parser_t* parser);
+static bjson_error_t build_structural_index(bjson_parser_t* parser);
+static int parse_indexed(bjson_parser_t* parser);
+static bjson_intern_t* intern_create(bjson_arena_t* arena);
+static void intern_clear(bjson_intern_t* intern);
+static void intern_destroy(bjson_intern_t* intern);
+static void regex_cache_release(bjson_regex_entry_t* entry);
+
+#define BJSON_ARENA_DEFAULT_CHUNK (64 * 1024)
+#define BJSON_ARENA_MAX_CHUNK (1024 * 1024)
+#define BJSON_ARENA_ALIGN 8  // Every node member is at most 8-byte aligned
+
+// Create an arena whose first chunk holds chunk_size bytes (0 for the default)
+bjson_arena_t* bjson_arena_create(size_t chunk_size) {
+    bjson_arena_t* arena = malloc(sizeof(bjson_arena_t));
+    if (!arena) return NULL;
+    
+    memset(arena, 0, sizeof(bjson_arena_t));
+    arena->chunk_size = chunk_size ? chunk_size : BJSON_ARENA_DEFAULT_CHUNK;
+    return arena;
+}
+
+// Allocate size bytes from the arena; memory is released by bjson_arena_destroy
+void* bjson_arena_alloc(bjson_arena_t* arena, size_t size) {
+    size = (size + BJSON_ARENA_ALIGN - 1) & ~(size_t)(BJSON_ARENA_ALIGN - 1);
+    
+    bjson_arena_chunk_t* chunk = arena->head;
+    if ((!chunk || chunk->size - chunk->used < size) && arena->spare && arena->spare->size >= size) {
+        // Already faulted in by an earlier document
+        chunk = arena->spare;
+        arena->spare = chunk->next;
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+    if (!chunk || chunk->size - chunk->used < size) {
+        // Oversized requests get a dedicated chunk so the current one keeps serving
+        size_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+        chunk = malloc(sizeof(bjson_arena_chunk_t) + chunk_size);
+        if (!chunk) return NULL;
+        
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        if (size > arena->chunk_size && arena->head) {
+            chunk->next = arena->head->next;
+            arena->head->next = chunk;
+        } else {
+            chunk->next = arena->head;
+            arena->head = chunk;
+            // Grow geometrically so large documents need few chunks
+            if (arena->chunk_size < BJSON_ARENA_MAX_CHUNK) {
+                arena->chunk_size *= 2;
+            }
+        }
+        arena->chunk_count++;
+    }
+    
+    void* ptr = (char*)(chunk + 1) + chunk->used;
+    chunk->used += size;
+    arena->bytes_used += size;
+    return ptr;
+}
+
+// Resize an arena allocation; the most recent allocation grows in place,
+// anything else is copied and the old block is abandoned until destroy
+void* bjson_arena_realloc(bjson_arena_t* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (!ptr) return bjson_arena_alloc(arena, new_size);
+    
+    size_t old_aligned = (old_size + BJSON_ARENA_ALIGN - 1) & ~(size_t)(BJSON_ARENA_ALIGN - 1);
+    size_t new_aligned = (new_size + BJSON_ARENA_ALIGN - 1) & ~(size_t)(BJSON_ARENA_ALIGN - 1);
+    bjson_arena_chunk_t* chunk = arena->head;
+    if (chunk && (char*)ptr + old_aligned == (char*)(chunk + 1) + chunk->used &&
+        new_aligned >= old_aligned && chunk->size - chunk->used >= new_aligned - old_aligned) {
+        chunk->used += new_aligned - old_aligned;
+        arena->bytes_used += new_aligned - old_aligned;
+        return ptr;
+    }
+    
+    void* copy = bjson_arena_alloc(arena, new_size);
+    if (copy) memcpy(copy, ptr, old_size < new_size ? old_size : new_size);
+    return copy;
+}
+
+// Drop the regex cache references of the arena's nodes
+static void arena_release_regexes(bjson_arena_t* arena) {
+    for (bjson_regex_ref_t* ref = arena->regexes; ref; ref = ref->next) {
+        regex_cache_release(ref->entry);
+    }
+    arena->regexes = NULL;
+}
+
+// Forget every allocation but keep the regular chunks as spares, so the
+// next document of a similar size needs no malloc and no fresh pages;
+// oversized chunks are released
+void bjson_arena_reset(bjson_arena_t* arena) {
+    arena_release_regexes(arena);
+    bjson_arena_chunk_t* chunk = arena->head;
+    bjson_arena_chunk_t** tail = &arena->spare;
+    while (*tail) tail = &(*tail)->next;
+    
+    while (chunk) {
+        bjson_arena_chunk_t* next = chunk->next;
+        if (chunk->size > BJSON_ARENA_MAX_CHUNK) {
+            free(chunk);
+        } else {
+            chunk->used = 0;
+            chunk->next = NULL;
+            *tail = chunk;
+            tail = &chunk->next;
+        }
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->chunk_count = 0;
+    arena->bytes_used = 0;
+}
+
+// Release every chunk owned by the arena
+void bjson_arena_destroy(bjson_arena_t* arena) {
+    if (!arena) return;
+    
+    arena_release_regexes(arena);
+    bjson_arena_chunk_t* lists[2] = {arena->head, arena->spare};
+    for (int i = 0; i < 2; i++) {
+        bjson_arena_chunk_t* chunk = lists[i];
+        while (chunk) {
+            bjson_arena_chunk_t* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+    }
+    free(arena);
+}
+
+// Allocate a zeroed node from an arena, or the heap when arena is NULL. An
+// extended node gets its extension block in front; objects, sets and maps
+// get their table block
+static bjson_value_t* value_alloc(bjson_arena_t* arena, bjson_type_t type, int extended) {
+    size_t prefix = extended ? sizeof(bjson_value_ext_t) : 0;
+    char* block = arena ? bjson_arena_alloc(arena, prefix + sizeof(bjson_value_t))
+                        : malloc(prefix + sizeof(bjson_value_t));
+    if (!block) return NULL;
     
-    memset(value, 0, sizeof(bjson_value_t));
+    memset(block, 0, prefix + sizeof(bjson_value_t));
+    bjson_value_t* value = (bjson_value_t*)(block + prefix);
     value->type = type;
+    value->flags = (arena ? BJSON_VALUE_ARENA : 0) | (extended ? BJSON_VALUE_EXTENDED : 0);
     
-    switch (type) {
-        case BJSON_ARRAY:
-            value->array_val.capacity = 10;
-            value->array_val.items = malloc(sizeof(bjson_value_t*) * 10);
-            break;
-        case BJSON_OBJECT:
-            value->object_val = malloc(sizeof(bjson_object_t));
-            value->object_val->capacity = 10;
-            value->object_val->pairs = malloc(sizeof(bjson_pair_t) * 10);
-            value->object_val->count = 0;
-            break;
-        case BJSON_SET:
-            value->set_val.capacity = 10;
-            value->set_val.values = malloc(sizeof(bjson_value_t*) * 10);
-            break;
-        case BJSON_MAP:
-            value->map_val.capacity = 10;
-            value->map_val.keys = malloc(sizeof(bjson_value_t*) * 10);
-            value->map_val.values = malloc(sizeof(bjson_value_t*) * 10);
-            break;
-        default:
-            break;
+    size_t table_size = type == BJSON_OBJECT ? sizeof(bjson_object_t)
+                      : type == BJSON_SET ? sizeof(bjson_set_t)
+                      : type == BJSON_MAP ? sizeof(bjson_map_t) : 0;
+    if (!table_size) return value;
+    
+    void* table = arena ? bjson_arena_alloc(arena, table_size) : malloc(table_size);
+    if (!table) {
+        if (!arena) free(block);
+        return NULL;
+    }
+    memset(table, 0, table_size);
+    if (type == BJSON_OBJECT) value->object_val = table;
+    if (type == BJSON_SET) value->set_val = table;
+    if (type == BJSON_MAP) value->map_val = table;
+    return value;
+}
+
+// Create a new Better JSON value; containers start empty and grow on demand.
+// Regexes always carry an extension block for their compiled form
+bjson_value_t* bjson_create_value(bjson_type_t type) {
+    return value_alloc(NULL, type, type == BJSON_REGEX);
+}
+
+// Create a value with an extension block, for metadata or a timezone
+bjson_value_t* bjson_create_value_ext(bjson_type_t type) {
+    return value_alloc(NULL, type, 1);
+}
+
+// Extension block of a node, or NULL when it has none
+bjson_value_ext_t* bjson_value_ext(const bjson_value_t* value) {
+    if (!(value->flags & BJSON_VALUE_EXTENDED)) return NULL;
+    return (bjson_value_ext_t*)((char*)value - sizeof(bjson_value_ext_t));
+}
+
+// Regex cache: one compiled regex_t per distinct pattern and flags for the
+// whole process. Nodes hold counted references to entries, and an entry is
+// compiled on its first match rather than when parsed, so documents that
+// repeat a pattern, or are loaded again and again, compile it once, and
+// documents that are never matched never compile at all. Entries no node
+// references stay compiled for the next document, oldest evicted first
+// beyond BJSON_REGEX_CACHE_IDLE
+
+#define BJSON_REGEX_CACHE_IDLE 256
+
+enum {
+    BJSON_REGEX_PENDING,     // Not compiled yet
+    BJSON_REGEX_COMPILED,
+    BJSON_REGEX_INVALID      // The pattern does not compile
+};
+
+struct bjson_regex_entry {
+    struct bjson_regex_entry* next;       // Bucket chain
+    struct bjson_regex_entry* idle_prev;  // Unreferenced entries, oldest first
+    struct bjson_regex_entry* idle_next;
+    uint64_t hash;
+    size_t refs;
+    int state;               // BJSON_REGEX_*; written under compile_lock
+    pthread_mutex_t compile_lock;
+    regex_t regex;           // Valid once BJSON_REGEX_COMPILED
+    const char* flags;       // Points into key, after the pattern's NUL
+    char key[];              // Pattern, NUL, flags, NUL
+};
+
+static struct {
+    pthread_mutex_t lock;    // Guards everything here but the entries' state
+    bjson_regex_entry_t** buckets;
+    size_t mask;             // Bucket count - 1
+    size_t count;
+    bjson_regex_entry_t* idle_head;
+    bjson_regex_entry_t* idle_tail;
+    size_t idle_count;
+} regex_cache = {PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, NULL, NULL, 0};
+
+static void regex_idle_unlink(bjson_regex_entry_t* entry) {
+    if (entry->idle_prev) entry->idle_prev->idle_next = entry->idle_next;
+    else regex_cache.idle_head = entry->idle_next;
+    if (entry->idle_next) entry->idle_next->idle_prev = entry->idle_prev;
+    else regex_cache.idle_tail = entry->idle_prev;
+    entry->idle_prev = entry->idle_next = NULL;
+    regex_cache.idle_count--;
+}
+
+// Remove an unreferenced entry from the cache and free it
+static void regex_cache_evict(bjson_regex_entry_t* entry) {
+    regex_idle_unlink(entry);
+    bjson_regex_entry_t** link = &regex_cache.buckets[entry->hash & regex_cache.mask];
+    while (*link != entry) link = &(*link)->next;
+    *link = entry->next;
+    regex_cache.count--;
+    
+    if (entry->state == BJSON_REGEX_COMPILED) regfree(&entry->regex);
+    pthread_mutex_destroy(&entry->compile_lock);
+    free(entry);
+}
+
+// Double the bucket array, starting at 64 buckets
+static int regex_cache_grow(void) {
+    size_t buckets = regex_cache.buckets ? (regex_cache.mask + 1) * 2 : 64;
+    bjson_regex_entry_t** table = calloc(buckets, sizeof(bjson_regex_entry_t*));
+    if (!table) return 0;
+    
+    for (size_t i = 0; regex_cache.buckets && i <= regex_cache.mask; i++) {
+        bjson_regex_entry_t* entry = regex_cache.buckets[i];
+        while (entry) {
+            bjson_regex_entry_t* next = entry->next;
+            entry->next = table[entry->hash & (buckets - 1)];
+            table[entry->hash & (buckets - 1)] = entry;
+            entry = next;
+        }
+    }
+    free(regex_cache.buckets);
+    regex_cache.buckets = table;
+    regex_cache.mask = buckets - 1;
+    return 1;
+}
+
+// Take a reference to the entry for a pattern and flags, adding it
+// uncompiled when it is new; NULL without a pattern or memory
+static bjson_regex_entry_t* regex_cache_acquire(const char* pattern, const char* flags) {
+    if (!pattern) return NULL;
+    if (!flags) flags = "";
+    size_t pattern_length = strlen(pattern);
+    size_t flags_length = strlen(flags);
+    uint64_t hash = bjson_hash_bytes(pattern, pattern_length) * 31 + bjson_hash_bytes(flags, flags_length);
+    
+    pthread_mutex_lock(&regex_cache.lock);
+    bjson_regex_entry_t* entry = regex_cache.buckets ? regex_cache.buckets[hash & regex_cache.mask] : NULL;
+    while (entry && (entry->hash != hash || strcmp(entry->key, pattern) != 0 || strcmp(entry->flags, flags) != 0)) {
+        entry = entry->next;
+    }
+    if (entry) {
+        if (entry->refs++ == 0) regex_idle_unlink(entry);
+        pthread_mutex_unlock(&regex_cache.lock);
+        return entry;
+    }
+    
+    if ((!regex_cache.buckets || regex_cache.count > regex_cache.mask) && !regex_cache_grow()) {
+        pthread_mutex_unlock(&regex_cache.lock);
+        return NULL;
+    }
+    entry = malloc(sizeof(bjson_regex_entry_t) + pattern_length + flags_length + 2);
+    if (entry) {
+        memset(entry, 0, sizeof(bjson_regex_entry_t));
+        memcpy(entry->key, pattern, pattern_length + 1);
+        memcpy(entry->key + pattern_length + 1, flags, flags_length + 1);
+        entry->flags = entry->key + pattern_length + 1;
+        entry->hash = hash;
+        entry->refs = 1;
+        pthread_mutex_init(&entry->compile_lock, NULL);
+        entry->next = regex_cache.buckets[hash & regex_cache.mask];
+        regex_cache.buckets[hash & regex_cache.mask] = entry;
+        regex_cache.count++;
+    }
+    pthread_mutex_unlock(&regex_cache.lock);
+    return entry;
+}
+
+// Drop a reference; the last one parks the entry, still compiled, on the
+// idle list, which evicts its oldest entry when full
+static void regex_cache_release(bjson_regex_entry_t* entry) {
+    if (!entry) return;
+    
+    pthread_mutex_lock(&regex_cache.lock);
+    if (--entry->refs == 0) {
+        entry->idle_prev = regex_cache.idle_tail;
+        if (regex_cache.idle_tail) regex_cache.idle_tail->idle_next = entry;
+        else regex_cache.idle_head = entry;
+        regex_cache.idle_tail = entry;
+        if (++regex_cache.idle_count > BJSON_REGEX_CACHE_IDLE) regex_cache_evict(regex_cache.idle_head);
+    }
+    pthread_mutex_unlock(&regex_cache.lock);
+}
+
+// Free every compiled regex no value references any more
+void bjson_regex_cache_trim(void) {
+    pthread_mutex_lock(&regex_cache.lock);
+    while (regex_cache.idle_head) regex_cache_evict(regex_cache.idle_head);
+    pthread_mutex_unlock(&regex_cache.lock);
+}
+
+// Rewrite a JavaScript-style pattern as a POSIX extended one: \d and \D
+// become bracket expressions, class escapes inside brackets become named
+// classes, (?: loses its marker, and escaped delimiters and control
+// characters become the characters themselves. Inside brackets, escaped
+// bytes that POSIX would read as syntax become collating symbols. The C
+// library understands \w, \s, \b and their negations as they are, but a
+// bracket expression has no form for \D, \S or \W: such patterns return
+// NULL with *unsupported set, where NULL alone means out of memory
+static char* regex_translate(const char* pattern, int* unsupported) {
+    char* out = malloc(strlen(pattern) * 10 + 1);  // \w inside brackets grows most
+    if (!out) return NULL;
+    
+    char* o = out;
+    int in_class = 0;
+    for (const char* p = pattern; *p; p++) {
+        if (*p != '\\' || !p[1]) {
+            if (in_class) {
+                in_class = *p != ']';
+            } else if (*p == '[') {
+                in_class = 1;
+            } else if (strncmp(p, "(?:", 3) == 0) {
+                // Nothing is captured, so a plain group does the same
+                p += 2;
+                *o++ = '(';
+                continue;
+            }
+            *o++ = *p;
+            continue;
+        }
+        
+        char c = *++p;
+        if (in_class && (c == 'D' || c == 'S' || c == 'W')) {
+            free(out);
+            if (unsupported) *unsupported = 1;
+            return NULL;
+        }
+        char literal = c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c == 'f' ? '\f' : c == 'v' ? '\v' : 0;
+        if (in_class && c == 'b') literal = '\b';
+        const char* class = in_class ? (c == 'd' ? "0-9" : c == 's' ? "[:space:]" : c == 'w' ? "[:alnum:]_" : NULL)
+                                     : (c == 'd' ? "[0-9]" : c == 'D' ? "[^0-9]" : NULL);
+        if (class) {
+            size_t length = strlen(class);
+            memcpy(o, class, length);
+            o += length;
+        } else if (in_class && (c == ']' || c == '-' || c == '^' || c == '[')) {
+            // [.x.] is the byte itself wherever it stands in the brackets
+            memcpy(o, "[. .]", 5);
+            o[2] = c;
+            o += 5;
+        } else if (literal || in_class || c == '/') {
+            // Brackets take every other byte literally, backslash included
+            *o++ = literal ? literal : c;
+        } else {
+            *o++ = '\\';
+            *o++ = c;
+        }
+    }
+    *o = '\0';
+    return out;
+}
+
+// Compile an entry once; later callers wait for the first and share its result
+static int regex_entry_compile(bjson_regex_entry_t* entry) {
+    pthread_mutex_lock(&entry->compile_lock);
+    int state = entry->state;
+    if (state == BJSON_REGEX_PENDING) {
+        int unsupported = 0;
+        char* translated = regex_translate(entry->key, &unsupported);
+        if (translated) {
+            // g, s, u and y do not change whether a text matches
+            int cflags = REG_EXTENDED | REG_NOSUB;
+            if (strchr(entry->flags, 'i')) cflags |= REG_ICASE;
+            if (strchr(entry->flags, 'm')) cflags |= REG_NEWLINE;
+            state = regcomp(&entry->regex, translated, cflags) == 0 ? BJSON_REGEX_COMPILED : BJSON_REGEX_INVALID;
+            free(translated);
+        } else if (unsupported) {
+            state = BJSON_REGEX_INVALID;
+        }
+        if (state != BJSON_REGEX_PENDING) __atomic_store_n(&entry->state, state, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&entry->compile_lock);
+    return state;
+}
+
+// Match text against a regex value: 1 on a match, 0 on none, and -1 when
+// value is not a regex, its pattern does not compile or memory runs out.
+// Heap values bind to the cache on their first match and arena values when
+// parsed; either way the compiled pattern is shared with every value of the
+// same pattern and flags. Safe to call from several threads at once
+int bjson_regex_match(const bjson_value_t* regex, const char* text) {
+    if (!regex || regex->type != BJSON_REGEX || !text) return -1;
+    bjson_value_ext_t* ext = bjson_value_ext(regex);
+    if (!ext) return -1;
+    
+    bjson_regex_entry_t* entry = __atomic_load_n(&ext->compiled, __ATOMIC_ACQUIRE);
+    if (!entry) {
+        if (regex->flags & BJSON_VALUE_ARENA) return -1;
+        bjson_regex_entry_t* expected = NULL;
+        entry = regex_cache_acquire(regex->regex_val.pattern, regex->regex_val.flags);
+        if (!entry) return -1;
+        if (!__atomic_compare_exchange_n(&ext->compiled, &expected, entry, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            // Another thread bound it first
+            regex_cache_release(entry);
+            entry = expected;
+        }
+    }
+    
+    int state = __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE);
+    if (state == BJSON_REGEX_PENDING) state = regex_entry_compile(entry);
+    if (state != BJSON_REGEX_COMPILED) return -1;
+    return regexec(&entry->regex, text, 0, NULL, 0) == 0;
+}
+
+#define BJSON_MS_PER_DAY 86400000LL
+
+// Days from 1970-01-01 to a proleptic Gregorian date
+static int64_t days_from_civil(const bjson_date_t* date) {
+    int64_t year = (int64_t)date->year - (date->month <= 2);
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (date->month + (date->month > 2 ? -3 : 9)) + 2) / 5 + date->day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// Inverse of days_from_civil
+static void civil_from_days(int64_t days, bjson_date_t* date) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t day_of_era = days - era * 146097;
+    int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int64_t shifted_month = (5 * day_of_year + 2) / 153;  // March is 0
+    date->day = (int)(day_of_year - (153 * shifted_month + 2) / 5 + 1);
+    date->month = (int)(shifted_month < 10 ? shifted_month + 3 : shifted_month - 9);
+    date->year = (int)(year_of_era + era * 400 + (date->month <= 2));
+}
+
+// Pack a datetime into its node form
+static bjson_datetime_packed_t pack_datetime(const bjson_datetime_t* datetime) {
+    bjson_datetime_packed_t packed;
+    int64_t time_of_day = ((datetime->hour * 60 + datetime->minute) * 60 + datetime->second) * 1000LL +
+                          datetime->millisecond;
+    packed.epoch_ms = days_from_civil(&datetime->date) * BJSON_MS_PER_DAY + time_of_day;
+    packed.offset_minutes = datetime->offset_minutes;
+    if (datetime->offset_minutes != BJSON_OFFSET_NONE) packed.epoch_ms -= datetime->offset_minutes * 60000LL;
+    return packed;
+}
+
+// Fields of a packed datetime in its own offset; timezone is not copied
+static void unpack_datetime(const bjson_datetime_packed_t* packed, char* timezone, bjson_datetime_t* datetime) {
+    int64_t local = packed->epoch_ms;
+    if (packed->offset_minutes != BJSON_OFFSET_NONE) local += packed->offset_minutes * 60000LL;
+    int64_t days = local / BJSON_MS_PER_DAY;
+    int64_t ms = local % BJSON_MS_PER_DAY;
+    if (ms < 0) {
+        days--;
+        ms += BJSON_MS_PER_DAY;
+    }
+    civil_from_days(days, &datetime->date);
+    datetime->millisecond = (int)(ms % 1000);
+    datetime->second = (int)(ms / 1000 % 60);
+    datetime->minute = (int)(ms / 60000 % 60);
+    datetime->hour = (int)(ms / 3600000);
+    datetime->timezone = timezone;
+    datetime->offset_minutes = packed->offset_minutes;
+}
+
+// Unpack a BJSON_DATETIME node; the timezone points into the node
+void bjson_value_datetime(const bjson_value_t* value, bjson_datetime_t* datetime) {
+    const bjson_value_ext_t* ext = bjson_value_ext(value);
+    unpack_datetime(&value->datetime_val, ext ? ext->timezone : NULL, datetime);
+}
+
+// Milliseconds since 1970-01-01T00:00:00Z of a BJSON_DATETIME, or of the
+// midnight UTC starting a BJSON_DATE, for ordering both on one timeline
+// without unpacking; 0 for other types
+int64_t bjson_value_epoch_ms(const bjson_value_t* value) {
+    if (value->type == BJSON_DATETIME) return value->datetime_val.epoch_ms;
+    if (value->type == BJSON_DATE) return days_from_civil(&value->date_val) * BJSON_MS_PER_DAY;
+    return 0;
+}
+
+// Allocate from the parser's arena, or the heap when not in arena mode
+static void* parser_alloc(bjson_parser_t* parser, size_t size) {
+    if (parser->arena) return bjson_arena_alloc(parser->arena, size);
+    return malloc(size);
+}
+
+static char* parser_strdup(bjson_parser_t* parser, const char* str) {
+    size_t len = strlen(str);
+    char* copy = parser_alloc(parser, len + 1);
+    if (copy) memcpy(copy, str, len + 1);
+    return copy;
+}
+
+// Create a value owned by the parser's allocation source
+static bjson_value_t* parser_create_value(bjson_parser_t* parser, bjson_type_t type) {
+    return value_alloc(parser->arena, type, type == BJSON_REGEX);
+}
+
+// The same with an extension block
+static bjson_value_t* parser_create_extended(bjson_parser_t* parser, bjson_type_t type) {
+    return value_alloc(parser->arena, type, 1);
+}
+
+// Bind a regex node of the parser's arena to its cache entry, which the arena
+// releases with the document; heap nodes bind on their first match instead
+static int parser_bind_regex(bjson_parser_t* parser, bjson_value_t* node) {
+    if (!parser->arena) return 1;
+    
+    bjson_regex_ref_t* ref = bjson_arena_alloc(parser->arena, sizeof(bjson_regex_ref_t));
+    if (!ref) return 0;
+    ref->entry = regex_cache_acquire(node->regex_val.pattern, node->regex_val.flags);
+    if (!ref->entry) return 0;
+    ref->next = parser->arena->regexes;
+    parser->arena->regexes = ref;
+    bjson_value_ext(node)->compiled = ref->entry;
+    return 1;
+}
+
+// Resize a container buffer from an arena, or the heap when arena is NULL
+static void* container_realloc(bjson_arena_t* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (arena) return bjson_arena_realloc(arena, ptr, old_size, new_size);
+    return realloc(ptr, new_size);
+}
+
+static void* parser_realloc(bjson_parser_t* parser, void* ptr, size_t old_size, size_t new_size) {
+    return container_realloc(parser->arena, ptr, old_size, new_size);
+}
+
+// Capacity for a container that must hold at least needed entries: doubles
+// so n appends cost O(n), and starts small for the many 1-2 entry containers
+static size_t grow_capacity(size_t capacity, size_t needed) {
+    size_t grown = capacity ? capacity * 2 : 4;
+    return grown > needed ? grown : needed;
+}
+
+// Custom extended types, in an open-addressing table with at least half of
+// its slots free. Slots are filled under the lock and published by their
+// parse member, so parsers look names up without locking. A slot never
+// changes once filled, and its index is the type of BJSON_CUSTOM values
+#define BJSON_CUSTOM_TYPE_SLOTS 128
+
+typedef struct {
+    char name[BJSON_TYPE_NAME_MAX + 1];
+    size_t length;
+    bjson_type_parse_fn parse;  // NULL while the slot is free
+    void* user;
+    bjson_type_hooks_t hooks;   // Value types (bjson_register_custom_type); parse is NULL otherwise
+} bjson_custom_type_t;
+
+static bjson_custom_type_t custom_types[BJSON_CUSTOM_TYPE_SLOTS];
+static size_t custom_type_count;
+static pthread_mutex_t custom_types_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Registered type named by the length bytes at name, or NULL
+static const bjson_custom_type_t* custom_type_find(const char* name, size_t length) {
+    size_t slot = bjson_hash_bytes(name, length) & (BJSON_CUSTOM_TYPE_SLOTS - 1);
+    while (__atomic_load_n(&custom_types[slot].parse, __ATOMIC_ACQUIRE)) {
+        const bjson_custom_type_t* type = &custom_types[slot];
+        if (type->length == length && memcmp(type->name, name, length) == 0) return type;
+        slot = (slot + 1) & (BJSON_CUSTOM_TYPE_SLOTS - 1);
+    }
+    return NULL;
+}
+
+// Name a BJSON_CUSTOM type was registered under, or NULL for another type
+const char* bjson_custom_type_name(unsigned type) {
+    if (type >= BJSON_CUSTOM_TYPE_SLOTS || !__atomic_load_n(&custom_types[type].parse, __ATOMIC_ACQUIRE)) {
+        return NULL;
     }
+    return custom_types[type].hooks.parse ? custom_types[type].name : NULL;
+}
+
+// Payload of a BJSON_CUSTOM value, or NULL for any other value
+const uint8_t* bjson_custom_payload(const bjson_value_t* value, size_t* length) {
+    if (!value || value->type != BJSON_CUSTOM) return NULL;
+    if (length) *length = value->custom_length;
+    return value->custom_length > BJSON_CUSTOM_INLINE ? value->custom_data : value->custom_inline;
+}
+
+// Custom value from an arena, or the heap when arena is NULL; the payload
+// goes into the node when it fits
+static bjson_value_t* custom_value_alloc(bjson_arena_t* arena, unsigned type, const uint8_t* payload,
+                                         size_t length) {
+    if (length > UINT32_MAX) return NULL;
+    bjson_value_t* value = value_alloc(arena, BJSON_CUSTOM, 0);
+    if (!value) return NULL;
     
+    value->custom_type = (uint16_t)type;
+    value->custom_length = (uint32_t)length;
+    uint8_t* out = value->custom_inline;
+    if (length > BJSON_CUSTOM_INLINE) {
+        out = arena ? bjson_arena_alloc(arena, length) : malloc(length);
+        if (!out) {
+            if (!arena) free(value);
+            return NULL;
+        }
+        value->custom_data = out;
+    }
+    if (length) memcpy(out, payload, length);
     return value;
 }
 
+// Create a value of the custom type registered as name, holding a copy of
+// payload; NULL when name is not a custom value type
+bjson_value_t* bjson_create_custom_value(const char* name, const void* payload, size_t length) {
+    const bjson_custom_type_t* type = name ? custom_type_find(name, strlen(name)) : NULL;
+    if (!type || !type->hooks.parse) return NULL;
+    return custom_value_alloc(NULL, (unsigned)(type - custom_types), payload, length);
+}
+
 // Free Better JSON value and all its contents
 void bjson_free_value(bjson_value_t* value) {
     if (!value) return;
+    // Arena nodes are released all at once by bjson_document_free, and
+    // interned keys with their intern table
+    if (value->flags & (BJSON_VALUE_ARENA | BJSON_VALUE_SHARED)) return;
     
     switch (value->type) {
         case BJSON_STRING:
-            free(value->string_val);
+        case BJSON_DECIMAL:
+            if (!(value->flags & BJSON_VALUE_BORROWED)) {
+                free(value->string_val.data);
+            }
             break;
         case BJSON_ARRAY:
             for (size_t i = 0; i < value->array_val.count; i++) {
@@ -207,84 +1171,444 @@ void bjson_free_value(bjson_value_t* value) {
             break;
         case BJSON_OBJECT:
             for (size_t i = 0; i < value->object_val->count; i++) {
-                bjson_free_value(value->object_val->pairs[i].key);
-                bjson_free_value(value->object_val->pairs[i].value);
+                bjson_free_value(value->object_val->keys[i]);
+                bjson_free_value(value->object_val->values[i]);
+            }
+            if (value->object_val->shape) {
+                free(value->object_val->values);
+            } else {
+                free(value->object_val->keys);
+                free(value->object_val->index);
             }
-            free(value->object_val->pairs);
             free(value->object_val);
             break;
         case BJSON_BYTES:
             free(value->bytes_val.data);
             break;
+        case BJSON_CUSTOM:
+            if (value->custom_length > BJSON_CUSTOM_INLINE) free(value->custom_data);
+            break;
         case BJSON_SET:
-            for (size_t i = 0; i < value->set_val.count; i++) {
-                bjson_free_value(value->set_val.values[i]);
+            for (size_t i = 0; i < value->set_val->count; i++) {
+                bjson_free_value(value->set_val->values[i]);
             }
-            free(value->set_val.values);
+            free(value->set_val->values);
+            free(value->set_val->index);
+            free(value->set_val);
             break;
         case BJSON_MAP:
-            for (size_t i = 0; i < value->map_val.count; i++) {
-                bjson_free_value(value->map_val.keys[i]);
-                bjson_free_value(value->map_val.values[i]);
+            for (size_t i = 0; i < value->map_val->count; i++) {
+                bjson_free_value(value->map_val->keys[i]);
+                bjson_free_value(value->map_val->values[i]);
             }
-            free(value->map_val.keys);
-            free(value->map_val.values);
+            free(value->map_val->keys);
+            free(value->map_val->values);
+            free(value->map_val->index);
+            free(value->map_val);
             break;
         case BJSON_REGEX:
             free(value->regex_val.pattern);
             free(value->regex_val.flags);
-            if (value->regex_val.is_compiled) {
-                regfree(&value->regex_val.compiled);
-            }
             break;
         case BJSON_REFERENCE:
             free(value->ref_val.path);
             break;
-        case BJSON_DATETIME:
-            free(value->datetime_val.timezone);
-            break;
         default:
             break;
     }
     
-    free(value->type_hint);
-    free(value->comment);
-    free(value->id);
-    free(value);
+    bjson_value_ext_t* ext = bjson_value_ext(value);
+    if (!ext) {
+        free(value);
+        return;
+    }
+    free(ext->type_hint);
+    free(ext->comment);
+    free(ext->id);
+    free(ext->timezone);
+    if (ext->compiled) regex_cache_release(ext->compiled);
+    free(ext);
 }
 
-// Skip whitespace and comments
-static void skip_whitespace_and_comments(bjson_parser_t* parser) {
-    while (parser->pos < parser->length) {
-        char c = parser->input[parser->pos];
-        
-        if (isspace(c)) {
-            if (c == '\n') {
-                parser->line++;
-                parser->column = 1;
-            } else {
-                parser->column++;
-            }
-            parser->pos++;
-        } else if (c == '/' && parser->pos + 1 < parser->length) {
-            if (parser->input[parser->pos + 1] == '/') {
-                // Single-line comment
-                parser->pos += 2;
-                while (parser->pos < parser->length && parser->input[parser->pos] != '\n') {
-                    parser->pos++;
-                }
-            } else if (parser->input[parser->pos + 1] == '*') {
-                // Multi-line comment
-                parser->pos += 2;
-                while (parser->pos + 1 < parser->length) {
-                    if (parser->input[parser->pos] == '*' && parser->input[parser->pos + 1] == '/') {
-                        parser->pos += 2;
-                        break;
-                    }
-                    if (parser->input[parser->pos] == '\n') {
-                        parser->line++;
-                        parser->column = 1;
-                    } else {
+// Structural hashing and equality
+
+static inline uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    return h ^ (h >> 33);
+}
+
+static inline uint64_t hash_combine(uint64_t seed, uint64_t h) {
+    return hash_mix(seed ^ (h + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2)));
+}
+
+// Hash of a string key as cached in string_hash
+static inline uint32_t key_hash(const char* data, size_t length) {
+    return (uint32_t)bjson_hash_bytes(data, length);
+}
+
+static uint64_t cstring_hash(const char* str) {
+    return str ? bjson_hash_bytes(str, strlen(str)) : 0;
+}
+
+static int cstring_equal(const char* a, const char* b) {
+    if (!a || !b) return a == b;
+    return strcmp(a, b) == 0;
+}
+
+// Structural hash consistent with bjson_value_equals: arrays and objects hash
+// in order, sets and maps as unordered collections
+uint64_t bjson_value_hash(const bjson_value_t* value) {
+    uint64_t h = hash_mix((uint64_t)value->type + 1);
+    
+    switch (value->type) {
+        case BJSON_NULL:
+            break;
+        case BJSON_BOOL:
+            h = hash_combine(h, value->bool_val != 0);
+            break;
+        case BJSON_INT:
+            h = hash_combine(h, (uint64_t)value->int_val);
+            break;
+        case BJSON_DOUBLE: {
+            // -0.0 == 0.0, so both must hash alike
+            double d = value->double_val == 0.0 ? 0.0 : value->double_val;
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            h = hash_combine(h, bits);
+            break;
+        }
+        case BJSON_STRING:
+        case BJSON_DECIMAL:
+            h = hash_combine(h, (value->flags & BJSON_VALUE_HASHED) ? value->string_hash
+                                : key_hash(value->string_val.data, value->string_val.length));
+            break;
+        case BJSON_ARRAY:
+            for (size_t i = 0; i < value->array_val.count; i++) {
+                h = hash_combine(h, bjson_value_hash(value->array_val.items[i]));
+            }
+            break;
+        case BJSON_OBJECT:
+            for (size_t i = 0; i < value->object_val->count; i++) {
+                h = hash_combine(h, bjson_value_hash(value->object_val->keys[i]));
+                h = hash_combine(h, bjson_value_hash(value->object_val->values[i]));
+            }
+            break;
+        case BJSON_SET: {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < value->set_val->count; i++) {
+                sum += hash_mix(bjson_value_hash(value->set_val->values[i]));
+            }
+            h = hash_combine(h, sum);
+            break;
+        }
+        case BJSON_MAP: {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < value->map_val->count; i++) {
+                sum += hash_combine(bjson_value_hash(value->map_val->keys[i]),
+                                    bjson_value_hash(value->map_val->values[i]));
+            }
+            h = hash_combine(h, sum);
+            break;
+        }
+        case BJSON_DATE:
+            h = hash_combine(h, (uint64_t)value->date_val.year * 10000 +
+                                value->date_val.month * 100 + value->date_val.day);
+            break;
+        case BJSON_DATETIME: {
+            const bjson_value_ext_t* ext = bjson_value_ext(value);
+            h = hash_combine(h, (uint64_t)value->datetime_val.epoch_ms);
+            h = hash_combine(h, (uint64_t)(uint32_t)value->datetime_val.offset_minutes);
+            h = hash_combine(h, cstring_hash(ext ? ext->timezone : NULL));
+            break;
+        }
+        case BJSON_DURATION:
+            h = hash_combine(h, (uint64_t)value->duration_val.milliseconds);
+            h = hash_combine(h, (uint64_t)(uint32_t)value->duration_val.months);
+            break;
+        case BJSON_BYTES:
+            h = hash_combine(h, bjson_hash_bytes((const char*)value->bytes_val.data, value->bytes_val.length));
+            break;
+        case BJSON_REGEX:
+            h = hash_combine(h, cstring_hash(value->regex_val.pattern));
+            h = hash_combine(h, cstring_hash(value->regex_val.flags));
+            break;
+        case BJSON_REFERENCE:
+            h = hash_combine(h, cstring_hash(value->ref_val.path));
+            break;
+        case BJSON_CUSTOM: {
+            const bjson_type_hooks_t* hooks = &custom_types[value->custom_type].hooks;
+            size_t length;
+            const uint8_t* payload = bjson_custom_payload(value, &length);
+            h = hash_combine(h, value->custom_type);
+            h = hash_combine(h, hooks->hash ? hooks->hash(hooks->user, payload, length)
+                                            : bjson_hash_bytes((const char*)payload, length));
+            break;
+        }
+    }
+    
+    return h;
+}
+
+static long hash_index_find(const uint64_t* index, size_t mask, bjson_value_t* const* entries,
+                            const bjson_value_t* key, uint64_t hash, size_t* insert_slot);
+
+// Structural equality: same type and contents, recursively. Arrays and
+// objects compare in order; sets and maps as unordered collections.
+int bjson_value_equals(const bjson_value_t* a, const bjson_value_t* b) {
+    if (a == b) return 1;
+    if (!a || !b || a->type != b->type) return 0;
+    
+    switch (a->type) {
+        case BJSON_NULL:
+            return 1;
+        case BJSON_BOOL:
+            return (a->bool_val != 0) == (b->bool_val != 0);
+        case BJSON_INT:
+            return a->int_val == b->int_val;
+        case BJSON_DOUBLE:
+            // Bitwise match lets a NaN equal itself
+            return a->double_val == b->double_val ||
+                   memcmp(&a->double_val, &b->double_val, sizeof(double)) == 0;
+        case BJSON_STRING:
+        case BJSON_DECIMAL:
+            if (a->string_val.length != b->string_val.length) return 0;
+            if ((a->flags & b->flags & BJSON_VALUE_HASHED) && a->string_hash != b->string_hash) return 0;
+            return memcmp(a->string_val.data, b->string_val.data, a->string_val.length) == 0;
+        case BJSON_ARRAY:
+            if (a->array_val.count != b->array_val.count) return 0;
+            for (size_t i = 0; i < a->array_val.count; i++) {
+                if (!bjson_value_equals(a->array_val.items[i], b->array_val.items[i])) return 0;
+            }
+            return 1;
+        case BJSON_OBJECT:
+            if (a->object_val->count != b->object_val->count) return 0;
+            for (size_t i = 0; i < a->object_val->count; i++) {
+                if (!bjson_value_equals(a->object_val->keys[i], b->object_val->keys[i]) ||
+                    !bjson_value_equals(a->object_val->values[i], b->object_val->values[i])) {
+                    return 0;
+                }
+            }
+            return 1;
+        case BJSON_SET:
+            if (a->set_val->count != b->set_val->count) return 0;
+            for (size_t i = 0; i < a->set_val->count; i++) {
+                if (!bjson_set_contains(b, a->set_val->values[i])) return 0;
+            }
+            return 1;
+        case BJSON_MAP:
+            if (a->map_val->count != b->map_val->count) return 0;
+            for (size_t i = 0; i < a->map_val->count; i++) {
+                const bjson_value_t* other = bjson_map_get(b, a->map_val->keys[i]);
+                if (!other || !bjson_value_equals(a->map_val->values[i], other)) return 0;
+            }
+            return 1;
+        case BJSON_DATE:
+            return a->date_val.year == b->date_val.year && a->date_val.month == b->date_val.month &&
+                   a->date_val.day == b->date_val.day;
+        case BJSON_DATETIME: {
+            const bjson_value_ext_t* xe = bjson_value_ext(a);
+            const bjson_value_ext_t* ye = bjson_value_ext(b);
+            return a->datetime_val.epoch_ms == b->datetime_val.epoch_ms &&
+                   a->datetime_val.offset_minutes == b->datetime_val.offset_minutes &&
+                   cstring_equal(xe ? xe->timezone : NULL, ye ? ye->timezone : NULL);
+        }
+        case BJSON_DURATION:
+            return a->duration_val.milliseconds == b->duration_val.milliseconds &&
+                   a->duration_val.months == b->duration_val.months;
+        case BJSON_BYTES:
+            return a->bytes_val.length == b->bytes_val.length &&
+                   (a->bytes_val.length == 0 ||
+                    memcmp(a->bytes_val.data, b->bytes_val.data, a->bytes_val.length) == 0);
+        case BJSON_REGEX:
+            return cstring_equal(a->regex_val.pattern, b->regex_val.pattern) &&
+                   cstring_equal(a->regex_val.flags, b->regex_val.flags);
+        case BJSON_REFERENCE:
+            return cstring_equal(a->ref_val.path, b->ref_val.path);
+        case BJSON_CUSTOM: {
+            const bjson_type_hooks_t* hooks = &custom_types[a->custom_type].hooks;
+            size_t a_length = 0, b_length = 0;
+            const uint8_t* x = bjson_custom_payload(a, &a_length);
+            const uint8_t* y = bjson_custom_payload(b, &b_length);
+            if (a->custom_type != b->custom_type) return 0;
+            if (hooks->equals) return hooks->equals(hooks->user, x, a_length, y, b_length) != 0;
+            return a_length == b_length && (a_length == 0 || memcmp(x, y, a_length) == 0);
+        }
+    }
+    
+    return 0;
+}
+
+// Probe a set/map index for an entry equal to key; returns the entry position
+// or -1, with the empty slot ending the probe chain in *insert_slot
+static long hash_index_find(const uint64_t* index, size_t mask, bjson_value_t* const* entries,
+                            const bjson_value_t* key, uint64_t hash, size_t* insert_slot) {
+    const uint64_t tag = hash & 0xFFFFFFFF00000000ULL;
+    size_t slot = (size_t)hash & mask;
+    
+    while (index[slot]) {
+        if ((index[slot] & 0xFFFFFFFF00000000ULL) == tag) {
+            size_t entry = (size_t)(index[slot] & 0xFFFFFFFFULL) - 1;
+            if (bjson_value_equals(entries[entry], key)) return (long)entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    if (insert_slot) *insert_slot = slot;
+    return -1;
+}
+
+// Replace a set/map index with one sized for capacity entries at a load
+// factor of at most 1/2, re-inserting the existing entries
+static int rebuild_hash_index(bjson_arena_t* arena, bjson_value_t* const* entries, size_t count,
+                              size_t capacity, uint64_t** index, size_t* mask) {
+    size_t slots = 1;
+    while (slots < capacity * 2) slots <<= 1;
+    
+    uint64_t* fresh = arena ? bjson_arena_alloc(arena, sizeof(uint64_t) * slots)
+                            : malloc(sizeof(uint64_t) * slots);
+    if (!fresh) return 0;
+    memset(fresh, 0, sizeof(uint64_t) * slots);
+    
+    for (size_t i = 0; i < count; i++) {
+        uint64_t hash = bjson_value_hash(entries[i]);
+        size_t slot = (size_t)hash & (slots - 1);
+        while (fresh[slot]) slot = (slot + 1) & (slots - 1);
+        fresh[slot] = (hash & 0xFFFFFFFF00000000ULL) | (uint64_t)(i + 1);
+    }
+    
+    if (!arena) free(*index);
+    *index = fresh;
+    *mask = slots - 1;
+    return 1;
+}
+
+// Add value unless an equal one is present: 1 added, 0 duplicate, -1 out of memory
+static int set_insert(bjson_arena_t* arena, bjson_set_t* set, bjson_value_t* value) {
+    if (set->count == set->capacity) {
+        size_t capacity = grow_capacity(set->capacity, set->count + 1);
+        bjson_value_t** values = container_realloc(arena, set->values,
+                                                   sizeof(bjson_value_t*) * set->capacity,
+                                                   sizeof(bjson_value_t*) * capacity);
+        if (!values) return -1;
+        set->values = values;
+        set->capacity = capacity;
+        if (!rebuild_hash_index(arena, set->values, set->count, capacity, &set->index, &set->index_mask)) {
+            return -1;
+        }
+    }
+    
+    uint64_t hash = bjson_value_hash(value);
+    size_t slot;
+    if (hash_index_find(set->index, set->index_mask, set->values, value, hash, &slot) >= 0) return 0;
+    
+    set->values[set->count++] = value;
+    set->index[slot] = (hash & 0xFFFFFFFF00000000ULL) | (uint64_t)set->count;
+    return 1;
+}
+
+// Insert or replace: 1 new key, 0 replaced (the map keeps its key and frees
+// the old value and the passed key), -1 out of memory
+static int map_insert(bjson_arena_t* arena, bjson_map_t* map, bjson_value_t* key, bjson_value_t* value) {
+    if (map->count == map->capacity) {
+        size_t capacity = grow_capacity(map->capacity, map->count + 1);
+        bjson_value_t** keys = container_realloc(arena, map->keys,
+                                                 sizeof(bjson_value_t*) * map->capacity,
+                                                 sizeof(bjson_value_t*) * capacity);
+        if (!keys) return -1;
+        map->keys = keys;
+        bjson_value_t** values = container_realloc(arena, map->values,
+                                                   sizeof(bjson_value_t*) * map->capacity,
+                                                   sizeof(bjson_value_t*) * capacity);
+        if (!values) return -1;
+        map->values = values;
+        map->capacity = capacity;
+        if (!rebuild_hash_index(arena, map->keys, map->count, capacity, &map->index, &map->index_mask)) {
+            return -1;
+        }
+    }
+    
+    uint64_t hash = bjson_value_hash(key);
+    size_t slot;
+    long existing = hash_index_find(map->index, map->index_mask, map->keys, key, hash, &slot);
+    if (existing >= 0) {
+        bjson_free_value(map->values[existing]);
+        bjson_free_value(key);
+        map->values[existing] = value;
+        return 0;
+    }
+    
+    map->keys[map->count] = key;
+    map->values[map->count++] = value;
+    map->index[slot] = (hash & 0xFFFFFFFF00000000ULL) | (uint64_t)map->count;
+    return 1;
+}
+
+// Add a value to a heap-allocated set, taking ownership when it is added:
+// 1 added, 0 an equal value was already present, -1 on error
+int bjson_set_add(bjson_value_t* set, bjson_value_t* value) {
+    if (!set || !value || set->type != BJSON_SET || (set->flags & BJSON_VALUE_ARENA)) return -1;
+    return set_insert(NULL, set->set_val, value);
+}
+
+// Membership test in O(1) expected time
+int bjson_set_contains(const bjson_value_t* set, const bjson_value_t* value) {
+    if (!set || !value || set->type != BJSON_SET || !set->set_val->count) return 0;
+    
+    const bjson_set_t* s = set->set_val;
+    return hash_index_find(s->index, s->index_mask, s->values, value, bjson_value_hash(value), NULL) >= 0;
+}
+
+// Insert or replace in a heap-allocated map, taking ownership of key and
+// value: 1 new key, 0 replaced an existing value, -1 on error
+int bjson_map_put(bjson_value_t* map, bjson_value_t* key, bjson_value_t* value) {
+    if (!map || !key || !value || map->type != BJSON_MAP || (map->flags & BJSON_VALUE_ARENA)) return -1;
+    return map_insert(NULL, map->map_val, key, value);
+}
+
+// Look up the value stored under a structurally equal key
+bjson_value_t* bjson_map_get(const bjson_value_t* map, const bjson_value_t* key) {
+    if (!map || !key || map->type != BJSON_MAP || !map->map_val->count) return NULL;
+    
+    const bjson_map_t* m = map->map_val;
+    long entry = hash_index_find(m->index, m->index_mask, m->keys, key, bjson_value_hash(key), NULL);
+    return entry >= 0 ? m->values[entry] : NULL;
+}
+
+// Skip whitespace and comments one byte at a time (portable fallback)
+static void skip_whitespace_and_comments_scalar(bjson_parser_t* parser) {
+    while (parser->pos < parser->length) {
+        char c = parser->input[parser->pos];
+        
+        if (isspace(c)) {
+            if (c == '\n') {
+                parser->line++;
+                parser->column = 1;
+            } else {
+                parser->column++;
+            }
+            parser->pos++;
+        } else if (c == '/' && parser->pos + 1 < parser->length) {
+            if (parser->input[parser->pos + 1] == '/') {
+                // Single-line comment
+                parser->pos += 2;
+                while (parser->pos < parser->length && parser->input[parser->pos] != '\n') {
+                    parser->pos++;
+                }
+            } else if (parser->input[parser->pos + 1] == '*') {
+                // Multi-line comment
+                parser->pos += 2;
+                while (parser->pos + 1 < parser->length) {
+                    if (parser->input[parser->pos] == '*' && parser->input[parser->pos + 1] == '/') {
+                        parser->pos += 2;
+                        break;
+                    }
+                    if (parser->input[parser->pos] == '\n') {
+                        parser->line++;
+                        parser->column = 1;
+                    } else {
                         parser->column++;
                     }
                     parser->pos++;
@@ -292,393 +1616,9169 @@ static void skip_whitespace_and_comments(bjson_parser_t* parser) {
             } else {
                 break;
             }
-        } else {
+        } else {
+            break;
+        }
+    }
+}
+
+#if BJSON_X86_SIMD
+
+// SIMD levels, detected once at runtime
+enum {
+    BJSON_SIMD_SSE2 = 1,  // Baseline on x86-64
+    BJSON_SIMD_SSSE3 = 2,
+    BJSON_SIMD_AVX2 = 3
+};
+
+static int bjson_simd_level(void) {
+    static int level = 0;
+    int current = __atomic_load_n(&level, __ATOMIC_RELAXED);
+    if (!current) {
+        __builtin_cpu_init();
+        current = __builtin_cpu_supports("avx2") ? BJSON_SIMD_AVX2 :
+                  __builtin_cpu_supports("ssse3") ? BJSON_SIMD_SSSE3 : BJSON_SIMD_SSE2;
+        __atomic_store_n(&level, current, __ATOMIC_RELAXED);
+    }
+    return current;
+}
+
+// Advance line/column over a span of count bytes whose newlines are in nl_mask,
+// matching the scalar rule: '\n' resets the column to 1, anything else adds 1
+static inline void advance_position(uint32_t nl_mask, unsigned count, int* line, int* column) {
+    if (nl_mask) {
+        *line += __builtin_popcount(nl_mask);
+        *column = (int)(count - (31 - __builtin_clz(nl_mask)));
+    } else {
+        *column += (int)count;
+    }
+}
+
+// Bytes accepted by isspace() in the C locale: '\t' '\n' '\v' '\f' '\r' ' '
+static inline uint32_t whitespace_mask_sse2(__m128i block) {
+    __m128i ctrl = _mm_subs_epu8(_mm_sub_epi8(block, _mm_set1_epi8('\t')), _mm_set1_epi8('\r' - '\t'));
+    __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(ctrl, _mm_setzero_si128()),
+                              _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+    return (uint32_t)_mm_movemask_epi8(ws);
+}
+
+// Length of the whitespace run at p, updating line/column
+static size_t scan_whitespace_sse2(const char* p, size_t n, int* line, int* column) {
+    size_t i = 0;
+    while (i + 16 <= n) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+        uint32_t other = ~whitespace_mask_sse2(block) & 0xFFFF;
+        unsigned run = other ? (unsigned)__builtin_ctz(other) : 16;
+        uint32_t nl = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+        advance_position(nl & ((1u << run) - 1), run, line, column);
+        i += run;
+        if (run < 16) return i;
+    }
+    while (i < n && isspace(p[i])) {
+        advance_position(p[i] == '\n', 1, line, column);
+        i++;
+    }
+    return i;
+}
+
+// Bytes consumed by a block comment body starting at p, including the closing
+// "*/"; an unterminated comment stops before its last byte like the scalar loop
+static size_t scan_block_comment_sse2(const char* p, size_t n, int* line, int* column) {
+    size_t i = 0;
+    while (i + 17 <= n) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i next = _mm_loadu_si128((const __m128i*)(p + i + 1));
+        uint32_t end = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('*')),
+                                                                 _mm_cmpeq_epi8(next, _mm_set1_epi8('/'))));
+        uint32_t nl = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+        if (end) {
+            unsigned k = (unsigned)__builtin_ctz(end);
+            advance_position(nl & ((1u << k) - 1), k, line, column);
+            return i + k + 2;
+        }
+        advance_position(nl, 16, line, column);
+        i += 16;
+    }
+    while (i + 1 < n) {
+        if (p[i] == '*' && p[i + 1] == '/') return i + 2;
+        advance_position(p[i] == '\n', 1, line, column);
+        i++;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t whitespace_mask_avx2(__m256i block) {
+    __m256i ctrl = _mm256_subs_epu8(_mm256_sub_epi8(block, _mm256_set1_epi8('\t')), _mm256_set1_epi8('\r' - '\t'));
+    __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(ctrl, _mm256_setzero_si256()),
+                                 _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')));
+    return (uint32_t)_mm256_movemask_epi8(ws);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t scan_whitespace_avx2(const char* p, size_t n, int* line, int* column) {
+    size_t i = 0;
+    while (i + 32 <= n) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(p + i));
+        uint32_t other = ~whitespace_mask_avx2(block);
+        unsigned run = other ? (unsigned)__builtin_ctz(other) : 32;
+        uint32_t nl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+        advance_position(run < 32 ? nl & ((1u << run) - 1) : nl, run, line, column);
+        i += run;
+        if (run < 32) return i;
+    }
+    // The SSE2 tail uses legacy encodings: clear the upper ymm state first,
+    // which the compiler does not do for us ahead of the call
+    _mm256_zeroupper();
+    return i + scan_whitespace_sse2(p + i, n - i, line, column);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t scan_block_comment_avx2(const char* p, size_t n, int* line, int* column) {
+    size_t i = 0;
+    while (i + 33 <= n) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i next = _mm256_loadu_si256((const __m256i*)(p + i + 1));
+        uint32_t end = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('*')),
+                                                                       _mm256_cmpeq_epi8(next, _mm256_set1_epi8('/'))));
+        uint32_t nl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+        if (end) {
+            unsigned k = (unsigned)__builtin_ctz(end);
+            advance_position(nl & ((1u << k) - 1), k, line, column);
+            return i + k + 2;
+        }
+        advance_position(nl, 32, line, column);
+        i += 32;
+    }
+    _mm256_zeroupper();
+    return i + scan_block_comment_sse2(p + i, n - i, line, column);
+}
+
+// Same state machine as the scalar path, with whitespace runs and comment
+// bodies consumed a vector at a time
+static void skip_whitespace_and_comments_simd(bjson_parser_t* parser) {
+    int avx2 = bjson_simd_level() >= BJSON_SIMD_AVX2;
+    
+    while (parser->pos < parser->length) {
+        const char* p = parser->input + parser->pos;
+        size_t n = parser->length - parser->pos;
+        char c = *p;
+        
+        if (isspace(c)) {
+            parser->pos += avx2 ? scan_whitespace_avx2(p, n, &parser->line, &parser->column)
+                                : scan_whitespace_sse2(p, n, &parser->line, &parser->column);
+        } else if (c == '/' && n > 1) {
+            if (p[1] == '/') {
+                // Single-line comment; the newline is left for the whitespace scan
+                const char* nl = memchr(p + 2, '\n', n - 2);
+                parser->pos = nl ? (size_t)(nl - parser->input) : parser->length;
+            } else if (p[1] == '*') {
+                parser->pos += 2;
+                parser->pos += avx2 ? scan_block_comment_avx2(p + 2, n - 2, &parser->line, &parser->column)
+                                    : scan_block_comment_sse2(p + 2, n - 2, &parser->line, &parser->column);
+            } else {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+}
+
+// Offset of the first '"' or '\\' in p[0..n), or n
+static size_t scan_string_run_sse2(const char* p, size_t n) {
+    size_t i = 0;
+    while (i + 16 <= n) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+        uint32_t special = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+                                                                    _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'))));
+        if (special) return i + __builtin_ctz(special);
+        i += 16;
+    }
+    while (i < n && p[i] != '"' && p[i] != '\\') i++;
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t scan_string_run_avx2(const char* p, size_t n) {
+    size_t i = 0;
+    while (i + 32 <= n) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(p + i));
+        uint32_t special = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')),
+                                                                          _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\'))));
+        if (special) return i + __builtin_ctz(special);
+        i += 32;
+    }
+    _mm256_zeroupper();
+    return i + scan_string_run_sse2(p + i, n - i);
+}
+
+// Offset of the first byte a JSON string must escape ('"', '\\' or a control
+// character below 0x20) in p[0..n), or n
+static size_t scan_escape_run_sse2(const char* p, size_t n) {
+    const __m128i limit = _mm_set1_epi8(0x1F);
+    size_t i = 0;
+    while (i + 16 <= n) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(block, limit), limit);
+        __m128i quote = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+                                     _mm_cmpeq_epi8(block, _mm_set1_epi8('\\')));
+        uint32_t special = (uint32_t)_mm_movemask_epi8(_mm_or_si128(control, quote));
+        if (special) return i + __builtin_ctz(special);
+        i += 16;
+    }
+    while (i < n && (unsigned char)p[i] >= 0x20 && p[i] != '"' && p[i] != '\\') i++;
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t scan_escape_run_avx2(const char* p, size_t n) {
+    const __m256i limit = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+    while (i + 32 <= n) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(block, limit), limit);
+        __m256i quote = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')),
+                                        _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\')));
+        uint32_t special = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(control, quote));
+        if (special) return i + __builtin_ctz(special);
+        i += 32;
+    }
+    _mm256_zeroupper();
+    return i + scan_escape_run_sse2(p + i, n - i);
+}
+
+#endif
+
+// Offset of the first '"' or '\\' in p[0..n), or n
+static size_t scan_string_run(const char* p, size_t n) {
+#if BJSON_X86_SIMD
+    if (bjson_simd_level() >= BJSON_SIMD_AVX2) return scan_string_run_avx2(p, n);
+    return scan_string_run_sse2(p, n);
+#else
+    size_t i = 0;
+    while (i < n && p[i] != '"' && p[i] != '\\') i++;
+    return i;
+#endif
+}
+
+// Offset of the first byte a JSON string must escape in p[0..n), or n
+static size_t scan_escape_run(const char* p, size_t n) {
+#if BJSON_X86_SIMD
+    if (bjson_simd_level() >= BJSON_SIMD_AVX2) return scan_escape_run_avx2(p, n);
+    return scan_escape_run_sse2(p, n);
+#else
+    size_t i = 0;
+    while (i < n && (unsigned char)p[i] >= 0x20 && p[i] != '"' && p[i] != '\\') i++;
+    return i;
+#endif
+}
+
+// Skip whitespace and comments
+static void skip_whitespace_and_comments(bjson_parser_t* parser) {
+    // Most calls land directly on a token
+    if (parser->pos >= parser->length) return;
+    unsigned char c = (unsigned char)parser->input[parser->pos];
+    if (c > ' ' && c != '/') return;
+    
+#if BJSON_X86_SIMD
+    skip_whitespace_and_comments_simd(parser);
+#else
+    skip_whitespace_and_comments_scalar(parser);
+#endif
+}
+
+// Load 8 input bytes as a little-endian word
+static inline uint64_t load_u64_le(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+// 64-bit hash of a byte string, mixing 8 bytes per step
+uint64_t bjson_hash_bytes(const char* data, size_t length) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ length;
+    while (length >= 8) {
+        h = (h ^ load_u64_le(data)) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 29;
+        data += 8;
+        length -= 8;
+    }
+    if (length) {
+        uint64_t tail = 0;
+        memcpy(&tail, data, length);
+        h = (h ^ tail) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 29;
+    }
+    h *= 0x94D049BB133111EBULL;
+    return h ^ (h >> 32);
+}
+
+// Make room for need more bytes at the end of the first used bytes of scratch
+static int reserve_scratch(bjson_parser_t* parser, size_t used, size_t need) {
+    if (used + need <= parser->scratch_capacity) return 1;
+    
+    size_t capacity = parser->scratch_capacity ? parser->scratch_capacity : 256;
+    while (capacity < used + need) capacity *= 2;
+    char* scratch = realloc(parser->scratch, capacity);
+    if (!scratch) return 0;
+    
+    parser->scratch = scratch;
+    parser->scratch_capacity = capacity;
+    return 1;
+}
+
+static int hex_digit_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Read the 4 hex digits of a \uXXXX escape; -1 if malformed
+static int32_t parse_hex4(const char* p, size_t available) {
+    if (available < 4) return -1;
+    
+    int32_t code = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_digit_value(p[i]);
+        if (digit < 0) return -1;
+        code = (code << 4) | digit;
+    }
+    return code;
+}
+
+// Encode a code point as UTF-8; returns the number of bytes written
+static size_t encode_utf8(uint32_t code, char* out) {
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    } else if (code < 0x800) {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    } else if (code < 0x10000) {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+// Decode the escape sequence at input[*pos] (just past the backslash) into
+// out, which has room for 4 bytes; returns bytes written or -1 on error
+static int unescape_sequence(bjson_parser_t* parser, size_t* pos, char* out) {
+    const char* input = parser->input;
+    char c = input[(*pos)++];
+    
+    switch (c) {
+        case 'n': out[0] = '\n'; return 1;
+        case 't': out[0] = '\t'; return 1;
+        case 'r': out[0] = '\r'; return 1;
+        case 'b': out[0] = '\b'; return 1;
+        case 'f': out[0] = '\f'; return 1;
+        case '/': out[0] = '/'; return 1;
+        case '\\': out[0] = '\\'; return 1;
+        case '"': out[0] = '"'; return 1;
+        case 'u': {
+            int32_t code = parse_hex4(input + *pos, parser->length - *pos);
+            if (code < 0) break;
+            *pos += 4;
+            
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                // High surrogate: combine with a following \uDC00-\uDFFF
+                int32_t low = -1;
+                if (*pos + 6 <= parser->length && input[*pos] == '\\' && input[*pos + 1] == 'u') {
+                    low = parse_hex4(input + *pos + 2, 4);
+                }
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    *pos += 6;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                } else {
+                    code = 0xFFFD;
+                }
+            } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                code = 0xFFFD;  // Unpaired low surrogate
+            }
+            return (int)encode_utf8((uint32_t)code, out);
+        }
+        default:
+            // Unknown escapes keep the escaped character
+            out[0] = c;
+            return 1;
+    }
+    
+    snprintf(parser->error_msg, sizeof(parser->error_msg), 
+            "Invalid \\u escape at line %d", parser->line);
+    return -1;
+}
+
+// Report a callback's request to stop; returns 0 when parsing must end
+static int sax_continue(bjson_parser_t* parser, int stop) {
+    if (!stop) return 1;
+    
+    parser->sax_stopped = 1;
+    if (!parser->error_msg[0]) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Parsing stopped by callback at line %d, column %d", parser->line, parser->column);
+    }
+    return 0;
+}
+
+// Deliver an event to the parser's handler, if it has that callback:
+// BJSON_SAX_CALL(parser, int_value, (parser->sax_ctx, 42))
+#define BJSON_SAX_CALL(parser, event, args) \
+    (!(parser)->sax->event || sax_continue((parser), (parser)->sax->event args))
+
+// Scan a string token in one pass: runs between escapes are found with
+// vector compares. *text is a view of the input when the string has no
+// escapes, and of the scratch buffer otherwise; valid until the next string.
+static int scan_string(bjson_parser_t* parser, const char** text_out, size_t* length_out) {
+    if (parser->pos >= parser->length || parser->input[parser->pos] != '"') {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Expected '\"' at line %d, column %d", parser->line, parser->column);
+        return 0;
+    }
+    
+    const char* input = parser->input;
+    size_t start = parser->pos + 1; // Skip opening quote
+    size_t pos = start + scan_string_run(input + start, parser->length - start);
+    const char* text = input + start;
+    size_t len = pos - start;
+    
+    if (pos < parser->length && input[pos] == '\\') {
+        // Escaped string: unescape into the scratch buffer
+        size_t used = 0;
+        for (;;) {
+            if (!reserve_scratch(parser, used, len + 4)) {
+                snprintf(parser->error_msg, sizeof(parser->error_msg), "Out of memory");
+                return 0;
+            }
+            memcpy(parser->scratch + used, input + pos - len, len);
+            used += len;
+            
+            if (pos >= parser->length || input[pos] == '"') break;
+            
+            pos++; // Skip backslash
+            if (pos >= parser->length) break;
+            int written = unescape_sequence(parser, &pos, parser->scratch + used);
+            if (written < 0) return 0;
+            used += (size_t)written;
+            
+            size_t run = scan_string_run(input + pos, parser->length - pos);
+            pos += run;
+            len = run;
+        }
+        text = parser->scratch;
+        len = used;
+    }
+    
+    if (pos >= parser->length) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Unterminated string at line %d", parser->line);
+        return 0;
+    }
+    
+    parser->column += (int)(pos - start) + 2;
+    parser->pos = pos + 1; // Skip closing quote
+    
+    *text_out = text;
+    *length_out = len;
+    return 1;
+}
+
+// Parse a string token and report it as a value or an object key
+static int parse_string(bjson_parser_t* parser, int is_key) {
+    const char* text;
+    size_t len;
+    if (!scan_string(parser, &text, &len)) return 0;
+    
+    if (is_key) return BJSON_SAX_CALL(parser, key, (parser->sax_ctx, text, len));
+    return BJSON_SAX_CALL(parser, string_value, (parser->sax_ctx, text, len));
+}
+
+// Consume a raw extended-type payload up to and including its closing ')',
+// balancing nested parentheses and skipping over quoted strings and escapes
+static int skip_extended_payload(bjson_parser_t* parser) {
+    const char* input = parser->input;
+    size_t pos = parser->pos;
+    int depth = 0;
+    char quote = 0;
+    
+    while (pos < parser->length) {
+        char c = input[pos++];
+        if (c == '\n') {
+            parser->line++;
+            parser->column = 1;
+        } else {
+            parser->column++;
+        }
+        
+        if (c == '\\' && pos < parser->length) {
+            pos++;
+            parser->column++;
+        } else if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            if (depth-- == 0) {
+                parser->pos = pos;
+                return 1;
+            }
+        }
+    }
+    
+    parser->pos = pos;
+    snprintf(parser->error_msg, sizeof(parser->error_msg), 
+            "Unterminated extended type payload at line %d", parser->line);
+    return 0;
+}
+
+// Lexical states of a @regex payload. The payload is delimited by its own
+// syntax rather than by parenthesis balancing: a /pattern/ in which
+// backslash escapes and [...] classes hide '/', then flag letters, then ')'.
+// Quotes and parentheses inside the pattern are ordinary bytes, so
+// @regex(/it's/) and @regex(/[(]/) are complete payloads.
+typedef enum {
+    BJSON_REGEX_LEX_OPEN,         // Whitespace before the opening '/'
+    BJSON_REGEX_LEX_BODY,
+    BJSON_REGEX_LEX_ESCAPE,       // Byte after a backslash in the pattern
+    BJSON_REGEX_LEX_CLASS,        // Inside [...], where '/' is literal
+    BJSON_REGEX_LEX_CLASS_ESCAPE, // Byte after a backslash inside [...]
+    BJSON_REGEX_LEX_FLAGS,        // After the closing '/', up to ')'
+    BJSON_REGEX_LEX_DONE,         // Closing ')' consumed
+    BJSON_REGEX_LEX_INVALID       // Not /pattern/flags
+} bjson_regex_lex_t;
+
+// Next state after byte c. The text parser, the structural indexer and the
+// push lexer all step through this, so they end a payload at the same byte.
+static inline int regex_lex_step(int state, char c) {
+    switch (state) {
+        case BJSON_REGEX_LEX_OPEN:
+            if (c == '/') return BJSON_REGEX_LEX_BODY;
+            return isspace((unsigned char)c) ? BJSON_REGEX_LEX_OPEN : BJSON_REGEX_LEX_INVALID;
+        case BJSON_REGEX_LEX_BODY:
+            if (c == '/') return BJSON_REGEX_LEX_FLAGS;
+            if (c == '\\') return BJSON_REGEX_LEX_ESCAPE;
+            if (c == '[') return BJSON_REGEX_LEX_CLASS;
+            return c == '\n' ? BJSON_REGEX_LEX_INVALID : BJSON_REGEX_LEX_BODY;
+        case BJSON_REGEX_LEX_ESCAPE:
+            return c == '\n' ? BJSON_REGEX_LEX_INVALID : BJSON_REGEX_LEX_BODY;
+        case BJSON_REGEX_LEX_CLASS:
+            if (c == ']') return BJSON_REGEX_LEX_BODY;
+            if (c == '\\') return BJSON_REGEX_LEX_CLASS_ESCAPE;
+            return c == '\n' ? BJSON_REGEX_LEX_INVALID : BJSON_REGEX_LEX_CLASS;
+        case BJSON_REGEX_LEX_CLASS_ESCAPE:
+            return c == '\n' ? BJSON_REGEX_LEX_INVALID : BJSON_REGEX_LEX_CLASS;
+        case BJSON_REGEX_LEX_FLAGS:
+            if (c == ')') return BJSON_REGEX_LEX_DONE;
+            if (isalnum((unsigned char)c) || isspace((unsigned char)c)) return BJSON_REGEX_LEX_FLAGS;
+            return BJSON_REGEX_LEX_INVALID;
+    }
+    return BJSON_REGEX_LEX_INVALID;
+}
+
+// Step through the @regex payload starting at *pos, leaving *pos just past
+// its closing ')', on the byte that made it invalid, or at length. Returns
+// the final state; close receives the offset of the pattern's closing '/'.
+static int scan_regex_payload(const char* input, size_t length, size_t* pos, size_t* close) {
+    int state = BJSON_REGEX_LEX_OPEN;
+    size_t at = *pos;
+    while (at < length && state != BJSON_REGEX_LEX_DONE) {
+        int next = regex_lex_step(state, input[at]);
+        if (next == BJSON_REGEX_LEX_INVALID) {
+            state = next;
+            break;
+        }
+        if (state != BJSON_REGEX_LEX_FLAGS && next == BJSON_REGEX_LEX_FLAGS) *close = at;
+        state = next;
+        at++;
+    }
+    *pos = at;
+    return state;
+}
+
+// Parse the /pattern/flags) payload of @regex, just after its '('. Pattern
+// and flags are kept verbatim and only compiled when first matched
+static int parse_regex(bjson_parser_t* parser) {
+    const char* input = parser->input;
+    size_t begin = parser->pos;
+    size_t end = begin;
+    size_t close = 0;
+    int state = scan_regex_payload(input, parser->length, &end, &close);
+    for (size_t i = begin; i < end; i++) {
+        if (input[i] == '\n') {
+            parser->line++;
+            parser->column = 1;
+        } else {
+            parser->column++;
+        }
+    }
+    parser->pos = end;
+    if (state == BJSON_REGEX_LEX_INVALID) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "@regex expects /pattern/flags at line %d", parser->line);
+        return 0;
+    }
+    if (state != BJSON_REGEX_LEX_DONE) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Unterminated extended type payload at line %d", parser->line);
+        return 0;
+    }
+    
+    while (isspace((unsigned char)input[begin])) begin++;
+    size_t flags_end = end - 1;
+    while (isspace((unsigned char)input[flags_end - 1])) flags_end--;
+    for (size_t i = close + 1; i < flags_end; i++) {
+        if (!memchr("gimsuy", input[i], 6)) {
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "Invalid @regex flag '%c' at line %d", input[i], parser->line);
+            return 0;
+        }
+    }
+    
+    // No bracket expression can hold \D, \S or \W (see regex_translate), so
+    // refuse them here rather than have every match fail
+    int lex = BJSON_REGEX_LEX_BODY;
+    for (size_t i = begin + 1; i < close; i++) {
+        if (lex == BJSON_REGEX_LEX_CLASS_ESCAPE && (input[i] == 'D' || input[i] == 'S' || input[i] == 'W')) {
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "Unsupported \\%c inside a @regex class at line %d", input[i], parser->line);
+            return 0;
+        }
+        lex = regex_lex_step(lex, input[i]);
+    }
+    
+    size_t pattern_length = close - (begin + 1);
+    size_t flags_length = flags_end - (close + 1);
+    if (!reserve_scratch(parser, 0, pattern_length + flags_length + 2)) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), "Out of memory");
+        return 0;
+    }
+    char* pattern = parser->scratch;
+    char* flags = pattern + pattern_length + 1;
+    memcpy(pattern, input + begin + 1, pattern_length);
+    pattern[pattern_length] = '\0';
+    memcpy(flags, input + close + 1, flags_length);
+    flags[flags_length] = '\0';
+    return BJSON_SAX_CALL(parser, regex_value, (parser->sax_ctx, pattern, flags));
+}
+
+// Free an array node's item buffer and the node itself, leaving its items
+// alone; used once the items have been moved into another container
+static void release_array_shell(bjson_value_t* array) {
+    if (array->flags & BJSON_VALUE_ARENA) return;
+    free(array->array_val.items);
+    free(array);
+}
+
+// Built-in extended type named by the length bytes at name, or -1. One
+// switch on the length and first byte leaves at most two candidates to
+// compare, so dispatch costs the same for every name and needs no copy
+static int builtin_type(const char* name, size_t length) {
+    if (length < 3 || length > 8) return -1;
+    
+    switch (length << 8 | (unsigned char)name[0]) {
+        case 3 << 8 | 's': return memcmp(name, "set", 3) == 0 ? BJSON_SET : -1;
+        case 3 << 8 | 'm': return memcmp(name, "map", 3) == 0 ? BJSON_MAP : -1;
+        case 3 << 8 | 'r': return memcmp(name, "ref", 3) == 0 ? BJSON_REFERENCE : -1;
+        case 4 << 8 | 'd': return memcmp(name, "date", 4) == 0 ? BJSON_DATE : -1;
+        case 5 << 8 | 'b': return memcmp(name, "bytes", 5) == 0 ? BJSON_BYTES : -1;
+        case 5 << 8 | 'r': return memcmp(name, "regex", 5) == 0 ? BJSON_REGEX : -1;
+        case 8 << 8 | 'd':
+            if (memcmp(name, "datetime", 8) == 0) return BJSON_DATETIME;
+            return memcmp(name, "duration", 8) == 0 ? BJSON_DURATION : -1;
+        default: return -1;
+    }
+}
+
+// Run a parse or decode hook into local, then once more into a heap block
+// when it asks for more room. Returns the payload, local or a block the
+// caller frees, with its length in *size; NULL for invalid input or no memory
+static uint8_t* custom_payload(const bjson_type_hooks_t* hooks, int binary, const void* data, size_t length,
+                               uint8_t* local, size_t capacity, size_t* size) {
+    long n = binary ? hooks->decode(hooks->user, data, length, local, capacity)
+                    : hooks->parse(hooks->user, data, length, local, capacity);
+    if (n < 0 || (unsigned long)n > UINT32_MAX) return NULL;
+    *size = (size_t)n;
+    if ((size_t)n <= capacity) return local;
+    
+    uint8_t* block = malloc((size_t)n);
+    if (!block) return NULL;
+    long again = binary ? hooks->decode(hooks->user, data, length, block, (size_t)n)
+                        : hooks->parse(hooks->user, data, length, block, (size_t)n);
+    if (again != n) {
+        free(block);
+        return NULL;
+    }
+    return block;
+}
+
+// Payload parser shared by every custom value type; user is the type's slot
+static int custom_value_parse(void* user, const char* text, size_t length, const bjson_sax_handler_t* handler,
+                              void* ctx) {
+    const bjson_custom_type_t* type = user;
+    uint8_t local[256];
+    size_t size;
+    uint8_t* payload = custom_payload(&type->hooks, 0, text, length, local, sizeof(local), &size);
+    if (!payload) return -1;
+    
+    int result = handler->custom_value ? handler->custom_value(ctx, (unsigned)(type - custom_types), payload, size) : 0;
+    if (payload != local) free(payload);
+    return result;
+}
+
+// Fill a free slot for name. A value type's slot is its parser's user data.
+// Returns 0 for a malformed, built-in or already registered name, or when
+// the table is full
+static int register_custom(const char* name, bjson_type_parse_fn parse, void* user, const bjson_type_hooks_t* hooks) {
+    size_t length = name ? strlen(name) : 0;
+    if (length == 0 || length > BJSON_TYPE_NAME_MAX || builtin_type(name, length) >= 0) return 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_') return 0;
+    }
+    
+    pthread_mutex_lock(&custom_types_lock);
+    int added = 0;
+    if (custom_type_count < BJSON_CUSTOM_TYPE_SLOTS / 2 && !custom_type_find(name, length)) {
+        size_t slot = bjson_hash_bytes(name, length) & (BJSON_CUSTOM_TYPE_SLOTS - 1);
+        while (custom_types[slot].parse) slot = (slot + 1) & (BJSON_CUSTOM_TYPE_SLOTS - 1);
+        memcpy(custom_types[slot].name, name, length + 1);
+        custom_types[slot].length = length;
+        custom_types[slot].user = hooks ? &custom_types[slot] : user;
+        if (hooks) custom_types[slot].hooks = *hooks;
+        __atomic_store_n(&custom_types[slot].parse, parse, __ATOMIC_RELEASE);
+        custom_type_count++;
+        added = 1;
+    }
+    pthread_mutex_unlock(&custom_types_lock);
+    return added;
+}
+
+// Register a parser for @name(...) that reports values of the existing
+// types, where name is up to BJSON_TYPE_NAME_MAX letters, digits and
+// underscores. Returns 0 for a malformed, built-in or already registered
+// name, or when the table is full. Registration is process-wide and may
+// run while other threads parse
+int bjson_register_type(const char* name, bjson_type_parse_fn parse, void* user) {
+    return parse && register_custom(name, parse, user, NULL);
+}
+
+// Register @name(...) as a type of its own, whose values are BJSON_CUSTOM
+// nodes handled through hooks (copied) in parsing, serialization, the binary
+// format, tapes, equality and hashing. Names follow bjson_register_type
+int bjson_register_custom_type(const char* name, const bjson_type_hooks_t* hooks) {
+    if (!hooks || !hooks->parse || !hooks->serialize || !hooks->encode != !hooks->decode) return 0;
+    return register_custom(name, custom_value_parse, NULL, hooks);
+}
+
+// Parse extended types like @date(...), @bytes(...), etc., named by the
+// length bytes at name
+static int parse_extended_type(bjson_parser_t* parser, const char* name, size_t length) {
+    int name_length = (int)length;
+    if (parser->pos >= parser->length || parser->input[parser->pos] != '(') {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Expected '(' after @%.*s at line %d, column %d", name_length, name, parser->line, parser->column);
+        return 0;
+    }
+    parser->pos++;
+    parser->column++;
+    
+    int type = builtin_type(name, length);
+    if (type == BJSON_SET || type == BJSON_MAP) {
+        // @set([...]) and @map({...}) wrap an ordinary array or object
+        int is_set = type == BJSON_SET;
+        skip_whitespace_and_comments(parser);
+        if (parser->pos >= parser->length || parser->input[parser->pos] != (is_set ? '[' : '{')) {
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "@%s expects %s at line %d, column %d", is_set ? "set" : "map", is_set ? "an array" : "an object",
+                    parser->line, parser->column);
+            return 0;
+        }
+        if (!(is_set ? parse_array(parser, 1) : parse_object(parser, 1))) return 0;
+        
+        skip_whitespace_and_comments(parser);
+        if (parser->pos >= parser->length || parser->input[parser->pos] != ')') {
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "Expected ')' to close @%s at line %d, column %d", is_set ? "set" : "map",
+                    parser->line, parser->column);
+            return 0;
+        }
+        parser->pos++;
+        parser->column++;
+        return 1;
+    }
+    
+    if (type == BJSON_DATE || type == BJSON_DATETIME || type == BJSON_DURATION) return parse_temporal(parser, type);
+    if (type == BJSON_BYTES) return parse_bytes(parser);
+    if (type == BJSON_REGEX) return parse_regex(parser);
+    
+    const bjson_custom_type_t* custom = type < 0 ? custom_type_find(name, length) : NULL;
+    if (type < 0 && !custom) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Unknown extended type: %.*s", name_length, name);
+        return 0;
+    }
+    size_t payload = parser->pos;
+    if (!skip_extended_payload(parser)) return 0;
+    
+    if (custom) {
+        int result = custom->parse(custom->user, parser->input + payload, parser->pos - 1 - payload,
+                                   parser->sax, parser->sax_ctx);
+        if (result < 0) {
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "Invalid @%.*s value at line %d", name_length, name, parser->line);
+            return 0;
+        }
+        return sax_continue(parser, result);
+    }
+    
+    // Parse @ref($.path.to.value)
+    return BJSON_SAX_CALL(parser, ref_value, (parser->sax_ctx, "$.example.path"));
+}
+
+// Message behind the last failure on this thread of an entry point that
+// returns no parser to ask, such as bjson_binary_decode
+static __thread char bjson_last_error[1024];
+
+static void set_error_message(const char* message) {
+    snprintf(bjson_last_error, sizeof(bjson_last_error), "%s", message);
+}
+
+// Why the last failed call on this thread to bjson_parse_document,
+// bjson_parse_file, bjson_parse_sax, bjson_ondemand_parse,
+// bjson_binary_decode or bjson_binary_decode_value failed; empty before any
+// failure
+const char* bjson_error_message(void) {
+    return bjson_last_error;
+}
+
+// Main parsing function (simplified for brevity)
+bjson_value_t* bjson_parse(const char* input, bjson_error_t* error) {
+    bjson_parser_t parser = {0};
+    parser.input = input;
+    parser.length = strlen(input);
+    parser.line = 1;
+    parser.column = 1;
+    
+    bjson_value_t* result = parse_tree(&parser);
+    free(parser.scratch);
+    
+    if (!result && error) {
+        *error = BJSON_ERROR_SYNTAX;
+        printf("Parse error: %s\n", parser.error_msg);
+    } else if (error) {
+        *error = BJSON_SUCCESS;
+    }
+    
+    return result;
+}
+
+// Empty document, with its arena when BJSON_PARSE_ARENA is set and its
+// intern table when BJSON_PARSE_SHARE_KEYS is
+static bjson_document_t* document_create(unsigned flags, bjson_error_t* error) {
+    bjson_document_t* doc = malloc(sizeof(bjson_document_t));
+    if (!doc) {
+        if (error) *error = BJSON_ERROR_MEMORY;
+        return NULL;
+    }
+    doc->root = NULL;
+    doc->arena = NULL;
+    doc->source = NULL;
+    doc->source_length = 0;
+    doc->source_mapped = 0;
+    doc->intern = NULL;
+    
+    if (flags & BJSON_PARSE_ARENA) {
+        doc->arena = bjson_arena_create(0);
+        if (!doc->arena) {
+            free(doc);
+            if (error) *error = BJSON_ERROR_MEMORY;
+            return NULL;
+        }
+    }
+    if (flags & BJSON_PARSE_SHARE_KEYS) {
+        doc->intern = intern_create(doc->arena);
+        if (!doc->intern) {
+            bjson_arena_destroy(doc->arena);
+            free(doc);
+            if (error) *error = BJSON_ERROR_MEMORY;
+            return NULL;
+        }
+    }
+    return doc;
+}
+
+// bjson_parse_document without the report on stdout; a syntax error's
+// message is left for bjson_error_message
+static bjson_document_t* document_parse(const char* input, size_t length, unsigned flags, bjson_error_t* error) {
+    bjson_document_t* doc = document_create(flags, error);
+    if (!doc) return NULL;
+    
+    bjson_parser_t parser = {0};
+    parser.input = input;
+    parser.length = length;
+    parser.line = 1;
+    parser.column = 1;
+    parser.arena = doc->arena;
+    parser.intern = doc->intern;
+    parser.flags = flags;
+    if (flags & BJSON_PARSE_PRESIZE) {
+        compute_size_hints(&parser);
+    }
+    int indexed = (flags & BJSON_PARSE_TWO_STAGE) && build_structural_index(&parser) == BJSON_SUCCESS;
+    
+    doc->root = parse_tree(&parser);
+    if (indexed) {
+        free((void*)parser.index);
+        parser.index = NULL;
+        if (!doc->root) {
+            // Stage 2 gave up: the recursive parser decides, and words the error
+            if (doc->arena) bjson_arena_reset(doc->arena);
+            if (doc->intern) intern_clear(doc->intern);
+            parser.pos = 0;
+            parser.line = 1;
+            parser.column = 1;
+            parser.size_hint_next = 0;
+            parser.sax_stopped = 0;
+            doc->root = parse_tree(&parser);
+        }
+    }
+    free(parser.scratch);
+    free(parser.size_hints);
+    
+    if (!doc->root) {
+        if (error) *error = BJSON_ERROR_SYNTAX;
+        set_error_message(parser.error_msg);
+        bjson_document_free(doc);
+        return NULL;
+    }
+    
+    if (error) *error = BJSON_SUCCESS;
+    return doc;
+}
+
+// Parse length bytes of input into a document; with BJSON_PARSE_ARENA every
+// node, string and buffer is carved from an arena owned by the document
+bjson_document_t* bjson_parse_document(const char* input, size_t length, unsigned flags, bjson_error_t* error) {
+    bjson_error_t status;
+    bjson_document_t* doc = document_parse(input, length, flags, &status);
+    if (status == BJSON_ERROR_SYNTAX) printf("Parse error: %s\n", bjson_error_message());
+    if (error) *error = status;
+    return doc;
+}
+
+// Free a document; arena documents release their chunks without walking the tree
+void bjson_document_free(bjson_document_t* doc) {
+    if (!doc) return;
+    
+    if (doc->arena) {
+        bjson_arena_destroy(doc->arena);
+    } else {
+        bjson_free_value(doc->root);
+    }
+    // Heap-mode interned keys and shapes outlive every object that used them
+    intern_destroy(doc->intern);
+    release_source(doc->source, doc->source_length, doc->source_mapped);
+    free(doc);
+}
+
+// Bytes of a file: mapped read-only when possible, otherwise read into a
+// heap buffer (pipes, character devices and other unmappable files)
+static void* load_source(const char* path, size_t* length, int* mapped) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    
+    struct stat st;
+    void* data = NULL;
+    *length = 0;
+    *mapped = 0;
+    
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            // The parser reads front to back exactly once
+            madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+            *length = (size_t)st.st_size;
+            *mapped = 1;
+            close(fd);
+            return data;
+        }
+        data = NULL;
+    }
+    
+    size_t capacity = 0;
+    for (;;) {
+        if (*length == capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            void* grown = realloc(data, capacity);
+            if (!grown) break;
+            data = grown;
+        }
+        ssize_t n = read(fd, (char*)data + *length, capacity - *length);
+        if (n < 0) break;
+        if (n == 0) {
+            close(fd);
+            // Keep a valid pointer for empty input
+            return data ? data : malloc(1);
+        }
+        *length += (size_t)n;
+    }
+    
+    free(data);
+    close(fd);
+    return NULL;
+}
+
+static void release_source(void* data, size_t length, int mapped) {
+    if (!data) return;
+    if (mapped) {
+        munmap(data, length);
+    } else {
+        free(data);
+    }
+}
+
+// Parse a file straight from a read-only mapping, with no copy and no NUL
+// terminator needed. With BJSON_PARSE_BORROW_STRINGS the mapping stays alive
+// as long as the document, whose strings point into it; otherwise it is
+// unmapped as soon as parsing finishes.
+bjson_document_t* bjson_parse_file(const char* path, unsigned flags, bjson_error_t* error) {
+    size_t length;
+    int mapped;
+    void* data = load_source(path, &length, &mapped);
+    if (!data) {
+        if (error) *error = BJSON_ERROR_IO;
+        snprintf(bjson_last_error, sizeof(bjson_last_error), "Cannot read %s", path);
+        return NULL;
+    }
+    
+    bjson_document_t* doc = document_parse(data, length, flags, error);
+    if (doc && (flags & BJSON_PARSE_BORROW_STRINGS)) {
+        doc->source = data;
+        doc->source_length = length;
+        doc->source_mapped = mapped;
+    } else {
+        release_source(data, length, mapped);
+    }
+    return doc;
+}
+
+// Parse one value of any kind, reporting it to the handler
+static int parse_value(bjson_parser_t* parser) {
+    skip_whitespace_and_comments(parser);
+    
+    if (parser->pos >= parser->length) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Unexpected end of input at line %d", parser->line);
+        return 0;
+    }
+    
+    char c = parser->input[parser->pos];
+    
+    switch (c) {
+        case '"':
+            return parse_string(parser, 0);
+        case '[':
+            return parse_array(parser, 0);
+        case '{':
+            return parse_object(parser, 0);
+        case '@': {
+            // Extended type syntax: @type(...)
+            parser->pos++;
+            size_t start = parser->pos;
+            while (parser->pos < parser->length && 
+                   (isalnum(parser->input[parser->pos]) || parser->input[parser->pos] == '_')) {
+                parser->pos++;
+            }
+            return parse_extended_type(parser, parser->input + start, parser->pos - start);
+        }
+        case 't':
+            if (parser->pos + 4 <= parser->length &&
+                strncmp(&parser->input[parser->pos], "true", 4) == 0) {
+                parser->pos += 4;
+                return BJSON_SAX_CALL(parser, bool_value, (parser->sax_ctx, 1));
+            }
+            break;
+        case 'f':
+            if (parser->pos + 5 <= parser->length &&
+                strncmp(&parser->input[parser->pos], "false", 5) == 0) {
+                parser->pos += 5;
+                return BJSON_SAX_CALL(parser, bool_value, (parser->sax_ctx, 0));
+            }
+            break;
+        case 'n':
+            if (parser->pos + 4 <= parser->length &&
+                strncmp(&parser->input[parser->pos], "null", 4) == 0) {
+                parser->pos += 4;
+                return BJSON_SAX_CALL(parser, null_value, (parser->sax_ctx));
+            }
+            break;
+        default:
+            if (isdigit(c) || c == '-') {
+                return parse_number(parser);
+            }
+            break;
+    }
+    
+    snprintf(parser->error_msg, sizeof(parser->error_msg), 
+            "Unexpected character '%c' at line %d, column %d", c, parser->line, parser->column);
+    return 0;
+}
+
+// Frame of the size-hint pre-pass
+typedef struct {
+    size_t hint;       // Index into parser->size_hints
+    int expect_item;   // Next token starts a new element
+} bjson_size_frame_t;
+
+// Pre-pass for BJSON_PARSE_PRESIZE: one linear scan recording the element
+// count of every container by position. Brackets inside @type(...) payloads
+// can mislead it, so the counts are only used as initial capacities.
+static void compute_size_hints(bjson_parser_t* parser) {
+    const char* in = parser->input;
+    size_t n = parser->length;
+    size_t hint_capacity = 64, hint_count = 0;
+    size_t stack_capacity = 16, depth = 0;
+    bjson_size_hint_t* hints = malloc(sizeof(bjson_size_hint_t) * hint_capacity);
+    bjson_size_frame_t* stack = malloc(sizeof(bjson_size_frame_t) * stack_capacity);
+    if (!hints || !stack) goto fail;
+    
+    for (size_t i = 0; i < n; i++) {
+        char c = in[i];
+        
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') continue;
+        
+        if (c == ',') {
+            if (depth) stack[depth - 1].expect_item = 1;
+            continue;
+        }
+        if (c == ']' || c == '}') {
+            if (depth) depth--;
+            continue;
+        }
+        if (c == ':') continue;
+        
+        if (c == '/' && i + 1 < n && (in[i + 1] == '/' || in[i + 1] == '*')) {
+            if (in[i + 1] == '/') {
+                const char* nl = memchr(in + i, '\n', n - i);
+                i = nl ? (size_t)(nl - in) : n;
+            } else {
+                for (i += 2; i + 1 < n && !(in[i] == '*' && in[i + 1] == '/'); i++) {}
+                i++;
+            }
+            continue;
+        }
+        
+        // Anything else starts or continues an element of the enclosing container
+        if (depth && stack[depth - 1].expect_item) {
+            hints[stack[depth - 1].hint].count++;
+            stack[depth - 1].expect_item = 0;
+        }
+        
+        if (c == '"') {
+            for (i++; i < n; i += 2) {
+                i += scan_string_run(in + i, n - i);
+                if (i >= n || in[i] == '"') break;
+            }
+        } else if (c == '[' || c == '{') {
+            if (hint_count == hint_capacity) {
+                hint_capacity *= 2;
+                bjson_size_hint_t* grown = realloc(hints, sizeof(bjson_size_hint_t) * hint_capacity);
+                if (!grown) goto fail;
+                hints = grown;
+            }
+            if (depth == stack_capacity) {
+                stack_capacity *= 2;
+                bjson_size_frame_t* grown = realloc(stack, sizeof(bjson_size_frame_t) * stack_capacity);
+                if (!grown) goto fail;
+                stack = grown;
+            }
+            hints[hint_count].pos = i;
+            hints[hint_count].count = 0;
+            stack[depth].hint = hint_count++;
+            stack[depth].expect_item = 1;
+            depth++;
+        }
+    }
+    
+    free(stack);
+    parser->size_hints = hints;
+    parser->size_hint_count = hint_count;
+    return;
+    
+fail:
+    // Presizing is an optimization; parse without hints
+    free(hints);
+    free(stack);
+}
+
+// Element count recorded by the pre-pass for the container at parser->pos
+static size_t take_size_hint(bjson_parser_t* parser) {
+    while (parser->size_hint_next < parser->size_hint_count &&
+           parser->size_hints[parser->size_hint_next].pos < parser->pos) {
+        parser->size_hint_next++;
+    }
+    if (parser->size_hint_next < parser->size_hint_count &&
+        parser->size_hints[parser->size_hint_next].pos == parser->pos) {
+        return parser->size_hints[parser->size_hint_next++].count;
+    }
+    return 0;
+}
+
+// Make room for at least needed items in an array
+static int reserve_array(bjson_parser_t* parser, bjson_value_t* array, size_t needed) {
+    if (needed <= array->array_capacity) return 1;
+    if (needed > BJSON_ARRAY_MAX_CAPACITY) return 0;
+    
+    size_t capacity = grow_capacity(array->array_capacity, needed);
+    if (capacity > BJSON_ARRAY_MAX_CAPACITY) capacity = BJSON_ARRAY_MAX_CAPACITY;
+    bjson_value_t** items = parser_realloc(parser, array->array_val.items,
+                                           sizeof(bjson_value_t*) * array->array_capacity,
+                                           sizeof(bjson_value_t*) * capacity);
+    if (!items) return 0;
+    
+    array->array_val.items = items;
+    array->array_capacity = (uint32_t)capacity;
+    return 1;
+}
+
+// Give an empty object room for count pairs: one block holding the keys
+// then the values
+static int reserve_object(bjson_parser_t* parser, bjson_object_t* object, size_t count) {
+    if (!count) return 1;
+    
+    bjson_value_t** block = parser_alloc(parser, sizeof(bjson_value_t*) * 2 * count);
+    if (!block) return 0;
+    
+    object->keys = block;
+    object->values = block + count;
+    object->capacity = count;
+    return 1;
+}
+
+// Hash index over the string keys of a key vector; slots are sized for a
+// load factor of at most 1/2 so probe chains stay short
+static uint32_t* index_keys(bjson_parser_t* parser, bjson_value_t* const* keys, size_t count, size_t* mask) {
+    size_t slots = 1;
+    while (slots < count * 2) slots <<= 1;
+    
+    uint32_t* index = parser_alloc(parser, sizeof(uint32_t) * slots);
+    if (!index) return NULL;
+    memset(index, 0, sizeof(uint32_t) * slots);
+    
+    for (size_t i = 0; i < count; i++) {
+        const bjson_value_t* key = keys[i];
+        if (key->type != BJSON_STRING || !(key->flags & BJSON_VALUE_HASHED)) continue;
+        
+        // Linear probing keeps the first of duplicate keys ahead of later ones
+        size_t slot = key->string_hash & (slots - 1);
+        while (index[slot]) slot = (slot + 1) & (slots - 1);
+        index[slot] = (uint32_t)(i + 1);
+    }
+    
+    *mask = slots - 1;
+    return index;
+}
+
+// Index the string keys of a finished object
+static int build_object_index(bjson_parser_t* parser, bjson_object_t* object) {
+    object->index = index_keys(parser, object->keys, object->count, &object->index_mask);
+    if (!object->index) return 0;
+    object->index_count = object->count;
+    return 1;
+}
+
+static inline int key_matches(const bjson_value_t* key, const char* data, size_t length, uint32_t hash) {
+    if (key->type != BJSON_STRING || key->string_val.length != length) return 0;
+    if ((key->flags & BJSON_VALUE_HASHED) && key->string_hash != hash) return 0;
+    return memcmp(key->string_val.data, data, length) == 0;
+}
+
+// Position of the first pair whose key is the given string, or -1; O(1)
+// expected for indexed objects, a hash-filtered scan for small ones
+static long object_find(const bjson_object_t* object, const char* key, size_t length) {
+    uint32_t hash = key_hash(key, length);
+    size_t from = 0;
+    if (object->index) {
+        for (size_t slot = hash & object->index_mask; object->index[slot];
+             slot = (slot + 1) & object->index_mask) {
+            size_t i = object->index[slot] - 1;
+            if (key_matches(object->keys[i], key, length, hash)) return (long)i;
+        }
+        // Pairs appended after the index was built are not in it
+        from = object->index_count;
+    }
+    for (size_t i = from; i < object->count; i++) {
+        if (key_matches(object->keys[i], key, length, hash)) return (long)i;
+    }
+    return -1;
+}
+
+// Look up the first value whose key is the given string
+bjson_value_t* bjson_object_get_n(const bjson_value_t* object, const char* key, size_t length) {
+    if (!object || object->type != BJSON_OBJECT) return NULL;
+    
+    long i = object_find(object->object_val, key, length);
+    return i >= 0 ? object->object_val->values[i] : NULL;
+}
+
+// bjson_object_get_n for one key across many objects, e.g. a field of every
+// record in an array: an object with the shape of the previous lookup reads
+// the cached position without hashing. Use one cache per key, and only
+// while the document lives.
+bjson_value_t* bjson_object_get_cached(const bjson_value_t* object, const char* key, size_t length,
+                                       bjson_key_cache_t* cache) {
+    if (!object || object->type != BJSON_OBJECT) return NULL;
+    
+    const bjson_object_t* obj = object->object_val;
+    if (obj->shape && obj->shape == cache->shape) {
+        return cache->slot < obj->count ? obj->values[cache->slot] : NULL;
+    }
+    
+    long i = object_find(obj, key, length);
+    if (obj->shape) {
+        cache->shape = obj->shape;
+        cache->slot = i >= 0 ? (size_t)i : SIZE_MAX;
+    }
+    return i >= 0 ? obj->values[i] : NULL;
+}
+
+bjson_value_t* bjson_object_get(const bjson_value_t* object, const char* key) {
+    return bjson_object_get_n(object, key, strlen(key));
+}
+
+// Parse an array, or the array inside @set(...)
+static int parse_array(bjson_parser_t* parser, int is_set) {
+    // Start events see pos on the '[' so consumers can look up size hints
+    if (!(is_set ? BJSON_SAX_CALL(parser, start_set, (parser->sax_ctx))
+                 : BJSON_SAX_CALL(parser, start_array, (parser->sax_ctx)))) {
+        return 0;
+    }
+    parser->pos++; // Skip '['
+    
+    size_t count = 0;
+    skip_whitespace_and_comments(parser);
+    
+    while (parser->pos < parser->length && parser->input[parser->pos] != ']') {
+        if (!parse_value(parser)) return 0;
+        count++;
+        
+        skip_whitespace_and_comments(parser);
+        
+        if (parser->pos >= parser->length) break;
+        
+        if (parser->input[parser->pos] == ',') {
+            parser->pos++;
+            // A trailing comma before ']' is allowed
+            skip_whitespace_and_comments(parser);
+        }
+    }
+    if (parser->pos < parser->length) parser->pos++; // Skip ']'
+    
+    return is_set ? BJSON_SAX_CALL(parser, end_set, (parser->sax_ctx, count))
+                  : BJSON_SAX_CALL(parser, end_array, (parser->sax_ctx, count));
+}
+
+// Parse an object, or the object inside @map(...). Keys may be any value;
+// string keys are reported through the key event.
+static int parse_object(bjson_parser_t* parser, int is_map) {
+    if (!(is_map ? BJSON_SAX_CALL(parser, start_map, (parser->sax_ctx))
+                 : BJSON_SAX_CALL(parser, start_object, (parser->sax_ctx)))) {
+        return 0;
+    }
+    parser->pos++; // Skip '{'
+    
+    size_t count = 0;
+    skip_whitespace_and_comments(parser);
+    
+    while (parser->pos < parser->length && parser->input[parser->pos] != '}') {
+        // Parse key (can be string, number, or boolean in Better JSON)
+        int ok = parser->input[parser->pos] == '"' ? parse_string(parser, 1) : parse_value(parser);
+        if (!ok) return 0;
+        
+        skip_whitespace_and_comments(parser);
+        
+        if (parser->pos >= parser->length || parser->input[parser->pos] != ':') {
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "Expected ':' at line %d, column %d", parser->line, parser->column);
+            return 0;
+        }
+        parser->pos++; // Skip ':'
+        
+        if (!parse_value(parser)) return 0;
+        count++;
+        
+        skip_whitespace_and_comments(parser);
+        
+        if (parser->pos >= parser->length) break;
+        
+        if (parser->input[parser->pos] == ',') {
+            parser->pos++;
+            // A trailing comma before '}' is allowed
+            skip_whitespace_and_comments(parser);
+        }
+    }
+    if (parser->pos < parser->length) parser->pos++; // Skip '}'
+    
+    return is_map ? BJSON_SAX_CALL(parser, end_map, (parser->sax_ctx, count))
+                  : BJSON_SAX_CALL(parser, end_object, (parser->sax_ctx, count));
+}
+
+// Two-stage parsing (BJSON_PARSE_TWO_STAGE). Stage 1 classifies the input
+// 64 bytes at a time into bitmasks and records the offset of every
+// structural character outside strings ({ } [ ] : , and the ')' closing
+// @set/@map), every opening quote, every '@' and the first byte of every
+// bare token. Comments, @type(...) payloads and the '(' of @set/@map are
+// dealt with in stage 1 as well, so stage 2 walks the index alone, with no
+// whitespace or comment skipping, and drives the tree builder from an
+// explicit frame stack. Stage 2 only accepts what the recursive parser
+// accepts; anything else is parsed again by the recursive engine, which
+// also produces the error message.
+
+// Character classes of one 64-byte block; bit i describes byte i
+typedef struct {
+    uint64_t whitespace;
+    uint64_t structural;     // { } [ ] : , )
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t special;        // '/' and '@': comments and extended types
+} bjson_block_masks_t;
+
+static void classify_block(const char* p, bjson_block_masks_t* m) {
+#if BJSON_X86_SIMD
+    memset(m, 0, sizeof(*m));
+    for (int i = 0; i < 64; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+        // Setting bit 5 folds '[' onto '{' and ']' onto '}'
+        __m128i folded = _mm_or_si128(block, _mm_set1_epi8(0x20));
+        __m128i structural = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                                                       _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+                                          _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(':')),
+                                                                    _mm_cmpeq_epi8(block, _mm_set1_epi8(','))),
+                                                       _mm_cmpeq_epi8(block, _mm_set1_epi8(')'))));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('/')),
+                                       _mm_cmpeq_epi8(block, _mm_set1_epi8('@')));
+        m->whitespace |= (uint64_t)whitespace_mask_sse2(block) << i;
+        m->structural |= (uint64_t)(uint32_t)_mm_movemask_epi8(structural) << i;
+        m->quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('"'))) << i;
+        m->backslash |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\\'))) << i;
+        m->special |= (uint64_t)(uint32_t)_mm_movemask_epi8(special) << i;
+    }
+#else
+    memset(m, 0, sizeof(*m));
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = 1ULL << i;
+        switch (p[i]) {
+            case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
+                m->whitespace |= bit;
+                break;
+            case '{': case '}': case '[': case ']': case ':': case ',': case ')':
+                m->structural |= bit;
+                break;
+            case '"':
+                m->quote |= bit;
+                break;
+            case '\\':
+                m->backslash |= bit;
+                break;
+            case '/': case '@':
+                m->special |= bit;
+                break;
+        }
+    }
+#endif
+}
+
+// Bit i set when an odd number of bits at or below i are set in x
+static inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Structural index under construction
+typedef struct {
+    uint32_t* positions;
+    size_t count;
+    size_t capacity;
+    int separated;           // The last byte ended a token, so a bare token may start
+    bjson_error_t failed;    // Out of memory, or input stage 2 must not see
+} bjson_indexer_t;
+
+static int index_reserve(bjson_indexer_t* ix, size_t needed) {
+    if (ix->count + needed <= ix->capacity) return 1;
+    
+    size_t capacity = ix->capacity * 2;
+    while (capacity < ix->count + needed) capacity *= 2;
+    uint32_t* positions = realloc(ix->positions, capacity * sizeof(uint32_t));
+    if (!positions) {
+        ix->failed = BJSON_ERROR_MEMORY;
+        return 0;
+    }
+    ix->positions = positions;
+    ix->capacity = capacity;
+    return 1;
+}
+
+static inline void index_push(bjson_indexer_t* ix, size_t pos) {
+    if (index_reserve(ix, 1)) ix->positions[ix->count++] = (uint32_t)pos;
+}
+
+// Offset just past the '"' closing the string whose body starts at pos
+static size_t skip_string_body(const char* input, size_t length, size_t pos) {
+    while (pos < length) {
+        pos += scan_string_run(input + pos, length - pos);
+        if (pos >= length) break;
+        if (input[pos] == '"') return pos + 1;
+        pos += 2; // Backslash and the byte it escapes
+    }
+    return length;
+}
+
+// Offset past an extended type whose name starts at pos: the '(' of @set
+// and @map, whose contents are indexed as usual, or the whole payload of
+// any other type, with the rules of parse_regex for @regex and of
+// skip_extended_payload for the rest
+static size_t skip_type_header(const char* input, size_t length, size_t pos) {
+    size_t name = pos;
+    while (pos < length && (isalnum(input[pos]) || input[pos] == '_')) pos++;
+    if (pos >= length || input[pos] != '(') return pos;
+    if (pos - name == 3 && (memcmp(input + name, "set", 3) == 0 || memcmp(input + name, "map", 3) == 0)) {
+        return pos + 1;
+    }
+    if (pos - name == 5 && memcmp(input + name, "regex", 5) == 0) {
+        size_t close;
+        pos++;
+        scan_regex_payload(input, length, &pos, &close);
+        return pos;
+    }
+    
+    int depth = 0;
+    char quote = 0;
+    pos++;
+    while (pos < length) {
+        char c = input[pos++];
+        if (c == '\\' && pos < length) {
+            pos++;
+        } else if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            if (depth-- == 0) break;
+        }
+    }
+    return pos;
+}
+
+// Index input[pos..) a byte or token at a time until at least stop, for the
+// blocks holding comments, extended types or stray backslashes. Strings,
+// comments and payloads are consumed whole, so the walk always ends outside
+// them. in_string and escaped describe the state at pos.
+static size_t index_scalar(bjson_indexer_t* ix, const char* input, size_t length, size_t pos, size_t stop,
+                           int in_string, int escaped) {
+    if (in_string) {
+        pos = skip_string_body(input, length, pos + (size_t)escaped);
+        ix->separated = 1;
+    }
+    
+    while (pos < stop && pos < length) {
+        char c = input[pos];
+        switch (c) {
+            case '{': case '}': case '[': case ']': case ':': case ',': case ')':
+                index_push(ix, pos++);
+                ix->separated = 1;
+                break;
+            case '"':
+                index_push(ix, pos);
+                pos = skip_string_body(input, length, pos + 1);
+                ix->separated = 1;
+                break;
+            case '@':
+                index_push(ix, pos);
+                pos = skip_type_header(input, length, pos + 1);
+                ix->separated = 1;
+                break;
+            case '/':
+                if (pos + 1 < length && input[pos + 1] == '/') {
+                    const char* nl = memchr(input + pos + 2, '\n', length - pos - 2);
+                    pos = nl ? (size_t)(nl - input) : length;
+                } else if (pos + 1 < length && input[pos + 1] == '*') {
+                    size_t end = pos + 2;
+                    while (end + 1 < length && !(input[end] == '*' && input[end + 1] == '/')) end++;
+                    if (end + 1 >= length) {
+                        // Unterminated: leave it to the recursive parser
+                        ix->failed = BJSON_ERROR_SYNTAX;
+                        return length;
+                    }
+                    pos = end + 2;
+                } else {
+                    // A stray '/' is indexed so that stage 2 rejects it
+                    index_push(ix, pos++);
+                }
+                ix->separated = 1;
+                break;
+            case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
+                pos++;
+                ix->separated = 1;
+                break;
+            default:
+                if (ix->separated) index_push(ix, pos);
+                pos++;
+                ix->separated = 0;
+                break;
+        }
+    }
+    return pos;
+}
+
+// Stage 1: fill parser->index. Inputs of 4 GB or more, allocation failure
+// and unterminated block comments leave no index and an error message.
+static bjson_error_t build_structural_index(bjson_parser_t* parser) {
+    const char* input = parser->input;
+    size_t length = parser->length;
+    if (length >= UINT32_MAX) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), "Input too large to index");
+        return BJSON_ERROR_MEMORY;
+    }
+    
+    bjson_indexer_t ix = {0};
+    ix.capacity = length / 8 + 64;
+    ix.positions = malloc(ix.capacity * sizeof(uint32_t));
+    if (!ix.positions) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), "Out of memory");
+        return BJSON_ERROR_MEMORY;
+    }
+    ix.separated = 1;
+    
+    uint64_t in_string = 0;      // All ones while a string spans blocks
+    uint64_t escape_carry = 0;   // The previous block ended in an escaping backslash
+    size_t pos = 0;
+    while (pos < length && !ix.failed) {
+        const char* block = input + pos;
+        char padded[64];
+        if (length - pos < 64) {
+            // Pad the tail with whitespace, which is never indexed
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, length - pos);
+            block = padded;
+        }
+        bjson_block_masks_t m;
+        classify_block(block, &m);
+        
+        // Bytes escaped by a backslash, with runs of backslashes pairing up
+        uint64_t backslash = m.backslash;
+        uint64_t escaped = escape_carry;
+        uint64_t next_carry = 0;
+        backslash &= ~escape_carry;
+        while (backslash) {
+            int i = __builtin_ctzll(backslash);
+            if (i == 63) {
+                next_carry = 1;
+                break;
+            }
+            escaped |= 2ULL << i;
+            backslash &= ~(3ULL << i);
+        }
+        uint64_t quotes = m.quote & ~escaped;
+        uint64_t strings = prefix_xor(quotes) ^ in_string;
+        
+        // Comments, extended types and backslashes outside strings need the
+        // byte-level walk; the block is redone from its start
+        if ((m.special | m.backslash) & ~strings) {
+            pos = index_scalar(&ix, input, length, pos, pos + 64, in_string != 0, escape_carry != 0);
+            in_string = 0;
+            escape_carry = 0;
+            continue;
+        }
+        
+        uint64_t separators = m.whitespace | m.structural | quotes;
+        uint64_t starts = ~(separators | strings) & ((separators << 1) | (uint64_t)ix.separated);
+        uint64_t structurals = (m.structural & ~strings) | (quotes & strings) | starts;
+        ix.separated = (int)(separators >> 63);
+        in_string = (uint64_t)((int64_t)strings >> 63);
+        escape_carry = next_carry;
+        
+        if (!index_reserve(&ix, 64)) break;
+        uint32_t* out = ix.positions + ix.count;
+        ix.count += (size_t)__builtin_popcountll(structurals);
+        while (structurals) {
+            *out++ = (uint32_t)(pos + (size_t)__builtin_ctzll(structurals));
+            structurals &= structurals - 1;
+        }
+        pos += 64;
+    }
+    
+    if (ix.failed) {
+        free(ix.positions);
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                ix.failed == BJSON_ERROR_MEMORY ? "Out of memory" : "Unterminated comment");
+        return ix.failed;
+    }
+    parser->index = ix.positions;
+    parser->index_count = ix.count;
+    return BJSON_SUCCESS;
+}
+
+// Frame of the stage 2 walk
+typedef struct {
+    unsigned char is_object;
+    unsigned char is_extended;   // Opened by @set( or @map(, so a ')' follows
+    unsigned char state;
+    size_t count;
+} bjson_index_frame_t;
+
+enum {
+    BJSON_INDEX_FIRST,       // After the opening bracket or a comma
+    BJSON_INDEX_AFTER,       // After a member; a comma is optional
+    BJSON_INDEX_COLON,       // After an object key
+    BJSON_INDEX_VALUE        // After ':'
+};
+
+// Bracket wrapped by the @set( or @map( at input[at], or 0 for any other value
+static char index_wrapper(const char* input, size_t length, size_t at) {
+    if (input[at] != '@' || at + 4 >= length || input[at + 4] != '(') return 0;
+    if (memcmp(input + at + 1, "set", 3) == 0) return '[';
+    if (memcmp(input + at + 1, "map", 3) == 0) return '{';
+    return 0;
+}
+
+// Bytes that may follow a scalar token
+static inline int is_token_end(char c) {
+    switch (c) {
+        case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
+        case '{': case '}': case '[': case ']': case ':': case ',': case ')':
+        case '"': case '/': case '@':
+            return 1;
+    }
+    return 0;
+}
+
+// Stage 2: deliver the events of the indexed document. Returns 0 without a
+// message whenever the input needs the recursive parser.
+static int parse_indexed(bjson_parser_t* parser) {
+    const char* input = parser->input;
+    const uint32_t* index = parser->index;
+    size_t n = parser->index_count;
+    bjson_index_frame_t* stack = NULL;
+    size_t depth = 0, capacity = 0;
+    size_t k = 0;
+    int ok = 0;
+    
+    while (k < n) {
+        size_t at = index[k++];
+        char c = input[at];
+        bjson_index_frame_t* top = depth ? &stack[depth - 1] : NULL;
+        
+        if (c == ',') {
+            if (!top || top->state != BJSON_INDEX_AFTER) goto done;
+            top->state = BJSON_INDEX_FIRST;
+            continue;
+        }
+        if (c == ':') {
+            if (!top || top->state != BJSON_INDEX_COLON) goto done;
+            top->state = BJSON_INDEX_VALUE;
+            continue;
+        }
+        if (c == ']' || c == '}') {
+            if (!top || top->is_object != (c == '}') ||
+                (top->state != BJSON_INDEX_FIRST && top->state != BJSON_INDEX_AFTER)) {
+                goto done;
+            }
+            depth--;
+            int event;
+            if (top->is_object) {
+                event = top->is_extended ? BJSON_SAX_CALL(parser, end_map, (parser->sax_ctx, top->count))
+                                         : BJSON_SAX_CALL(parser, end_object, (parser->sax_ctx, top->count));
+            } else {
+                event = top->is_extended ? BJSON_SAX_CALL(parser, end_set, (parser->sax_ctx, top->count))
+                                         : BJSON_SAX_CALL(parser, end_array, (parser->sax_ctx, top->count));
+            }
+            if (!event) goto done;
+            if (top->is_extended) {
+                if (k >= n || input[index[k]] != ')') goto done;
+                k++;
+            }
+        } else {
+            // Anything else starts a value, which must be expected here
+            if (c == ')' || c == '/' || (top && top->state == BJSON_INDEX_COLON)) goto done;
+            
+            char open = index_wrapper(input, parser->length, at);
+            int is_extended = open != 0;
+            if (is_extended) {
+                // @set( and @map( must wrap an array and an object
+                if (k >= n || input[index[k]] != open) goto done;
+                at = index[k++];
+                c = open;
+            }
+            
+            if (c == '[' || c == '{') {
+                if (depth == capacity) {
+                    capacity = grow_capacity(capacity, depth + 1);
+                    bjson_index_frame_t* grown = realloc(stack, capacity * sizeof(bjson_index_frame_t));
+                    if (!grown) goto done;
+                    stack = grown;
+                }
+                bjson_index_frame_t* frame = &stack[depth++];
+                frame->is_object = c == '{';
+                frame->is_extended = (unsigned char)is_extended;
+                frame->state = BJSON_INDEX_FIRST;
+                frame->count = 0;
+                
+                // Start events see pos on the bracket, for the size hints
+                parser->pos = at;
+                int event;
+                if (c == '{') {
+                    event = is_extended ? BJSON_SAX_CALL(parser, start_map, (parser->sax_ctx))
+                                        : BJSON_SAX_CALL(parser, start_object, (parser->sax_ctx));
+                } else {
+                    event = is_extended ? BJSON_SAX_CALL(parser, start_set, (parser->sax_ctx))
+                                        : BJSON_SAX_CALL(parser, start_array, (parser->sax_ctx));
+                }
+                if (!event) goto done;
+                continue;
+            }
+            
+            parser->pos = at;
+            if (c == '"') {
+                int is_key = top && top->is_object && top->state != BJSON_INDEX_VALUE;
+                if (!parse_string(parser, is_key)) goto done;
+            } else if (!parse_value(parser)) {
+                goto done;
+            }
+            // Inside a container the token must end where stage 1 thought it did
+            if (depth) {
+                if (parser->pos < parser->length && !is_token_end(input[parser->pos])) goto done;
+                if (k < n && index[k] < parser->pos) goto done;
+            }
+        }
+        
+        // A value is complete
+        if (!depth) {
+            // Root done; trailing content is ignored, as by parse_value
+            ok = 1;
+            goto done;
+        }
+        top = &stack[depth - 1];
+        if (!top->is_object || top->state == BJSON_INDEX_VALUE) {
+            top->state = BJSON_INDEX_AFTER;
+            top->count++;
+        } else {
+            top->state = BJSON_INDEX_COLON;
+        }
+    }
+    
+    // End of input: like the recursive parser, close what is still open,
+    // unless a key lacks its value or a ')' is missing
+    if (!depth) goto done;
+    while (depth) {
+        bjson_index_frame_t* top = &stack[--depth];
+        if (top->is_extended || (top->state != BJSON_INDEX_FIRST && top->state != BJSON_INDEX_AFTER)) goto done;
+        int event = top->is_object ? BJSON_SAX_CALL(parser, end_object, (parser->sax_ctx, top->count))
+                                   : BJSON_SAX_CALL(parser, end_array, (parser->sax_ctx, top->count));
+        if (!event) goto done;
+        if (depth) {
+            bjson_index_frame_t* parent = &stack[depth - 1];
+            if (parent->is_object && parent->state != BJSON_INDEX_VALUE) goto done;
+            parent->state = BJSON_INDEX_AFTER;
+            parent->count++;
+        }
+    }
+    ok = 1;
+    
+done:
+    free(stack);
+    return ok;
+}
+
+// Tree building: a handler that assembles bjson_value_t nodes from the
+// token events. Containers are attached to their parent once complete, so
+// sets can hash their members and objects can build their key index.
+// Object members wait on a stack shared by all open objects, so every
+// object gets exact-size storage (and, when keys are shared, its shape)
+// once its last member is known.
+
+typedef struct {
+    bjson_value_t* container;
+    bjson_value_t* key;      // Pending key of a map member
+    size_t members;          // Objects: start of their keys and values on the member stack
+} bjson_build_frame_t;
+
+typedef struct {
+    bjson_parser_t* parser;  // Allocation source, flags and size hints
+    bjson_build_frame_t* stack;
+    size_t depth;
+    size_t capacity;
+    bjson_value_t* root;
+    bjson_value_t** members; // Keys and values of the open objects, alternating
+    size_t member_count;
+    size_t member_capacity;
+} bjson_builder_t;
+
+static int build_out_of_memory(bjson_builder_t* b) {
+    snprintf(b->parser->error_msg, sizeof(b->parser->error_msg), "Out of memory");
+    return 1;
+}
+
+// Make room for at least needed entries on the member stack
+static int reserve_members(bjson_builder_t* b, size_t needed) {
+    if (needed <= b->member_capacity) return 1;
+    
+    size_t capacity = grow_capacity(b->member_capacity, needed);
+    bjson_value_t** members = realloc(b->members, sizeof(bjson_value_t*) * capacity);
+    if (!members) return 0;
+    
+    b->members = members;
+    b->member_capacity = capacity;
+    return 1;
+}
+
+// Add a finished value to the innermost open container; returns nonzero
+// (stop) on failure, after freeing the value
+static int build_attach(bjson_builder_t* b, bjson_value_t* value) {
+    if (!value) return build_out_of_memory(b);
+    if (!b->depth) {
+        b->root = value;
+        return 0;
+    }
+    
+    bjson_parser_t* parser = b->parser;
+    bjson_build_frame_t* frame = &b->stack[b->depth - 1];
+    bjson_value_t* container = frame->container;
+    
+    switch (container->type) {
+        case BJSON_ARRAY:
+            if (!reserve_array(parser, container, container->array_val.count + 1)) break;
+            container->array_val.items[container->array_val.count++] = value;
+            return 0;
+        case BJSON_SET: {
+            int added = set_insert(parser->arena, container->set_val, value);
+            if (added < 0) break;
+            if (added == 0) bjson_free_value(value);  // Duplicate
+            return 0;
+        }
+        case BJSON_OBJECT:
+            if (!reserve_members(b, b->member_count + 1)) break;
+            b->members[b->member_count++] = value;
+            return 0;
+        case BJSON_MAP:
+            if (!frame->key) {
+                frame->key = value;
+                return 0;
+            }
+            if (map_insert(parser->arena, container->map_val, frame->key, value) < 0) break;
+            frame->key = NULL;
+            return 0;
+        default:
+            break;
+    }
+    
+    bjson_free_value(value);
+    return build_out_of_memory(b);
+}
+
+static int build_open(bjson_builder_t* b, bjson_type_t type) {
+    bjson_parser_t* parser = b->parser;
+    if (b->depth == b->capacity) {
+        size_t capacity = grow_capacity(b->capacity, b->depth + 1);
+        bjson_build_frame_t* stack = realloc(b->stack, sizeof(bjson_build_frame_t) * capacity);
+        if (!stack) return build_out_of_memory(b);
+        b->stack = stack;
+        b->capacity = capacity;
+    }
+    
+    bjson_value_t* container = parser_create_value(parser, type);
+    if (!container) return build_out_of_memory(b);
+    
+    // The parser is still on the opening bracket, where the pre-pass keyed its count
+    size_t hint = parser->size_hints ? take_size_hint(parser) : 0;
+    int reserved = 1;
+    if (type == BJSON_ARRAY) reserved = reserve_array(parser, container, hint);
+    if (type == BJSON_OBJECT) reserved = reserve_members(b, b->member_count + 2 * hint);
+    if (!reserved) {
+        bjson_free_value(container);
+        return build_out_of_memory(b);
+    }
+    
+    b->stack[b->depth].container = container;
+    b->stack[b->depth].key = NULL;
+    b->stack[b->depth].members = b->member_count;
+    b->depth++;
+    return 0;
+}
+
+// Copy text into a string node, or view it in place when borrowing is on
+// and it lies in the input (escaped strings live in the scratch buffer)
+static bjson_value_t* build_text(bjson_builder_t* b, bjson_type_t type, const char* data, size_t length) {
+    bjson_parser_t* parser = b->parser;
+    bjson_value_t* value = parser_create_value(parser, type);
+    if (!value) return NULL;
+    
+    value->string_val.length = length;
+    if ((parser->flags & BJSON_PARSE_BORROW_STRINGS) &&
+        data >= parser->input && data + length <= parser->input + parser->length) {
+        value->string_val.data = (char*)data;
+        value->flags |= BJSON_VALUE_BORROWED;
+        return value;
+    }
+    
+    value->string_val.data = parser_alloc(parser, length + 1);
+    if (!value->string_val.data) {
+        bjson_free_value(value);
+        return NULL;
+    }
+    memcpy(value->string_val.data, data, length);
+    value->string_val.data[length] = '\0';
+    return value;
+}
+
+// Key interning and shapes (BJSON_PARSE_SHARE_KEYS). Every distinct object
+// key of a document becomes one shared string node, and objects whose keys
+// are the same interned nodes in the same order share one shape: the key
+// vector and its index. A record array then stores each key once and each
+// record only its values. The tables belong to the document; their entries
+// come from its arena or, without one, the heap.
+
+struct bjson_intern {
+    bjson_arena_t* arena;
+    bjson_value_t** keys;    // Open addressing over interned keys by string_hash
+    size_t key_mask;
+    size_t key_count;
+    bjson_shape_t** shapes;  // Open addressing over shapes by hash
+    size_t shape_mask;
+    size_t shape_count;
+};
+
+static bjson_intern_t* intern_create(bjson_arena_t* arena) {
+    bjson_intern_t* intern = calloc(1, sizeof(bjson_intern_t));
+    if (intern) intern->arena = arena;
+    return intern;
+}
+
+// Forget every key and shape; heap entries are freed, arena entries go
+// with the arena
+static void intern_clear(bjson_intern_t* intern) {
+    if (!intern->arena) {
+        for (size_t i = 0; intern->keys && i <= intern->key_mask; i++) {
+            bjson_value_t* key = intern->keys[i];
+            if (!key) continue;
+            if (!(key->flags & BJSON_VALUE_BORROWED)) free(key->string_val.data);
+            free(key);
+        }
+        for (size_t i = 0; intern->shapes && i <= intern->shape_mask; i++) {
+            bjson_shape_t* shape = intern->shapes[i];
+            if (!shape) continue;
+            free(shape->keys);
+            free(shape->index);
+            free(shape);
+        }
+    }
+    free(intern->keys);
+    free(intern->shapes);
+    intern->keys = NULL;
+    intern->shapes = NULL;
+    intern->key_mask = intern->key_count = 0;
+    intern->shape_mask = intern->shape_count = 0;
+}
+
+static void intern_destroy(bjson_intern_t* intern) {
+    if (!intern) return;
+    intern_clear(intern);
+    free(intern);
+}
+
+// Double the key table (or start it at 64 slots) to keep it at most half full
+static int intern_grow_keys(bjson_intern_t* intern) {
+    size_t slots = intern->keys ? (intern->key_mask + 1) * 2 : 64;
+    bjson_value_t** keys = calloc(slots, sizeof(bjson_value_t*));
+    if (!keys) return 0;
+    
+    for (size_t i = 0; intern->keys && i <= intern->key_mask; i++) {
+        if (!intern->keys[i]) continue;
+        size_t slot = intern->keys[i]->string_hash & (slots - 1);
+        while (keys[slot]) slot = (slot + 1) & (slots - 1);
+        keys[slot] = intern->keys[i];
+    }
+    free(intern->keys);
+    intern->keys = keys;
+    intern->key_mask = slots - 1;
+    return 1;
+}
+
+// The same for the shape table
+static int intern_grow_shapes(bjson_intern_t* intern) {
+    size_t slots = intern->shapes ? (intern->shape_mask + 1) * 2 : 64;
+    bjson_shape_t** shapes = calloc(slots, sizeof(bjson_shape_t*));
+    if (!shapes) return 0;
+    
+    for (size_t i = 0; intern->shapes && i <= intern->shape_mask; i++) {
+        if (!intern->shapes[i]) continue;
+        size_t slot = intern->shapes[i]->hash & (slots - 1);
+        while (shapes[slot]) slot = (slot + 1) & (slots - 1);
+        shapes[slot] = intern->shapes[i];
+    }
+    free(intern->shapes);
+    intern->shapes = shapes;
+    intern->shape_mask = slots - 1;
+    return 1;
+}
+
+// The document's node for an object key, created on first sight
+static bjson_value_t* intern_key(bjson_builder_t* b, const char* data, size_t length) {
+    bjson_intern_t* intern = b->parser->intern;
+    if ((intern->key_count + 1) * 2 > (intern->keys ? intern->key_mask + 1 : 0) && !intern_grow_keys(intern)) {
+        return NULL;
+    }
+    
+    uint32_t hash = key_hash(data, length);
+    size_t slot = hash & intern->key_mask;
+    for (; intern->keys[slot]; slot = (slot + 1) & intern->key_mask) {
+        if (key_matches(intern->keys[slot], data, length, hash)) return intern->keys[slot];
+    }
+    
+    bjson_value_t* key = build_text(b, BJSON_STRING, data, length);
+    if (!key) return NULL;
+    key->string_hash = hash;
+    key->flags |= BJSON_VALUE_HASHED | BJSON_VALUE_SHARED;
+    intern->keys[slot] = key;
+    intern->key_count++;
+    return key;
+}
+
+// The document's shape for count keys (members alternate key, value),
+// created on first sight; NULL when a key is not interned, for example a
+// non-string key, or when memory runs out
+static const bjson_shape_t* intern_shape(bjson_parser_t* parser, bjson_value_t* const* members, size_t count) {
+    bjson_intern_t* intern = parser->intern;
+    uint64_t hash = count;
+    for (size_t i = 0; i < count; i++) {
+        const bjson_value_t* key = members[2 * i];
+        if (!(key->flags & BJSON_VALUE_SHARED)) return NULL;
+        hash = (hash ^ key->string_hash) * 0x100000001B3ULL;
+    }
+    hash = hash_mix(hash);
+    
+    if ((intern->shape_count + 1) * 2 > (intern->shapes ? intern->shape_mask + 1 : 0) && !intern_grow_shapes(intern)) {
+        return NULL;
+    }
+    size_t slot = hash & intern->shape_mask;
+    for (; intern->shapes[slot]; slot = (slot + 1) & intern->shape_mask) {
+        const bjson_shape_t* shape = intern->shapes[slot];
+        if (shape->hash != hash || shape->count != count) continue;
+        size_t i = 0;
+        while (i < count && shape->keys[i] == members[2 * i]) i++;
+        if (i == count) return shape;
+    }
+    
+    bjson_shape_t* shape = parser_alloc(parser, sizeof(bjson_shape_t));
+    bjson_value_t** keys = parser_alloc(parser, sizeof(bjson_value_t*) * count);
+    uint32_t* index = NULL;
+    size_t index_mask = 0;
+    if (shape && keys) {
+        for (size_t i = 0; i < count; i++) keys[i] = members[2 * i];
+        if (count >= BJSON_OBJECT_INDEX_THRESHOLD) index = index_keys(parser, keys, count, &index_mask);
+    }
+    if (!shape || !keys || (count >= BJSON_OBJECT_INDEX_THRESHOLD && !index)) {
+        if (!parser->arena) {
+            free(shape);
+            free(keys);
+        }
+        return NULL;
+    }
+    
+    shape->keys = keys;
+    shape->count = count;
+    shape->index = index;
+    shape->index_mask = index_mask;
+    shape->hash = hash;
+    intern->shapes[slot] = shape;
+    intern->shape_count++;
+    return shape;
+}
+
+// Move a closing object's members off the member stack into its storage:
+// just the values when its keys match a shape, otherwise one block of keys
+// then values, indexed when large. On failure the members are freed.
+static int build_object(bjson_builder_t* b, bjson_object_t* obj, size_t base) {
+    bjson_parser_t* parser = b->parser;
+    // An odd member out is a key whose value never came (truncated input)
+    if ((b->member_count - base) % 2) bjson_free_value(b->members[--b->member_count]);
+    
+    bjson_value_t** members = b->members + base;
+    size_t count = (b->member_count - base) / 2;
+    const bjson_shape_t* shape = parser->intern && count ? intern_shape(parser, members, count) : NULL;
+    if (shape) {
+        obj->values = parser_alloc(parser, sizeof(bjson_value_t*) * count);
+        if (obj->values) {
+            obj->keys = shape->keys;
+            obj->capacity = count;
+            obj->shape = shape;
+            obj->index = shape->index;
+            obj->index_mask = shape->index_mask;
+        }
+    } else if (reserve_object(parser, obj, count)) {
+        for (size_t i = 0; i < count; i++) obj->keys[i] = members[2 * i];
+    }
+    if (count && !obj->values) {
+        while (b->member_count > base) bjson_free_value(b->members[--b->member_count]);
+        return 0;
+    }
+    
+    for (size_t i = 0; i < count; i++) obj->values[i] = members[2 * i + 1];
+    obj->count = count;
+    obj->index_count = count;
+    b->member_count = base;
+    return shape || count < BJSON_OBJECT_INDEX_THRESHOLD || build_object_index(parser, obj);
+}
+
+static int build_close(bjson_builder_t* b) {
+    bjson_build_frame_t* frame = &b->stack[--b->depth];
+    bjson_value_t* container = frame->container;
+    
+    // A key with no value can only come from truncated input
+    bjson_free_value(frame->key);
+    frame->key = NULL;
+    
+    if (container->type == BJSON_OBJECT && !build_object(b, container->object_val, frame->members)) {
+        bjson_free_value(container);
+        return build_out_of_memory(b);
+    }
+    return build_attach(b, container);
+}
+
+static int build_start_object(void* ctx) { return build_open(ctx, BJSON_OBJECT); }
+static int build_start_array(void* ctx) { return build_open(ctx, BJSON_ARRAY); }
+static int build_start_set(void* ctx) { return build_open(ctx, BJSON_SET); }
+static int build_start_map(void* ctx) { return build_open(ctx, BJSON_MAP); }
+
+static int build_end(void* ctx, size_t count) {
+    (void)count;
+    return build_close(ctx);
+}
+
+static int build_key(void* ctx, const char* data, size_t length) {
+    bjson_builder_t* b = ctx;
+    // Map keys stay private: a map frees the key of a replaced entry
+    if (b->parser->intern && b->depth && b->stack[b->depth - 1].container->type == BJSON_OBJECT) {
+        return build_attach(b, intern_key(b, data, length));
+    }
+    
+    bjson_value_t* key = build_text(b, BJSON_STRING, data, length);
+    if (key) {
+        // Hashed here rather than inside scan_string: lookups hash the
+        // unescaped bytes, which an escaped key only has once its scan is
+        // done, and the key event carries no hash. The bytes were just
+        // scanned and copied, so this pass runs from cache
+        key->string_hash = key_hash(data, length);
+        key->flags |= BJSON_VALUE_HASHED;
+    }
+    return build_attach(b, key);
+}
+
+static int build_string(void* ctx, const char* data, size_t length) {
+    return build_attach(ctx, build_text(ctx, BJSON_STRING, data, length));
+}
+
+static int build_decimal(void* ctx, const char* digits, size_t length) {
+    return build_attach(ctx, build_text(ctx, BJSON_DECIMAL, digits, length));
+}
+
+static int build_null(void* ctx) {
+    bjson_builder_t* b = ctx;
+    return build_attach(b, parser_create_value(b->parser, BJSON_NULL));
+}
+
+static int build_bool(void* ctx, int value) {
+    bjson_builder_t* b = ctx;
+    bjson_value_t* node = parser_create_value(b->parser, BJSON_BOOL);
+    if (node) node->bool_val = value;
+    return build_attach(b, node);
+}
+
+static int build_int(void* ctx, long long value) {
+    bjson_builder_t* b = ctx;
+    bjson_value_t* node = parser_create_value(b->parser, BJSON_INT);
+    if (node) node->int_val = value;
+    return build_attach(b, node);
+}
+
+static int build_double(void* ctx, double value) {
+    bjson_builder_t* b = ctx;
+    bjson_value_t* node = parser_create_value(b->parser, BJSON_DOUBLE);
+    if (node) node->double_val = value;
+    return build_attach(b, node);
+}
+
+static int build_date(void* ctx, const bjson_date_t* date) {
+    bjson_builder_t* b = ctx;
+    bjson_value_t* node = parser_create_value(b->parser, BJSON_DATE);
+    if (node) node->date_val = *date;
+    return build_attach(b, node);
+}
+
+static int build_datetime(void* ctx, const bjson_datetime_t* datetime) {
+    bjson_builder_t* b = ctx;
+    bjson_value_t* node = datetime->timezone ? parser_create_extended(b->parser, BJSON_DATETIME)
+                                             : parser_create_value(b->parser, BJSON_DATETIME);
+    if (node) {
+        node->datetime_val = pack_datetime(datetime);
+        if (datetime->timezone) {
+            bjson_value_ext_t* ext = bjson_value_ext(node);
+            ext->timezone = parser_strdup(b->parser, datetime->timezone);
+            if (!ext->timezone) {
+                bjson_free_value(node);
+                node = NULL;
+            }
+        }
+    }
+    return build_attach(b, node);
+}
+
+static int build_duration(void* ctx, const bjson_duration_t* duration) {
+    bjson_builder_t* b = ctx;
+    bjson_value_t* node = parser_create_value(b->parser, BJSON_DURATION);
+    if (node) node->duration_val = *duration;
+    return build_attach(b, node);
+}
+
+static int build_custom(void* ctx, unsigned type, const uint8_t* payload, size_t length) {
+    bjson_builder_t* b = ctx;
+    bjson_value_t* node = bjson_custom_type_name(type) ? custom_value_alloc(b->parser->arena, type, payload, length)
+                                                       : NULL;
+    return build_attach(b, node);
+}
+
+// Bytes node with an unfilled buffer of length bytes, so a payload can be
+// decoded straight into the tree (see parse_bytes)
+static bjson_value_t* build_bytes_node(bjson_builder_t* b, size_t length) {
+    bjson_value_t* node = parser_create_value(b->parser, BJSON_BYTES);
+    if (!node) return NULL;
+    
+    node->bytes_val.length = length;
+    node->bytes_val.data = parser_alloc(b->parser, length ? length : 1);
+    if (!node->bytes_val.data) {
+        bjson_free_value(node);
+        return NULL;
+    }
+    return node;
+}
+
+static int build_bytes(void* ctx, const uint8_t* data, size_t length) {
+    bjson_value_t* node = build_bytes_node(ctx, length);
+    if (node) memcpy(node->bytes_val.data, data, length);
+    return build_attach(ctx, node);
+}
+
+static int build_regex(void* ctx, const char* pattern, const char* flags) {
+    bjson_builder_t* b = ctx;
+    bjson_value_t* node = parser_create_value(b->parser, BJSON_REGEX);
+    if (node) {
+        node->regex_val.pattern = parser_strdup(b->parser, pattern);
+        node->regex_val.flags = parser_strdup(b->parser, flags);
+        if (!node->regex_val.pattern || !node->regex_val.flags || !parser_bind_regex(b->parser, node)) {
+            bjson_free_value(node);
+            node = NULL;
+        }
+    }
+    return build_attach(b, node);
+}
+
+static int build_ref(void* ctx, const char* path) {
+    bjson_builder_t* b = ctx;
+    bjson_value_t* node = parser_create_value(b->parser, BJSON_REFERENCE);
+    if (node) {
+        node->ref_val.path = parser_strdup(b->parser, path);
+        if (!node->ref_val.path) {
+            bjson_free_value(node);
+            node = NULL;
+        }
+    }
+    return build_attach(b, node);
+}
+
+static const bjson_sax_handler_t bjson_tree_builder = {
+    build_start_object, build_end, build_start_array, build_end,
+    build_start_set, build_end, build_start_map, build_end,
+    build_key, build_null, build_bool, build_int, build_double, build_decimal, build_string,
+    build_date, build_datetime, build_bytes, build_regex, build_ref, build_duration, build_custom
+};
+
+// Free a partly built tree: the containers still open, innermost first,
+// the members of open objects, and the root
+static void build_discard(bjson_builder_t* b) {
+    while (b->depth) {
+        bjson_build_frame_t* frame = &b->stack[--b->depth];
+        bjson_free_value(frame->key);
+        bjson_free_value(frame->container);
+    }
+    while (b->member_count) bjson_free_value(b->members[--b->member_count]);
+    bjson_free_value(b->root);
+    b->root = NULL;
+}
+
+// Parse one value from the parser's input into a tree, with the tree builder
+// as the event consumer
+static bjson_value_t* parse_tree(bjson_parser_t* parser) {
+    bjson_builder_t builder = {0};
+    builder.parser = parser;
+    parser->sax = &bjson_tree_builder;
+    parser->sax_ctx = &builder;
+    
+    int ok;
+    if (parser->index) {
+        ok = parse_indexed(parser);
+    } else {
+        skip_whitespace_and_comments(parser);
+        ok = parse_value(parser);
+    }
+    
+    if (!ok) build_discard(&builder);
+    free(builder.stack);
+    free(builder.members);
+    return builder.root;
+}
+
+// Stream the events of one value to a handler without building any nodes.
+// Returns BJSON_ERROR_PARTIAL when a callback stopped the parse; the
+// message of any failure is left for bjson_error_message.
+bjson_error_t bjson_parse_sax(const char* input, size_t length, unsigned flags,
+                              const bjson_sax_handler_t* handler, void* ctx) {
+    if (!input || !handler) return BJSON_ERROR_TYPE;
+    
+    bjson_parser_t parser = {0};
+    parser.input = input;
+    parser.length = length;
+    parser.line = 1;
+    parser.column = 1;
+    parser.flags = flags;
+    parser.sax = handler;
+    parser.sax_ctx = ctx;
+    
+    skip_whitespace_and_comments(&parser);
+    int ok = parse_value(&parser);
+    free(parser.scratch);
+    
+    if (ok) return BJSON_SUCCESS;
+    set_error_message(parser.error_msg);
+    return parser.sax_stopped ? BJSON_ERROR_PARTIAL : BJSON_ERROR_SYNTAX;
+}
+
+// Binary payloads: @bytes(base64:...), @bytes(hex:...) and
+// @bytes(sha256:...), a hex digest of exactly 32 bytes. The decoded size
+// follows from the payload length, so each payload is decoded in a single
+// pass straight into its final buffer; the SIMD loops turn 16 or 32
+// characters into bytes per step and leave the tail and any invalid
+// character to the scalar code. Base64 is standard, padded or not.
+
+static const int8_t bjson_base64_values[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+static const char bjson_base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Strip the padding of n base64 characters and compute their decoded size;
+// 0 when no base64 text has that shape
+static int base64_measure(const char* text, size_t* n, size_t* size) {
+    size_t pad = 0;
+    while (pad < 2 && pad < *n && text[*n - 1 - pad] == '=') pad++;
+    if ((pad && *n % 4) || (*n - pad) % 4 == 1) return 0;
+    
+    *n -= pad;
+    *size = *n / 4 * 3 + (*n % 4 ? *n % 4 - 1 : 0);
+    return 1;
+}
+
+static int base64_decode_scalar(const char* text, size_t n, uint8_t* out) {
+    const uint8_t* in = (const uint8_t*)text;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int a = bjson_base64_values[in[i]], b = bjson_base64_values[in[i + 1]];
+        int c = bjson_base64_values[in[i + 2]], d = bjson_base64_values[in[i + 3]];
+        if ((a | b | c | d) < 0) return 0;
+        uint32_t group = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | (uint32_t)d;
+        *out++ = (uint8_t)(group >> 16);
+        *out++ = (uint8_t)(group >> 8);
+        *out++ = (uint8_t)group;
+    }
+    if (i == n) return 1;
+    
+    // Two or three characters left: one or two bytes
+    int a = bjson_base64_values[in[i]], b = bjson_base64_values[in[i + 1]];
+    int c = n - i == 3 ? bjson_base64_values[in[i + 2]] : 0;
+    if ((a | b | c) < 0) return 0;
+    uint32_t group = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6;
+    *out++ = (uint8_t)(group >> 16);
+    if (n - i == 3) *out = (uint8_t)(group >> 8);
+    return 1;
+}
+
+static int hex_decode_scalar(const char* text, size_t n, uint8_t* out) {
+    for (size_t i = 0; i < n; i += 2) {
+        int high = hex_digit_value(text[i]);
+        int low = hex_digit_value(text[i + 1]);
+        if ((high | low) < 0) return 0;
+        *out++ = (uint8_t)(high << 4 | low);
+    }
+    return 1;
+}
+
+static size_t base64_encode_scalar(const uint8_t* data, size_t length, char* out) {
+    char* start = out;
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t group = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 | data[i + 2];
+        *out++ = bjson_base64_alphabet[group >> 18];
+        *out++ = bjson_base64_alphabet[(group >> 12) & 0x3F];
+        *out++ = bjson_base64_alphabet[(group >> 6) & 0x3F];
+        *out++ = bjson_base64_alphabet[group & 0x3F];
+    }
+    if (i < length) {
+        uint32_t group = (uint32_t)data[i] << 16 | (i + 1 < length ? (uint32_t)data[i + 1] << 8 : 0);
+        *out++ = bjson_base64_alphabet[group >> 18];
+        *out++ = bjson_base64_alphabet[(group >> 12) & 0x3F];
+        *out++ = i + 1 < length ? bjson_base64_alphabet[(group >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+    return (size_t)(out - start);
+}
+
+#if BJSON_X86_SIMD
+
+// Base64 in SIMD after Muła and Lemire: nibble lookups validate and map
+// each character to its 6-bit value, multiply-adds pack four values into
+// three bytes, and a shuffle drops the gaps. Encoding runs the same steps
+// backwards.
+#define BJSON_BASE64_LUT_LO 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, \
+                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+#define BJSON_BASE64_LUT_HI 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, \
+                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+#define BJSON_BASE64_LUT_ROLL 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+#define BJSON_BASE64_PACK 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+#define BJSON_BASE64_SPREAD 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+#define BJSON_BASE64_OFFSETS 65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0
+
+// Characters decoded from text[0..n); stops at the first block holding a
+// non-base64 byte. Every block stores 16 bytes for its 12, so it only runs
+// while 24 characters, and so 16 bytes of output, remain
+__attribute__((target("ssse3")))
+static size_t base64_decode_ssse3(const char* text, size_t n, uint8_t* out) {
+    const __m128i lut_lo = _mm_setr_epi8(BJSON_BASE64_LUT_LO);
+    const __m128i lut_hi = _mm_setr_epi8(BJSON_BASE64_LUT_HI);
+    const __m128i lut_roll = _mm_setr_epi8(BJSON_BASE64_LUT_ROLL);
+    const __m128i nibble = _mm_set1_epi8(0x2F);  // '/', and a low-nibble mask for the shuffles
+    size_t i = 0;
+    
+    for (; n - i >= 24; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(block, 4), nibble);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(block, nibble));
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128()))) break;
+        
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(block, nibble), hi_nibbles));
+        __m128i values = _mm_add_epi8(block, roll);
+        __m128i merged = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)),
+                                        _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i*)(out + i / 4 * 3), _mm_shuffle_epi8(merged, _mm_setr_epi8(BJSON_BASE64_PACK)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t base64_decode_avx2(const char* text, size_t n, uint8_t* out) {
+    const __m256i lut_lo = _mm256_setr_epi8(BJSON_BASE64_LUT_LO, BJSON_BASE64_LUT_LO);
+    const __m256i lut_hi = _mm256_setr_epi8(BJSON_BASE64_LUT_HI, BJSON_BASE64_LUT_HI);
+    const __m256i lut_roll = _mm256_setr_epi8(BJSON_BASE64_LUT_ROLL, BJSON_BASE64_LUT_ROLL);
+    const __m256i nibble = _mm256_set1_epi8(0x2F);
+    size_t i = 0;
+    
+    // 32 characters store 32 bytes for their 24
+    for (; n - i >= 48; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(text + i));
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(block, 4), nibble);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(block, nibble));
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256()))) break;
+        
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(block, nibble), hi_nibbles));
+        __m256i values = _mm256_add_epi8(block, roll);
+        __m256i merged = _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)),
+                                           _mm256_set1_epi32(0x00011000));
+        __m256i packed = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(BJSON_BASE64_PACK, BJSON_BASE64_PACK));
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm256_storeu_si256((__m256i*)(out + i / 4 * 3), packed);
+    }
+    _mm256_zeroupper();
+    return i + base64_decode_ssse3(text + i, n - i, out + i / 4 * 3);
+}
+
+// Bytes encoded from data[0..length) as 16 characters per 12 bytes; each
+// step loads 16 bytes, so the last 4 are left to the scalar code
+__attribute__((target("ssse3")))
+static size_t base64_encode_ssse3(const uint8_t* data, size_t length, char* out) {
+    const __m128i offsets = _mm_setr_epi8(BJSON_BASE64_OFFSETS);
+    size_t i = 0;
+    
+    for (; length - i >= 16; i += 12) {
+        __m128i block = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i)),
+                                         _mm_setr_epi8(BJSON_BASE64_SPREAD));
+        // Four 6-bit indices per three bytes, one per output byte
+        __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(block, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        __m128i t1 = _mm_mullo_epi16(_mm_and_si128(block, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(t0, t1);
+        // Offset of each index's alphabet range: A-Z, a-z, 0-9, '+' and '/'
+        __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        range = _mm_sub_epi8(range, _mm_cmpgt_epi8(indices, _mm_set1_epi8(25)));
+        __m128i ascii = _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+        _mm_storeu_si128((__m128i*)(out + i / 3 * 4), ascii);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t base64_encode_avx2(const uint8_t* data, size_t length, char* out) {
+    const __m256i offsets = _mm256_setr_epi8(BJSON_BASE64_OFFSETS, BJSON_BASE64_OFFSETS);
+    const __m256i spread = _mm256_setr_epi8(BJSON_BASE64_SPREAD, BJSON_BASE64_SPREAD);
+    size_t i = 0;
+    
+    // 24 bytes per step, 12 in each lane
+    for (; length - i >= 28; i += 24) {
+        __m128i low = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i high = _mm_loadu_si128((const __m128i*)(data + i + 12));
+        __m256i block = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), spread);
+        __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(block, _mm256_set1_epi32(0x0FC0FC00)),
+                                        _mm256_set1_epi32(0x04000040));
+        __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(block, _mm256_set1_epi32(0x003F03F0)),
+                                        _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t0, t1);
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        range = _mm256_sub_epi8(range, _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25)));
+        __m256i ascii = _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+        _mm256_storeu_si256((__m256i*)(out + i / 3 * 4), ascii);
+    }
+    _mm256_zeroupper();
+    return i + base64_encode_ssse3(data + i, length - i, out + i / 3 * 4);
+}
+
+// Hex digits decoded from text[0..n) as 16 per step; stops at the first
+// block holding a non-hex byte
+__attribute__((target("ssse3")))
+static size_t hex_decode_ssse3(const char* text, size_t n, uint8_t* out) {
+    size_t i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i digits = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+        __m128i letters = _mm_sub_epi8(_mm_or_si128(block, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        // Unsigned range checks: a digit is below 10, a letter below 6
+        __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+        __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+        if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xFFFF) break;
+        
+        __m128i values = _mm_or_si128(_mm_and_si128(is_digit, digits),
+                                      _mm_andnot_si128(is_digit, _mm_add_epi8(letters, _mm_set1_epi8(10))));
+        __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi16(0x0110));  // high * 16 + low
+        _mm_storel_epi64((__m128i*)(out + i / 2), _mm_packus_epi16(pairs, pairs));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t hex_decode_avx2(const char* text, size_t n, uint8_t* out) {
+    size_t i = 0;
+    for (; n - i >= 32; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(text + i));
+        __m256i digits = _mm256_sub_epi8(block, _mm256_set1_epi8('0'));
+        __m256i letters = _mm256_sub_epi8(_mm256_or_si256(block, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+        __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letters, _mm256_set1_epi8(5)), letters);
+        if ((uint32_t)_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_letter)) != 0xFFFFFFFF) break;
+        
+        __m256i values = _mm256_or_si256(_mm256_and_si256(is_digit, digits),
+                                         _mm256_andnot_si256(is_digit, _mm256_add_epi8(letters, _mm256_set1_epi8(10))));
+        __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi16(0x0110));
+        // Packing works per lane; gather both lanes' 8 bytes into the low half
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(pairs, pairs), 0x08);
+        _mm_storeu_si128((__m128i*)(out + i / 2), _mm256_castsi256_si128(packed));
+    }
+    _mm256_zeroupper();
+    return i + hex_decode_ssse3(text + i, n - i, out + i / 2);
+}
+
+#endif
+
+// Decode n base64 characters, without padding, into out; 0 if one is invalid
+static int base64_decode(const char* text, size_t n, uint8_t* out) {
+    size_t done = 0;
+#if BJSON_X86_SIMD
+    int level = bjson_simd_level();
+    if (level >= BJSON_SIMD_AVX2) done = base64_decode_avx2(text, n, out);
+    else if (level >= BJSON_SIMD_SSSE3) done = base64_decode_ssse3(text, n, out);
+#endif
+    return base64_decode_scalar(text + done, n - done, out + done / 4 * 3);
+}
+
+// Decode an even number n of hex digits into out; 0 if one is invalid
+static int hex_decode(const char* text, size_t n, uint8_t* out) {
+    size_t done = 0;
+#if BJSON_X86_SIMD
+    int level = bjson_simd_level();
+    if (level >= BJSON_SIMD_AVX2) done = hex_decode_avx2(text, n, out);
+    else if (level >= BJSON_SIMD_SSSE3) done = hex_decode_ssse3(text, n, out);
+#endif
+    return hex_decode_scalar(text + done, n - done, out + done / 2);
+}
+
+// Encode length bytes as padded base64 into out, which holds
+// (length + 2) / 3 * 4 characters; returns that count
+static size_t base64_encode(const uint8_t* data, size_t length, char* out) {
+    size_t done = 0;
+#if BJSON_X86_SIMD
+    int level = bjson_simd_level();
+    if (level >= BJSON_SIMD_AVX2) done = base64_encode_avx2(data, length, out);
+    else if (level >= BJSON_SIMD_SSSE3) done = base64_encode_ssse3(data, length, out);
+#endif
+    return done / 3 * 4 + base64_encode_scalar(data + done, length - done, out + done / 3 * 4);
+}
+
+// Parse the payload of @bytes through its ')'. When the tree builder is
+// listening the bytes are decoded into the node itself, otherwise into the
+// scratch buffer for the bytes_value event
+static int parse_bytes(bjson_parser_t* parser) {
+    const char* start = parser->input + parser->pos;
+    const char* close = memchr(start, ')', parser->length - parser->pos);
+    if (!close) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Unterminated extended type payload at line %d", parser->line);
+        return 0;
+    }
+    
+    const char* colon = memchr(start, ':', (size_t)(close - start));
+    size_t tag_length = colon ? (size_t)(colon - start) : 0;
+    int base64 = tag_length == 6 && memcmp(start, "base64", 6) == 0;
+    int sha256 = tag_length == 6 && memcmp(start, "sha256", 6) == 0;
+    if (!base64 && !sha256 && !(tag_length == 3 && memcmp(start, "hex", 3) == 0)) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "@bytes expects base64:, hex: or sha256: at line %d, column %d", parser->line, parser->column);
+        return 0;
+    }
+    
+    const char* text = colon + 1;
+    size_t n = (size_t)(close - text);
+    size_t size = n / 2;
+    if (base64 ? !base64_measure(text, &n, &size) : (n % 2 || (sha256 && size != 32))) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Invalid @bytes length at line %d, column %d", parser->line, parser->column);
+        return 0;
+    }
+    
+    bjson_value_t* node = NULL;
+    uint8_t* out;
+    if (parser->sax == &bjson_tree_builder) {
+        node = build_bytes_node(parser->sax_ctx, size);
+        if (!node) return sax_continue(parser, build_attach(parser->sax_ctx, NULL));
+        out = node->bytes_val.data;
+    } else {
+        if (!reserve_scratch(parser, 0, size + 1)) {
+            snprintf(parser->error_msg, sizeof(parser->error_msg), "Out of memory");
+            return 0;
+        }
+        out = (uint8_t*)parser->scratch;
+    }
+    
+    if (!(base64 ? base64_decode(text, n, out) : hex_decode(text, n, out))) {
+        bjson_free_value(node);
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Invalid %s digit in @bytes at line %d, column %d", base64 ? "base64" : "hex",
+                parser->line, parser->column);
+        return 0;
+    }
+    
+    parser->column += (int)(close - start) + 1;
+    parser->pos += (size_t)(close - start) + 1;
+    if (node) return sax_continue(parser, build_attach(parser->sax_ctx, node));
+    return BJSON_SAX_CALL(parser, bytes_value, (parser->sax_ctx, out, size));
+}
+
+// Push parsing: input arrives in chunks through bjson_parser_feed. A small
+// lexer state machine finds token boundaries and an explicit container
+// stack replaces recursion, so parsing can stop anywhere, even inside a
+// string, number, comment or @type(...) payload, and resume with the next
+// chunk. Complete tokens are handed to the ordinary token parsers; only a
+// token split across chunks is copied, so memory is bounded by the nesting
+// depth and the longest token.
+
+typedef enum {
+    BJSON_LEX_BETWEEN,       // Whitespace between tokens
+    BJSON_LEX_SLASH,         // '/' that must start a comment
+    BJSON_LEX_LINE_COMMENT,
+    BJSON_LEX_BLOCK_COMMENT,
+    BJSON_LEX_BLOCK_STAR,    // '*' inside a block comment
+    BJSON_LEX_STRING,
+    BJSON_LEX_STRING_ESCAPE, // Byte after a backslash
+    BJSON_LEX_BARE,          // Number or literal, ended by any other byte
+    BJSON_LEX_TYPE_NAME,     // @name before its '('
+    BJSON_LEX_PAYLOAD        // Raw @type(...) payload up to its closing ')'
+} bjson_lex_state_t;
+
+typedef enum {
+    BJSON_PUSH_OPEN,         // @set( / @map( waiting for its '[' or '{'
+    BJSON_PUSH_VALUE,        // Array item, object key or object value expected
+    BJSON_PUSH_COLON,        // Object key done, ':' expected
+    BJSON_PUSH_NEXT,         // Member done, ',' or the closing bracket expected
+    BJSON_PUSH_PAREN         // @set/@map body closed, ')' expected
+} bjson_push_state_t;
+
+typedef struct {
+    uint8_t is_object;       // Object or map rather than array or set
+    uint8_t is_extended;     // @set / @map
+    uint8_t state;           // bjson_push_state_t
+    uint8_t in_value;        // Object member: the key is done, its value pending
+    size_t count;
+} bjson_push_frame_t;
+
+struct bjson_push_parser {
+    bjson_parser_t core;     // Handler, flags, arena, scratch and error message
+    bjson_parser_t token_parser;  // Runs the token parsers over one complete token
+    bjson_builder_t builder; // Tree building when no handler was given
+    bjson_push_frame_t* stack;
+    size_t depth;
+    size_t stack_capacity;
+    int lex;                 // bjson_lex_state_t
+    int payload_depth;       // Nested '(' inside an @type payload
+    char payload_quote;      // Open quote inside an @type payload, or 0
+    int payload_escape;      // Previous payload byte was a backslash
+    int payload_regex;       // bjson_regex_lex_t inside a @regex payload, else -1
+    char* token;             // Prefix of a token split across chunks
+    size_t token_length;
+    size_t token_capacity;
+    int token_line;
+    int token_column;
+    int have_root;
+    bjson_error_t status;    // Sticky once parsing has failed
+};
+
+static int push_fail(bjson_push_parser_t* p, bjson_error_t status, const char* message) {
+    if (message) {
+        snprintf(p->core.error_msg, sizeof(p->core.error_msg), 
+                "%s at line %d, column %d", message, p->core.line, p->core.column);
+    }
+    p->status = status;
+    return 0;
+}
+
+static int push_open(bjson_push_parser_t* p, int is_object, int is_extended) {
+    if (p->depth == p->stack_capacity) {
+        size_t capacity = grow_capacity(p->stack_capacity, p->depth + 1);
+        bjson_push_frame_t* stack = realloc(p->stack, sizeof(bjson_push_frame_t) * capacity);
+        if (!stack) return push_fail(p, BJSON_ERROR_MEMORY, "Out of memory");
+        p->stack = stack;
+        p->stack_capacity = capacity;
+    }
+    
+    bjson_push_frame_t* frame = &p->stack[p->depth++];
+    frame->is_object = (uint8_t)is_object;
+    frame->is_extended = (uint8_t)is_extended;
+    frame->state = is_extended ? BJSON_PUSH_OPEN : BJSON_PUSH_VALUE;
+    frame->in_value = 0;
+    frame->count = 0;
+    return 1;
+}
+
+// A whole value (scalar or closed container) has been delivered
+static void push_value_done(bjson_push_parser_t* p) {
+    if (!p->depth) {
+        p->have_root = 1;
+        return;
+    }
+    
+    bjson_push_frame_t* frame = &p->stack[p->depth - 1];
+    if (frame->is_object && !frame->in_value) {
+        frame->in_value = 1;
+        frame->state = BJSON_PUSH_COLON;
+    } else {
+        frame->in_value = 0;
+        frame->count++;
+        frame->state = BJSON_PUSH_NEXT;
+    }
+}
+
+// Check that a value may start here
+static int push_expect_value(bjson_push_parser_t* p) {
+    if (!p->depth) {
+        return p->have_root ? push_fail(p, BJSON_ERROR_SYNTAX, "Unexpected data after the document") : 1;
+    }
+    
+    // Members may also follow each other without a comma, as in the text parser
+    bjson_push_frame_t* frame = &p->stack[p->depth - 1];
+    if (frame->state == BJSON_PUSH_VALUE || frame->state == BJSON_PUSH_NEXT) return 1;
+    if (frame->state == BJSON_PUSH_OPEN) {
+        return push_fail(p, BJSON_ERROR_SYNTAX, frame->is_object ? "@map expects an object" : "@set expects an array");
+    }
+    return push_fail(p, BJSON_ERROR_SYNTAX, frame->state == BJSON_PUSH_COLON ? "Expected ':'" : "Unexpected value");
+}
+
+// The tree builder only stops when it runs out of memory
+static int push_event_result(bjson_push_parser_t* p, int ok) {
+    if (ok) return 1;
+    return push_fail(p, p->core.sax == &bjson_tree_builder ? BJSON_ERROR_MEMORY : BJSON_ERROR_PARTIAL, NULL);
+}
+
+static int push_structural(bjson_push_parser_t* p, char c) {
+    bjson_parser_t* core = &p->core;
+    bjson_push_frame_t* frame = p->depth ? &p->stack[p->depth - 1] : NULL;
+    
+    if (frame && frame->state == BJSON_PUSH_OPEN) {
+        // The body of @set(...) / @map(...)
+        if (c != (frame->is_object ? '{' : '[')) {
+            return push_fail(p, BJSON_ERROR_SYNTAX, frame->is_object ? "@map expects an object" : "@set expects an array");
+        }
+        frame->state = BJSON_PUSH_VALUE;
+        return push_event_result(p, frame->is_object ? BJSON_SAX_CALL(core, start_map, (core->sax_ctx))
+                                                     : BJSON_SAX_CALL(core, start_set, (core->sax_ctx)));
+    }
+    
+    switch (c) {
+        case '[':
+        case '{':
+            if (!push_expect_value(p) || !push_open(p, c == '{', 0)) return 0;
+            return push_event_result(p, c == '{' ? BJSON_SAX_CALL(core, start_object, (core->sax_ctx))
+                                                 : BJSON_SAX_CALL(core, start_array, (core->sax_ctx)));
+        case ']':
+        case '}': {
+            if (!frame || frame->state == BJSON_PUSH_PAREN || frame->is_object != (c == '}') ||
+                frame->in_value) {
+                break;
+            }
+            size_t count = frame->count;
+            int ok;
+            if (frame->is_extended) {
+                frame->state = BJSON_PUSH_PAREN;
+                ok = frame->is_object ? BJSON_SAX_CALL(core, end_map, (core->sax_ctx, count))
+                                      : BJSON_SAX_CALL(core, end_set, (core->sax_ctx, count));
+                return push_event_result(p, ok);
+            }
+            p->depth--;
+            ok = frame->is_object ? BJSON_SAX_CALL(core, end_object, (core->sax_ctx, count))
+                                  : BJSON_SAX_CALL(core, end_array, (core->sax_ctx, count));
+            if (!push_event_result(p, ok)) return 0;
+            push_value_done(p);
+            return 1;
+        }
+        case ')':
+            if (!frame || frame->state != BJSON_PUSH_PAREN) break;
+            p->depth--;
+            push_value_done(p);
+            return 1;
+        case ',':
+            if (!frame || frame->state != BJSON_PUSH_NEXT) break;
+            frame->state = BJSON_PUSH_VALUE;
+            return 1;
+        case ':':
+            if (!frame || frame->state != BJSON_PUSH_COLON) break;
+            frame->state = BJSON_PUSH_VALUE;
+            return 1;
+    }
+    
+    snprintf(core->error_msg, sizeof(core->error_msg), 
+            "Unexpected character '%c' at line %d, column %d", c, core->line, core->column);
+    return push_fail(p, BJSON_ERROR_SYNTAX, NULL);
+}
+
+// Run a complete scalar token (string, number, literal or @type(...))
+// through the ordinary token parsers
+static int push_token(bjson_push_parser_t* p, const char* text, size_t length) {
+    if (!push_expect_value(p)) return 0;
+    
+    bjson_parser_t* core = &p->core;
+    bjson_parser_t* sub = &p->token_parser;
+    bjson_push_frame_t* frame = p->depth ? &p->stack[p->depth - 1] : NULL;
+    
+    sub->input = text;
+    sub->length = length;
+    sub->pos = 0;
+    sub->line = p->token_line;
+    sub->column = p->token_column;
+    
+    int is_key = frame && frame->is_object && !frame->in_value;
+    int ok = (is_key && text[0] == '"') ? parse_string(sub, 1) : parse_value(sub);
+    if (ok && sub->pos != length) {
+        snprintf(sub->error_msg, sizeof(sub->error_msg), 
+                "Invalid token '%.*s' at line %d, column %d", (int)(length > 32 ? 32 : length), text,
+                p->token_line, p->token_column);
+        ok = 0;
+    }
+    
+    if (!ok) {
+        // The tree builder reports its own failures through the core parser
+        if (!core->error_msg[0]) memcpy(core->error_msg, sub->error_msg, sizeof(core->error_msg));
+        if (!sub->sax_stopped) return push_fail(p, BJSON_ERROR_SYNTAX, NULL);
+        core->sax_stopped = 1;
+        return push_event_result(p, 0);
+    }
+    
+    push_value_done(p);
+    return 1;
+}
+
+static int push_append_token(bjson_push_parser_t* p, const char* data, size_t length) {
+    if (p->token_length + length > p->token_capacity) {
+        size_t capacity = p->token_capacity ? p->token_capacity : 256;
+        while (capacity < p->token_length + length) capacity *= 2;
+        char* token = realloc(p->token, capacity);
+        if (!token) return push_fail(p, BJSON_ERROR_MEMORY, "Out of memory");
+        p->token = token;
+        p->token_capacity = capacity;
+    }
+    memcpy(p->token + p->token_length, data, length);
+    p->token_length += length;
+    return 1;
+}
+
+// The token running from chunk[from] (or from the buffered prefix) ends
+// before chunk[end]
+static int push_finish_token(bjson_push_parser_t* p, const char* chunk, size_t from, size_t end) {
+    p->lex = BJSON_LEX_BETWEEN;
+    p->core.column = p->token_column + (int)(p->token_length + end - from);
+    if (!p->token_length) return push_token(p, chunk + from, end - from);
+    
+    if (!push_append_token(p, chunk + from, end - from)) return 0;
+    size_t length = p->token_length;
+    p->token_length = 0;
+    return push_token(p, p->token, length);
+}
+
+static inline int is_bare_byte(char c) {
+    return isalnum((unsigned char)c) || c == '-' || c == '+' || c == '.' || c == '_';
+}
+
+// '(' after @name: @set and @map open a container frame, any other type
+// collects its raw payload
+static int push_type_open(bjson_push_parser_t* p, const char* chunk, size_t from, size_t end) {
+    char name[6] = {0};
+    size_t length = p->token_length + (end - from);
+    if (length == 4 || length == 6) {
+        // "@set", "@map" or "@regex", possibly split across chunks
+        for (size_t k = 0; k + 1 < length; k++) {
+            size_t at = k + 1;
+            name[k] = at < p->token_length ? p->token[at] : chunk[from + at - p->token_length];
+        }
+    }
+    
+    if (strcmp(name, "set") != 0 && strcmp(name, "map") != 0) {
+        p->lex = BJSON_LEX_PAYLOAD;
+        p->payload_depth = 0;
+        p->payload_quote = 0;
+        p->payload_escape = 0;
+        p->payload_regex = strcmp(name, "regex") == 0 ? BJSON_REGEX_LEX_OPEN : -1;
+        return 1;
+    }
+    
+    p->lex = BJSON_LEX_BETWEEN;
+    p->token_length = 0;
+    p->core.column = p->token_column + 5;
+    return push_expect_value(p) && push_open(p, name[0] == 'm', 1);
+}
+
+static int is_token_state(int lex) {
+    return lex == BJSON_LEX_STRING || lex == BJSON_LEX_STRING_ESCAPE || lex == BJSON_LEX_BARE ||
+           lex == BJSON_LEX_TYPE_NAME || lex == BJSON_LEX_PAYLOAD;
+}
+
+static bjson_push_parser_t* push_parser_ready(bjson_push_parser_t* p) {
+    p->token_parser.flags = p->core.flags;
+    p->token_parser.sax = p->core.sax;
+    p->token_parser.sax_ctx = p->core.sax_ctx;
+    return p;
+}
+
+// Push parser delivering events to handler, or building a document when
+// handler is NULL. BJSON_PARSE_BORROW_STRINGS and BJSON_PARSE_PRESIZE need
+// the whole input at once and are ignored.
+bjson_push_parser_t* bjson_push_parser_create(unsigned flags, const bjson_sax_handler_t* handler, void* ctx) {
+    bjson_push_parser_t* p = calloc(1, sizeof(bjson_push_parser_t));
+    if (!p) return NULL;
+    
+    p->core.line = 1;
+    p->core.column = 1;
+    p->core.flags = flags & ~(unsigned)(BJSON_PARSE_BORROW_STRINGS | BJSON_PARSE_PRESIZE);
+    p->lex = BJSON_LEX_BETWEEN;
+    
+    if (handler) {
+        p->core.sax = handler;
+        p->core.sax_ctx = ctx;
+        return push_parser_ready(p);
+    }
+    
+    if (flags & BJSON_PARSE_ARENA) {
+        p->core.arena = bjson_arena_create(0);
+        if (!p->core.arena) {
+            free(p);
+            return NULL;
+        }
+    }
+    p->builder.parser = &p->core;
+    p->core.sax = &bjson_tree_builder;
+    p->core.sax_ctx = &p->builder;
+    return push_parser_ready(p);
+}
+
+// Consume the next length bytes of input. Chunks may split the input
+// anywhere; events for complete tokens are delivered before returning.
+bjson_error_t bjson_parser_feed(bjson_push_parser_t* p, const char* chunk, size_t length) {
+    if (!p || (!chunk && length)) return BJSON_ERROR_TYPE;
+    if (p->status != BJSON_SUCCESS) return p->status;
+    
+    bjson_parser_t* core = &p->core;
+    size_t i = 0;
+    size_t from = 0;  // Start of the current token in this chunk
+    int ok = 1;
+    
+    while (ok && i < length) {
+        char c = chunk[i];
+        switch (p->lex) {
+            case BJSON_LEX_BETWEEN:
+                if (isspace(c)) {
+                    // Whole runs of indentation at once
+                    do {
+                        if (chunk[i] == '\n') {
+                            core->line++;
+                            core->column = 1;
+                        } else {
+                            core->column++;
+                        }
+                    } while (++i < length && isspace(chunk[i]));
+                } else if (c == '/') {
+                    p->lex = BJSON_LEX_SLASH;
+                    core->column++;
+                    i++;
+                } else if (c == '"' || c == '@' || is_bare_byte(c)) {
+                    p->lex = c == '"' ? BJSON_LEX_STRING : c == '@' ? BJSON_LEX_TYPE_NAME : BJSON_LEX_BARE;
+                    p->token_line = core->line;
+                    p->token_column = core->column;
+                    from = i++;
+                } else {
+                    ok = push_structural(p, c);
+                    core->column++;
+                    i++;
+                }
+                break;
+            case BJSON_LEX_SLASH:
+                if (c != '/' && c != '*') {
+                    core->column--;
+                    ok = push_structural(p, '/');
+                    break;
+                }
+                p->lex = c == '/' ? BJSON_LEX_LINE_COMMENT : BJSON_LEX_BLOCK_COMMENT;
+                core->column++;
+                i++;
+                break;
+            case BJSON_LEX_LINE_COMMENT: {
+                // The newline itself is counted as whitespace
+                const char* newline = memchr(chunk + i, '\n', length - i);
+                if (newline) {
+                    i = (size_t)(newline - chunk);
+                    p->lex = BJSON_LEX_BETWEEN;
+                } else {
+                    i = length;
+                }
+                break;
+            }
+            case BJSON_LEX_BLOCK_COMMENT:
+            case BJSON_LEX_BLOCK_STAR:
+                if (c == '/' && p->lex == BJSON_LEX_BLOCK_STAR) {
+                    p->lex = BJSON_LEX_BETWEEN;
+                } else {
+                    p->lex = c == '*' ? BJSON_LEX_BLOCK_STAR : BJSON_LEX_BLOCK_COMMENT;
+                }
+                if (c == '\n') {
+                    core->line++;
+                    core->column = 1;
+                } else {
+                    core->column++;
+                }
+                i++;
+                break;
+            case BJSON_LEX_STRING:
+                i += scan_string_run(chunk + i, length - i);
+                if (i < length) {
+                    if (chunk[i++] == '\\') {
+                        p->lex = BJSON_LEX_STRING_ESCAPE;
+                    } else {
+                        ok = push_finish_token(p, chunk, from, i);
+                    }
+                }
+                break;
+            case BJSON_LEX_STRING_ESCAPE:
+                p->lex = BJSON_LEX_STRING;
+                i++;
+                break;
+            case BJSON_LEX_BARE:
+                while (i < length && is_bare_byte(chunk[i])) i++;
+                if (i < length) ok = push_finish_token(p, chunk, from, i);
+                break;
+            case BJSON_LEX_TYPE_NAME:
+                if (isalnum((unsigned char)c) || c == '_') {
+                    i++;
+                } else if (c == '(') {
+                    ok = push_type_open(p, chunk, from, i);
+                    i++;
+                } else {
+                    ok = push_finish_token(p, chunk, from, i);
+                }
+                break;
+            case BJSON_LEX_PAYLOAD:
+                i++;
+                if (p->payload_regex >= 0) {
+                    // Ends after its ')', or on the byte the token parser will reject
+                    p->payload_regex = regex_lex_step(p->payload_regex, c);
+                    if (p->payload_regex == BJSON_REGEX_LEX_DONE || p->payload_regex == BJSON_REGEX_LEX_INVALID) {
+                        ok = push_finish_token(p, chunk, from, i);
+                    }
+                } else if (p->payload_escape) {
+                    p->payload_escape = 0;
+                } else if (c == '\\') {
+                    p->payload_escape = 1;
+                } else if (p->payload_quote) {
+                    if (c == p->payload_quote) p->payload_quote = 0;
+                } else if (c == '"' || c == '\'') {
+                    p->payload_quote = c;
+                } else if (c == '(') {
+                    p->payload_depth++;
+                } else if (c == ')' && p->payload_depth-- == 0) {
+                    ok = push_finish_token(p, chunk, from, i);
+                }
+                break;
+        }
+    }
+    
+    // Keep the unfinished token for the next chunk
+    if (ok && is_token_state(p->lex)) {
+        ok = push_append_token(p, chunk + from, length - from);
+    }
+    
+    return ok ? BJSON_SUCCESS : p->status;
+}
+
+// Signal the end of the input. Unlike the text parser, unclosed containers
+// are an error here, since they usually mean a truncated stream. In tree
+// mode the document is returned through doc and owned by the caller.
+bjson_error_t bjson_parser_finish(bjson_push_parser_t* p, bjson_document_t** doc) {
+    if (doc) *doc = NULL;
+    if (!p) return BJSON_ERROR_TYPE;
+    if (p->status != BJSON_SUCCESS) return p->status;
+    
+    bjson_parser_t* core = &p->core;
+    int ok = 1;
+    if (p->lex == BJSON_LEX_BARE || p->lex == BJSON_LEX_TYPE_NAME) {
+        // Numbers and literals end at the end of the input
+        ok = push_finish_token(p, "", 0, 0);
+    } else if (p->lex != BJSON_LEX_BETWEEN && p->lex != BJSON_LEX_LINE_COMMENT) {
+        ok = push_fail(p, BJSON_ERROR_SYNTAX, "Unexpected end of input");
+    }
+    if (ok && (p->depth || !p->have_root)) {
+        ok = push_fail(p, BJSON_ERROR_SYNTAX, "Unexpected end of input");
+    }
+    if (!ok) return p->status;
+    
+    if (core->sax == &bjson_tree_builder && doc) {
+        bjson_error_t error;
+        *doc = document_create(0, &error);
+        if (!*doc) {
+            push_fail(p, BJSON_ERROR_MEMORY, "Out of memory");
+            return p->status;
+        }
+        (*doc)->root = p->builder.root;
+        (*doc)->arena = core->arena;
+        p->builder.root = NULL;
+        core->arena = NULL;
+    }
+    return BJSON_SUCCESS;
+}
+
+// Why feeding or finishing failed, or NULL while the parser is healthy;
+// valid until the parser is freed
+const char* bjson_parser_error_message(const bjson_push_parser_t* p) {
+    return p && p->status != BJSON_SUCCESS ? p->core.error_msg : NULL;
+}
+
+void bjson_push_parser_free(bjson_push_parser_t* p) {
+    if (!p) return;
+    
+    build_discard(&p->builder);
+    free(p->builder.stack);
+    free(p->builder.members);
+    if (p->core.arena) bjson_arena_destroy(p->core.arena);
+    free(p->token_parser.scratch);
+    free(p->stack);
+    free(p->token);
+    free(p);
+}
+
+// Newline-delimited record streams: one value per line, from a buffer or a
+// file descriptor. A record ends at the first newline outside strings and
+// block comments, so those may still span lines. One parser (and its
+// scratch buffer) serves every record, and in arena mode the arena is
+// rewound between records, so after the first few lines a record costs no
+// allocations at all. A line that fails to parse is reported as a bad
+// record and the stream moves on to the next line; a record spanning lines
+// that fails, or that runs into the end of the input inside a string or
+// comment, falls back to its first line, so a stray quote or comment
+// opener costs one bad record rather than every record after it.
+
+#define BJSON_RECORD_READ_SIZE (64 * 1024)
+
+// Lexical state at a record boundary scan position
+enum {
+    BJSON_SCAN_OUT,
+    BJSON_SCAN_STRING,
+    BJSON_SCAN_COMMENT       // Inside /* ... */
+};
+
+// Bit i set when p[i] is one of the bytes that can move the record scan:
+// '"', '\\', '/', '*' or a newline; n is at most 64
+static uint64_t record_special_mask(const char* p, size_t n) {
+    uint64_t mask = 0;
+    size_t i = 0;
+#if BJSON_X86_SIMD
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+                                                    _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'))),
+                                       _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('/')),
+                                                                 _mm_cmpeq_epi8(block, _mm_set1_epi8('*'))),
+                                                    _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+        mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(special) << i;
+    }
+#endif
+    for (; i < n; i++) {
+        char c = p[i];
+        if (c == '"' || c == '\\' || c == '/' || c == '*' || c == '\n') mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+// Offset just past the pattern of a @regex whose opening '/' is data[i], or
+// i when that '/' opens none. The record scan skips patterns whole, so their
+// quotes and slashes start no string or comment; a pattern never spans lines.
+static size_t record_skip_regex(const char* data, size_t i, size_t end) {
+    size_t at = i;
+    while (at && (data[at - 1] == ' ' || data[at - 1] == '\t')) at--;
+    if (at < 7 || memcmp(data + at - 7, "@regex(", 7) != 0) return i;
+    
+    int state = BJSON_REGEX_LEX_BODY;
+    for (at = i + 1; at < end && state != BJSON_REGEX_LEX_FLAGS; at++) {
+        state = regex_lex_step(state, data[at]);
+        if (state == BJSON_REGEX_LEX_INVALID) return at;
+    }
+    return at;
+}
+
+// Scan data[pos..end) starting in *state. With stop set, return the index of
+// the first newline outside strings and comments (a record boundary);
+// otherwise, or when there is none, return end. *state receives the state
+// at the returned position and *newlines, when given, counts the newlines
+// passed inside strings and comments. Only the special bytes of each 64-byte
+// block are visited.
+static size_t record_scan(const char* data, size_t pos, size_t end, int* state, size_t* newlines, int stop) {
+    int s = *state;
+    int line_comment = 0;
+    size_t resume = pos;     // Bytes before this were consumed by an escape or a comment marker
+    
+    for (; pos < end; pos += 64) {
+        size_t n = end - pos < 64 ? end - pos : 64;
+        uint64_t mask = record_special_mask(data + pos, n);
+        
+        while (mask) {
+            size_t i = pos + (size_t)__builtin_ctzll(mask);
+            mask &= mask - 1;
+            if (i < resume) continue;
+            
+            char c = data[i];
+            char next = i + 1 < end ? data[i + 1] : '\0';
+            if (c == '\n') {
+                if (s != BJSON_SCAN_OUT) {
+                    if (newlines) (*newlines)++;
+                    continue;
+                }
+                line_comment = 0;
+                if (stop) {
+                    *state = s;
+                    return i;
+                }
+            } else if (line_comment) {
+                continue;
+            } else if (s == BJSON_SCAN_STRING) {
+                if (c == '\\') {
+                    if (newlines && next == '\n') (*newlines)++;
+                    resume = i + 2;
+                } else if (c == '"') {
+                    s = BJSON_SCAN_OUT;
+                }
+            } else if (s == BJSON_SCAN_COMMENT) {
+                if (c == '*' && next == '/') {
+                    s = BJSON_SCAN_OUT;
+                    resume = i + 2;
+                }
+            } else if (c == '"') {
+                s = BJSON_SCAN_STRING;
+            } else if (c == '/' && (resume = record_skip_regex(data, i, end)) != i) {
+                continue;
+            } else if (c == '/' && next == '/') {
+                line_comment = 1;
+            } else if (c == '/' && next == '*') {
+                s = BJSON_SCAN_COMMENT;
+                resume = i + 2;
+            }
+        }
+    }
+    *state = s;
+    return end;
+}
+
+// Parse the record in line[0..length) on its own. Returns 0 when the line
+// holds only whitespace and comments, otherwise 1 with the value in *value,
+// or NULL and the reason in parser->error_msg for a bad record.
+static int record_parse(bjson_parser_t* parser, const char* line, size_t length, size_t line_number,
+                        bjson_value_t** value) {
+    parser->input = line;
+    parser->length = length;
+    parser->pos = 0;
+    parser->line = (int)line_number;
+    parser->column = 1;
+    parser->error_msg[0] = '\0';
+    parser->sax_stopped = 0;
+    skip_whitespace_and_comments(parser);
+    if (parser->pos == length) return 0;
+    
+    *value = parse_tree(parser);
+    if (*value) {
+        skip_whitespace_and_comments(parser);
+        if (parser->pos < length) {
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "Unexpected data after the record at line %d, column %d", parser->line, parser->column);
+            bjson_free_value(*value);
+            *value = NULL;
+        }
+    }
+    return 1;
+}
+
+// Parse the record data[pos..*end) found by record_scan, which left it in
+// state with *newlines newlines inside strings and comments. A record
+// spanning lines that fails, or ends in an open string or comment, is cut
+// back to its first line (*end moves to that line's newline, *newlines to
+// 0) and reported bad. *length receives the record length without a
+// trailing '\r'. Returns as record_parse.
+static int record_parse_span(bjson_parser_t* parser, const char* data, size_t pos, size_t* end, int state,
+                             size_t* newlines, size_t line_number, bjson_value_t** value, size_t* length) {
+    const char* line = data + pos;
+    *length = *end - pos;
+    if (*length && line[*length - 1] == '\r') (*length)--;
+    *value = NULL;
+    int parsed = record_parse(parser, line, *length, line_number, value);
+    if (!*newlines || (state == BJSON_SCAN_OUT && (!parsed || *value))) return parsed;
+    
+    // The first newline is inside the string or comment that spans lines,
+    // so the first line cannot be a good record on its own; an open string
+    // fails to parse and words its own error
+    bjson_free_value(*value);
+    *value = NULL;
+    *end = (size_t)((const char*)memchr(line, '\n', *end - pos) - data);
+    *newlines = 0;
+    *length = *end - pos;
+    if (*length && line[*length - 1] == '\r') (*length)--;
+    state = BJSON_SCAN_OUT;
+    record_scan(data, pos, *end, &state, NULL, 0);
+    if (state == BJSON_SCAN_COMMENT) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Unterminated comment at line %zu", line_number);
+    } else {
+        record_parse(parser, line, *length, line_number, value);
+        bjson_free_value(*value);
+        *value = NULL;
+    }
+    return 1;
+}
+
+struct bjson_record_stream {
+    bjson_parser_t parser;   // Reused for every record
+    bjson_arena_t* arena;    // Rewound between records in arena mode
+    const char* data;        // Unconsumed input is data[pos..length)
+    size_t length;
+    size_t pos;
+    size_t base;             // Stream offset of data[0]
+    char* buffer;            // Read buffer in descriptor mode
+    size_t buffer_capacity;
+    int fd;                  // -1 for a buffer stream
+    int eof;
+    size_t line;
+    bjson_value_t* current;  // Value of the last record, released by the next call
+};
+
+static bjson_record_stream_t* record_stream_create(unsigned flags) {
+    bjson_record_stream_t* stream = calloc(1, sizeof(bjson_record_stream_t));
+    if (!stream) return NULL;
+    
+    // Records are too small for the size pre-pass to pay off
+    stream->parser.flags = flags & ~(unsigned)BJSON_PARSE_PRESIZE;
+    stream->fd = -1;
+    if (flags & BJSON_PARSE_ARENA) {
+        stream->arena = bjson_arena_create(0);
+        if (!stream->arena) {
+            free(stream);
+            return NULL;
+        }
+        stream->parser.arena = stream->arena;
+    }
+    return stream;
+}
+
+// Records from length bytes of data, which must outlive the stream
+bjson_record_stream_t* bjson_record_stream_open(const char* data, size_t length, unsigned flags) {
+    if (!data && length) return NULL;
+    
+    bjson_record_stream_t* stream = record_stream_create(flags);
+    if (!stream) return NULL;
+    stream->data = data;
+    stream->length = length;
+    stream->eof = 1;
+    return stream;
+}
+
+// Records read from fd until end of file; the descriptor is not closed
+bjson_record_stream_t* bjson_record_stream_open_fd(int fd, unsigned flags) {
+    if (fd < 0) return NULL;
+    
+    bjson_record_stream_t* stream = record_stream_create(flags);
+    if (!stream) return NULL;
+    stream->fd = fd;
+    return stream;
+}
+
+// Refill the read buffer, keeping the unconsumed tail; returns 0 on a read
+// error or when out of memory
+static int record_stream_fill(bjson_record_stream_t* s) {
+    size_t tail = s->length - s->pos;
+    if (s->pos) {
+        memmove(s->buffer, s->buffer + s->pos, tail);
+        s->base += s->pos;
+        s->pos = 0;
+        s->length = tail;
+    }
+    
+    // A line longer than the buffer doubles it
+    if (s->buffer_capacity - tail < BJSON_RECORD_READ_SIZE / 2) {
+        size_t capacity = s->buffer_capacity ? s->buffer_capacity * 2 : BJSON_RECORD_READ_SIZE;
+        char* buffer = realloc(s->buffer, capacity);
+        if (!buffer) return 0;
+        s->buffer = buffer;
+        s->buffer_capacity = capacity;
+    }
+    s->data = s->buffer;
+    
+    ssize_t n;
+    do {
+        n = read(s->fd, s->buffer + tail, s->buffer_capacity - tail);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return 0;
+    if (n == 0) s->eof = 1;
+    s->length = tail + (size_t)n;
+    return 1;
+}
+
+// End of the next record at data[pos..), with the scan state there and the
+// newlines inside it; returns 0 at the end of the stream, or -1 when
+// reading failed
+static int record_stream_line(bjson_record_stream_t* s, size_t* end, int* state, size_t* newlines) {
+    for (;;) {
+        *state = BJSON_SCAN_OUT;
+        *newlines = 0;
+        *end = record_scan(s->data, s->pos, s->length, state, newlines, 1);
+        
+        if (*end < s->length || (s->eof && s->pos < s->length)) return 1;
+        if (s->eof) return 0;
+        if (!record_stream_fill(s)) return -1;
+    }
+}
+
+static void record_stream_release(bjson_record_stream_t* s) {
+    if (s->arena) {
+        bjson_arena_reset(s->arena);
+    } else {
+        bjson_free_value(s->current);
+    }
+    s->current = NULL;
+}
+
+// Advance to the next record, skipping blank and comment-only lines.
+// Returns 1 with *record filled in, good or bad, and 0 at the end of the
+// stream. A record's value and strings stay valid until the next call.
+int bjson_record_stream_next(bjson_record_stream_t* s, bjson_record_t* record) {
+    if (!s || !record) return 0;
+    record_stream_release(s);
+    
+    bjson_parser_t* parser = &s->parser;
+    for (;;) {
+        size_t end;
+        int state;
+        size_t newlines;
+        int got = record_stream_line(s, &end, &state, &newlines);
+        if (got <= 0) {
+            if (got == 0) return 0;
+            
+            // Report the failure once, then end the stream
+            s->eof = 1;
+            s->pos = s->length;
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "Read failed after line %zu", s->line);
+            record->value = NULL;
+            record->offset = s->base + s->length;
+            record->length = 0;
+            record->line = s->line;
+            record->error = BJSON_ERROR_IO;
+            record->error_msg = parser->error_msg;
+            return 1;
+        }
+        size_t start = s->pos;
+        size_t line_number = ++s->line;
+        bjson_value_t* value;
+        size_t length;
+        int parsed = record_parse_span(parser, s->data, start, &end, state, &newlines, line_number, &value, &length);
+        s->line += newlines;
+        s->pos = end + (end < s->length);
+        if (!parsed) continue;
+        
+        record->offset = s->base + start;
+        record->length = length;
+        record->line = line_number;
+        
+        // Bad records are the caller's to report; nothing is printed here
+        s->current = value;
+        record->value = value;
+        record->error = value ? BJSON_SUCCESS : BJSON_ERROR_SYNTAX;
+        record->error_msg = value ? NULL : parser->error_msg;
+        if (!value && s->arena) bjson_arena_reset(s->arena);
+        return 1;
+    }
+}
+
+void bjson_record_stream_close(bjson_record_stream_t* s) {
+    if (!s) return;
+    
+    record_stream_release(s);
+    bjson_arena_destroy(s->arena);
+    free(s->parser.scratch);
+    free(s->buffer);
+    free(s);
+}
+
+// Parallel record parsing. The buffer is cut into slices at newlines and
+// worker threads scan every slice speculatively from each state a newline
+// can leave behind (outside, in a string, in a block comment). Chaining the
+// slice exit states, in slice order, then gives the true state at every cut
+// and with it the first real record boundary, so no thread ever scans from
+// the start of the buffer. The chunks between boundaries are parsed by a
+// worker pool, each chunk into its own arena, while the calling thread
+// hands records to the callback in input order. A bad record that falls
+// back to its first line can move later boundaries off the lexical ones;
+// the chunk after it is then parsed again from where its predecessor
+// stopped, so the records match a sequential stream exactly. At most a window of chunks
+// is in flight ahead of delivery, which bounds memory on large inputs.
+
+#define BJSON_PARALLEL_MIN_CHUNK (64 * 1024)
+#define BJSON_PARALLEL_MAX_CHUNK (256 * 1024)  // Keeps each chunk's tree cache-sized
+#define BJSON_PARALLEL_WINDOW 2  // Chunks in flight per thread
+
+typedef struct {
+    size_t start;            // Just after a newline (or 0)
+    size_t end;
+    int exit_state[3];       // State at end, by state at start
+    size_t boundary[3];      // First boundary newline, by state at start; end when none
+    size_t newlines;
+} bjson_slice_t;
+
+typedef struct {
+    size_t start;
+    size_t end;              // Records start before end but may run past it
+    size_t stop;             // Just past the last record, at or after end
+    bjson_arena_t* arena;
+    size_t line;             // Line number at start, then at stop
+    bjson_record_t* records;
+    size_t count;
+    size_t capacity;
+    bjson_error_t status;
+    int done;
+} bjson_chunk_t;
+
+typedef struct {
+    const char* data;
+    size_t length;
+    unsigned flags;
+    bjson_slice_t* slices;
+    size_t slice_count;
+    bjson_chunk_t* chunks;
+    size_t chunk_count;
+    size_t next;             // Next slice to scan, then next chunk to parse
+    size_t delivered;        // Chunks handed to the callback and released
+    bjson_arena_t** spare_arenas;  // Reset arenas of delivered chunks
+    size_t spare_count;
+    size_t window;
+    int stopped;
+    pthread_mutex_t lock;
+    pthread_cond_t chunk_done;
+    pthread_cond_t window_moved;
+} bjson_parallel_t;
+
+static size_t count_newlines(const char* p, size_t n) {
+    size_t count = 0;
+    const char* end = p + n;
+    while ((p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        count++;
+        p++;
+    }
+    return count;
+}
+
+static void* parallel_scan_worker(void* arg) {
+    bjson_parallel_t* job = arg;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        size_t index = job->next++;
+        pthread_mutex_unlock(&job->lock);
+        if (index >= job->slice_count) return NULL;
+        
+        bjson_slice_t* slice = &job->slices[index];
+        slice->newlines = count_newlines(job->data + slice->start, slice->end - slice->start);
+        for (int state = 0; state < 3; state++) {
+            int s = state;
+            size_t boundary = record_scan(job->data, slice->start, slice->end, &s, NULL, 1);
+            slice->boundary[state] = boundary;
+            if (boundary < slice->end) {
+                // From the same boundary on, the scans agree
+                if (state && boundary == slice->boundary[BJSON_SCAN_OUT]) {
+                    slice->exit_state[state] = slice->exit_state[BJSON_SCAN_OUT];
+                    continue;
+                }
+                s = BJSON_SCAN_OUT;
+                record_scan(job->data, boundary, slice->end, &s, NULL, 0);
+            }
+            slice->exit_state[state] = s;
+        }
+    }
+}
+
+static int chunk_add_record(bjson_chunk_t* chunk, const bjson_record_t* record) {
+    if (chunk->count == chunk->capacity) {
+        size_t capacity = grow_capacity(chunk->capacity, chunk->count + 1);
+        bjson_record_t* records = realloc(chunk->records, sizeof(bjson_record_t) * capacity);
+        if (!records) return 0;
+        chunk->records = records;
+        chunk->capacity = capacity;
+    }
+    chunk->records[chunk->count++] = *record;
+    return 1;
+}
+
+// Parse every record of a chunk into the chunk's arena, recycling the arena
+// of a delivered chunk when there is one
+static void parse_chunk(bjson_parallel_t* job, bjson_parser_t* parser, bjson_chunk_t* chunk) {
+    pthread_mutex_lock(&job->lock);
+    chunk->arena = job->spare_count ? job->spare_arenas[--job->spare_count] : NULL;
+    pthread_mutex_unlock(&job->lock);
+    if (!chunk->arena) chunk->arena = bjson_arena_create(0);
+    if (!chunk->arena) {
+        chunk->status = BJSON_ERROR_MEMORY;
+        return;
+    }
+    parser->arena = chunk->arena;
+    chunk->stop = chunk->start;
+    
+    size_t pos = chunk->start;
+    size_t line_number = chunk->line;
+    while (pos < chunk->end) {
+        int state = BJSON_SCAN_OUT;
+        size_t inner = 0;
+        size_t end = record_scan(job->data, pos, job->length, &state, &inner, 1);
+        size_t record_line = line_number;
+        size_t start = pos;
+        
+        bjson_value_t* value;
+        size_t length;
+        int parsed = record_parse_span(parser, job->data, start, &end, state, &inner, record_line, &value, &length);
+        line_number += inner + 1;
+        pos = end + 1;
+        chunk->stop = pos;
+        chunk->line = line_number;
+        if (!parsed) continue;
+        
+        bjson_record_t record;
+        record.value = value;
+        record.offset = start;
+        record.length = length;
+        record.line = record_line;
+        record.error = value ? BJSON_SUCCESS : BJSON_ERROR_SYNTAX;
+        record.error_msg = value ? NULL : parser_strdup(parser, parser->error_msg);
+        if ((!value && !record.error_msg) || !chunk_add_record(chunk, &record)) {
+            chunk->status = BJSON_ERROR_MEMORY;
+            return;
+        }
+    }
+}
+
+static void release_chunk(bjson_parallel_t* job, bjson_chunk_t* chunk) {
+    if (chunk->arena) {
+        bjson_arena_reset(chunk->arena);
+        pthread_mutex_lock(&job->lock);
+        job->spare_arenas[job->spare_count++] = chunk->arena;
+        pthread_mutex_unlock(&job->lock);
+    }
+    free(chunk->records);
+    chunk->arena = NULL;
+    chunk->records = NULL;
+    chunk->count = 0;
+    chunk->capacity = 0;
+}
+
+static void* parallel_parse_worker(void* arg) {
+    bjson_parallel_t* job = arg;
+    bjson_parser_t parser = {0};
+    parser.flags = job->flags;
+    
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        while (!job->stopped && job->next < job->chunk_count && job->next >= job->delivered + job->window) {
+            pthread_cond_wait(&job->window_moved, &job->lock);
+        }
+        size_t index = job->next++;
+        int stop = job->stopped || index >= job->chunk_count;
+        pthread_mutex_unlock(&job->lock);
+        if (stop) break;
+        
+        parse_chunk(job, &parser, &job->chunks[index]);
+        
+        pthread_mutex_lock(&job->lock);
+        job->chunks[index].done = 1;
+        pthread_cond_broadcast(&job->chunk_done);
+        pthread_mutex_unlock(&job->lock);
+    }
+    free(parser.scratch);
+    return NULL;
+}
+
+// Hand a chunk's records to the callback; returns 0 when it asked to stop
+static int deliver_chunk(const bjson_chunk_t* chunk, bjson_record_fn callback, void* ctx) {
+    for (size_t i = 0; i < chunk->count; i++) {
+        if (callback(ctx, &chunk->records[i])) return 0;
+    }
+    return 1;
+}
+
+// Split data[0..length) into slices at newlines, about slice_size bytes each
+static size_t cut_slices(const char* data, size_t length, size_t slice_size, bjson_slice_t* slices, size_t max) {
+    size_t count = 0;
+    size_t start = 0;
+    while (start < length && count < max) {
+        size_t end = length;
+        if (count + 1 < max && length - start > slice_size) {
+            const char* newline = memchr(data + start + slice_size, '\n', length - start - slice_size);
+            if (newline) end = (size_t)(newline - data) + 1;
+        }
+        slices[count].start = start;
+        slices[count].end = end;
+        count++;
+        start = end;
+    }
+    return count;
+}
+
+// Parse a buffer of newline-delimited records on threads worker threads (0
+// for one per online CPU) and pass every record, good or bad, to callback in
+// input order. A record's value and strings are only valid during the
+// callback; every chunk gets its own arena, so BJSON_PARSE_ARENA is implied.
+// Returns BJSON_ERROR_PARTIAL when the callback returned nonzero.
+bjson_error_t bjson_parse_records_parallel(const char* data, size_t length, unsigned flags, int threads,
+                                           bjson_record_fn callback, void* ctx) {
+    if ((!data && length) || !callback) return BJSON_ERROR_TYPE;
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    
+    if (threads == 1) {
+        // A single stream with one rewound arena is fastest on one core
+        bjson_record_stream_t* stream = bjson_record_stream_open(data, length, flags | BJSON_PARSE_ARENA);
+        if (!stream) return BJSON_ERROR_MEMORY;
+        bjson_record_t record;
+        bjson_error_t result = BJSON_SUCCESS;
+        while (bjson_record_stream_next(stream, &record)) {
+            if (callback(ctx, &record)) {
+                result = BJSON_ERROR_PARTIAL;
+                break;
+            }
+        }
+        bjson_record_stream_close(stream);
+        return result;
+    }
+    
+    bjson_parallel_t job = {0};
+    job.data = data;
+    job.length = length;
+    job.flags = (flags | BJSON_PARSE_ARENA) & ~(unsigned)BJSON_PARSE_PRESIZE;
+    
+    // Enough chunks to balance the load, each small enough that its tree
+    // stays in cache and the window of parsed trees stays modest
+    size_t chunk_size = length / ((size_t)threads * 8);
+    if (chunk_size < BJSON_PARALLEL_MIN_CHUNK) chunk_size = BJSON_PARALLEL_MIN_CHUNK;
+    if (chunk_size > BJSON_PARALLEL_MAX_CHUNK) chunk_size = BJSON_PARALLEL_MAX_CHUNK;
+    size_t max_slices = length / chunk_size + 1;
+    if ((size_t)threads > max_slices) threads = (int)max_slices;
+    
+    job.slices = malloc(sizeof(bjson_slice_t) * max_slices);
+    job.chunks = calloc(max_slices, sizeof(bjson_chunk_t));
+    job.spare_arenas = malloc(sizeof(bjson_arena_t*) * max_slices);
+    pthread_t* workers = malloc(sizeof(pthread_t) * (size_t)threads);
+    if (!job.slices || !job.chunks || !job.spare_arenas || !workers) {
+        free(job.slices);
+        free(job.chunks);
+        free(job.spare_arenas);
+        free(workers);
+        return BJSON_ERROR_MEMORY;
+    }
+    job.slice_count = cut_slices(data, length, chunk_size, job.slices, max_slices);
+    job.window = (size_t)threads * BJSON_PARALLEL_WINDOW;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.chunk_done, NULL);
+    pthread_cond_init(&job.window_moved, NULL);
+    
+    // Phase 1: speculative state scan of every slice
+    int started = 0;
+    if (threads > 1) {
+        while (started < threads && pthread_create(&workers[started], NULL, parallel_scan_worker, &job) == 0) {
+            started++;
+        }
+    }
+    if (!started) parallel_scan_worker(&job);
+    for (int t = 0; t < started; t++) pthread_join(workers[t], NULL);
+    
+    // Phase 2: chain the states; a slice whose start is outside strings and
+    // comments begins on a boundary, others at their first boundary
+    int state = BJSON_SCAN_OUT;
+    size_t cut_count = 0;
+    size_t line = 1;
+    for (size_t i = 0; i < job.slice_count; i++) {
+        bjson_slice_t* slice = &job.slices[i];
+        size_t cut = state == BJSON_SCAN_OUT ? slice->start : slice->boundary[state] + 1;
+        if (i == 0 || cut <= slice->end) {
+            if (cut_count) job.chunks[cut_count - 1].end = cut;
+            job.chunks[cut_count].start = cut;
+            job.chunks[cut_count].line = line + count_newlines(data + slice->start, cut - slice->start);
+            cut_count++;
+        }
+        line += slice->newlines;
+        state = slice->exit_state[state];
+    }
+    if (cut_count) job.chunks[cut_count - 1].end = length;
+    job.chunk_count = cut_count;
+    
+    // Phase 3: parse chunks on the pool, deliver in order on this thread
+    job.next = 0;
+    started = 0;
+    if (threads > 1) {
+        while (started < threads && pthread_create(&workers[started], NULL, parallel_parse_worker, &job) == 0) {
+            started++;
+        }
+    }
+    
+    bjson_error_t result = BJSON_SUCCESS;
+    bjson_parser_t parser = {0};
+    parser.flags = job.flags;
+    size_t stop = 0;
+    size_t stop_line = 1;
+    for (size_t k = 0; k < job.chunk_count; k++) {
+        bjson_chunk_t* chunk = &job.chunks[k];
+        if (started) {
+            pthread_mutex_lock(&job.lock);
+            while (!chunk->done) pthread_cond_wait(&job.chunk_done, &job.lock);
+            pthread_mutex_unlock(&job.lock);
+        } else {
+            parse_chunk(&job, &parser, chunk);
+        }
+        if (chunk->status == BJSON_SUCCESS && k && chunk->start != stop) {
+            // The previous chunk's last record ran past this chunk's start
+            release_chunk(&job, chunk);
+            chunk->start = stop;
+            chunk->line = stop_line;
+            parse_chunk(&job, &parser, chunk);
+        }
+        stop = chunk->stop;
+        stop_line = chunk->line;
+        
+        if (chunk->status != BJSON_SUCCESS) {
+            result = chunk->status;
+        } else if (!deliver_chunk(chunk, callback, ctx)) {
+            result = BJSON_ERROR_PARTIAL;
+        }
+        release_chunk(&job, chunk);
+        
+        pthread_mutex_lock(&job.lock);
+        job.delivered = k + 1;
+        if (result != BJSON_SUCCESS) job.stopped = 1;
+        pthread_cond_broadcast(&job.window_moved);
+        pthread_mutex_unlock(&job.lock);
+        if (result != BJSON_SUCCESS) break;
+    }
+    
+    for (int t = 0; t < started; t++) pthread_join(workers[t], NULL);
+    for (size_t k = 0; k < job.chunk_count; k++) release_chunk(&job, &job.chunks[k]);
+    for (size_t i = 0; i < job.spare_count; i++) bjson_arena_destroy(job.spare_arenas[i]);
+    free(parser.scratch);
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.chunk_done);
+    pthread_cond_destroy(&job.window_moved);
+    free(job.slices);
+    free(job.chunks);
+    free(job.spare_arenas);
+    free(workers);
+    return result;
+}
+
+// 128-bit truncated mantissas of 5^q for q in [-342, 308], most significant
+// word first (the Eisel-Lemire table used by fast_float)
+#define BJSON_SMALLEST_POWER_OF_TEN (-342)
+#define BJSON_LARGEST_POWER_OF_TEN 308
+
+static const uint64_t bjson_power_of_five_128[][2] = {
+    {0xeef453d6923bd65a, 0x113faa2906a13b3f},
+    {0x9558b4661b6565f8, 0x4ac7ca59a424c507},
+    {0xbaaee17fa23ebf76, 0x5d79bcf00d2df649},
+    {0xe95a99df8ace6f53, 0xf4d82c2c107973dc},
+    {0x91d8a02bb6c10594, 0x79071b9b8a4be869},
+    {0xb64ec836a47146f9, 0x9748e2826cdee284},
+    {0xe3e27a444d8d98b7, 0xfd1b1b2308169b25},
+    {0x8e6d8c6ab0787f72, 0xfe30f0f5e50e20f7},
+    {0xb208ef855c969f4f, 0xbdbd2d335e51a935},
+    {0xde8b2b66b3bc4723, 0xad2c788035e61382},
+    {0x8b16fb203055ac76, 0x4c3bcb5021afcc31},
+    {0xaddcb9e83c6b1793, 0xdf4abe242a1bbf3d},
+    {0xd953e8624b85dd78, 0xd71d6dad34a2af0d},
+    {0x87d4713d6f33aa6b, 0x8672648c40e5ad68},
+    {0xa9c98d8ccb009506, 0x680efdaf511f18c2},
+    {0xd43bf0effdc0ba48, 0x0212bd1b2566def2},
+    {0x84a57695fe98746d, 0x014bb630f7604b57},
+    {0xa5ced43b7e3e9188, 0x419ea3bd35385e2d},
+    {0xcf42894a5dce35ea, 0x52064cac828675b9},
+    {0x818995ce7aa0e1b2, 0x7343efebd1940993},
+    {0xa1ebfb4219491a1f, 0x1014ebe6c5f90bf8},
+    {0xca66fa129f9b60a6, 0xd41a26e077774ef6},
+    {0xfd00b897478238d0, 0x8920b098955522b4},
+    {0x9e20735e8cb16382, 0x55b46e5f5d5535b0},
+    {0xc5a890362fddbc62, 0xeb2189f734aa831d},
+    {0xf712b443bbd52b7b, 0xa5e9ec7501d523e4},
+    {0x9a6bb0aa55653b2d, 0x47b233c92125366e},
+    {0xc1069cd4eabe89f8, 0x999ec0bb696e840a},
+    {0xf148440a256e2c76, 0xc00670ea43ca250d},
+    {0x96cd2a865764dbca, 0x380406926a5e5728},
+    {0xbc807527ed3e12bc, 0xc605083704f5ecf2},
+    {0xeba09271e88d976b, 0xf7864a44c633682e},
+    {0x93445b8731587ea3, 0x7ab3ee6afbe0211d},
+    {0xb8157268fdae9e4c, 0x5960ea05bad82964},
+    {0xe61acf033d1a45df, 0x6fb92487298e33bd},
+    {0x8fd0c16206306bab, 0xa5d3b6d479f8e056},
+    {0xb3c4f1ba87bc8696, 0x8f48a4899877186c},
+    {0xe0b62e2929aba83c, 0x331acdabfe94de87},
+    {0x8c71dcd9ba0b4925, 0x9ff0c08b7f1d0b14},
+    {0xaf8e5410288e1b6f, 0x07ecf0ae5ee44dd9},
+    {0xdb71e91432b1a24a, 0xc9e82cd9f69d6150},
+    {0x892731ac9faf056e, 0xbe311c083a225cd2},
+    {0xab70fe17c79ac6ca, 0x6dbd630a48aaf406},
+    {0xd64d3d9db981787d, 0x092cbbccdad5b108},
+    {0x85f0468293f0eb4e, 0x25bbf56008c58ea5},
+    {0xa76c582338ed2621, 0xaf2af2b80af6f24e},
+    {0xd1476e2c07286faa, 0x1af5af660db4aee1},
+    {0x82cca4db847945ca, 0x50d98d9fc890ed4d},
+    {0xa37fce126597973c, 0xe50ff107bab528a0},
+    {0xcc5fc196fefd7d0c, 0x1e53ed49a96272c8},
+    {0xff77b1fcbebcdc4f, 0x25e8e89c13bb0f7a},
+    {0x9faacf3df73609b1, 0x77b191618c54e9ac},
+    {0xc795830d75038c1d, 0xd59df5b9ef6a2417},
+    {0xf97ae3d0d2446f25, 0x4b0573286b44ad1d},
+    {0x9becce62836ac577, 0x4ee367f9430aec32},
+    {0xc2e801fb244576d5, 0x229c41f793cda73f},
+    {0xf3a20279ed56d48a, 0x6b43527578c1110f},
+    {0x9845418c345644d6, 0x830a13896b78aaa9},
+    {0xbe5691ef416bd60c, 0x23cc986bc656d553},
+    {0xedec366b11c6cb8f, 0x2cbfbe86b7ec8aa8},
+    {0x94b3a202eb1c3f39, 0x7bf7d71432f3d6a9},
+    {0xb9e08a83a5e34f07, 0xdaf5ccd93fb0cc53},
+    {0xe858ad248f5c22c9, 0xd1b3400f8f9cff68},
+    {0x91376c36d99995be, 0x23100809b9c21fa1},
+    {0xb58547448ffffb2d, 0xabd40a0c2832a78a},
+    {0xe2e69915b3fff9f9, 0x16c90c8f323f516c},
+    {0x8dd01fad907ffc3b, 0xae3da7d97f6792e3},
+    {0xb1442798f49ffb4a, 0x99cd11cfdf41779c},
+    {0xdd95317f31c7fa1d, 0x40405643d711d583},
+    {0x8a7d3eef7f1cfc52, 0x482835ea666b2572},
+    {0xad1c8eab5ee43b66, 0xda3243650005eecf},
+    {0xd863b256369d4a40, 0x90bed43e40076a82},
+    {0x873e4f75e2224e68, 0x5a7744a6e804a291},
+    {0xa90de3535aaae202, 0x711515d0a205cb36},
+    {0xd3515c2831559a83, 0x0d5a5b44ca873e03},
+    {0x8412d9991ed58091, 0xe858790afe9486c2},
+    {0xa5178fff668ae0b6, 0x626e974dbe39a872},
+    {0xce5d73ff402d98e3, 0xfb0a3d212dc8128f},
+    {0x80fa687f881c7f8e, 0x7ce66634bc9d0b99},
+    {0xa139029f6a239f72, 0x1c1fffc1ebc44e80},
+    {0xc987434744ac874e, 0xa327ffb266b56220},
+    {0xfbe9141915d7a922, 0x4bf1ff9f0062baa8},
+    {0x9d71ac8fada6c9b5, 0x6f773fc3603db4a9},
+    {0xc4ce17b399107c22, 0xcb550fb4384d21d3},
+    {0xf6019da07f549b2b, 0x7e2a53a146606a48},
+    {0x99c102844f94e0fb, 0x2eda7444cbfc426d},
+    {0xc0314325637a1939, 0xfa911155fefb5308},
+    {0xf03d93eebc589f88, 0x793555ab7eba27ca},
+    {0x96267c7535b763b5, 0x4bc1558b2f3458de},
+    {0xbbb01b9283253ca2, 0x9eb1aaedfb016f16},
+    {0xea9c227723ee8bcb, 0x465e15a979c1cadc},
+    {0x92a1958a7675175f, 0x0bfacd89ec191ec9},
+    {0xb749faed14125d36, 0xcef980ec671f667b},
+    {0xe51c79a85916f484, 0x82b7e12780e7401a},
+    {0x8f31cc0937ae58d2, 0xd1b2ecb8b0908810},
+    {0xb2fe3f0b8599ef07, 0x861fa7e6dcb4aa15},
+    {0xdfbdcece67006ac9, 0x67a791e093e1d49a},
+    {0x8bd6a141006042bd, 0xe0c8bb2c5c6d24e0},
+    {0xaecc49914078536d, 0x58fae9f773886e18},
+    {0xda7f5bf590966848, 0xaf39a475506a899e},
+    {0x888f99797a5e012d, 0x6d8406c952429603},
+    {0xaab37fd7d8f58178, 0xc8e5087ba6d33b83},
+    {0xd5605fcdcf32e1d6, 0xfb1e4a9a90880a64},
+    {0x855c3be0a17fcd26, 0x5cf2eea09a55067f},
+    {0xa6b34ad8c9dfc06f, 0xf42faa48c0ea481e},
+    {0xd0601d8efc57b08b, 0xf13b94daf124da26},
+    {0x823c12795db6ce57, 0x76c53d08d6b70858},
+    {0xa2cb1717b52481ed, 0x54768c4b0c64ca6e},
+    {0xcb7ddcdda26da268, 0xa9942f5dcf7dfd09},
+    {0xfe5d54150b090b02, 0xd3f93b35435d7c4c},
+    {0x9efa548d26e5a6e1, 0xc47bc5014a1a6daf},
+    {0xc6b8e9b0709f109a, 0x359ab6419ca1091b},
+    {0xf867241c8cc6d4c0, 0xc30163d203c94b62},
+    {0x9b407691d7fc44f8, 0x79e0de63425dcf1d},
+    {0xc21094364dfb5636, 0x985915fc12f542e4},
+    {0xf294b943e17a2bc4, 0x3e6f5b7b17b2939d},
+    {0x979cf3ca6cec5b5a, 0xa705992ceecf9c42},
+    {0xbd8430bd08277231, 0x50c6ff782a838353},
+    {0xece53cec4a314ebd, 0xa4f8bf5635246428},
+    {0x940f4613ae5ed136, 0x871b7795e136be99},
+    {0xb913179899f68584, 0x28e2557b59846e3f},
+    {0xe757dd7ec07426e5, 0x331aeada2fe589cf},
+    {0x9096ea6f3848984f, 0x3ff0d2c85def7621},
+    {0xb4bca50b065abe63, 0x0fed077a756b53a9},
+    {0xe1ebce4dc7f16dfb, 0xd3e8495912c62894},
+    {0x8d3360f09cf6e4bd, 0x64712dd7abbbd95c},
+    {0xb080392cc4349dec, 0xbd8d794d96aacfb3},
+    {0xdca04777f541c567, 0xecf0d7a0fc5583a0},
+    {0x89e42caaf9491b60, 0xf41686c49db57244},
+    {0xac5d37d5b79b6239, 0x311c2875c522ced5},
+    {0xd77485cb25823ac7, 0x7d633293366b828b},
+    {0x86a8d39ef77164bc, 0xae5dff9c02033197},
+    {0xa8530886b54dbdeb, 0xd9f57f830283fdfc},
+    {0xd267caa862a12d66, 0xd072df63c324fd7b},
+    {0x8380dea93da4bc60, 0x4247cb9e59f71e6d},
+    {0xa46116538d0deb78, 0x52d9be85f074e608},
+    {0xcd795be870516656, 0x67902e276c921f8b},
+    {0x806bd9714632dff6, 0x00ba1cd8a3db53b6},
+    {0xa086cfcd97bf97f3, 0x80e8a40eccd228a4},
+    {0xc8a883c0fdaf7df0, 0x6122cd128006b2cd},
+    {0xfad2a4b13d1b5d6c, 0x796b805720085f81},
+    {0x9cc3a6eec6311a63, 0xcbe3303674053bb0},
+    {0xc3f490aa77bd60fc, 0xbedbfc4411068a9c},
+    {0xf4f1b4d515acb93b, 0xee92fb5515482d44},
+    {0x991711052d8bf3c5, 0x751bdd152d4d1c4a},
+    {0xbf5cd54678eef0b6, 0xd262d45a78a0635d},
+    {0xef340a98172aace4, 0x86fb897116c87c34},
+    {0x9580869f0e7aac0e, 0xd45d35e6ae3d4da0},
+    {0xbae0a846d2195712, 0x8974836059cca109},
+    {0xe998d258869facd7, 0x2bd1a438703fc94b},
+    {0x91ff83775423cc06, 0x7b6306a34627ddcf},
+    {0xb67f6455292cbf08, 0x1a3bc84c17b1d542},
+    {0xe41f3d6a7377eeca, 0x20caba5f1d9e4a93},
+    {0x8e938662882af53e, 0x547eb47b7282ee9c},
+    {0xb23867fb2a35b28d, 0xe99e619a4f23aa43},
+    {0xdec681f9f4c31f31, 0x6405fa00e2ec94d4},
+    {0x8b3c113c38f9f37e, 0xde83bc408dd3dd04},
+    {0xae0b158b4738705e, 0x9624ab50b148d445},
+    {0xd98ddaee19068c76, 0x3badd624dd9b0957},
+    {0x87f8a8d4cfa417c9, 0xe54ca5d70a80e5d6},
+    {0xa9f6d30a038d1dbc, 0x5e9fcf4ccd211f4c},
+    {0xd47487cc8470652b, 0x7647c3200069671f},
+    {0x84c8d4dfd2c63f3b, 0x29ecd9f40041e073},
+    {0xa5fb0a17c777cf09, 0xf468107100525890},
+    {0xcf79cc9db955c2cc, 0x7182148d4066eeb4},
+    {0x81ac1fe293d599bf, 0xc6f14cd848405530},
+    {0xa21727db38cb002f, 0xb8ada00e5a506a7c},
+    {0xca9cf1d206fdc03b, 0xa6d90811f0e4851c},
+    {0xfd442e4688bd304a, 0x908f4a166d1da663},
+    {0x9e4a9cec15763e2e, 0x9a598e4e043287fe},
+    {0xc5dd44271ad3cdba, 0x40eff1e1853f29fd},
+    {0xf7549530e188c128, 0xd12bee59e68ef47c},
+    {0x9a94dd3e8cf578b9, 0x82bb74f8301958ce},
+    {0xc13a148e3032d6e7, 0xe36a52363c1faf01},
+    {0xf18899b1bc3f8ca1, 0xdc44e6c3cb279ac1},
+    {0x96f5600f15a7b7e5, 0x29ab103a5ef8c0b9},
+    {0xbcb2b812db11a5de, 0x7415d448f6b6f0e7},
+    {0xebdf661791d60f56, 0x111b495b3464ad21},
+    {0x936b9fcebb25c995, 0xcab10dd900beec34},
+    {0xb84687c269ef3bfb, 0x3d5d514f40eea742},
+    {0xe65829b3046b0afa, 0x0cb4a5a3112a5112},
+    {0x8ff71a0fe2c2e6dc, 0x47f0e785eaba72ab},
+    {0xb3f4e093db73a093, 0x59ed216765690f56},
+    {0xe0f218b8d25088b8, 0x306869c13ec3532c},
+    {0x8c974f7383725573, 0x1e414218c73a13fb},
+    {0xafbd2350644eeacf, 0xe5d1929ef90898fa},
+    {0xdbac6c247d62a583, 0xdf45f746b74abf39},
+    {0x894bc396ce5da772, 0x6b8bba8c328eb783},
+    {0xab9eb47c81f5114f, 0x066ea92f3f326564},
+    {0xd686619ba27255a2, 0xc80a537b0efefebd},
+    {0x8613fd0145877585, 0xbd06742ce95f5f36},
+    {0xa798fc4196e952e7, 0x2c48113823b73704},
+    {0xd17f3b51fca3a7a0, 0xf75a15862ca504c5},
+    {0x82ef85133de648c4, 0x9a984d73dbe722fb},
+    {0xa3ab66580d5fdaf5, 0xc13e60d0d2e0ebba},
+    {0xcc963fee10b7d1b3, 0x318df905079926a8},
+    {0xffbbcfe994e5c61f, 0xfdf17746497f7052},
+    {0x9fd561f1fd0f9bd3, 0xfeb6ea8bedefa633},
+    {0xc7caba6e7c5382c8, 0xfe64a52ee96b8fc0},
+    {0xf9bd690a1b68637b, 0x3dfdce7aa3c673b0},
+    {0x9c1661a651213e2d, 0x06bea10ca65c084e},
+    {0xc31bfa0fe5698db8, 0x486e494fcff30a62},
+    {0xf3e2f893dec3f126, 0x5a89dba3c3efccfa},
+    {0x986ddb5c6b3a76b7, 0xf89629465a75e01c},
+    {0xbe89523386091465, 0xf6bbb397f1135823},
+    {0xee2ba6c0678b597f, 0x746aa07ded582e2c},
+    {0x94db483840b717ef, 0xa8c2a44eb4571cdc},
+    {0xba121a4650e4ddeb, 0x92f34d62616ce413},
+    {0xe896a0d7e51e1566, 0x77b020baf9c81d17},
+    {0x915e2486ef32cd60, 0x0ace1474dc1d122e},
+    {0xb5b5ada8aaff80b8, 0x0d819992132456ba},
+    {0xe3231912d5bf60e6, 0x10e1fff697ed6c69},
+    {0x8df5efabc5979c8f, 0xca8d3ffa1ef463c1},
+    {0xb1736b96b6fd83b3, 0xbd308ff8a6b17cb2},
+    {0xddd0467c64bce4a0, 0xac7cb3f6d05ddbde},
+    {0x8aa22c0dbef60ee4, 0x6bcdf07a423aa96b},
+    {0xad4ab7112eb3929d, 0x86c16c98d2c953c6},
+    {0xd89d64d57a607744, 0xe871c7bf077ba8b7},
+    {0x87625f056c7c4a8b, 0x11471cd764ad4972},
+    {0xa93af6c6c79b5d2d, 0xd598e40d3dd89bcf},
+    {0xd389b47879823479, 0x4aff1d108d4ec2c3},
+    {0x843610cb4bf160cb, 0xcedf722a585139ba},
+    {0xa54394fe1eedb8fe, 0xc2974eb4ee658828},
+    {0xce947a3da6a9273e, 0x733d226229feea32},
+    {0x811ccc668829b887, 0x0806357d5a3f525f},
+    {0xa163ff802a3426a8, 0xca07c2dcb0cf26f7},
+    {0xc9bcff6034c13052, 0xfc89b393dd02f0b5},
+    {0xfc2c3f3841f17c67, 0xbbac2078d443ace2},
+    {0x9d9ba7832936edc0, 0xd54b944b84aa4c0d},
+    {0xc5029163f384a931, 0x0a9e795e65d4df11},
+    {0xf64335bcf065d37d, 0x4d4617b5ff4a16d5},
+    {0x99ea0196163fa42e, 0x504bced1bf8e4e45},
+    {0xc06481fb9bcf8d39, 0xe45ec2862f71e1d6},
+    {0xf07da27a82c37088, 0x5d767327bb4e5a4c},
+    {0x964e858c91ba2655, 0x3a6a07f8d510f86f},
+    {0xbbe226efb628afea, 0x890489f70a55368b},
+    {0xeadab0aba3b2dbe5, 0x2b45ac74ccea842e},
+    {0x92c8ae6b464fc96f, 0x3b0b8bc90012929d},
+    {0xb77ada0617e3bbcb, 0x09ce6ebb40173744},
+    {0xe55990879ddcaabd, 0xcc420a6a101d0515},
+    {0x8f57fa54c2a9eab6, 0x9fa946824a12232d},
+    {0xb32df8e9f3546564, 0x47939822dc96abf9},
+    {0xdff9772470297ebd, 0x59787e2b93bc56f7},
+    {0x8bfbea76c619ef36, 0x57eb4edb3c55b65a},
+    {0xaefae51477a06b03, 0xede622920b6b23f1},
+    {0xdab99e59958885c4, 0xe95fab368e45eced},
+    {0x88b402f7fd75539b, 0x11dbcb0218ebb414},
+    {0xaae103b5fcd2a881, 0xd652bdc29f26a119},
+    {0xd59944a37c0752a2, 0x4be76d3346f0495f},
+    {0x857fcae62d8493a5, 0x6f70a4400c562ddb},
+    {0xa6dfbd9fb8e5b88e, 0xcb4ccd500f6bb952},
+    {0xd097ad07a71f26b2, 0x7e2000a41346a7a7},
+    {0x825ecc24c873782f, 0x8ed400668c0c28c8},
+    {0xa2f67f2dfa90563b, 0x728900802f0f32fa},
+    {0xcbb41ef979346bca, 0x4f2b40a03ad2ffb9},
+    {0xfea126b7d78186bc, 0xe2f610c84987bfa8},
+    {0x9f24b832e6b0f436, 0x0dd9ca7d2df4d7c9},
+    {0xc6ede63fa05d3143, 0x91503d1c79720dbb},
+    {0xf8a95fcf88747d94, 0x75a44c6397ce912a},
+    {0x9b69dbe1b548ce7c, 0xc986afbe3ee11aba},
+    {0xc24452da229b021b, 0xfbe85badce996168},
+    {0xf2d56790ab41c2a2, 0xfae27299423fb9c3},
+    {0x97c560ba6b0919a5, 0xdccd879fc967d41a},
+    {0xbdb6b8e905cb600f, 0x5400e987bbc1c920},
+    {0xed246723473e3813, 0x290123e9aab23b68},
+    {0x9436c0760c86e30b, 0xf9a0b6720aaf6521},
+    {0xb94470938fa89bce, 0xf808e40e8d5b3e69},
+    {0xe7958cb87392c2c2, 0xb60b1d1230b20e04},
+    {0x90bd77f3483bb9b9, 0xb1c6f22b5e6f48c2},
+    {0xb4ecd5f01a4aa828, 0x1e38aeb6360b1af3},
+    {0xe2280b6c20dd5232, 0x25c6da63c38de1b0},
+    {0x8d590723948a535f, 0x579c487e5a38ad0e},
+    {0xb0af48ec79ace837, 0x2d835a9df0c6d851},
+    {0xdcdb1b2798182244, 0xf8e431456cf88e65},
+    {0x8a08f0f8bf0f156b, 0x1b8e9ecb641b58ff},
+    {0xac8b2d36eed2dac5, 0xe272467e3d222f3f},
+    {0xd7adf884aa879177, 0x5b0ed81dcc6abb0f},
+    {0x86ccbb52ea94baea, 0x98e947129fc2b4e9},
+    {0xa87fea27a539e9a5, 0x3f2398d747b36224},
+    {0xd29fe4b18e88640e, 0x8eec7f0d19a03aad},
+    {0x83a3eeeef9153e89, 0x1953cf68300424ac},
+    {0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7},
+    {0xcdb02555653131b6, 0x3792f412cb06794d},
+    {0x808e17555f3ebf11, 0xe2bbd88bbee40bd0},
+    {0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4},
+    {0xc8de047564d20a8b, 0xf245825a5a445275},
+    {0xfb158592be068d2e, 0xeed6e2f0f0d56712},
+    {0x9ced737bb6c4183d, 0x55464dd69685606b},
+    {0xc428d05aa4751e4c, 0xaa97e14c3c26b886},
+    {0xf53304714d9265df, 0xd53dd99f4b3066a8},
+    {0x993fe2c6d07b7fab, 0xe546a8038efe4029},
+    {0xbf8fdb78849a5f96, 0xde98520472bdd033},
+    {0xef73d256a5c0f77c, 0x963e66858f6d4440},
+    {0x95a8637627989aad, 0xdde7001379a44aa8},
+    {0xbb127c53b17ec159, 0x5560c018580d5d52},
+    {0xe9d71b689dde71af, 0xaab8f01e6e10b4a6},
+    {0x9226712162ab070d, 0xcab3961304ca70e8},
+    {0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22},
+    {0xe45c10c42a2b3b05, 0x8cb89a7db77c506a},
+    {0x8eb98a7a9a5b04e3, 0x77f3608e92adb242},
+    {0xb267ed1940f1c61c, 0x55f038b237591ed3},
+    {0xdf01e85f912e37a3, 0x6b6c46dec52f6688},
+    {0x8b61313bbabce2c6, 0x2323ac4b3b3da015},
+    {0xae397d8aa96c1b77, 0xabec975e0a0d081a},
+    {0xd9c7dced53c72255, 0x96e7bd358c904a21},
+    {0x881cea14545c7575, 0x7e50d64177da2e54},
+    {0xaa242499697392d2, 0xdde50bd1d5d0b9e9},
+    {0xd4ad2dbfc3d07787, 0x955e4ec64b44e864},
+    {0x84ec3c97da624ab4, 0xbd5af13bef0b113e},
+    {0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e},
+    {0xcfb11ead453994ba, 0x67de18eda5814af2},
+    {0x81ceb32c4b43fcf4, 0x80eacf948770ced7},
+    {0xa2425ff75e14fc31, 0xa1258379a94d028d},
+    {0xcad2f7f5359a3b3e, 0x096ee45813a04330},
+    {0xfd87b5f28300ca0d, 0x8bca9d6e188853fc},
+    {0x9e74d1b791e07e48, 0x775ea264cf55347e},
+    {0xc612062576589dda, 0x95364afe032a819e},
+    {0xf79687aed3eec551, 0x3a83ddbd83f52205},
+    {0x9abe14cd44753b52, 0xc4926a9672793543},
+    {0xc16d9a0095928a27, 0x75b7053c0f178294},
+    {0xf1c90080baf72cb1, 0x5324c68b12dd6339},
+    {0x971da05074da7bee, 0xd3f6fc16ebca5e04},
+    {0xbce5086492111aea, 0x88f4bb1ca6bcf585},
+    {0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6},
+    {0x9392ee8e921d5d07, 0x3aff322e62439fd0},
+    {0xb877aa3236a4b449, 0x09befeb9fad487c3},
+    {0xe69594bec44de15b, 0x4c2ebe687989a9b4},
+    {0x901d7cf73ab0acd9, 0x0f9d37014bf60a11},
+    {0xb424dc35095cd80f, 0x538484c19ef38c95},
+    {0xe12e13424bb40e13, 0x2865a5f206b06fba},
+    {0x8cbccc096f5088cb, 0xf93f87b7442e45d4},
+    {0xafebff0bcb24aafe, 0xf78f69a51539d749},
+    {0xdbe6fecebdedd5be, 0xb573440e5a884d1c},
+    {0x89705f4136b4a597, 0x31680a88f8953031},
+    {0xabcc77118461cefc, 0xfdc20d2b36ba7c3e},
+    {0xd6bf94d5e57a42bc, 0x3d32907604691b4d},
+    {0x8637bd05af6c69b5, 0xa63f9a49c2c1b110},
+    {0xa7c5ac471b478423, 0x0fcf80dc33721d54},
+    {0xd1b71758e219652b, 0xd3c36113404ea4a9},
+    {0x83126e978d4fdf3b, 0x645a1cac083126ea},
+    {0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4},
+    {0xcccccccccccccccc, 0xcccccccccccccccd},
+    {0x8000000000000000, 0x0000000000000000},
+    {0xa000000000000000, 0x0000000000000000},
+    {0xc800000000000000, 0x0000000000000000},
+    {0xfa00000000000000, 0x0000000000000000},
+    {0x9c40000000000000, 0x0000000000000000},
+    {0xc350000000000000, 0x0000000000000000},
+    {0xf424000000000000, 0x0000000000000000},
+    {0x9896800000000000, 0x0000000000000000},
+    {0xbebc200000000000, 0x0000000000000000},
+    {0xee6b280000000000, 0x0000000000000000},
+    {0x9502f90000000000, 0x0000000000000000},
+    {0xba43b74000000000, 0x0000000000000000},
+    {0xe8d4a51000000000, 0x0000000000000000},
+    {0x9184e72a00000000, 0x0000000000000000},
+    {0xb5e620f480000000, 0x0000000000000000},
+    {0xe35fa931a0000000, 0x0000000000000000},
+    {0x8e1bc9bf04000000, 0x0000000000000000},
+    {0xb1a2bc2ec5000000, 0x0000000000000000},
+    {0xde0b6b3a76400000, 0x0000000000000000},
+    {0x8ac7230489e80000, 0x0000000000000000},
+    {0xad78ebc5ac620000, 0x0000000000000000},
+    {0xd8d726b7177a8000, 0x0000000000000000},
+    {0x878678326eac9000, 0x0000000000000000},
+    {0xa968163f0a57b400, 0x0000000000000000},
+    {0xd3c21bcecceda100, 0x0000000000000000},
+    {0x84595161401484a0, 0x0000000000000000},
+    {0xa56fa5b99019a5c8, 0x0000000000000000},
+    {0xcecb8f27f4200f3a, 0x0000000000000000},
+    {0x813f3978f8940984, 0x4000000000000000},
+    {0xa18f07d736b90be5, 0x5000000000000000},
+    {0xc9f2c9cd04674ede, 0xa400000000000000},
+    {0xfc6f7c4045812296, 0x4d00000000000000},
+    {0x9dc5ada82b70b59d, 0xf020000000000000},
+    {0xc5371912364ce305, 0x6c28000000000000},
+    {0xf684df56c3e01bc6, 0xc732000000000000},
+    {0x9a130b963a6c115c, 0x3c7f400000000000},
+    {0xc097ce7bc90715b3, 0x4b9f100000000000},
+    {0xf0bdc21abb48db20, 0x1e86d40000000000},
+    {0x96769950b50d88f4, 0x1314448000000000},
+    {0xbc143fa4e250eb31, 0x17d955a000000000},
+    {0xeb194f8e1ae525fd, 0x5dcfab0800000000},
+    {0x92efd1b8d0cf37be, 0x5aa1cae500000000},
+    {0xb7abc627050305ad, 0xf14a3d9e40000000},
+    {0xe596b7b0c643c719, 0x6d9ccd05d0000000},
+    {0x8f7e32ce7bea5c6f, 0xe4820023a2000000},
+    {0xb35dbf821ae4f38b, 0xdda2802c8a800000},
+    {0xe0352f62a19e306e, 0xd50b2037ad200000},
+    {0x8c213d9da502de45, 0x4526f422cc340000},
+    {0xaf298d050e4395d6, 0x9670b12b7f410000},
+    {0xdaf3f04651d47b4c, 0x3c0cdd765f114000},
+    {0x88d8762bf324cd0f, 0xa5880a69fb6ac800},
+    {0xab0e93b6efee0053, 0x8eea0d047a457a00},
+    {0xd5d238a4abe98068, 0x72a4904598d6d880},
+    {0x85a36366eb71f041, 0x47a6da2b7f864750},
+    {0xa70c3c40a64e6c51, 0x999090b65f67d924},
+    {0xd0cf4b50cfe20765, 0xfff4b4e3f741cf6d},
+    {0x82818f1281ed449f, 0xbff8f10e7a8921a4},
+    {0xa321f2d7226895c7, 0xaff72d52192b6a0d},
+    {0xcbea6f8ceb02bb39, 0x9bf4f8a69f764490},
+    {0xfee50b7025c36a08, 0x02f236d04753d5b4},
+    {0x9f4f2726179a2245, 0x01d762422c946590},
+    {0xc722f0ef9d80aad6, 0x424d3ad2b7b97ef5},
+    {0xf8ebad2b84e0d58b, 0xd2e0898765a7deb2},
+    {0x9b934c3b330c8577, 0x63cc55f49f88eb2f},
+    {0xc2781f49ffcfa6d5, 0x3cbf6b71c76b25fb},
+    {0xf316271c7fc3908a, 0x8bef464e3945ef7a},
+    {0x97edd871cfda3a56, 0x97758bf0e3cbb5ac},
+    {0xbde94e8e43d0c8ec, 0x3d52eeed1cbea317},
+    {0xed63a231d4c4fb27, 0x4ca7aaa863ee4bdd},
+    {0x945e455f24fb1cf8, 0x8fe8caa93e74ef6a},
+    {0xb975d6b6ee39e436, 0xb3e2fd538e122b44},
+    {0xe7d34c64a9c85d44, 0x60dbbca87196b616},
+    {0x90e40fbeea1d3a4a, 0xbc8955e946fe31cd},
+    {0xb51d13aea4a488dd, 0x6babab6398bdbe41},
+    {0xe264589a4dcdab14, 0xc696963c7eed2dd1},
+    {0x8d7eb76070a08aec, 0xfc1e1de5cf543ca2},
+    {0xb0de65388cc8ada8, 0x3b25a55f43294bcb},
+    {0xdd15fe86affad912, 0x49ef0eb713f39ebe},
+    {0x8a2dbf142dfcc7ab, 0x6e3569326c784337},
+    {0xacb92ed9397bf996, 0x49c2c37f07965404},
+    {0xd7e77a8f87daf7fb, 0xdc33745ec97be906},
+    {0x86f0ac99b4e8dafd, 0x69a028bb3ded71a3},
+    {0xa8acd7c0222311bc, 0xc40832ea0d68ce0c},
+    {0xd2d80db02aabd62b, 0xf50a3fa490c30190},
+    {0x83c7088e1aab65db, 0x792667c6da79e0fa},
+    {0xa4b8cab1a1563f52, 0x577001b891185938},
+    {0xcde6fd5e09abcf26, 0xed4c0226b55e6f86},
+    {0x80b05e5ac60b6178, 0x544f8158315b05b4},
+    {0xa0dc75f1778e39d6, 0x696361ae3db1c721},
+    {0xc913936dd571c84c, 0x03bc3a19cd1e38e9},
+    {0xfb5878494ace3a5f, 0x04ab48a04065c723},
+    {0x9d174b2dcec0e47b, 0x62eb0d64283f9c76},
+    {0xc45d1df942711d9a, 0x3ba5d0bd324f8394},
+    {0xf5746577930d6500, 0xca8f44ec7ee36479},
+    {0x9968bf6abbe85f20, 0x7e998b13cf4e1ecb},
+    {0xbfc2ef456ae276e8, 0x9e3fedd8c321a67e},
+    {0xefb3ab16c59b14a2, 0xc5cfe94ef3ea101e},
+    {0x95d04aee3b80ece5, 0xbba1f1d158724a12},
+    {0xbb445da9ca61281f, 0x2a8a6e45ae8edc97},
+    {0xea1575143cf97226, 0xf52d09d71a3293bd},
+    {0x924d692ca61be758, 0x593c2626705f9c56},
+    {0xb6e0c377cfa2e12e, 0x6f8b2fb00c77836c},
+    {0xe498f455c38b997a, 0x0b6dfb9c0f956447},
+    {0x8edf98b59a373fec, 0x4724bd4189bd5eac},
+    {0xb2977ee300c50fe7, 0x58edec91ec2cb657},
+    {0xdf3d5e9bc0f653e1, 0x2f2967b66737e3ed},
+    {0x8b865b215899f46c, 0xbd79e0d20082ee74},
+    {0xae67f1e9aec07187, 0xecd8590680a3aa11},
+    {0xda01ee641a708de9, 0xe80e6f4820cc9495},
+    {0x884134fe908658b2, 0x3109058d147fdcdd},
+    {0xaa51823e34a7eede, 0xbd4b46f0599fd415},
+    {0xd4e5e2cdc1d1ea96, 0x6c9e18ac7007c91a},
+    {0x850fadc09923329e, 0x03e2cf6bc604ddb0},
+    {0xa6539930bf6bff45, 0x84db8346b786151c},
+    {0xcfe87f7cef46ff16, 0xe612641865679a63},
+    {0x81f14fae158c5f6e, 0x4fcb7e8f3f60c07e},
+    {0xa26da3999aef7749, 0xe3be5e330f38f09d},
+    {0xcb090c8001ab551c, 0x5cadf5bfd3072cc5},
+    {0xfdcb4fa002162a63, 0x73d9732fc7c8f7f6},
+    {0x9e9f11c4014dda7e, 0x2867e7fddcdd9afa},
+    {0xc646d63501a1511d, 0xb281e1fd541501b8},
+    {0xf7d88bc24209a565, 0x1f225a7ca91a4226},
+    {0x9ae757596946075f, 0x3375788de9b06958},
+    {0xc1a12d2fc3978937, 0x0052d6b1641c83ae},
+    {0xf209787bb47d6b84, 0xc0678c5dbd23a49a},
+    {0x9745eb4d50ce6332, 0xf840b7ba963646e0},
+    {0xbd176620a501fbff, 0xb650e5a93bc3d898},
+    {0xec5d3fa8ce427aff, 0xa3e51f138ab4cebe},
+    {0x93ba47c980e98cdf, 0xc66f336c36b10137},
+    {0xb8a8d9bbe123f017, 0xb80b0047445d4184},
+    {0xe6d3102ad96cec1d, 0xa60dc059157491e5},
+    {0x9043ea1ac7e41392, 0x87c89837ad68db2f},
+    {0xb454e4a179dd1877, 0x29babe4598c311fb},
+    {0xe16a1dc9d8545e94, 0xf4296dd6fef3d67a},
+    {0x8ce2529e2734bb1d, 0x1899e4a65f58660c},
+    {0xb01ae745b101e9e4, 0x5ec05dcff72e7f8f},
+    {0xdc21a1171d42645d, 0x76707543f4fa1f73},
+    {0x899504ae72497eba, 0x6a06494a791c53a8},
+    {0xabfa45da0edbde69, 0x0487db9d17636892},
+    {0xd6f8d7509292d603, 0x45a9d2845d3c42b6},
+    {0x865b86925b9bc5c2, 0x0b8a2392ba45a9b2},
+    {0xa7f26836f282b732, 0x8e6cac7768d7141e},
+    {0xd1ef0244af2364ff, 0x3207d795430cd926},
+    {0x8335616aed761f1f, 0x7f44e6bd49e807b8},
+    {0xa402b9c5a8d3a6e7, 0x5f16206c9c6209a6},
+    {0xcd036837130890a1, 0x36dba887c37a8c0f},
+    {0x802221226be55a64, 0xc2494954da2c9789},
+    {0xa02aa96b06deb0fd, 0xf2db9baa10b7bd6c},
+    {0xc83553c5c8965d3d, 0x6f92829494e5acc7},
+    {0xfa42a8b73abbf48c, 0xcb772339ba1f17f9},
+    {0x9c69a97284b578d7, 0xff2a760414536efb},
+    {0xc38413cf25e2d70d, 0xfef5138519684aba},
+    {0xf46518c2ef5b8cd1, 0x7eb258665fc25d69},
+    {0x98bf2f79d5993802, 0xef2f773ffbd97a61},
+    {0xbeeefb584aff8603, 0xaafb550ffacfd8fa},
+    {0xeeaaba2e5dbf6784, 0x95ba2a53f983cf38},
+    {0x952ab45cfa97a0b2, 0xdd945a747bf26183},
+    {0xba756174393d88df, 0x94f971119aeef9e4},
+    {0xe912b9d1478ceb17, 0x7a37cd5601aab85d},
+    {0x91abb422ccb812ee, 0xac62e055c10ab33a},
+    {0xb616a12b7fe617aa, 0x577b986b314d6009},
+    {0xe39c49765fdf9d94, 0xed5a7e85fda0b80b},
+    {0x8e41ade9fbebc27d, 0x14588f13be847307},
+    {0xb1d219647ae6b31c, 0x596eb2d8ae258fc8},
+    {0xde469fbd99a05fe3, 0x6fca5f8ed9aef3bb},
+    {0x8aec23d680043bee, 0x25de7bb9480d5854},
+    {0xada72ccc20054ae9, 0xaf561aa79a10ae6a},
+    {0xd910f7ff28069da4, 0x1b2ba1518094da04},
+    {0x87aa9aff79042286, 0x90fb44d2f05d0842},
+    {0xa99541bf57452b28, 0x353a1607ac744a53},
+    {0xd3fa922f2d1675f2, 0x42889b8997915ce8},
+    {0x847c9b5d7c2e09b7, 0x69956135febada11},
+    {0xa59bc234db398c25, 0x43fab9837e699095},
+    {0xcf02b2c21207ef2e, 0x94f967e45e03f4bb},
+    {0x8161afb94b44f57d, 0x1d1be0eebac278f5},
+    {0xa1ba1ba79e1632dc, 0x6462d92a69731732},
+    {0xca28a291859bbf93, 0x7d7b8f7503cfdcfe},
+    {0xfcb2cb35e702af78, 0x5cda735244c3d43e},
+    {0x9defbf01b061adab, 0x3a0888136afa64a7},
+    {0xc56baec21c7a1916, 0x088aaa1845b8fdd0},
+    {0xf6c69a72a3989f5b, 0x8aad549e57273d45},
+    {0x9a3c2087a63f6399, 0x36ac54e2f678864b},
+    {0xc0cb28a98fcf3c7f, 0x84576a1bb416a7dd},
+    {0xf0fdf2d3f3c30b9f, 0x656d44a2a11c51d5},
+    {0x969eb7c47859e743, 0x9f644ae5a4b1b325},
+    {0xbc4665b596706114, 0x873d5d9f0dde1fee},
+    {0xeb57ff22fc0c7959, 0xa90cb506d155a7ea},
+    {0x9316ff75dd87cbd8, 0x09a7f12442d588f2},
+    {0xb7dcbf5354e9bece, 0x0c11ed6d538aeb2f},
+    {0xe5d3ef282a242e81, 0x8f1668c8a86da5fa},
+    {0x8fa475791a569d10, 0xf96e017d694487bc},
+    {0xb38d92d760ec4455, 0x37c981dcc395a9ac},
+    {0xe070f78d3927556a, 0x85bbe253f47b1417},
+    {0x8c469ab843b89562, 0x93956d7478ccec8e},
+    {0xaf58416654a6babb, 0x387ac8d1970027b2},
+    {0xdb2e51bfe9d0696a, 0x06997b05fcc0319e},
+    {0x88fcf317f22241e2, 0x441fece3bdf81f03},
+    {0xab3c2fddeeaad25a, 0xd527e81cad7626c3},
+    {0xd60b3bd56a5586f1, 0x8a71e223d8d3b074},
+    {0x85c7056562757456, 0xf6872d5667844e49},
+    {0xa738c6bebb12d16c, 0xb428f8ac016561db},
+    {0xd106f86e69d785c7, 0xe13336d701beba52},
+    {0x82a45b450226b39c, 0xecc0024661173473},
+    {0xa34d721642b06084, 0x27f002d7f95d0190},
+    {0xcc20ce9bd35c78a5, 0x31ec038df7b441f4},
+    {0xff290242c83396ce, 0x7e67047175a15271},
+    {0x9f79a169bd203e41, 0x0f0062c6e984d386},
+    {0xc75809c42c684dd1, 0x52c07b78a3e60868},
+    {0xf92e0c3537826145, 0xa7709a56ccdf8a82},
+    {0x9bbcc7a142b17ccb, 0x88a66076400bb691},
+    {0xc2abf989935ddbfe, 0x6acff893d00ea435},
+    {0xf356f7ebf83552fe, 0x0583f6b8c4124d43},
+    {0x98165af37b2153de, 0xc3727a337a8b704a},
+    {0xbe1bf1b059e9a8d6, 0x744f18c0592e4c5c},
+    {0xeda2ee1c7064130c, 0x1162def06f79df73},
+    {0x9485d4d1c63e8be7, 0x8addcb5645ac2ba8},
+    {0xb9a74a0637ce2ee1, 0x6d953e2bd7173692},
+    {0xe8111c87c5c1ba99, 0xc8fa8db6ccdd0437},
+    {0x910ab1d4db9914a0, 0x1d9c9892400a22a2},
+    {0xb54d5e4a127f59c8, 0x2503beb6d00cab4b},
+    {0xe2a0b5dc971f303a, 0x2e44ae64840fd61d},
+    {0x8da471a9de737e24, 0x5ceaecfed289e5d2},
+    {0xb10d8e1456105dad, 0x7425a83e872c5f47},
+    {0xdd50f1996b947518, 0xd12f124e28f77719},
+    {0x8a5296ffe33cc92f, 0x82bd6b70d99aaa6f},
+    {0xace73cbfdc0bfb7b, 0x636cc64d1001550b},
+    {0xd8210befd30efa5a, 0x3c47f7e05401aa4e},
+    {0x8714a775e3e95c78, 0x65acfaec34810a71},
+    {0xa8d9d1535ce3b396, 0x7f1839a741a14d0d},
+    {0xd31045a8341ca07c, 0x1ede48111209a050},
+    {0x83ea2b892091e44d, 0x934aed0aab460432},
+    {0xa4e4b66b68b65d60, 0xf81da84d5617853f},
+    {0xce1de40642e3f4b9, 0x36251260ab9d668e},
+    {0x80d2ae83e9ce78f3, 0xc1d72b7c6b426019},
+    {0xa1075a24e4421730, 0xb24cf65b8612f81f},
+    {0xc94930ae1d529cfc, 0xdee033f26797b627},
+    {0xfb9b7cd9a4a7443c, 0x169840ef017da3b1},
+    {0x9d412e0806e88aa5, 0x8e1f289560ee864e},
+    {0xc491798a08a2ad4e, 0xf1a6f2bab92a27e2},
+    {0xf5b5d7ec8acb58a2, 0xae10af696774b1db},
+    {0x9991a6f3d6bf1765, 0xacca6da1e0a8ef29},
+    {0xbff610b0cc6edd3f, 0x17fd090a58d32af3},
+    {0xeff394dcff8a948e, 0xddfc4b4cef07f5b0},
+    {0x95f83d0a1fb69cd9, 0x4abdaf101564f98e},
+    {0xbb764c4ca7a4440f, 0x9d6d1ad41abe37f1},
+    {0xea53df5fd18d5513, 0x84c86189216dc5ed},
+    {0x92746b9be2f8552c, 0x32fd3cf5b4e49bb4},
+    {0xb7118682dbb66a77, 0x3fbc8c33221dc2a1},
+    {0xe4d5e82392a40515, 0x0fabaf3feaa5334a},
+    {0x8f05b1163ba6832d, 0x29cb4d87f2a7400e},
+    {0xb2c71d5bca9023f8, 0x743e20e9ef511012},
+    {0xdf78e4b2bd342cf6, 0x914da9246b255416},
+    {0x8bab8eefb6409c1a, 0x1ad089b6c2f7548e},
+    {0xae9672aba3d0c320, 0xa184ac2473b529b1},
+    {0xda3c0f568cc4f3e8, 0xc9e5d72d90a2741e},
+    {0x8865899617fb1871, 0x7e2fa67c7a658892},
+    {0xaa7eebfb9df9de8d, 0xddbb901b98feeab7},
+    {0xd51ea6fa85785631, 0x552a74227f3ea565},
+    {0x8533285c936b35de, 0xd53a88958f87275f},
+    {0xa67ff273b8460356, 0x8a892abaf368f137},
+    {0xd01fef10a657842c, 0x2d2b7569b0432d85},
+    {0x8213f56a67f6b29b, 0x9c3b29620e29fc73},
+    {0xa298f2c501f45f42, 0x8349f3ba91b47b8f},
+    {0xcb3f2f7642717713, 0x241c70a936219a73},
+    {0xfe0efb53d30dd4d7, 0xed238cd383aa0110},
+    {0x9ec95d1463e8a506, 0xf4363804324a40aa},
+    {0xc67bb4597ce2ce48, 0xb143c6053edcd0d5},
+    {0xf81aa16fdc1b81da, 0xdd94b7868e94050a},
+    {0x9b10a4e5e9913128, 0xca7cf2b4191c8326},
+    {0xc1d4ce1f63f57d72, 0xfd1c2f611f63a3f0},
+    {0xf24a01a73cf2dccf, 0xbc633b39673c8cec},
+    {0x976e41088617ca01, 0xd5be0503e085d813},
+    {0xbd49d14aa79dbc82, 0x4b2d8644d8a74e18},
+    {0xec9c459d51852ba2, 0xddf8e7d60ed1219e},
+    {0x93e1ab8252f33b45, 0xcabb90e5c942b503},
+    {0xb8da1662e7b00a17, 0x3d6a751f3b936243},
+    {0xe7109bfba19c0c9d, 0x0cc512670a783ad4},
+    {0x906a617d450187e2, 0x27fb2b80668b24c5},
+    {0xb484f9dc9641e9da, 0xb1f9f660802dedf6},
+    {0xe1a63853bbd26451, 0x5e7873f8a0396973},
+    {0x8d07e33455637eb2, 0xdb0b487b6423e1e8},
+    {0xb049dc016abc5e5f, 0x91ce1a9a3d2cda62},
+    {0xdc5c5301c56b75f7, 0x7641a140cc7810fb},
+    {0x89b9b3e11b6329ba, 0xa9e904c87fcb0a9d},
+    {0xac2820d9623bf429, 0x546345fa9fbdcd44},
+    {0xd732290fbacaf133, 0xa97c177947ad4095},
+    {0x867f59a9d4bed6c0, 0x49ed8eabcccc485d},
+    {0xa81f301449ee8c70, 0x5c68f256bfff5a74},
+    {0xd226fc195c6a2f8c, 0x73832eec6fff3111},
+    {0x83585d8fd9c25db7, 0xc831fd53c5ff7eab},
+    {0xa42e74f3d032f525, 0xba3e7ca8b77f5e55},
+    {0xcd3a1230c43fb26f, 0x28ce1bd2e55f35eb},
+    {0x80444b5e7aa7cf85, 0x7980d163cf5b81b3},
+    {0xa0555e361951c366, 0xd7e105bcc332621f},
+    {0xc86ab5c39fa63440, 0x8dd9472bf3fefaa7},
+    {0xfa856334878fc150, 0xb14f98f6f0feb951},
+    {0x9c935e00d4b9d8d2, 0x6ed1bf9a569f33d3},
+    {0xc3b8358109e84f07, 0x0a862f80ec4700c8},
+    {0xf4a642e14c6262c8, 0xcd27bb612758c0fa},
+    {0x98e7e9cccfbd7dbd, 0x8038d51cb897789c},
+    {0xbf21e44003acdd2c, 0xe0470a63e6bd56c3},
+    {0xeeea5d5004981478, 0x1858ccfce06cac74},
+    {0x95527a5202df0ccb, 0x0f37801e0c43ebc8},
+    {0xbaa718e68396cffd, 0xd30560258f54e6ba},
+    {0xe950df20247c83fd, 0x47c6b82ef32a2069},
+    {0x91d28b7416cdd27e, 0x4cdc331d57fa5441},
+    {0xb6472e511c81471d, 0xe0133fe4adf8e952},
+    {0xe3d8f9e563a198e5, 0x58180fddd97723a6},
+    {0x8e679c2f5e44ff8f, 0x570f09eaa7ea7648},
+};
+
+// Exactly representable powers of ten for the Clinger fast path
+static const double bjson_exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// SWAR check that all 8 bytes are ASCII digits
+static inline int is_eight_digits(uint64_t v) {
+    return (((v & 0xF0F0F0F0F0F0F0F0ULL) |
+             (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL);
+}
+
+// SWAR conversion of 8 ASCII digits to their value
+static inline uint32_t parse_eight_digits(uint64_t v) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 0x000F424000000064ULL;  // 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ULL;  // 1 + (10000 << 32)
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return (uint32_t)v;
+}
+
+// Accumulate the digits at p into *mantissa (wrapping past 19 digits; the
+// caller re-parses those), 8 at a time while possible
+static const char* parse_digits(const char* p, const char* end, uint64_t* mantissa) {
+    uint64_t m = *mantissa;
+    while (end - p >= 8) {
+        uint64_t chunk = load_u64_le(p);
+        if (!is_eight_digits(chunk)) break;
+        m = m * 100000000 + parse_eight_digits(chunk);
+        p += 8;
+    }
+    while (p < end && *p >= '0' && *p <= '9') {
+        m = m * 10 + (uint64_t)(*p - '0');
+        p++;
+    }
+    *mantissa = m;
+    return p;
+}
+
+// Binary exponent and mantissa produced by the Eisel-Lemire algorithm
+typedef struct {
+    uint64_t mantissa;
+    int32_t power2;  // Biased exponent; 0x7FF means infinity
+} bjson_adjusted_mantissa_t;
+
+static inline uint64_t mul_high_low(uint64_t a, uint64_t b, uint64_t* low) {
+    __uint128_t product = (__uint128_t)a * b;
+    *low = (uint64_t)product;
+    return (uint64_t)(product >> 64);
+}
+
+// Correctly rounded w * 10^q for a 19-digit-or-shorter w (Eisel-Lemire,
+// following fast_float's compute_float<binary64>)
+static bjson_adjusted_mantissa_t compute_float64(int64_t q, uint64_t w) {
+    bjson_adjusted_mantissa_t answer = {0, 0};
+    
+    if (w == 0 || q < BJSON_SMALLEST_POWER_OF_TEN) return answer;
+    if (q > BJSON_LARGEST_POWER_OF_TEN) {
+        answer.power2 = 0x7FF;
+        return answer;
+    }
+    
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+    
+    // 55 bits of precision: 52 explicit + implicit bit + rounding bit + upperbit
+    const uint64_t* power = bjson_power_of_five_128[q - BJSON_SMALLEST_POWER_OF_TEN];
+    const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFULL >> 55;
+    uint64_t low;
+    uint64_t high = mul_high_low(w, power[0], &low);
+    if ((high & precision_mask) == precision_mask) {
+        uint64_t second_low;
+        uint64_t second_high = mul_high_low(w, power[1], &second_low);
+        low += second_high;
+        if (second_high > low) high++;
+    }
+    
+    int upperbit = (int)(high >> 63);
+    int shift = upperbit + 64 - 52 - 3;
+    answer.mantissa = high >> shift;
+    answer.power2 = (int32_t)((((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023);
+    
+    if (answer.power2 <= 0) {
+        // Subnormal, or zero once more than 64 bits fall below the minimum exponent
+        if (-answer.power2 + 1 >= 64) {
+            answer.mantissa = 0;
+            answer.power2 = 0;
+            return answer;
+        }
+        answer.mantissa >>= -answer.power2 + 1;
+        answer.mantissa += (answer.mantissa & 1);
+        answer.mantissa >>= 1;
+        // Rounding can carry a value just below the threshold into the normal range
+        answer.power2 = (answer.mantissa < (1ULL << 52)) ? 0 : 1;
+        return answer;
+    }
+    
+    // Exactly halfway between two floats can only happen when 5^q fits in 64
+    // bits; round to even instead of up there
+    if (low <= 1 && q >= -4 && q <= 23 && (answer.mantissa & 3) == 1 &&
+        (answer.mantissa << shift) == high) {
+        answer.mantissa &= ~1ULL;
+    }
+    
+    answer.mantissa += (answer.mantissa & 1);
+    answer.mantissa >>= 1;
+    if (answer.mantissa >= (2ULL << 52)) {
+        answer.mantissa = 1ULL << 52;
+        answer.power2++;
+    }
+    
+    answer.mantissa &= ~(1ULL << 52);
+    if (answer.power2 >= 0x7FF) {
+        answer.power2 = 0x7FF;
+        answer.mantissa = 0;
+    }
+    return answer;
+}
+
+// Rare fallback when more than 19 significant digits leave the rounding
+// ambiguous: hand strtod a point-free "<digits>e<exp>" form, which no locale
+// can misread
+static double parse_double_slow(const char* int_start, const char* int_end,
+                                const char* frac_start, const char* frac_end,
+                                int64_t exp_number, int negative) {
+    // 768 significant digits decide the rounding of any double; later nonzero
+    // digits only matter as a sticky bit
+    char buf[800];
+    size_t len = 0;
+    int64_t exponent = exp_number - (frac_end - frac_start);
+    int sticky = 0;
+    
+    if (negative) buf[len++] = '-';
+    size_t first_digit = len;
+    for (int part = 0; part < 2; part++) {
+        const char* p = part ? frac_start : int_start;
+        const char* end = part ? frac_end : int_end;
+        for (; p < end; p++) {
+            if (len == first_digit && *p == '0') continue;  // Leading zeros
+            if (len - first_digit < 768) {
+                buf[len++] = *p;
+            } else {
+                exponent++;
+                sticky |= (*p != '0');
+            }
+        }
+    }
+    if (len == first_digit) return negative ? -0.0 : 0.0;
+    if (sticky) {
+        buf[len++] = '1';
+        exponent--;
+    }
+    // Clamped exponents still over/underflow the same way
+    if (exponent > 100000) exponent = 100000;
+    if (exponent < -100000) exponent = -100000;
+    snprintf(buf + len, sizeof(buf) - len, "e%lld", (long long)exponent);
+    return strtod(buf, NULL);
+}
+
+static inline double make_double(bjson_adjusted_mantissa_t am, int negative) {
+    uint64_t bits = am.mantissa | ((uint64_t)am.power2 << 52) | ((uint64_t)negative << 63);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+// A scanned number token
+typedef struct {
+    bjson_type_t type;       // BJSON_INT, BJSON_DOUBLE or BJSON_DECIMAL
+    long long int_val;
+    double double_val;
+    const char* text;        // BJSON_DECIMAL: the digits, in the input
+    size_t length;
+} bjson_number_t;
+
+// Scan a number without re-scanning or consulting the locale: integers are
+// accumulated 8 digits at a time, doubles are rounded exactly via Clinger's
+// fast path or Eisel-Lemire
+static int scan_number(bjson_parser_t* parser, bjson_number_t* number) {
+    const char* p = parser->input + parser->pos;
+    const char* end = parser->input + parser->length;
+    const char* start = p;
+    
+    int negative = (*p == '-');
+    if (negative) p++;
+    
+    const char* int_start = p;
+    uint64_t mantissa = 0;
+    p = parse_digits(p, end, &mantissa);
+    const char* int_end = p;
+    if (int_end == int_start) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Invalid number at line %d, column %d", parser->line, parser->column);
+        return 0;
+    }
+    
+    int is_float = 0;
+    const char* frac_start = p;
+    const char* frac_end = p;
+    if (p < end && *p == '.') {
+        is_float = 1;
+        frac_start = ++p;
+        p = parse_digits(p, end, &mantissa);
+        frac_end = p;
+    }
+    
+    int64_t exp_number = 0;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        is_float = 1;
+        p++;
+        int exp_negative = 0;
+        if (p < end && (*p == '+' || *p == '-')) {
+            exp_negative = (*p == '-');
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9') {
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "Invalid exponent at line %d, column %d", parser->line, parser->column);
+            return 0;
+        }
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            // Saturate; anything this large is already 0 or infinity
+            if (exp_number < 0x10000000) exp_number = exp_number * 10 + (*p - '0');
+        }
+        if (exp_negative) exp_number = -exp_number;
+    }
+    
+    parser->pos = (size_t)(p - parser->input);
+    
+    int64_t digit_count = (int_end - int_start) + (frac_end - frac_start);
+    int64_t exponent = exp_number - (frac_end - frac_start);
+    int truncated = 0;
+    
+    if (digit_count > 19) {
+        // Leading zeros do not count; "0.000...0123" is still short
+        const char* q = int_start;
+        while (q < frac_end && (*q == '0' || *q == '.')) {
+            if (*q == '0') digit_count--;
+            q++;
+        }
+        if (digit_count > 19) {
+            // Keep the first 19 significant digits and note the truncation
+            truncated = 1;
+            mantissa = 0;
+            const uint64_t min_19_digits = 1000000000000000000ULL;
+            for (q = int_start; mantissa < min_19_digits && q < int_end; q++) {
+                mantissa = mantissa * 10 + (uint64_t)(*q - '0');
+            }
+            if (mantissa >= min_19_digits) {
+                exponent = (int_end - q) + exp_number;
+            } else {
+                for (q = frac_start; mantissa < min_19_digits && q < frac_end; q++) {
+                    mantissa = mantissa * 10 + (uint64_t)(*q - '0');
+                }
+                exponent = (frac_start - q) + exp_number;
+            }
+        }
+    }
+    
+    if (!is_float) {
+        uint64_t limit = negative ? (1ULL << 63) : (uint64_t)INT64_MAX;
+        if (!truncated && mantissa <= limit) {
+            number->type = BJSON_INT;
+            number->int_val = negative ? (long long)(0 - mantissa) : (long long)mantissa;
+            return 1;
+        }
+        
+        if (parser->flags & BJSON_PARSE_BIG_DECIMALS) {
+            // Keep the exact digits rather than rounding to a double
+            number->type = BJSON_DECIMAL;
+            number->text = start;
+            number->length = (size_t)(p - start);
+            return 1;
+        }
+    }
+    
+    double result;
+    if (!truncated && exponent >= -22 && exponent <= 22 && mantissa <= (1ULL << 53)) {
+        // Clinger: both operands are exact, so one IEEE operation rounds correctly
+        result = (double)mantissa;
+        if (exponent < 0) {
+            result /= bjson_exact_powers_of_ten[-exponent];
+        } else {
+            result *= bjson_exact_powers_of_ten[exponent];
+        }
+        if (negative) result = -result;
+    } else {
+        bjson_adjusted_mantissa_t am = compute_float64(exponent, mantissa);
+        if (truncated) {
+            // The dropped digits lie between mantissa and mantissa + 1
+            bjson_adjusted_mantissa_t upper = compute_float64(exponent, mantissa + 1);
+            if (am.mantissa != upper.mantissa || am.power2 != upper.power2) {
+                am.power2 = -1;
+            }
+        }
+        if (am.power2 >= 0) {
+            result = make_double(am, negative);
+        } else {
+            result = parse_double_slow(int_start, int_end, frac_start, frac_end, exp_number, negative);
+        }
+    }
+    
+    number->type = BJSON_DOUBLE;
+    number->double_val = result;
+    return 1;
+}
+
+// Parse a number token and report it as an int, double or decimal event
+static int parse_number(bjson_parser_t* parser) {
+    bjson_number_t number;
+    if (!scan_number(parser, &number)) return 0;
+    
+    switch (number.type) {
+        case BJSON_INT:
+            return BJSON_SAX_CALL(parser, int_value, (parser->sax_ctx, number.int_val));
+        case BJSON_DECIMAL:
+            return BJSON_SAX_CALL(parser, decimal_value, (parser->sax_ctx, number.text, number.length));
+        default:
+            return BJSON_SAX_CALL(parser, double_value, (parser->sax_ctx, number.double_val));
+    }
+}
+
+// Temporal extended types in ISO-8601: @date(2024-01-15),
+// @datetime(2024-08-15T14:30:00.250-07:00) and @duration(PT5M30S). The
+// fixed-width date and time fields are checked and converted with SWAR,
+// eight bytes at a time.
+
+// SWAR check of 8 bytes against a template such as "00:00:00", where '0'
+// stands for any digit and every other byte must match exactly. On success
+// byte i of *pairs holds the two-digit number starting at byte i
+static inline int swar_fields(const char* p, const char* pattern, uint64_t* pairs) {
+    uint64_t expected = load_u64_le(pattern);
+    uint64_t x = load_u64_le(p) ^ expected;          // Digits become 0-9, matching separators 0
+    uint64_t t = expected ^ 0x3030303030303030ULL;   // Nonzero at separators
+    uint64_t separators = (((t & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | t) & 0x8080808080808080ULL;
+    // Adding 0x76 to a digit, or 0x7F to a separator, sets the top bit when it is out of range
+    uint64_t limit = 0x7676767676767676ULL + (separators >> 7) * 9;
+    if (((x + limit) | x) & 0x8080808080808080ULL) return 0;
+    *pairs = x * 10 + (x >> 8);
+    return 1;
+}
+
+#define SWAR_FIELD(pairs, at) ((int)((pairs) >> (8 * (at)) & 0xFF))
+
+static int days_in_month(int year, int month) {
+    static const uint8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) return 29;
+    return days[month - 1];
+}
+
+static int scan_two_digits(const char* p, const char* end, int* value) {
+    if (end - p < 2 || (unsigned)(p[0] - '0') > 9 || (unsigned)(p[1] - '0') > 9) return 0;
+    *value = (p[0] - '0') * 10 + (p[1] - '0');
+    return 1;
+}
+
+// Scan a fraction of a second after its '.' or ','; digits past the
+// milliseconds are dropped
+static const char* scan_fraction(const char* p, const char* end, int* millisecond) {
+    const char* digits = p;
+    int scale = 100;
+    *millisecond = 0;
+    while (p < end && (unsigned)(*p - '0') <= 9) {
+        *millisecond += (*p - '0') * scale;
+        scale /= 10;
+        p++;
+    }
+    return p == digits ? NULL : p;
+}
+
+// Scan YYYY-MM-DD through two overlapping loads
+static const char* scan_date(const char* p, const char* end, bjson_date_t* date) {
+    uint64_t high, low;
+    if (end - p < 10 || !swar_fields(p, "0000-00-", &high) || !swar_fields(p + 2, "00-00-00", &low)) return NULL;
+    
+    date->year = SWAR_FIELD(high, 0) * 100 + SWAR_FIELD(low, 0);
+    date->month = SWAR_FIELD(low, 3);
+    date->day = SWAR_FIELD(low, 6);
+    if (date->month < 1 || date->month > 12 || date->day < 1 ||
+        date->day > days_in_month(date->year, date->month)) {
+        return NULL;
+    }
+    return p + 10;
+}
+
+// Scan YYYY-MM-DDTHH:MM:SS with an optional fraction and UTC offset (Z,
+// +HH:MM, +HHMM or +HH); without an offset the time is floating
+static const char* scan_datetime(const char* p, const char* end, bjson_datetime_t* datetime) {
+    uint64_t fields;
+    p = scan_date(p, end, &datetime->date);
+    if (!p || end - p < 9 || (*p != 'T' && *p != 't') || !swar_fields(p + 1, "00:00:00", &fields)) return NULL;
+    
+    datetime->hour = SWAR_FIELD(fields, 0);
+    datetime->minute = SWAR_FIELD(fields, 3);
+    datetime->second = SWAR_FIELD(fields, 6);
+    if (datetime->hour > 23 || datetime->minute > 59 || datetime->second > 59) return NULL;
+    p += 9;
+    
+    datetime->millisecond = 0;
+    if (p < end && (*p == '.' || *p == ',')) {
+        p = scan_fraction(p + 1, end, &datetime->millisecond);
+        if (!p) return NULL;
+    }
+    
+    datetime->timezone = NULL;
+    datetime->offset_minutes = BJSON_OFFSET_NONE;
+    if (p < end && (*p == 'Z' || *p == 'z')) {
+        datetime->offset_minutes = 0;
+        p++;
+    } else if (p < end && (*p == '+' || *p == '-')) {
+        int negative = *p++ == '-';
+        int hours, minutes = 0;
+        if (!scan_two_digits(p, end, &hours)) return NULL;
+        p += 2;
+        if (p < end && *p == ':') {
+            if (!scan_two_digits(p + 1, end, &minutes)) return NULL;
+            p += 3;
+        } else if (scan_two_digits(p, end, &minutes)) {
+            p += 2;
+        }
+        if (hours > 23 || minutes > 59) return NULL;
+        datetime->offset_minutes = (negative ? -1 : 1) * (hours * 60 + minutes);
+    }
+    return p;
+}
+
+// Scan [-]P[nY][nM][nW][nD][T[nH][nM][nS]]: at least one field, in this
+// order, and only seconds may have a fraction. Years and months count as
+// months, the rest as milliseconds
+static const char* scan_duration(const char* p, const char* end, bjson_duration_t* duration) {
+    static const char date_units[] = "YMWD";
+    static const int64_t date_scale[] = {12, 1, 7 * BJSON_MS_PER_DAY, BJSON_MS_PER_DAY};
+    static const char time_units[] = "HMS";
+    static const int64_t time_scale[] = {3600000, 60000, 1000};
+    
+    int negative = p < end && *p == '-';
+    p += negative;
+    if (p >= end || *p != 'P') return NULL;
+    p++;
+    
+    const char* units = date_units;
+    int64_t months = 0, ms = 0;
+    int fields = 0, time_fields = 0, in_time = 0;
+    while (p < end) {
+        if (*p == 'T' && !in_time) {
+            in_time = 1;
+            units = time_units;
+            p++;
+            continue;
+        }
+        
+        const char* digits = p;
+        int64_t count = 0;
+        while (p < end && (unsigned)(*p - '0') <= 9 && p - digits < 18) count = count * 10 + (*p++ - '0');
+        if (p == digits) break;
+        if (p < end && (unsigned)(*p - '0') <= 9) return NULL;  // Beyond 18 digits
+        
+        int fraction = -1;
+        if (p < end && (*p == '.' || *p == ',')) {
+            p = scan_fraction(p + 1, end, &fraction);
+            if (!p) return NULL;
+        }
+        
+        const char* unit = p < end && *p ? strchr(units, *p) : NULL;
+        if (!unit || (fraction >= 0 && *p != 'S')) return NULL;
+        p++;
+        
+        const char* order = in_time ? time_units : date_units;
+        int64_t scale = in_time ? time_scale[unit - order] : date_scale[unit - order];
+        int64_t* total = !in_time && unit - order < 2 ? &months : &ms;
+        if (__builtin_mul_overflow(count, scale, &count) || __builtin_add_overflow(*total, count, total)) {
+            return NULL;
+        }
+        if (fraction > 0 && __builtin_add_overflow(ms, fraction, &ms)) return NULL;
+        units = unit + 1;  // Later fields only
+        fields++;
+        time_fields += in_time;
+    }
+    if (!fields || (in_time && !time_fields) || months > INT32_MAX) return NULL;
+    
+    duration->months = (int32_t)(negative ? -months : months);
+    duration->milliseconds = negative ? -ms : ms;
+    return p;
+}
+
+// Parse the payload of @date, @datetime or @duration through its ')'. A
+// datetime may end with a bracketed zone name, as in [Europe/Paris]
+static int parse_temporal(bjson_parser_t* parser, bjson_type_t type) {
+    const char* type_name = type == BJSON_DATE ? "date" : type == BJSON_DURATION ? "duration" : "datetime";
+    skip_whitespace_and_comments(parser);
+    const char* start = parser->input + parser->pos;
+    const char* end = parser->input + parser->length;
+    bjson_date_t date;
+    bjson_datetime_t datetime;
+    bjson_duration_t duration;
+    const char* p;
+    
+    if (type == BJSON_DATE) {
+        p = scan_date(start, end, &date);
+    } else if (type == BJSON_DURATION) {
+        p = scan_duration(start, end, &duration);
+    } else {
+        p = scan_datetime(start, end, &datetime);
+        if (p && p < end && *p == '[') {
+            const char* zone = ++p;
+            while (p < end && (isalnum((unsigned char)*p) || *p == '/' || *p == '_' || *p == '-' || *p == '+')) p++;
+            if (p == zone || p >= end || *p != ']') {
+                p = NULL;
+            } else if (!reserve_scratch(parser, 0, (size_t)(p - zone) + 1)) {
+                snprintf(parser->error_msg, sizeof(parser->error_msg), "Out of memory");
+                return 0;
+            } else {
+                memcpy(parser->scratch, zone, (size_t)(p - zone));
+                parser->scratch[p - zone] = '\0';
+                datetime.timezone = parser->scratch;
+                p++;
+            }
+        }
+    }
+    if (!p) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Invalid @%s value at line %d, column %d", type_name, parser->line, parser->column);
+        return 0;
+    }
+    
+    parser->column += (int)(p - start);
+    parser->pos += (size_t)(p - start);
+    skip_whitespace_and_comments(parser);
+    if (parser->pos >= parser->length || parser->input[parser->pos] != ')') {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                "Expected ')' to close @%s at line %d, column %d", type_name, parser->line, parser->column);
+        return 0;
+    }
+    parser->pos++;
+    parser->column++;
+    
+    if (type == BJSON_DATE) return BJSON_SAX_CALL(parser, date_value, (parser->sax_ctx, &date));
+    if (type == BJSON_DURATION) return BJSON_SAX_CALL(parser, duration_value, (parser->sax_ctx, &duration));
+    return BJSON_SAX_CALL(parser, datetime_value, (parser->sax_ctx, &datetime));
+}
+
+// On-demand access: the input is indexed once by stage 1 of the two-stage
+// parser and then navigated through cursors. Lookups walk the index,
+// skipping unwanted members by bracket matching, and only the values the
+// caller asks for become bjson_value_t nodes. Nothing outside the visited
+// path is validated, so a malformed document may still answer lookups.
+
+struct bjson_ondemand {
+    bjson_parser_t parser;   // Input, scratch and allocation source for materialized values
+    uint32_t* positions;     // Structural index of the whole input
+    size_t count;
+    int failed;              // The last bjson_cursor_value failed
+};
+
+// Index the input for on-demand access; input must outlive the handle. With
+// BJSON_PARSE_ARENA, materialized values live in the handle's arena;
+// BJSON_PARSE_PRESIZE does not apply.
+bjson_ondemand_t* bjson_ondemand_parse(const char* input, size_t length, unsigned flags, bjson_error_t* error) {
+    bjson_ondemand_t* doc = calloc(1, sizeof(bjson_ondemand_t));
+    if (!doc) {
+        if (error) *error = BJSON_ERROR_MEMORY;
+        return NULL;
+    }
+    bjson_parser_t* parser = &doc->parser;
+    parser->input = input;
+    parser->length = length;
+    parser->line = 1;
+    parser->column = 1;
+    parser->flags = flags & ~(unsigned)BJSON_PARSE_PRESIZE;
+    
+    if ((flags & BJSON_PARSE_ARENA) && !(parser->arena = bjson_arena_create(0))) {
+        free(doc);
+        if (error) *error = BJSON_ERROR_MEMORY;
+        return NULL;
+    }
+    bjson_error_t status = build_structural_index(parser);
+    doc->positions = (uint32_t*)parser->index;
+    doc->count = parser->index_count;
+    parser->index = NULL;
+    if (status == BJSON_SUCCESS && !doc->count) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), "Unexpected end of input at line 1");
+        status = BJSON_ERROR_SYNTAX;
+    }
+    
+    if (status != BJSON_SUCCESS) {
+        if (error) *error = status;
+        set_error_message(parser->error_msg);
+        bjson_ondemand_free(doc);
+        return NULL;
+    }
+    if (error) *error = BJSON_SUCCESS;
+    return doc;
+}
+
+// Cursor on the root value
+bjson_cursor_t bjson_ondemand_root(bjson_ondemand_t* doc) {
+    bjson_cursor_t cursor = {doc, 0};
+    return cursor;
+}
+
+// Index entry just past the value starting at entry k
+static size_t ondemand_skip(const bjson_ondemand_t* doc, size_t k) {
+    const char* input = doc->parser.input;
+    const uint32_t* index = doc->positions;
+    size_t n = doc->count;
+    char c = input[index[k]];
+    
+    int wrapped = 0;
+    if (c == '@') {
+        char open = index_wrapper(input, doc->parser.length, index[k]);
+        if (!open || k + 1 >= n || input[index[k + 1]] != open) return k + 1;
+        wrapped = 1;
+        k++;
+    } else if (c != '[' && c != '{') {
+        return k + 1;
+    }
+    
+    size_t depth = 0;
+    for (; k < n; k++) {
+        c = input[index[k]];
+        if (c == '[' || c == '{') {
+            depth++;
+        } else if ((c == ']' || c == '}') && --depth == 0) {
+            k++;
+            break;
+        }
+    }
+    if (wrapped && k < n && input[index[k]] == ')') k++;
+    return k;
+}
+
+// Entry of the first member of the container at entry k, which must open
+// with the given bracket, directly or through @set( / @map(; 0 otherwise
+static size_t ondemand_members(const bjson_ondemand_t* doc, size_t k, char open) {
+    const char* input = doc->parser.input;
+    if (k >= doc->count) return 0;
+    
+    size_t at = doc->positions[k];
+    if (input[at] == open) return k + 1;
+    if (index_wrapper(input, doc->parser.length, at) == open &&
+        k + 1 < doc->count && input[doc->positions[k + 1]] == open) {
+        return k + 2;
+    }
+    return 0;
+}
+
+// Move to the value of the first member named key in an object, or in a
+// map with string keys. Returns 1 and sets *out when the key is present.
+// Cursors of one document must not be used from several threads at once.
+int bjson_cursor_find(const bjson_cursor_t* cursor, const char* key, bjson_cursor_t* out) {
+    bjson_ondemand_t* doc = cursor->doc;
+    const char* input = doc->parser.input;
+    const uint32_t* index = doc->positions;
+    size_t n = doc->count;
+    size_t key_length = strlen(key);
+    
+    size_t k = ondemand_members(doc, cursor->at, '{');
+    if (!k) return 0;
+    while (k < n) {
+        char c = input[index[k]];
+        if (c == '}') return 0;
+        if (c == ',') {
+            k++;
+            continue;
+        }
+        
+        int match = 0;
+        if (c == '"') {
+            const char* text;
+            size_t length;
+            doc->parser.pos = index[k];
+            if (!scan_string(&doc->parser, &text, &length)) return 0;
+            match = length == key_length && memcmp(text, key, length) == 0;
+        }
+        k = ondemand_skip(doc, k);
+        if (k + 1 >= n || input[index[k]] != ':') return 0;
+        k++;
+        if (match) {
+            out->doc = doc;
+            out->at = k;
+            return 1;
+        }
+        k = ondemand_skip(doc, k);
+    }
+    return 0;
+}
+
+// Move to element i of an array or set. Returns 1 and sets *out when the
+// element exists.
+int bjson_cursor_at(const bjson_cursor_t* cursor, size_t i, bjson_cursor_t* out) {
+    bjson_ondemand_t* doc = cursor->doc;
+    const char* input = doc->parser.input;
+    size_t n = doc->count;
+    
+    size_t k = ondemand_members(doc, cursor->at, '[');
+    if (!k) return 0;
+    while (k < n) {
+        char c = input[doc->positions[k]];
+        if (c == ']') return 0;
+        if (c == ',') {
+            k++;
+            continue;
+        }
+        if (i-- == 0) {
+            out->doc = doc;
+            out->at = k;
+            return 1;
+        }
+        k = ondemand_skip(doc, k);
+    }
+    return 0;
+}
+
+// Handler that records the type of the first value event in ctx and stops
+static int probe_type(void* ctx, bjson_type_t type) {
+    *(bjson_type_t*)ctx = type;
+    return 1;
+}
+
+static int probe_object(void* ctx) { return probe_type(ctx, BJSON_OBJECT); }
+static int probe_array(void* ctx) { return probe_type(ctx, BJSON_ARRAY); }
+static int probe_set(void* ctx) { return probe_type(ctx, BJSON_SET); }
+static int probe_map(void* ctx) { return probe_type(ctx, BJSON_MAP); }
+static int probe_null(void* ctx) { return probe_type(ctx, BJSON_NULL); }
+static int probe_bool(void* ctx, int value) { (void)value; return probe_type(ctx, BJSON_BOOL); }
+static int probe_int(void* ctx, long long value) { (void)value; return probe_type(ctx, BJSON_INT); }
+static int probe_double(void* ctx, double value) { (void)value; return probe_type(ctx, BJSON_DOUBLE); }
+
+static int probe_decimal(void* ctx, const char* digits, size_t length) {
+    (void)digits; (void)length;
+    return probe_type(ctx, BJSON_DECIMAL);
+}
+
+static int probe_string(void* ctx, const char* data, size_t length) {
+    (void)data; (void)length;
+    return probe_type(ctx, BJSON_STRING);
+}
+
+static int probe_date(void* ctx, const bjson_date_t* date) { (void)date; return probe_type(ctx, BJSON_DATE); }
+
+static int probe_datetime(void* ctx, const bjson_datetime_t* datetime) {
+    (void)datetime;
+    return probe_type(ctx, BJSON_DATETIME);
+}
+
+static int probe_bytes(void* ctx, const uint8_t* data, size_t length) {
+    (void)data; (void)length;
+    return probe_type(ctx, BJSON_BYTES);
+}
+
+static int probe_regex(void* ctx, const char* pattern, const char* flags) {
+    (void)pattern; (void)flags;
+    return probe_type(ctx, BJSON_REGEX);
+}
+
+static int probe_ref(void* ctx, const char* path) { (void)path; return probe_type(ctx, BJSON_REFERENCE); }
+
+static int probe_duration(void* ctx, const bjson_duration_t* duration) {
+    (void)duration;
+    return probe_type(ctx, BJSON_DURATION);
+}
+
+static int probe_custom(void* ctx, unsigned type, const uint8_t* payload, size_t length) {
+    (void)type; (void)payload; (void)length;
+    return probe_type(ctx, BJSON_CUSTOM);
+}
+
+static const bjson_sax_handler_t bjson_type_probe = {
+    probe_object, NULL, probe_array, NULL, probe_set, NULL, probe_map, NULL, NULL,
+    probe_null, probe_bool, probe_int, probe_double, probe_decimal, probe_string,
+    probe_date, probe_datetime, probe_bytes, probe_regex, probe_ref, probe_duration, probe_custom
+};
+
+// Type of the value under the cursor, judged from its first token without
+// building it. Returns 0 when no valid value starts there.
+int bjson_cursor_type(const bjson_cursor_t* cursor, bjson_type_t* type) {
+    bjson_ondemand_t* doc = cursor->doc;
+    if (cursor->at >= doc->count) return 0;
+    
+    bjson_parser_t* parser = &doc->parser;
+    size_t at = doc->positions[cursor->at];
+    const char* p = parser->input + at;
+    size_t available = parser->length - at;
+    switch (*p) {
+        case '{': *type = BJSON_OBJECT; return 1;
+        case '[': *type = BJSON_ARRAY; return 1;
+        case '"': *type = BJSON_STRING; return 1;
+        case 't':
+            if (available < 4 || memcmp(p, "true", 4) != 0) return 0;
+            *type = BJSON_BOOL;
+            return 1;
+        case 'f':
+            if (available < 5 || memcmp(p, "false", 5) != 0) return 0;
+            *type = BJSON_BOOL;
+            return 1;
+        case 'n':
+            if (available < 4 || memcmp(p, "null", 4) != 0) return 0;
+            *type = BJSON_NULL;
+            return 1;
+        case '@': {
+            size_t length = 1;
+            while (length < available && (isalnum(p[length]) || p[length] == '_')) length++;
+            int builtin = builtin_type(p + 1, length - 1);
+            if (builtin >= 0) {
+                *type = (bjson_type_t)builtin;
+                return 1;
+            }
+            
+            // A custom type is whatever its parser reports first
+            const bjson_custom_type_t* custom = custom_type_find(p + 1, length - 1);
+            size_t end = skip_type_header(parser->input, parser->length, at + 1);
+            if (!custom || length >= available || p[length] != '(' || parser->input[end - 1] != ')') return 0;
+            *type = BJSON_NULL;
+            return custom->parse(custom->user, p + length + 1, end - 1 - (at + length + 1),
+                                 &bjson_type_probe, type) > 0;
+        }
+        default: {
+            if (!isdigit(*p) && *p != '-') return 0;
+            bjson_number_t number;
+            parser->pos = at;
+            if (!scan_number(parser, &number)) return 0;
+            *type = number.type;
+            return 1;
+        }
+    }
+}
+
+// Build the value under the cursor, and nothing else. In arena mode it is
+// owned by the document; otherwise the caller frees it with
+// bjson_free_value. Returns NULL on a syntax error in the value, which
+// bjson_ondemand_error_message then describes.
+bjson_value_t* bjson_cursor_value(const bjson_cursor_t* cursor) {
+    bjson_ondemand_t* doc = cursor->doc;
+    if (cursor->at >= doc->count) {
+        snprintf(doc->parser.error_msg, sizeof(doc->parser.error_msg), "Cursor is past the end of the document");
+        doc->failed = 1;
+        return NULL;
+    }
+    
+    bjson_parser_t* parser = &doc->parser;
+    parser->index = doc->positions + cursor->at;
+    parser->index_count = doc->count - cursor->at;
+    parser->sax_stopped = 0;
+    bjson_value_t* value = parse_tree(parser);
+    parser->index = NULL;
+    
+    if (!value) {
+        // Let the recursive parser find and word the error, from the
+        // value's real line and column
+        size_t start = doc->positions[cursor->at];
+        parser->pos = 0;
+        parser->line = 1;
+        parser->column = 1;
+        const char* nl;
+        while ((nl = memchr(parser->input + parser->pos, '\n', start - parser->pos)) != NULL) {
+            parser->pos = (size_t)(nl - parser->input) + 1;
+            parser->line++;
+        }
+        parser->column = (int)(start - parser->pos) + 1;
+        parser->pos = start;
+        parser->sax_stopped = 0;
+        value = parse_tree(parser);
+    }
+    doc->failed = !value;
+    return value;
+}
+
+// Why the last bjson_cursor_value on doc failed, or NULL when it succeeded;
+// valid until the next bjson_cursor_value on doc
+const char* bjson_ondemand_error_message(const bjson_ondemand_t* doc) {
+    return doc && doc->failed ? doc->parser.error_msg : NULL;
+}
+
+void bjson_ondemand_free(bjson_ondemand_t* doc) {
+    if (!doc) return;
+    
+    bjson_arena_destroy(doc->parser.arena);
+    free(doc->parser.scratch);
+    free(doc->positions);
+    free(doc);
+}
+
+// Serialization
+
+#define BJSON_WRITER_CHUNK 4096
+
+// Output buffer: grows geometrically, or is flushed into a sink when full
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    bjson_write_fn sink;     // NULL: accumulate everything in data
+    void* sink_ctx;
+    int pretty;
+    int depth;
+    int failed;              // Out of memory or the sink asked to stop
+} bjson_writer_t;
+
+static int writer_flush(bjson_writer_t* w) {
+    if (w->failed) return 0;
+    if (w->length && w->sink(w->sink_ctx, w->data, w->length) != 0) {
+        w->failed = 1;
+        return 0;
+    }
+    w->length = 0;
+    return 1;
+}
+
+// Room for n more bytes at data + length (n <= BJSON_WRITER_CHUNK); NULL on
+// failure, which a larger n is for a sink's fixed buffer
+static char* writer_reserve(bjson_writer_t* w, size_t n) {
+    if (w->failed) return NULL;
+    if (w->length + n <= w->capacity) return w->data + w->length;
+    
+    if (w->sink) {
+        if (n > w->capacity) {
+            w->failed = 1;
+            return NULL;
+        }
+        if (!writer_flush(w)) return NULL;
+        return w->data;
+    }
+    
+    size_t capacity = w->capacity ? w->capacity : 256;
+    while (capacity < w->length + n) capacity *= 2;
+    char* data = realloc(w->data, capacity);
+    if (!data) {
+        w->failed = 1;
+        return NULL;
+    }
+    w->data = data;
+    w->capacity = capacity;
+    return data + w->length;
+}
+
+static void writer_put(bjson_writer_t* w, const char* data, size_t n) {
+    while (n) {
+        size_t take = n < BJSON_WRITER_CHUNK ? n : BJSON_WRITER_CHUNK;
+        char* out = writer_reserve(w, take);
+        if (!out) return;
+        memcpy(out, data, take);
+        w->length += take;
+        data += take;
+        n -= take;
+    }
+}
+
+// bjson_write_fn appending to a writer, for custom type hooks
+static int writer_sink(void* ctx, const char* data, size_t length) {
+    bjson_writer_t* w = ctx;
+    writer_put(w, data, length);
+    return w->failed;
+}
+
+static inline void writer_byte(bjson_writer_t* w, char c) {
+    char* out = writer_reserve(w, 1);
+    if (!out) return;
+    *out = c;
+    w->length++;
+}
+
+// Newline and indentation, in pieces of at most one chunk since nesting
+// depth is unbounded
+static void writer_newline(bjson_writer_t* w) {
+    if (!w->pretty) return;
+    writer_byte(w, '\n');
+    size_t n = 4 * (size_t)w->depth;
+    while (n) {
+        size_t take = n < BJSON_WRITER_CHUNK ? n : BJSON_WRITER_CHUNK;
+        char* out = writer_reserve(w, take);
+        if (!out) return;
+        memset(out, ' ', take);
+        w->length += take;
+        n -= take;
+    }
+}
+
+static const char bjson_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Write the decimal digits of v, two at a time, ending at out + length
+static void format_digits(uint64_t v, char* out, int length) {
+    char* p = out + length;
+    while (v >= 100) {
+        memcpy(p -= 2, bjson_digit_pairs + (v % 100) * 2, 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        memcpy(p - 2, bjson_digit_pairs + v * 2, 2);
+    } else {
+        p[-1] = (char)('0' + v);
+    }
+}
+
+static int decimal_length(uint64_t v) {
+    int length = 1;
+    while (v >= 10000) {
+        v /= 10000;
+        length += 4;
+    }
+    if (v >= 1000) return length + 3;
+    if (v >= 100) return length + 2;
+    if (v >= 10) return length + 1;
+    return length;
+}
+
+static void write_int(bjson_writer_t* w, long long value) {
+    char* out = writer_reserve(w, 20);
+    if (!out) return;
+    
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    size_t sign = value < 0;
+    if (sign) out[0] = '-';
+    int length = decimal_length(magnitude);
+    format_digits(magnitude, out + sign, length);
+    w->length += sign + (size_t)length;
+}
+
+// Ryu multipliers: 5^-i as ceil(2^(bits(5^i) - 1 + 125) / 5^i) and 5^i
+// truncated to 125 bits, least significant word first
+#define BJSON_RYU_POW5_INV_BITCOUNT 125
+#define BJSON_RYU_POW5_BITCOUNT 125
+
+static const uint64_t bjson_ryu_pow5_inv_split[342][2] = {
+    {0x0000000000000001, 0x2000000000000000},
+    {0x999999999999999a, 0x1999999999999999},
+    {0x47ae147ae147ae15, 0x147ae147ae147ae1},
+    {0x6c8b4395810624de, 0x10624dd2f1a9fbe7},
+    {0x7a786c226809d496, 0x1a36e2eb1c432ca5},
+    {0x61f9f01b866e43ab, 0x14f8b588e368f084},
+    {0xb4c7f34938583622, 0x10c6f7a0b5ed8d36},
+    {0x87a6520ec08d236a, 0x1ad7f29abcaf4857},
+    {0x9fb841a566d74f88, 0x15798ee2308c39df},
+    {0xe62d01511f12a607, 0x112e0be826d694b2},
+    {0xd6ae6881cb5109a4, 0x1b7cdfd9d7bdbab7},
+    {0xdef1ed34a2a73aea, 0x15fd7fe17964955f},
+    {0x7f27f0f6e885c8bb, 0x119799812dea1119},
+    {0x650cb4be40d60df8, 0x1c25c268497681c2},
+    {0xea70909833de7193, 0x16849b86a12b9b01},
+    {0x21f3a6e0297ec143, 0x1203af9ee756159b},
+    {0x6985d7cd0f313537, 0x1cd2b297d889bc2b},
+    {0x2137dfd73f5a90f9, 0x170ef54646d49689},
+    {0xe75fe645cc4873fa, 0x12725dd1d243aba0},
+    {0xa5663d3c7a0d865d, 0x1d83c94fb6d2ac34},
+    {0x511e976394d79eb1, 0x179ca10c9242235d},
+    {0xda7edf82dd794bc1, 0x12e3b40a0e9b4f7d},
+    {0x2a6498d1625bac68, 0x1e392010175ee596},
+    {0xeeb6e0a781e2f053, 0x182db34012b25144},
+    {0x58924d52ce4f26a9, 0x1357c299a88ea76a},
+    {0x27507bb7b07ea441, 0x1ef2d0f5da7dd8aa},
+    {0x52a6c95fc0655034, 0x18c240c4aecb13bb},
+    {0x0eebd44c99eaa690, 0x13ce9a36f23c0fc9},
+    {0xb17953adc3110a80, 0x1fb0f6be50601941},
+    {0xc12ddc8b02740867, 0x195a5efea6b34767},
+    {0x3424b06f3529a052, 0x14484bfeebc29f86},
+    {0x901d59f290ee19db, 0x1039d66589687f9e},
+    {0x4cfbc31db4b0295f, 0x19f623d5a8a73297},
+    {0x3d9635b15d59bab2, 0x14c4e977ba1f5bac},
+    {0x97ab5e277de16228, 0x109d8792fb4c4956},
+    {0xf2abc9d8c9689d0d, 0x1a95a5b7f87a0ef0},
+    {0x5bbca17a3aba173e, 0x154484932d2e725a},
+    {0xafca1ac82efb45cb, 0x11039d428a8b8eae},
+    {0xb2dcf7a6b1920945, 0x1b38fb9daa78e44a},
+    {0xf57d92ebc141a104, 0x15c72fb1552d836e},
+    {0xc46475896767b403, 0x116c262777579c58},
+    {0x6d6d88dbd8a5ecd2, 0x1be03d0bf225c6f4},
+    {0x8abe071646eb23db, 0x164cfda3281e38c3},
+    {0x6efe6c11d255b649, 0x11d7314f534b609c},
+    {0xb197134fb6ef8a0e, 0x1c8b821885456760},
+    {0x27ac0f72f8bfa1a5, 0x16d601ad376ab91a},
+    {0xb95672c260994e1e, 0x1244ce242c5560e1},
+    {0xf5571e03cdc21695, 0x1d3ae36d13bbce35},
+    {0x2aac18030b01abab, 0x17624f8a762fd82b},
+    {0xbbbce0026f348956, 0x12b50c6ec4f31355},
+    {0x92c7ccd0b1eda889, 0x1dee7a4ad4b81eef},
+    {0xdbd30a408e57ba07, 0x17f1fb6f10934bf2},
+    {0x7ca8d50071dfc806, 0x1327fc58da0f6ff5},
+    {0xfaa7bb33e9660cd6, 0x1ea6608e29b24cbb},
+    {0x9552fc298784d711, 0x18851a0b548ea3c9},
+    {0xaaa8c9bad2d0ac0e, 0x139dae6f76d88307},
+    {0xdddadc5e1e1aace3, 0x1f62b0b257c0d1a5},
+    {0x7e48b04b4b488a4f, 0x191bc08eac9a4151},
+    {0xcb6d59d5d5d3a1d9, 0x141633a556e1cdda},
+    {0x3c577b1177dc817b, 0x1011c2eaabe7d7e2},
+    {0xc6f25e825960cf2a, 0x19b604aaaca62636},
+    {0x6bf518684780a5bb, 0x14919d5556eb51c5},
+    {0x232a79ed06008496, 0x10747ddddf22a7d1},
+    {0xd1dd8fe1a3340756, 0x1a53fc9631d10c81},
+    {0xa7e4731ae8f66c45, 0x150ffd44f4a73d34},
+    {0x531d28e253f8569e, 0x10d9976a5d52975d},
+    {0xeb61db03b98d5762, 0x1af5bf109550f22e},
+    {0xbc4e48cfc7a445e8, 0x159165a6ddda5b58},
+    {0x6371d3d96c836b20, 0x11411e1f17e1e2ad},
+    {0x9f1c8628ad9f11cd, 0x1b9b6364f3030448},
+    {0xe5b06b53be18db0b, 0x1615e91d8f359d06},
+    {0xeaf3890fcb4715a2, 0x11ab20e472914a6b},
+    {0x44b8db4c7871bc37, 0x1c45016d841baa46},
+    {0x03c715d6c6c1635f, 0x169d9abe03495505},
+    {0x3638de456bcde919, 0x1217aefe69077737},
+    {0x56c163a2461641c1, 0x1cf2b1970e725858},
+    {0xdf011c81d1ab67ce, 0x17288e1271f51379},
+    {0x7f3416ce4155eca5, 0x1286d80ec190dc61},
+    {0x6520247d3556476e, 0x1da48ce468e7c702},
+    {0xea801d30f7783925, 0x17b6d71d20b96c01},
+    {0xbb99b0f3f92cfa84, 0x12f8ac174d612334},
+    {0x5f5c4e532847f739, 0x1e5aacf215683854},
+    {0x7f7d0b75b9d32c2e, 0x18488a5b44536043},
+    {0x9930d5f7c7dc2358, 0x136d3b7c36a919cf},
+    {0x8eb4898c72f9d226, 0x1f152bf9f10e8fb2},
+    {0x722a07a38f2e41b8, 0x18ddbcc7f40ba628},
+    {0xc1bb394fa5be9afa, 0x13e497065cd61e86},
+    {0x9c5ec2190930f7f6, 0x1fd424d6faf030d7},
+    {0x49e56814075a5ff8, 0x197683df2f268d79},
+    {0x6e51201005e1e660, 0x145ecfe5bf520ac7},
+    {0xf1da800cd181851a, 0x104bd984990e6f05},
+    {0x4fc400148268d4f5, 0x1a12f5a0f4e3e4d6},
+    {0xd96999aa01ed772b, 0x14dbf7b3f71cb711},
+    {0xadee1488018ac5bc, 0x10aff95cc5b09274},
+    {0x497ceda668de092c, 0x1ab328946f80ea54},
+    {0x3aca57b853e4d424, 0x155c2076bf9a5510},
+    {0x623b7960431d7683, 0x1116805effaeaa73},
+    {0x9d2bf566d1c8bd9e, 0x1b5733cb32b110b8},
+    {0x7dbcc452416d647f, 0x15df5ca28ef40d60},
+    {0xcafd69db678ab6cc, 0x117f7d4ed8c33de6},
+    {0xab2f0fc572778adf, 0x1bff2ee48e052fd7},
+    {0x88f273045b92d580, 0x1665bf1d3e6a8cac},
+    {0xd3f528d049424466, 0x11eaff4a98553d56},
+    {0xb988414d4203a0a3, 0x1cab3210f3bb9557},
+    {0x6139cdd76802e6e9, 0x16ef5b40c2fc7779},
+    {0xe761717920025254, 0x125915cd68c9f92d},
+    {0xa568b58e999d5086, 0x1d5b561574765b7c},
+    {0x5120913ee14aa6d2, 0x177c44ddf6c515fd},
+    {0xa74d40ff1aa21f0e, 0x12c9d0b1923744ca},
+    {0x0baece64f769cb4a, 0x1e0fb44f50586e11},
+    {0x3c8bd850c5ee3c3b, 0x180c903f7379f1a7},
+    {0xca0979da37f1c9c9, 0x133d4032c2c7f485},
+    {0xa9a8c2f6bfe942db, 0x1ec866b79e0cba6f},
+    {0x2153cf2bccba9be3, 0x18a0522c7e709526},
+    {0x1aa9728970954982, 0x13b374f06526ddb8},
+    {0xf775840f1a88759d, 0x1f8587e7083e2f8c},
+    {0x5f9136727ba05e17, 0x19379fec0698260a},
+    {0x1940f85b9619e4df, 0x142c7ff0054684d5},
+    {0xe100c6afab47ea4c, 0x1023998cd1053710},
+    {0xce67a44c453fdd47, 0x19d28f47b4d524e7},
+    {0xd852e9d69dccb106, 0x14a8729fc3ddb71f},
+    {0x79dbee454b0a2738, 0x1086c219697e2c19},
+    {0x295fe3a211a9d859, 0x1a71368f0f30468f},
+    {0xbab31c81a7bb137a, 0x15275ed8d8f36ba5},
+    {0x6228e39aec95a92f, 0x10ec4be0ad8f8951},
+    {0x9d0e38f7e0ef7517, 0x1b13ac9aaf4c0ee8},
+    {0xb0d82d931a592a79, 0x15a956e225d67253},
+    {0x8d79be0f4847552e, 0x11544581b7dec1dc},
+    {0x158f967eda0bbb7c, 0x1bba08cf8c979c94},
+    {0x77a611ff14d62f97, 0x162e6d72d6dfb076},
+    {0xf951a7ff43de8c79, 0x11bebdf578b2f391},
+    {0xc21c3ffed2fdad8e, 0x1c6463225ab7ec1c},
+    {0x01b0333242648ad8, 0x16b6b5b5155ff017},
+    {0x0159c28e9b83a246, 0x122bc490dde659ac},
+    {0xcef604175f3903a3, 0x1d12d41afca3c2ac},
+    {0x725e69ac4c2d9c83, 0x17424348ca1c9bbd},
+    {0xf5185489d68ae39c, 0x129b69070816e2fd},
+    {0xee8d540fbdab05c6, 0x1dc574d80cf16b2f},
+    {0xbed77672fe226b05, 0x17d12a4670c1228c},
+    {0xff12c528cb4ebc04, 0x130dbb6b8d674ed6},
+    {0xcb513b74787df9a0, 0x1e7c5f127bd87e24},
+    {0x090dc929f9fe614d, 0x18637f41fcad31b7},
+    {0xa0d7d42194cb810a, 0x1382cc34ca2427c5},
+    {0x67bfb9cf5478ce77, 0x1f37ad21436d0c6f},
+    {0x1fcc94a5dd2d71f9, 0x18f9574dcf8a7059},
+    {0x7fd6dd517dbdf4c7, 0x13faac3e3fa1f37a},
+    {0xffbe2ee8c92fee0b, 0x1ff779fd329cb8c3},
+    {0x6631bf20a0f324d6, 0x1992c7fdc216fa36},
+    {0xb827cc1a1a5c1d78, 0x14756ccb01abfb5e},
+    {0x935309ae7b7ce460, 0x105df0a267bcc918},
+    {0x1eeb42b0c594a099, 0x1a2fe76a3f9474f4},
+    {0xe58902270476e6e1, 0x14f31f8832dd2a5c},
+    {0xb7a0ce859d2bebe7, 0x10c27fa028b0eeb0},
+    {0x59014a6f61dfdfd8, 0x1ad0cc33744e4ab4},
+    {0xe0cdd525e7e64cad, 0x1573d68f903ea229},
+    {0x4d7177518651d6f1, 0x11297872d9cbb4ee},
+    {0x7be8bee8d6e957e8, 0x1b758d848fac54b0},
+    {0xfcba3253df211320, 0x15f7a46a0c89dd59},
+    {0x63c8284318e74280, 0x1192e9ee706e4aae},
+    {0x060d0d3827d86a66, 0x1c1e43171a4a1117},
+    {0x6b3da42cecad21eb, 0x167e9c127b6e7412},
+    {0x88fe1cf0bd574e56, 0x11fee341fc585cdb},
+    {0x419694b462254a23, 0x1ccb0536608d615f},
+    {0x67abaa29e81dd4e9, 0x1708d0f84d3de77f},
+    {0xb95621bb2017dd87, 0x126d73f9d764b932},
+    {0xc223692b668c95a5, 0x1d7becc2f23ac1ea},
+    {0xce82ba891ed6de1d, 0x179657025b6234bb},
+    {0xa53562074bdf1818, 0x12deac01e2b4f6fc},
+    {0x3b889cd87964f359, 0x1e3113363787f194},
+    {0xfc6d4a46c783f5e1, 0x18274291c6065adc},
+    {0x30576e9f06032b1a, 0x13529ba7d19eaf17},
+    {0x1a257dcb3cd1de90, 0x1eea92a61c311825},
+    {0x481dfe3c30a7e540, 0x18bba884e35a79b7},
+    {0xd34b31c9c0865100, 0x13c9539d82aec7c5},
+    {0x5211e942cda3b4cd, 0x1fa885c8d117a609},
+    {0x74db21023e1c90a4, 0x19539e3a40dfb807},
+    {0xf715b401cb4a0d50, 0x1442e4fb67196005},
+    {0xf8de299b09080aa7, 0x103583fc527ab337},
+    {0x8e304291a80cddd7, 0x19ef3993b72ab859},
+    {0x3e8d020e200a4b13, 0x14bf6142f8eef9e1},
+    {0x653d9b3e80083c0f, 0x10991a9bfa58c7e7},
+    {0x6ec8f864000d2ce4, 0x1a8e90f9908e0ca5},
+    {0x8bd3f9e999a423ea, 0x153eda614071a3b7},
+    {0x3ca994bae1501cbb, 0x10ff151a99f482f9},
+    {0xc775bac49bb3612b, 0x1b31bb5dc320d18e},
+    {0xd2c4956a16291a89, 0x15c162b168e70e0b},
+    {0xdbd0778811ba7ba1, 0x11678227871f3e6f},
+    {0x2c80bf401c5d929b, 0x1bd8d03f3e9863e6},
+    {0xbd33cc3349e47549, 0x16470cff6546b651},
+    {0xca8fd68f6e505dd4, 0x11d270cc51055ea7},
+    {0x4419574be3b3c953, 0x1c83e7ad4e6efdd9},
+    {0x0347790982f63aa9, 0x16cfec8aa52597e1},
+    {0xcf6c60d468c4fbba, 0x123ff06eea847980},
+    {0xe57a34870e07f92a, 0x1d331a4b10d3f59a},
+    {0x512e906c0b399422, 0x175c1508da432ae2},
+    {0xda8ba6bcd5c7a9b5, 0x12b010d3e1cf5581},
+    {0x90df712e22d90f87, 0x1de6815302e5559c},
+    {0xda4c5a8b4f140c6c, 0x17eb9aa8cf1dde16},
+    {0xaea37ba2a5a9a38a, 0x1322e220a5b17e78},
+    {0x7dd25f6aa2a905a9, 0x1e9e369aa2b59727},
+    {0x97db7f888220d154, 0x187e92154ef7ac1f},
+    {0x797c6606ce80a777, 0x139874ddd8c6234c},
+    {0x8f2d700ae4010bf1, 0x1f5a549627a36bad},
+    {0x0c2459a25000d65a, 0x191510781fb5efbe},
+    {0x701d1481d99a4515, 0x1410d9f9b2f7f2fe},
+    {0xc017439b147b6a77, 0x100d7b2e28c65bfe},
+    {0xccf205c4ed9243f2, 0x19af2b7d0e0a2cca},
+    {0x0a5b37d0be0e9cc2, 0x148c22ca71a1bd6f},
+    {0x0848f973cb3ee3ce, 0x10701bd527b4978c},
+    {0xda0e5bec78649fb0, 0x1a4cf9550c5425ac},
+    {0x7b3eaff060507fc0, 0x150a6110d6a9b7bd},
+    {0x95cbbff380406633, 0x10d51a73deee2c97},
+    {0xefac665266cd7052, 0x1aee90b964b04758},
+    {0x2623850eb8a459db, 0x158ba6fab6f36c47},
+    {0x1e82d0d893b6ae49, 0x113c85955f29236c},
+    {0xfd9e1af41f8ab075, 0x1b9408eefea838ac},
+    {0x97b1af29b2d559f7, 0x16100725988693bd},
+    {0xac8e25baf5777b2c, 0x11a66c1e139edc97},
+    {0x7a7d092b2258c513, 0x1c3d79c9b8fe2dbf},
+    {0x61fda0ef4ead6a76, 0x169794a160cb57cc},
+    {0xe7fe1a590bbdeec5, 0x1212dd4de7091309},
+    {0xa6635d5b45fcb13a, 0x1ceafbafd80e84dc},
+    {0x851c4aaf6b308dc8, 0x172262f3133ed0b0},
+    {0xd0e36ef2bc26d7d4, 0x1281e8c275cbda26},
+    {0xb49f17eac6a48c86, 0x1d9ca79d894629d7},
+    {0x2a18dfef0550706b, 0x17b08617a104ee46},
+    {0x54e0b3259dd9f389, 0x12f39e794d9d8b6b},
+    {0x87cdeb6f62f65274, 0x1e5297287c2f4578},
+    {0xd30b22bf825ea85d, 0x18421286c9bf6ac6},
+    {0x0f3c1bcc684bb9e4, 0x13680ed23aff889f},
+    {0x18602c7a4079296d, 0x1f0ce4839198da98},
+    {0x46b356c833942124, 0x18d71d360e13e213},
+    {0x388f78a029434db6, 0x13df4a91a4dcb4dc},
+    {0x5a7f2766a86baf8a, 0x1fcbaa82a1612160},
+    {0x153285ebb9efbfa2, 0x196fbb9bb44db44d},
+    {0xaa8ed189618c994e, 0x145962e2f6a4903d},
+    {0xeed8a7a11ad6e10c, 0x1047824f2bb6d9ca},
+    {0x7e27729b5e249b45, 0x1a0c03b1df8af611},
+    {0xfe85f549181d4904, 0x14d6695b193bf80d},
+    {0xcb9e5dd4134aa0d0, 0x10ab877c142ff9a4},
+    {0xdf63c9535211014d, 0x1aac0bf9b9e65c3a},
+    {0x191ca10f74da6771, 0x15566ffafb1eb02f},
+    {0xadb080d92a4852c1, 0x1111f32f2f4bc025},
+    {0x15e7348eaa0d5134, 0x1b4feb7eb212cd09},
+    {0xab1f5d3eee710dc4, 0x15d98932280f0a6d},
+    {0xbc1917658b8da49d, 0x117ad428200c0857},
+    {0x2cf4f23c127c3a94, 0x1bf7b9d9cce00d59},
+    {0xf0c3f4fcdb969543, 0x165fc7e170b33de0},
+    {0x5a365d9716121103, 0x11e6398126f5cb1a},
+    {0x9056fc24f01ce804, 0x1ca38f350b22de90},
+    {0xd9df301d8ce3ecd0, 0x16e93f5da2824ba6},
+    {0xe17f59b13d8323da, 0x125432b14ecea2eb},
+    {0x68cbc2b52f38395c, 0x1d53844ee47dd179},
+    {0x53d6355dbf602de3, 0x177603725064a794},
+    {0xa9782ab165e68b1c, 0x12c4cf8ea6b6ec76},
+    {0x0f26aab56fd744fa, 0x1e07b27dd78b13f1},
+    {0x3f52222abfdf6a62, 0x18062864ac6f4327},
+    {0x65db4e88997f884e, 0x1338205089f29c1f},
+    {0x6fc54a7428cc0d4a, 0x1ec033b40fea9365},
+    {0x596aa1f68709a43b, 0x1899c2f673220f84},
+    {0xadeee7f86c07b696, 0x13ae3591f5b4d936},
+    {0x497e3ff3e00c5756, 0x1f7d228322baf524},
+    {0xd464fff64cd6ac45, 0x1930e868e89590e9},
+    {0x4383fff83d7889d1, 0x14272053ed4473ee},
+    {0xcf9cccc69793a174, 0x101f4d0ff1038ff1},
+    {0x7f6147a425b90252, 0x19cbae7fe805b31c},
+    {0xcc4dd2e9b7c7350f, 0x14a2f1ffecd15c16},
+    {0x3d0b0f215fd290d9, 0x10825b3323dab012},
+    {0x61ab4b689950e7c1, 0x1a6a2b85062ab350},
+    {0x4e22a2ba1440b967, 0x1521bc6a6b555c40},
+    {0x0b4ee894dd009453, 0x10e7c9eebc4449cd},
+    {0x1217da87c800ed51, 0x1b0c764ac6d3a948},
+    {0xdb46486ca000bdda, 0x15a391d56bdc876c},
+    {0x490506bd4ccd64af, 0x114fa7ddefe39f8a},
+    {0xa8080ac87ae23ab1, 0x1bb2a62fe638ff43},
+    {0x5339a239fbe82ef4, 0x162884f31e93ff69},
+    {0x75c7b4fb2fecf25d, 0x11ba03f5b20fff87},
+    {0x22d92191e647ea2e, 0x1c5cd322b67fff3f},
+    {0xb57a8141850654f2, 0x16b0a8e891ffff65},
+    {0xc4620101373843f5, 0x1226ed86db3332b7},
+    {0x3a366801f1f39fee, 0x1d0b15a491eb8459},
+    {0xfb5eb99b27f6198b, 0x173c115074bc69e0},
+    {0x2f7efae2865e7ad6, 0x129674405d6387e7},
+    {0xe597f7d0d6fd9156, 0x1dbd86cd6238d971},
+    {0x8479930d78cadaab, 0x17cad23de82d7ac1},
+    {0xd06142712d6f1556, 0x1308a831868ac89a},
+    {0x4d686a4eaf182222, 0x1e74404f3daada91},
+    {0xa453883ef279b4e8, 0x185d003f6488aeda},
+    {0xe9dc6cff28615d87, 0x137d99cc506d58ae},
+    {0xa960ae650d6895a4, 0x1f2f5c7a1a488de4},
+    {0xbab3beb73ded4483, 0x18f2b061aea07183},
+    {0x2ef6322c318a9d36, 0x13f559e7bee6c136},
+    {0xe4bd1d13827761f0, 0x1feef63f97d79b89},
+    {0x83ca7da9352c4e5a, 0x198bf832dfdfafa1},
+    {0x9ca1fe20f756a515, 0x146ff9c24cb2f2e7},
+    {0x4a1b31b3f9121daa, 0x1059949b708f28b9},
+    {0x435eb5ecc1b695dd, 0x1a28edc580e50df5},
+    {0x35e55e57015ede4a, 0x14ed8b04671da4c4},
+    {0xc4b77eac0118b1d5, 0x10be08d0527e1d69},
+    {0xa12597799b5ab622, 0x1ac9a7b3b7302f0f},
+    {0x4db7ac6149155e81, 0x156e1fc2f8f358d9},
+    {0xd7c6238107444b9b, 0x1124e63593f5e0ad},
+    {0x593d059b3ed3ac2b, 0x1b6e3d2286563449},
+    {0xe0fd9e15cbdc89bc, 0x15f1ca820511c36d},
+    {0xb3fe18116fe3a163, 0x118e3b9b37416924},
+    {0x866359b57fd29bd1, 0x1c16c5c525357507},
+    {0xd1e91491330ee30e, 0x16789e3750f790d2},
+    {0x74ba76da8f3f1c0b, 0x11fa182c40c60d75},
+    {0xedf72490e531c678, 0x1cc359e067a348bb},
+    {0x8b2c1d40b75b052d, 0x1702ae4d1fb5d3c9},
+    {0x6f567dcd5f7c0424, 0x12688b70e62b0fd4},
+    {0x7ef0c94898c66d06, 0x1d74124e3d11b2ed},
+    {0x98c0a106e09ebd9f, 0x17900ea4fda7c257},
+    {0x470080d24d4bcae6, 0x12d9a550caec9b79},
+    {0xd800ce1d487944a2, 0x1e29088144adc58e},
+    {0x1333d8176d2dd082, 0x1820d39a9d57d13f},
+    {0xa8f646792424a6ce, 0x134d76154aaca765},
+    {0x74bd3d8ea03aa47d, 0x1ee25688777aa56f},
+    {0x5d64313ee6955064, 0x18b51206c5fbb78c},
+    {0x4ab68dcbebaaa6b7, 0x13c40e6bd1962c70},
+    {0x1124161312aaa457, 0x1fa01712e8f0471a},
+    {0xda8344dc0eeee9df, 0x194cdf4253f36c14},
+    {0xe2029d7cd8bf2180, 0x143d7f6843292343},
+    {0x4e687dfd7a328133, 0x103132b9cf541c36},
+    {0x4a40c9959050ceb8, 0x19e851294bb9c6bd},
+    {0x0833d477a6a70bc6, 0x14b9da876fc7d231},
+    {0xa02976c61eec096b, 0x1094aed2bfd30e8d},
+    {0x004257a364acdbdf, 0x1a877e1dffb81749},
+    {0xcd01dfb5ea23e319, 0x153931b1996012a0},
+    {0x70ce4c91881cb5ae, 0x10fa8e27ade6754d},
+    {0x1ae3adb5a69455e2, 0x1b2a7d0c4970bbaf},
+    {0x7be957c4854377e8, 0x15bb973d078d62f2},
+    {0xc987796a0435f987, 0x1162df64060ab58e},
+    {0x75a58f1006bcc271, 0x1bd1656cd67788e4},
+    {0xf7b7a5a66bca3527, 0x16411df0ab92d3e9},
+    {0x5fc61e1ebca1c41f, 0x11cdb18d560f0fee},
+    {0xffa363646102d365, 0x1c7c4f4889b1b316},
+    {0x32e91c504d9bdc51, 0x16c9d906d48e28df},
+    {0x8f20e37371497d0e, 0x123b140576d820b2},
+    {0x7e9b0585820f2e7c, 0x1d2b533bf159cdea},
+    {0xcbaf379e01a5beca, 0x1755dc2ff447d7ee},
+    {0x0958f94b348498a1, 0x12ab168cc36cacbf},
+};
+
+static const uint64_t bjson_ryu_pow5_split[326][2] = {
+    {0x0000000000000000, 0x1000000000000000},
+    {0x0000000000000000, 0x1400000000000000},
+    {0x0000000000000000, 0x1900000000000000},
+    {0x0000000000000000, 0x1f40000000000000},
+    {0x0000000000000000, 0x1388000000000000},
+    {0x0000000000000000, 0x186a000000000000},
+    {0x0000000000000000, 0x1e84800000000000},
+    {0x0000000000000000, 0x1312d00000000000},
+    {0x0000000000000000, 0x17d7840000000000},
+    {0x0000000000000000, 0x1dcd650000000000},
+    {0x0000000000000000, 0x12a05f2000000000},
+    {0x0000000000000000, 0x174876e800000000},
+    {0x0000000000000000, 0x1d1a94a200000000},
+    {0x0000000000000000, 0x12309ce540000000},
+    {0x0000000000000000, 0x16bcc41e90000000},
+    {0x0000000000000000, 0x1c6bf52634000000},
+    {0x0000000000000000, 0x11c37937e0800000},
+    {0x0000000000000000, 0x16345785d8a00000},
+    {0x0000000000000000, 0x1bc16d674ec80000},
+    {0x0000000000000000, 0x1158e460913d0000},
+    {0x0000000000000000, 0x15af1d78b58c4000},
+    {0x0000000000000000, 0x1b1ae4d6e2ef5000},
+    {0x0000000000000000, 0x10f0cf064dd59200},
+    {0x0000000000000000, 0x152d02c7e14af680},
+    {0x0000000000000000, 0x1a784379d99db420},
+    {0x0000000000000000, 0x108b2a2c28029094},
+    {0x0000000000000000, 0x14adf4b7320334b9},
+    {0x4000000000000000, 0x19d971e4fe8401e7},
+    {0x8800000000000000, 0x1027e72f1f128130},
+    {0xaa00000000000000, 0x1431e0fae6d7217c},
+    {0xd480000000000000, 0x193e5939a08ce9db},
+    {0xc9a0000000000000, 0x1f8def8808b02452},
+    {0xbe04000000000000, 0x13b8b5b5056e16b3},
+    {0xad85000000000000, 0x18a6e32246c99c60},
+    {0xd8e6400000000000, 0x1ed09bead87c0378},
+    {0x878fe80000000000, 0x13426172c74d822b},
+    {0x6973e20000000000, 0x1812f9cf7920e2b6},
+    {0x03d0da8000000000, 0x1e17b84357691b64},
+    {0x8262889000000000, 0x12ced32a16a1b11e},
+    {0x22fb2ab400000000, 0x178287f49c4a1d66},
+    {0xabb9f56100000000, 0x1d6329f1c35ca4bf},
+    {0xcb54395ca0000000, 0x125dfa371a19e6f7},
+    {0xbe2947b3c8000000, 0x16f578c4e0a060b5},
+    {0x2db399a0ba000000, 0x1cb2d6f618c878e3},
+    {0xfc90400474400000, 0x11efc659cf7d4b8d},
+    {0x7bb4500591500000, 0x166bb7f0435c9e71},
+    {0xdaa16406f5a40000, 0x1c06a5ec5433c60d},
+    {0xa8a4de8459868000, 0x118427b3b4a05bc8},
+    {0xd2ce16256fe82000, 0x15e531a0a1c872ba},
+    {0x87819baecbe22800, 0x1b5e7e08ca3a8f69},
+    {0xf4b1014d3f6d5900, 0x111b0ec57e6499a1},
+    {0x71dd41a08f48af40, 0x1561d276ddfdc00a},
+    {0x0e549208b31adb10, 0x1aba4714957d300d},
+    {0x28f4db456ff0c8ea, 0x10b46c6cdd6e3e08},
+    {0x33321216cbecfb24, 0x14e1878814c9cd8a},
+    {0xbffe969c7ee839ed, 0x1a19e96a19fc40ec},
+    {0xf7ff1e21cf512434, 0x105031e2503da893},
+    {0xf5fee5aa43256d41, 0x14643e5ae44d12b8},
+    {0x337e9f14d3eec892, 0x197d4df19d605767},
+    {0x005e46da08ea7ab6, 0x1fdca16e04b86d41},
+    {0xa03aec4845928cb2, 0x13e9e4e4c2f34448},
+    {0xc849a75a56f72fde, 0x18e45e1df3b0155a},
+    {0x7a5c1130ecb4fbd6, 0x1f1d75a5709c1ab1},
+    {0xec798abe93f11d65, 0x13726987666190ae},
+    {0xa797ed6e38ed64bf, 0x184f03e93ff9f4da},
+    {0x517de8c9c728bdef, 0x1e62c4e38ff87211},
+    {0xd2eeb17e1c7976b5, 0x12fdbb0e39fb474a},
+    {0x87aa5ddda397d462, 0x17bd29d1c87a191d},
+    {0xe994f5550c7dc97b, 0x1dac74463a989f64},
+    {0x11fd195527ce9ded, 0x128bc8abe49f639f},
+    {0xd67c5faa71c24568, 0x172ebad6ddc73c86},
+    {0x8c1b77950e32d6c2, 0x1cfa698c95390ba8},
+    {0x57912abd28dfc639, 0x121c81f7dd43a749},
+    {0xad75756c7317b7c8, 0x16a3a275d494911b},
+    {0x98d2d2c78fdda5ba, 0x1c4c8b1349b9b562},
+    {0x9f83c3bcb9ea8794, 0x11afd6ec0e14115d},
+    {0x0764b4abe8652979, 0x161bcca7119915b5},
+    {0x493de1d6e27e73d7, 0x1ba2bfd0d5ff5b22},
+    {0x6dc6ad264d8f0866, 0x1145b7e285bf98f5},
+    {0xc938586fe0f2ca80, 0x159725db272f7f32},
+    {0x7b866e8bd92f7d20, 0x1afcef51f0fb5eff},
+    {0xad34051767bdae34, 0x10de1593369d1b5f},
+    {0x9881065d41ad19c1, 0x15159af804446237},
+    {0x7ea147f492186032, 0x1a5b01b605557ac5},
+    {0x6f24ccf8db4f3c1f, 0x1078e111c3556cbb},
+    {0x4aee003712230b27, 0x14971956342ac7ea},
+    {0xdda98044d6abcdf0, 0x19bcdfabc13579e4},
+    {0x0a89f02b062b60b6, 0x10160bcb58c16c2f},
+    {0xcd2c6c35c7b638e4, 0x141b8ebe2ef1c73a},
+    {0x8077874339a3c71d, 0x1922726dbaae3909},
+    {0xe0956914080cb8e4, 0x1f6b0f092959c74b},
+    {0x6c5d61ac8507f38e, 0x13a2e965b9d81c8f},
+    {0x4774ba17a649f072, 0x188ba3bf284e23b3},
+    {0x1951e89d8fdc6c8f, 0x1eae8caef261aca0},
+    {0x0fd3316279e9c3d9, 0x132d17ed577d0be4},
+    {0x13c7fdbb186434cf, 0x17f85de8ad5c4edd},
+    {0x58b9fd29de7d4203, 0x1df67562d8b36294},
+    {0xb7743e3a2b0e4942, 0x12ba095dc7701d9c},
+    {0xe5514dc8b5d1db92, 0x17688bb5394c2503},
+    {0xdea5a13ae3465277, 0x1d42aea2879f2e44},
+    {0x0b2784c4ce0bf38a, 0x1249ad2594c37ceb},
+    {0xcdf165f6018ef06d, 0x16dc186ef9f45c25},
+    {0x416dbf7381f2ac88, 0x1c931e8ab871732f},
+    {0x88e497a83137abd5, 0x11dbf316b346e7fd},
+    {0xeb1dbd923d8596ca, 0x1652efdc6018a1fc},
+    {0x25e52cf6cce6fc7d, 0x1be7abd3781eca7c},
+    {0x97af3c1a40105dce, 0x1170cb642b133e8d},
+    {0xfd9b0b20d0147542, 0x15ccfe3d35d80e30},
+    {0x3d01cde904199292, 0x1b403dcc834e11bd},
+    {0x462120b1a28ffb9b, 0x1108269fd210cb16},
+    {0xd7a968de0b33fa82, 0x154a3047c694fddb},
+    {0xcd93c3158e00f923, 0x1a9cbc59b83a3d52},
+    {0xc07c59ed78c09bb6, 0x10a1f5b813246653},
+    {0xb09b7068d6f0c2a3, 0x14ca732617ed7fe8},
+    {0xdcc24c830cacf34c, 0x19fd0fef9de8dfe2},
+    {0xc9f96fd1e7ec180f, 0x103e29f5c2b18bed},
+    {0x3c77cbc661e71e13, 0x144db473335deee9},
+    {0x8b95beb7fa60e598, 0x1961219000356aa3},
+    {0x6e7b2e65f8f91efe, 0x1fb969f40042c54c},
+    {0xc50cfcffbb9bb35f, 0x13d3e2388029bb4f},
+    {0xb6503c3faa82a037, 0x18c8dac6a0342a23},
+    {0xa3e44b4f95234844, 0x1efb1178484134ac},
+    {0xe66eaf11bd360d2b, 0x135ceaeb2d28c0eb},
+    {0xe00a5ad62c839075, 0x183425a5f872f126},
+    {0x980cf18bb7a47493, 0x1e412f0f768fad70},
+    {0x5f0816f752c6c8dc, 0x12e8bd69aa19cc66},
+    {0xf6ca1cb527787b13, 0x17a2ecc414a03f7f},
+    {0xf47ca3e2715699d7, 0x1d8ba7f519c84f5f},
+    {0xf8cde66d86d62026, 0x127748f9301d319b},
+    {0xf7016008e88ba830, 0x17151b377c247e02},
+    {0xb4c1b80b22ae923c, 0x1cda62055b2d9d83},
+    {0x50f91306f5ad1b65, 0x12087d4358fc8272},
+    {0xe53757c8b318623f, 0x168a9c942f3ba30e},
+    {0x9e852dbadfde7acf, 0x1c2d43b93b0a8bd2},
+    {0xa3133c94cbeb0cc1, 0x119c4a53c4e69763},
+    {0x8bd80bb9fee5cff1, 0x16035ce8b6203d3c},
+    {0xaece0ea87e9f43ee, 0x1b843422e3a84c8b},
+    {0x4d40c9294f238a75, 0x1132a095ce492fd7},
+    {0x2090fb73a2ec6d12, 0x157f48bb41db7bcd},
+    {0x68b53a508ba78856, 0x1adf1aea12525ac0},
+    {0x417144725748b536, 0x10cb70d24b7378b8},
+    {0x51cd958eed1ae283, 0x14fe4d06de5056e6},
+    {0xe640faf2a8619b24, 0x1a3de04895e46c9f},
+    {0xefe89cd7a93d00f7, 0x1066ac2d5daec3e3},
+    {0xebe2c40d938c4134, 0x14805738b51a74dc},
+    {0x26db7510f86f5181, 0x19a06d06e2611214},
+    {0x9849292a9b4592f1, 0x100444244d7cab4c},
+    {0xbe5b73754216f7ad, 0x1405552d60dbd61f},
+    {0xadf25052929cb598, 0x1906aa78b912cba7},
+    {0x996ee4673743e2ff, 0x1f485516e7577e91},
+    {0xffe54ec0828a6ddf, 0x138d352e5096af1a},
+    {0xbfdea270a32d0957, 0x18708279e4bc5ae1},
+    {0x2fd64b0ccbf84bad, 0x1e8ca3185deb719a},
+    {0x5de5eee7ff7b2f4c, 0x1317e5ef3ab32700},
+    {0x755f6aa1ff59fb1f, 0x17dddf6b095ff0c0},
+    {0x92b7454a7f3079e7, 0x1dd55745cbb7ecf0},
+    {0x5bb28b4e8f7e4c30, 0x12a5568b9f52f416},
+    {0xf29f2e22335ddf3c, 0x174eac2e8727b11b},
+    {0xef46f9aac035570b, 0x1d22573a28f19d62},
+    {0xd58c5c0ab8215667, 0x123576845997025d},
+    {0x4aef730d6629ac01, 0x16c2d4256ffcc2f5},
+    {0x9dab4fd0bfb41701, 0x1c73892ecbfbf3b2},
+    {0xa28b11e277d08e60, 0x11c835bd3f7d784f},
+    {0x8b2dd65b15c4b1f9, 0x163a432c8f5cd663},
+    {0x6df94bf1db35de77, 0x1bc8d3f7b3340bfc},
+    {0xc4bbcf772901ab0a, 0x115d847ad000877d},
+    {0x35eac354f34215cd, 0x15b4e5998400a95d},
+    {0x8365742a30129b40, 0x1b221effe500d3b4},
+    {0xd21f689a5e0ba108, 0x10f5535fef208450},
+    {0x06a742c0f58e894a, 0x1532a837eae8a565},
+    {0x4851137132f22b9d, 0x1a7f5245e5a2cebe},
+    {0xed32ac26bfd75b42, 0x108f936baf85c136},
+    {0xa87f57306fcd3212, 0x14b378469b673184},
+    {0xd29f2cfc8bc07e97, 0x19e056584240fde5},
+    {0xa3a37c1dd7584f1e, 0x102c35f729689eaf},
+    {0x8c8c5b254d2e62e6, 0x14374374f3c2c65b},
+    {0x6faf71eea079fb9f, 0x1945145230b377f2},
+    {0x0b9b4e6a48987a87, 0x1f965966bce055ef},
+    {0x674111026d5f4c94, 0x13bdf7e0360c35b5},
+    {0xc111554308b71fba, 0x18ad75d8438f4322},
+    {0x7155aa93cae4e7a8, 0x1ed8d34e547313eb},
+    {0x26d58a9c5ecf10c9, 0x13478410f4c7ec73},
+    {0xf08aed437682d4fb, 0x1819651531f9e78f},
+    {0xecada89454238a3a, 0x1e1fbe5a7e786173},
+    {0x73ec895cb4963664, 0x12d3d6f88f0b3ce8},
+    {0x90e7abb3e1bbc3fd, 0x1788ccb6b2ce0c22},
+    {0x352196a0da2ab4fd, 0x1d6affe45f818f2b},
+    {0x0134fe24885ab11e, 0x1262dfeebbb0f97b},
+    {0xc1823dadaa715d65, 0x16fb97ea6a9d37d9},
+    {0x31e2cd19150db4bf, 0x1cba7de5054485d0},
+    {0x1f2dc02fad2890f7, 0x11f48eaf234ad3a2},
+    {0xa6f9303b9872b535, 0x1671b25aec1d888a},
+    {0x50b77c4a7e8f6282, 0x1c0e1ef1a724eaad},
+    {0x5272adae8f199d91, 0x1188d357087712ac},
+    {0x670f591a32e004f6, 0x15eb082cca94d757},
+    {0x40d32f60bf980633, 0x1b65ca37fd3a0d2d},
+    {0x4883fd9c77bf03e0, 0x111f9e62fe44483c},
+    {0x5aa4fd0395aec4d8, 0x156785fbbdd55a4b},
+    {0x314e3c447b1a760e, 0x1ac1677aad4ab0de},
+    {0xded0e5aaccf089c9, 0x10b8e0acac4eae8a},
+    {0x96851f15802cac3b, 0x14e718d7d7625a2d},
+    {0xfc2666dae037d74a, 0x1a20df0dcd3af0b8},
+    {0x9d980048cc22e68e, 0x10548b68a044d673},
+    {0x84fe005aff2ba032, 0x1469ae42c8560c10},
+    {0xa63d8071bef6883e, 0x198419d37a6b8f14},
+    {0xcfcce08e2eb42a4e, 0x1fe52048590672d9},
+    {0x21e00c58dd309a70, 0x13ef342d37a407c8},
+    {0x2a580f6f147cc10d, 0x18eb0138858d09ba},
+    {0xb4ee134ad99bf150, 0x1f25c186a6f04c28},
+    {0x7114cc0ec80176d2, 0x137798f428562f99},
+    {0xcd59ff127a01d486, 0x18557f31326bbb7f},
+    {0xc0b07ed7188249a8, 0x1e6adefd7f06aa5f},
+    {0xd86e4f466f516e09, 0x1302cb5e6f642a7b},
+    {0xce89e3180b25c98b, 0x17c37e360b3d351a},
+    {0x822c5bde0def3bee, 0x1db45dc38e0c8261},
+    {0xf15bb96ac8b58575, 0x1290ba9a38c7d17c},
+    {0x2db2a7c57ae2e6d2, 0x1734e940c6f9c5dc},
+    {0x391f51b6d99ba086, 0x1d022390f8b83753},
+    {0x03b3931248014454, 0x1221563a9b732294},
+    {0x04a077d6da019569, 0x16a9abc9424feb39},
+    {0x45c895cc9081fac3, 0x1c5416bb92e3e607},
+    {0x8b9d5d9fda513cba, 0x11b48e353bce6fc4},
+    {0xae84b507d0e58be8, 0x1621b1c28ac20bb5},
+    {0x1a25e249c51eeee3, 0x1baa1e332d728ea3},
+    {0xf057ad6e1b33554d, 0x114a52dffc679925},
+    {0x6c6d98c9a2002aa1, 0x159ce797fb817f6f},
+    {0x4788fefc0a803549, 0x1b04217dfa61df4b},
+    {0x0cb59f5d8690214e, 0x10e294eebc7d2b8f},
+    {0xcfe30734e83429a1, 0x151b3a2a6b9c7672},
+    {0x83dbc9022241340a, 0x1a6208b50683940f},
+    {0xb2695da15568c086, 0x107d457124123c89},
+    {0x1f03b509aac2f0a7, 0x149c96cd6d16cbac},
+    {0x26c4a24c1573acd1, 0x19c3bc80c85c7e97},
+    {0x783ae56f8d684c03, 0x101a55d07d39cf1e},
+    {0x16499ecb70c25f03, 0x1420eb449c8842e6},
+    {0x9bdc067e4cf2f6c4, 0x19292615c3aa539f},
+    {0x82d3081de02fb476, 0x1f736f9b3494e887},
+    {0xb1c3e512ac1dd0c9, 0x13a825c100dd1154},
+    {0xde34de57572544fc, 0x18922f31411455a9},
+    {0x55c215ed2cee963b, 0x1eb6bafd91596b14},
+    {0xb5994db43c151de5, 0x133234de7ad7e2ec},
+    {0xe2ffa1214b1a655e, 0x17fec216198ddba7},
+    {0xdbbf89699de0feb6, 0x1dfe729b9ff15291},
+    {0x2957b5e202ac9f31, 0x12bf07a143f6d39b},
+    {0xf3ada35a8357c6fe, 0x176ec98994f48881},
+    {0x70990c31242db8bd, 0x1d4a7bebfa31aaa2},
+    {0x865fa79eb69c9376, 0x124e8d737c5f0aa5},
+    {0xe7f791866443b854, 0x16e230d05b76cd4e},
+    {0xa1f575e7fd54a669, 0x1c9abd04725480a2},
+    {0xa53969b0fe54e801, 0x11e0b622c774d065},
+    {0x0e87c41d3dea2202, 0x1658e3ab7952047f},
+    {0xd229b5248d64aa82, 0x1bef1c9657a6859e},
+    {0x435a1136d85eea91, 0x117571ddf6c81383},
+    {0x143095848e76a536, 0x15d2ce55747a1864},
+    {0x193cbae5b2144e83, 0x1b4781ead1989e7d},
+    {0x2fc5f4cf8f4cb112, 0x110cb132c2ff630e},
+    {0xbbb77203731fdd56, 0x154fdd7f73bf3bd1},
+    {0x2aa54e844fe7d4ac, 0x1aa3d4df50af0ac6},
+    {0xdaa75112b1f0e4eb, 0x10a6650b926d66bb},
+    {0xd15125575e6d1e26, 0x14cffe4e7708c06a},
+    {0x85a56ead360865b0, 0x1a03fde214caf085},
+    {0x7387652c41c53f8e, 0x10427ead4cfed653},
+    {0x50693e7752368f71, 0x14531e58a03e8be8},
+    {0x64838e1526c4334e, 0x1967e5eec84e2ee2},
+    {0xfda4719a70754022, 0x1fc1df6a7a61ba9a},
+    {0xde86c70086494815, 0x13d92ba28c7d14a0},
+    {0x162878c0a7db9a1a, 0x18cf768b2f9c59c9},
+    {0x5bb296f0d1d280a1, 0x1f03542dfb83703b},
+    {0x194f9e5683239064, 0x1362149cbd322625},
+    {0x5fa385ec23ec747e, 0x183a99c3ec7eafae},
+    {0xf78c67672ce7919d, 0x1e494034e79e5b99},
+    {0x3ab7c0a07c10bb02, 0x12edc82110c2f940},
+    {0x4965b0c89b14e9c3, 0x17a93a2954f3b790},
+    {0x5bbf1cfac1da2433, 0x1d9388b3aa30a574},
+    {0xb957721cb92856a0, 0x127c35704a5e6768},
+    {0xe7ad4ea3e7726c48, 0x171b42cc5cf60142},
+    {0xa198a24ce14f075a, 0x1ce2137f74338193},
+    {0x44ff65700cd16498, 0x120d4c2fa8a030fc},
+    {0x563f3ecc1005bdbe, 0x16909f3b92c83d3b},
+    {0x2bcf0e7f14072d2e, 0x1c34c70a777a4c8a},
+    {0x5b61690f6c847c3d, 0x11a0fc668aac6fd6},
+    {0xf239c35347a59b4c, 0x16093b802d578bcb},
+    {0xeec83428198f021f, 0x1b8b8a6038ad6ebe},
+    {0x553d20990ff96153, 0x1137367c236c6537},
+    {0x2a8c68bf53f7b9a8, 0x1585041b2c477e85},
+    {0x752f82ef28f5a812, 0x1ae64521f7595e26},
+    {0x093db1d57999890b, 0x10cfeb353a97dad8},
+    {0x0b8d1e4ad7ffeb4e, 0x1503e602893dd18e},
+    {0x8e7065dd8dffe622, 0x1a44df832b8d45f1},
+    {0xf9063faa78bfefd5, 0x106b0bb1fb384bb6},
+    {0xb747cf9516efebca, 0x1485ce9e7a065ea4},
+    {0xe519c37a5cabe6bd, 0x19a742461887f64d},
+    {0xaf301a2c79eb7036, 0x1008896bcf54f9f0},
+    {0xdafc20b798664c43, 0x140aabc6c32a386c},
+    {0x11bb28e57e7fdf54, 0x190d56b873f4c688},
+    {0x1629f31ede1fd72a, 0x1f50ac6690f1f82a},
+    {0x4dda37f34ad3e67a, 0x13926bc01a973b1a},
+    {0xe150c5f01d88e019, 0x187706b0213d09e0},
+    {0x19a4f76c24eb181f, 0x1e94c85c298c4c59},
+    {0xb0071aa39712ef13, 0x131cfd3999f7afb7},
+    {0x9c08e14c7cd7aad8, 0x17e43c8800759ba5},
+    {0x030b199f9c0d958e, 0x1ddd4baa0093028f},
+    {0x61e6f003c1887d79, 0x12aa4f4a405be199},
+    {0xba60ac04b1ea9cd7, 0x1754e31cd072d9ff},
+    {0xa8f8d705de65440d, 0x1d2a1be4048f907f},
+    {0xc99b8663aaff4a88, 0x123a516e82d9ba4f},
+    {0xbc0267fc95bf1d2a, 0x16c8e5ca239028e3},
+    {0xab0301fbbb2ee474, 0x1c7b1f3cac74331c},
+    {0xeae1e13d54fd4ec9, 0x11ccf385ebc89ff1},
+    {0x659a598caa3ca27b, 0x1640306766bac7ee},
+    {0xff00efefd4cbcb1a, 0x1bd03c81406979e9},
+    {0x3f6095f5e4ff5ef0, 0x116225d0c841ec32},
+    {0xcf38bb735e3f36ac, 0x15baaf44fa52673e},
+    {0x8306ea5035cf0457, 0x1b295b1638e7010e},
+    {0x11e4527221a162b6, 0x10f9d8ede39060a9},
+    {0x565d670eaa09bb64, 0x15384f295c7478d3},
+    {0x2bf4c0d2548c2a3d, 0x1a8662f3b3919708},
+    {0x1b78f88374d79a66, 0x1093fdd8503afe65},
+    {0x625736a4520d8100, 0x14b8fd4e6449bdfe},
+    {0xfaed044d6690e140, 0x19e73ca1fd5c2d7d},
+    {0xbcd422b0601a8cc8, 0x103085e53e599c6e},
+    {0x6c092b5c78212ffa, 0x143ca75e8df0038a},
+    {0x070b763396297bf8, 0x194bd136316c046d},
+    {0x48ce53c07bb3daf6, 0x1f9ec583bdc70588},
+    {0x2d80f4584d5068da, 0x13c33b72569c6375},
+    {0x78e1316e60a48310, 0x18b40a4eec437c52},
+};
+
+// ceil(log2(5^e)) for e in [1, 3528], and 1 for e == 0
+static inline int32_t ryu_pow5_bits(int32_t e) {
+    return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e)) and floor(log10(5^e)) for e in [0, 1650]
+static inline uint32_t ryu_log10_pow2(int32_t e) {
+    return ((uint32_t)e * 78913) >> 18;
+}
+
+static inline uint32_t ryu_log10_pow5(int32_t e) {
+    return ((uint32_t)e * 732923) >> 20;
+}
+
+static inline int ryu_multiple_of_pow5(uint64_t value, uint32_t p) {
+    uint32_t count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count >= p;
+}
+
+static inline int ryu_multiple_of_pow2(uint64_t value, uint32_t p) {
+    return (value & ((1ULL << p) - 1)) == 0;
+}
+
+static inline uint64_t ryu_mul_shift(uint64_t m, const uint64_t* mul, int32_t j) {
+    __uint128_t low = (__uint128_t)m * mul[0];
+    __uint128_t high = (__uint128_t)m * mul[1];
+    return (uint64_t)(((low >> 64) + high) >> (j - 64));
+}
+
+// Shortest decimal mantissa * 10^exponent that rounds back to the finite,
+// positive double with the given IEEE fields (Ulf Adams, "Ryu", PLDI 2018)
+static uint64_t ryu_shortest(uint64_t ieee_mantissa, uint32_t ieee_exponent, int32_t* exponent) {
+    int32_t e2;
+    uint64_t m2;
+    if (ieee_exponent == 0) {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = (int32_t)ieee_exponent - 1023 - 52 - 2;
+        m2 = (1ULL << 52) | ieee_mantissa;
+    }
+    const int accept_bounds = (m2 & 1) == 0;
+    
+    // Interval of decimals that round to this double, scaled by 4
+    const uint64_t mv = 4 * m2;
+    const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+    
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    int vm_trailing_zeros = 0;
+    int vr_trailing_zeros = 0;
+    if (e2 >= 0) {
+        const uint32_t q = ryu_log10_pow2(e2) - (e2 > 3);
+        e10 = (int32_t)q;
+        const int32_t k = BJSON_RYU_POW5_INV_BITCOUNT + ryu_pow5_bits((int32_t)q) - 1;
+        const int32_t i = -e2 + (int32_t)q + k;
+        vr = ryu_mul_shift(4 * m2, bjson_ryu_pow5_inv_split[q], i);
+        vp = ryu_mul_shift(4 * m2 + 2, bjson_ryu_pow5_inv_split[q], i);
+        vm = ryu_mul_shift(4 * m2 - 1 - mm_shift, bjson_ryu_pow5_inv_split[q], i);
+        if (q <= 21) {
+            // Only mantissas this small can be multiples of 5^q
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = ryu_multiple_of_pow5(mv, q);
+            } else if (accept_bounds) {
+                vm_trailing_zeros = ryu_multiple_of_pow5(mv - 1 - mm_shift, q);
+            } else {
+                vp -= ryu_multiple_of_pow5(mv + 2, q);
+            }
+        }
+    } else {
+        const uint32_t q = ryu_log10_pow5(-e2) - (-e2 > 1);
+        e10 = (int32_t)q + e2;
+        const int32_t i = -e2 - (int32_t)q;
+        const int32_t k = ryu_pow5_bits(i) - BJSON_RYU_POW5_BITCOUNT;
+        const int32_t j = (int32_t)q - k;
+        vr = ryu_mul_shift(4 * m2, bjson_ryu_pow5_split[i], j);
+        vp = ryu_mul_shift(4 * m2 + 2, bjson_ryu_pow5_split[i], j);
+        vm = ryu_mul_shift(4 * m2 - 1 - mm_shift, bjson_ryu_pow5_split[i], j);
+        if (q <= 1) {
+            vr_trailing_zeros = 1;
+            if (accept_bounds) {
+                vm_trailing_zeros = mm_shift == 1;
+            } else {
+                vp--;
+            }
+        } else if (q < 63) {
+            vr_trailing_zeros = ryu_multiple_of_pow2(mv, q);
+        }
+    }
+    
+    // Drop digits while the interval still holds a shorter decimal
+    int32_t removed = 0;
+    uint64_t output;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        // Exact-tie handling; rare
+        uint32_t last_removed = 0;
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = (uint32_t)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = (uint32_t)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+            last_removed = 4;  // Exactly halfway: round to even
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+    } else {
+        int round_up = 0;
+        if (vp / 100 > vm / 100) {
+            round_up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    
+    *exponent = e10 + removed;
+    return output;
+}
+
+// Shortest round-trip text for a double. Values that are whole numbers keep
+// a ".0" so they parse back as doubles; NaN and infinities have no JSON
+// spelling and are written as null.
+static void write_double(bjson_writer_t* w, double value) {
+    char* out = writer_reserve(w, 32);
+    if (!out) return;
+    
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint64_t ieee_mantissa = bits & ((1ULL << 52) - 1);
+    const uint32_t ieee_exponent = (uint32_t)(bits >> 52) & 0x7FF;
+    
+    if (ieee_exponent == 0x7FF) {
+        memcpy(out, "null", 4);
+        w->length += 4;
+        return;
+    }
+    
+    size_t n = 0;
+    if (bits >> 63) out[n++] = '-';
+    if (ieee_exponent == 0 && ieee_mantissa == 0) {
+        memcpy(out + n, "0.0", 3);
+        w->length += n + 3;
+        return;
+    }
+    
+    int32_t exponent;
+    uint64_t digits = ryu_shortest(ieee_mantissa, ieee_exponent, &exponent);
+    const int length = decimal_length(digits);
+    const int point = length + exponent;  // Decimal point position within the digits
+    
+    if (point > 0 && point <= 21) {
+        if (exponent >= 0) {
+            // 1234e2 -> 123400.0
+            format_digits(digits, out + n, length);
+            n += (size_t)length;
+            memset(out + n, '0', (size_t)exponent);
+            n += (size_t)exponent;
+            memcpy(out + n, ".0", 2);
+            n += 2;
+        } else {
+            // 1234e-2 -> 12.34
+            format_digits(digits, out + n + 1, length);
+            memmove(out + n, out + n + 1, (size_t)point);
+            out[n + (size_t)point] = '.';
+            n += (size_t)length + 1;
+        }
+    } else if (point <= 0 && point > -6) {
+        // 1234e-7 -> 0.0001234
+        memcpy(out + n, "0.", 2);
+        memset(out + n + 2, '0', (size_t)-point);
+        n += 2 + (size_t)-point;
+        format_digits(digits, out + n, length);
+        n += (size_t)length;
+    } else {
+        // 1234e30 -> 1.234e33
+        format_digits(digits, out + n + 1, length);
+        out[n] = out[n + 1];
+        if (length > 1) {
+            out[n + 1] = '.';
+            n += (size_t)length + 1;
+        } else {
+            n += 1;
+        }
+        int32_t e = point - 1;
+        out[n++] = 'e';
+        if (e < 0) {
+            out[n++] = '-';
+            e = -e;
+        }
+        int e_length = decimal_length((uint64_t)e);
+        format_digits((uint64_t)e, out + n, e_length);
+        n += (size_t)e_length;
+    }
+    
+    w->length += n;
+}
+
+// Write a quoted string; runs that need no escaping are found with vector
+// compares and copied in bulk
+static void write_string(bjson_writer_t* w, const char* data, size_t length) {
+    static const char hex[] = "0123456789abcdef";
+    
+    writer_byte(w, '"');
+    size_t pos = 0;
+    while (pos < length) {
+        size_t run = scan_escape_run(data + pos, length - pos);
+        writer_put(w, data + pos, run);
+        pos += run;
+        if (pos == length) break;
+        
+        unsigned char c = (unsigned char)data[pos++];
+        char* out = writer_reserve(w, 6);
+        if (!out) return;
+        out[0] = '\\';
+        switch (c) {
+            case '"': out[1] = '"'; w->length += 2; break;
+            case '\\': out[1] = '\\'; w->length += 2; break;
+            case '\n': out[1] = 'n'; w->length += 2; break;
+            case '\t': out[1] = 't'; w->length += 2; break;
+            case '\r': out[1] = 'r'; w->length += 2; break;
+            case '\b': out[1] = 'b'; w->length += 2; break;
+            case '\f': out[1] = 'f'; w->length += 2; break;
+            default:
+                memcpy(out + 1, "u00", 3);
+                out[4] = hex[c >> 4];
+                out[5] = hex[c & 0xF];
+                w->length += 6;
+                break;
+        }
+    }
+    writer_byte(w, '"');
+}
+
+static void write_cstring(bjson_writer_t* w, const char* str) {
+    if (str) writer_put(w, str, strlen(str));
+}
+
+// Whether the [...] class opened just before p is closed within the pattern
+static int regex_class_closes(const char* p) {
+    int state = BJSON_REGEX_LEX_CLASS;
+    for (; *p && state != BJSON_REGEX_LEX_BODY; p++) {
+        state = *p == '\n' ? BJSON_REGEX_LEX_CLASS : regex_lex_step(state, *p);
+    }
+    return state == BJSON_REGEX_LEX_BODY;
+}
+
+// Pattern of a @regex value with whatever would end its payload early
+// escaped: '/' outside classes, newlines, a '[' never closed and a trailing
+// backslash. Patterns read by parse_regex are written back unchanged.
+static void write_regex_pattern(bjson_writer_t* w, const char* pattern) {
+    int state = BJSON_REGEX_LEX_BODY;
+    for (const char* p = pattern; *p; p++) {
+        char c = *p;
+        int escaped = state == BJSON_REGEX_LEX_ESCAPE || state == BJSON_REGEX_LEX_CLASS_ESCAPE;
+        if (c == '\n') {
+            writer_put(w, escaped ? "n" : "\\n", escaped ? 1 : 2);
+            int in_class = state == BJSON_REGEX_LEX_CLASS || state == BJSON_REGEX_LEX_CLASS_ESCAPE;
+            state = in_class ? BJSON_REGEX_LEX_CLASS : BJSON_REGEX_LEX_BODY;
+        } else if (state == BJSON_REGEX_LEX_BODY && (c == '/' || (c == '[' && !regex_class_closes(p + 1)))) {
+            writer_byte(w, '\\');
+            writer_byte(w, c);
+        } else {
+            writer_byte(w, c);
+            state = regex_lex_step(state, c);
+        }
+    }
+    if (state == BJSON_REGEX_LEX_ESCAPE || state == BJSON_REGEX_LEX_CLASS_ESCAPE) writer_byte(w, '\\');
+}
+
+// Encoded in slices whose output fits one reserve, so a sink's fixed
+// buffer is never overrun; slices are whole groups of three bytes
+static void write_base64(bjson_writer_t* w, const uint8_t* data, size_t length) {
+    while (length) {
+        size_t take = length < BJSON_WRITER_CHUNK / 4 * 3 ? length : BJSON_WRITER_CHUNK / 4 * 3;
+        char* out = writer_reserve(w, (take + 2) / 3 * 4);
+        if (!out) return;
+        w->length += base64_encode(data, take, out);
+        data += take;
+        length -= take;
+    }
+}
+
+static void write_value(bjson_writer_t* w, const bjson_value_t* value);
+
+static void begin_container(bjson_writer_t* w, char open) {
+    writer_byte(w, open);
+    w->depth++;
+}
+
+// Separator and indentation ahead of member i
+static void next_member(bjson_writer_t* w, size_t i) {
+    if (i) writer_byte(w, ',');
+    writer_newline(w);
+}
+
+static void end_container(bjson_writer_t* w, char close, size_t count) {
+    w->depth--;
+    if (count) writer_newline(w);
+    writer_byte(w, close);
+}
+
+static void write_key_value(bjson_writer_t* w, const bjson_value_t* key, const bjson_value_t* value) {
+    write_value(w, key);
+    writer_put(w, ": ", w->pretty ? 2 : 1);
+    write_value(w, value);
+}
+
+static void write_date(bjson_writer_t* w, const bjson_date_t* date) {
+    char* out = writer_reserve(w, 48);
+    if (!out) return;
+    w->length += (size_t)snprintf(out, 48, "%04d-%02d-%02d", date->year, date->month, date->day);
+}
+
+static void write_duration_field(bjson_writer_t* w, uint64_t count, char unit) {
+    char* out = writer_reserve(w, 24);
+    if (!out) return;
+    w->length += (size_t)snprintf(out, 24, "%llu%c", (unsigned long long)count, unit);
+}
+
+// ISO-8601 form of a duration: years and months from the months, days and
+// a time part from the milliseconds, "PT0S" when empty
+static void write_duration(bjson_writer_t* w, const bjson_duration_t* duration) {
+    uint64_t months = duration->months < 0 ? -(uint64_t)duration->months : (uint64_t)duration->months;
+    uint64_t ms = duration->milliseconds < 0 ? -(uint64_t)duration->milliseconds : (uint64_t)duration->milliseconds;
+    uint64_t days = ms / BJSON_MS_PER_DAY;
+    ms %= BJSON_MS_PER_DAY;
+    
+    if (duration->months < 0 || duration->milliseconds < 0) writer_byte(w, '-');
+    writer_byte(w, 'P');
+    if (months / 12) write_duration_field(w, months / 12, 'Y');
+    if (months % 12) write_duration_field(w, months % 12, 'M');
+    if (days) write_duration_field(w, days, 'D');
+    if (!ms && (months || days)) return;
+    
+    writer_byte(w, 'T');
+    if (ms / 3600000) write_duration_field(w, ms / 3600000, 'H');
+    if (ms / 60000 % 60) write_duration_field(w, ms / 60000 % 60, 'M');
+    if (ms % 60000 == 0 && ms) return;
+    if (ms % 1000) {
+        char* out = writer_reserve(w, 24);
+        if (!out) return;
+        w->length += (size_t)snprintf(out, 24, "%d.%03dS", (int)(ms / 1000 % 60), (int)(ms % 1000));
+    } else {
+        write_duration_field(w, ms / 1000 % 60, 'S');
+    }
+}
+
+static void write_value(bjson_writer_t* w, const bjson_value_t* value) {
+    if (!value) {
+        writer_put(w, "null", 4);
+        return;
+    }
+    
+    switch (value->type) {
+        case BJSON_NULL:
+            writer_put(w, "null", 4);
+            break;
+        case BJSON_BOOL:
+            if (value->bool_val) {
+                writer_put(w, "true", 4);
+            } else {
+                writer_put(w, "false", 5);
+            }
+            break;
+        case BJSON_INT:
+            write_int(w, value->int_val);
+            break;
+        case BJSON_DOUBLE:
+            write_double(w, value->double_val);
+            break;
+        case BJSON_STRING:
+            write_string(w, value->string_val.data, value->string_val.length);
+            break;
+        case BJSON_DECIMAL:
+            writer_put(w, value->string_val.data, value->string_val.length);
+            break;
+        case BJSON_ARRAY:
+            begin_container(w, '[');
+            for (size_t i = 0; i < value->array_val.count && !w->failed; i++) {
+                next_member(w, i);
+                write_value(w, value->array_val.items[i]);
+            }
+            end_container(w, ']', value->array_val.count);
+            break;
+        case BJSON_OBJECT:
+            begin_container(w, '{');
+            for (size_t i = 0; i < value->object_val->count && !w->failed; i++) {
+                next_member(w, i);
+                write_key_value(w, value->object_val->keys[i], value->object_val->values[i]);
+            }
+            end_container(w, '}', value->object_val->count);
+            break;
+        case BJSON_SET:
+            writer_put(w, "@set(", 5);
+            begin_container(w, '[');
+            for (size_t i = 0; i < value->set_val->count && !w->failed; i++) {
+                next_member(w, i);
+                write_value(w, value->set_val->values[i]);
+            }
+            end_container(w, ']', value->set_val->count);
+            writer_byte(w, ')');
+            break;
+        case BJSON_MAP:
+            writer_put(w, "@map(", 5);
+            begin_container(w, '{');
+            for (size_t i = 0; i < value->map_val->count && !w->failed; i++) {
+                next_member(w, i);
+                write_key_value(w, value->map_val->keys[i], value->map_val->values[i]);
+            }
+            end_container(w, '}', value->map_val->count);
+            writer_byte(w, ')');
+            break;
+        case BJSON_DATE:
+            writer_put(w, "@date(", 6);
+            write_date(w, &value->date_val);
+            writer_byte(w, ')');
+            break;
+        case BJSON_DATETIME: {
+            bjson_datetime_t datetime;
+            const bjson_datetime_t* dt = &datetime;
+            bjson_value_datetime(value, &datetime);
+            writer_put(w, "@datetime(", 10);
+            write_date(w, &dt->date);
+            char* out = writer_reserve(w, 48);
+            if (!out) return;
+            if (dt->millisecond) {
+                w->length += (size_t)snprintf(out, 48, "T%02d:%02d:%02d.%03d",
+                                              dt->hour, dt->minute, dt->second, dt->millisecond);
+            } else {
+                w->length += (size_t)snprintf(out, 48, "T%02d:%02d:%02d", dt->hour, dt->minute, dt->second);
+            }
+            if (dt->offset_minutes == 0) {
+                writer_byte(w, 'Z');
+            } else if (dt->offset_minutes != BJSON_OFFSET_NONE) {
+                int offset = dt->offset_minutes < 0 ? -dt->offset_minutes : dt->offset_minutes;
+                out = writer_reserve(w, 16);
+                if (!out) return;
+                w->length += (size_t)snprintf(out, 16, "%c%02d:%02d", dt->offset_minutes < 0 ? '-' : '+',
+                                              offset / 60, offset % 60);
+            }
+            if (dt->timezone) {
+                writer_byte(w, '[');
+                write_cstring(w, dt->timezone);
+                writer_byte(w, ']');
+            }
+            writer_byte(w, ')');
+            break;
+        }
+        case BJSON_DURATION:
+            writer_put(w, "@duration(", 10);
+            write_duration(w, &value->duration_val);
+            writer_byte(w, ')');
+            break;
+        case BJSON_BYTES:
+            writer_put(w, "@bytes(base64:", 14);
+            write_base64(w, value->bytes_val.data, value->bytes_val.length);
+            writer_byte(w, ')');
+            break;
+        case BJSON_REGEX:
+            writer_put(w, "@regex(/", 8);
+            write_regex_pattern(w, value->regex_val.pattern);
+            writer_byte(w, '/');
+            write_cstring(w, value->regex_val.flags);
+            writer_byte(w, ')');
+            break;
+        case BJSON_REFERENCE:
+            writer_put(w, "@ref(", 5);
+            write_cstring(w, value->ref_val.path);
+            writer_byte(w, ')');
+            break;
+        case BJSON_CUSTOM: {
+            const bjson_custom_type_t* type = &custom_types[value->custom_type];
+            size_t length;
+            const uint8_t* payload = bjson_custom_payload(value, &length);
+            writer_byte(w, '@');
+            writer_put(w, type->name, type->length);
+            writer_byte(w, '(');
+            if (type->hooks.serialize(type->hooks.user, payload, length, writer_sink, w)) w->failed = 1;
+            writer_byte(w, ')');
+            break;
+        }
+    }
+}
+
+// Serialize a value tree into one NUL-terminated heap string in a single
+// walk; pretty output indents nested members by four spaces
+char* bjson_serialize(bjson_value_t* value, int pretty) {
+    if (!value) return NULL;
+    
+    bjson_writer_t w = {0};
+    w.pretty = pretty;
+    write_value(&w, value);
+    writer_byte(&w, '\0');
+    
+    if (w.failed) {
+        free(w.data);
+        return NULL;
+    }
+    return w.data;
+}
+
+// Serialize a value tree through a sink callback, using a fixed staging
+// buffer instead of materializing the whole output
+bjson_error_t bjson_serialize_to(const bjson_value_t* value, int pretty, bjson_write_fn sink, void* ctx) {
+    if (!value || !sink) return BJSON_ERROR_TYPE;
+    
+    char buffer[BJSON_WRITER_CHUNK];
+    bjson_writer_t w = {0};
+    w.data = buffer;
+    w.capacity = sizeof(buffer);
+    w.sink = sink;
+    w.sink_ctx = ctx;
+    w.pretty = pretty;
+    
+    write_value(&w, value);
+    writer_flush(&w);
+    
+    return w.failed ? BJSON_ERROR_PARTIAL : BJSON_SUCCESS;
+}
+
+// BJSON-BIN-1.2 binary encoding
+//
+// An 8-byte header ("BJSON", major 1, minor 2, reserved 0) followed by one
+// value: a tag byte and its payload. Integers are zigzag LEB128 varints,
+// strings and blobs a varint length plus raw bytes, doubles 8 bytes
+// little-endian. Containers start with a 32-bit body size so a reader can
+// step over them whole; objects and maps add a table of 32-bit member
+// offsets so a single member can be reached without decoding the others.
+// Minor 1 writes datetimes as instants and adds durations; 1.0 buffers
+// still decode, their datetimes as floating times. Minor 2 adds
+// custom-type records (BJSON_TAG_CUSTOM), which name their type so buffers
+// do not depend on registration order.
+
+#define BJSON_BINARY_MAGIC "BJSON"
+#define BJSON_BINARY_HEADER_SIZE 8
+#define BJSON_BINARY_MAX_DEPTH 1024
+
+typedef enum {
+    BJSON_TAG_NULL = 0x00,
+    BJSON_TAG_FALSE,
+    BJSON_TAG_TRUE,
+    BJSON_TAG_INT,           // zigzag varint
+    BJSON_TAG_DOUBLE,        // 8 bytes
+    BJSON_TAG_STRING,        // varint length, bytes
+    BJSON_TAG_DECIMAL,       // varint length, digits
+    BJSON_TAG_ARRAY,         // u32 body size, varint count, items
+    BJSON_TAG_OBJECT,        // u32 body size, varint count, u32 offsets[count], key/value pairs
+    BJSON_TAG_SET,           // as BJSON_TAG_ARRAY
+    BJSON_TAG_MAP,           // as BJSON_TAG_OBJECT
+    BJSON_TAG_DATE,          // zigzag varint of year * 512 + month * 32 + day
+    BJSON_TAG_DATETIME,      // 1.0: packed date, varint milliseconds of day, varint-length timezone
+    BJSON_TAG_BYTES,         // varint length, raw bytes
+    BJSON_TAG_REGEX,         // varint-length pattern, varint-length flags
+    BJSON_TAG_REFERENCE,     // varint-length path
+    BJSON_TAG_INSTANT,       // 1.1: zigzag epoch milliseconds, zigzag UTC offset, varint-length timezone
+    BJSON_TAG_DURATION,      // 1.1: zigzag months, zigzag milliseconds
+    BJSON_TAG_CUSTOM         // 1.2: varint-length type name, varint-length payload
+} bjson_binary_tag_t;
+
+// Largest epoch milliseconds a decoder accepts, about 285,000 years out
+#define BJSON_BINARY_MAX_EPOCH_MS (1LL << 53)
+
+// Largest packed date (see pack_date) a decoder accepts: years up to 9999
+#define BJSON_BINARY_MAX_PACKED_DATE (10000LL * 512)
+
+static inline void store_u32_le(char* p, uint32_t v) {
+    p[0] = (char)v;
+    p[1] = (char)(v >> 8);
+    p[2] = (char)(v >> 16);
+    p[3] = (char)(v >> 24);
+}
+
+static inline uint32_t load_u32_le(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t zigzag_encode(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline int64_t pack_date(const bjson_date_t* date) {
+    return (int64_t)date->year * 512 + ((date->month & 15) << 5) + (date->day & 31);
+}
+
+static void bin_put_varint(bjson_writer_t* w, uint64_t v) {
+    char* out = writer_reserve(w, 10);
+    if (!out) return;
+    
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (char)v;
+    w->length += n;
+}
+
+static void bin_put_blob(bjson_writer_t* w, const void* data, size_t length) {
+    bin_put_varint(w, length);
+    if (length) writer_put(w, data, length);
+}
+
+static void bin_put_cstring(bjson_writer_t* w, const char* str) {
+    bin_put_blob(w, str, str ? strlen(str) : 0);
+}
+
+// Offsets of a container being written; patched as members are added
+typedef struct {
+    size_t size_at;          // u32 body size field
+    size_t table_at;         // u32 offset table; 0 for arrays and sets
+    size_t members_at;
+} bjson_bin_container_t;
+
+static bjson_bin_container_t bin_begin_container(bjson_writer_t* w, uint8_t tag, size_t count, int keyed) {
+    bjson_bin_container_t c = {0, 0, 0};
+    writer_byte(w, (char)tag);
+    c.size_at = w->length;
+    if (writer_reserve(w, 4)) w->length += 4;
+    bin_put_varint(w, count);
+    
+    if (keyed) {
+        c.table_at = w->length;
+        char* table = writer_reserve(w, 4 * count);
+        if (table) w->length += 4 * count;
+    }
+    c.members_at = w->length;
+    return c;
+}
+
+static void bin_mark_member(bjson_writer_t* w, const bjson_bin_container_t* c, size_t i) {
+    if (!w->failed) store_u32_le(w->data + c->table_at + 4 * i, (uint32_t)(w->length - c->members_at));
+}
+
+static void bin_end_container(bjson_writer_t* w, const bjson_bin_container_t* c) {
+    if (w->failed) return;
+    
+    size_t body = w->length - (c->size_at + 4);
+    if (body > UINT32_MAX) {
+        w->failed = 1;
+        return;
+    }
+    store_u32_le(w->data + c->size_at, (uint32_t)body);
+}
+
+static void bin_encode_value(bjson_writer_t* w, const bjson_value_t* value) {
+    if (!value) {
+        writer_byte(w, BJSON_TAG_NULL);
+        return;
+    }
+    
+    switch (value->type) {
+        case BJSON_NULL:
+            writer_byte(w, BJSON_TAG_NULL);
+            break;
+        case BJSON_BOOL:
+            writer_byte(w, value->bool_val ? BJSON_TAG_TRUE : BJSON_TAG_FALSE);
+            break;
+        case BJSON_INT:
+            writer_byte(w, BJSON_TAG_INT);
+            bin_put_varint(w, zigzag_encode(value->int_val));
+            break;
+        case BJSON_DOUBLE: {
+            uint64_t bits;
+            memcpy(&bits, &value->double_val, sizeof(bits));
+            char* out = writer_reserve(w, 9);
+            if (!out) return;
+            out[0] = BJSON_TAG_DOUBLE;
+            store_u32_le(out + 1, (uint32_t)bits);
+            store_u32_le(out + 5, (uint32_t)(bits >> 32));
+            w->length += 9;
+            break;
+        }
+        case BJSON_STRING:
+        case BJSON_DECIMAL:
+            writer_byte(w, value->type == BJSON_STRING ? BJSON_TAG_STRING : BJSON_TAG_DECIMAL);
+            bin_put_blob(w, value->string_val.data, value->string_val.length);
+            break;
+        case BJSON_ARRAY:
+        case BJSON_SET: {
+            int is_set = value->type == BJSON_SET;
+            size_t count = is_set ? value->set_val->count : value->array_val.count;
+            bjson_value_t** items = is_set ? value->set_val->values : value->array_val.items;
+            bjson_bin_container_t c = bin_begin_container(w, is_set ? BJSON_TAG_SET : BJSON_TAG_ARRAY, count, 0);
+            for (size_t i = 0; i < count && !w->failed; i++) {
+                bin_encode_value(w, items[i]);
+            }
+            bin_end_container(w, &c);
+            break;
+        }
+        case BJSON_OBJECT: {
+            const bjson_object_t* obj = value->object_val;
+            bjson_bin_container_t c = bin_begin_container(w, BJSON_TAG_OBJECT, obj->count, 1);
+            for (size_t i = 0; i < obj->count && !w->failed; i++) {
+                bin_mark_member(w, &c, i);
+                bin_encode_value(w, obj->keys[i]);
+                bin_encode_value(w, obj->values[i]);
+            }
+            bin_end_container(w, &c);
+            break;
+        }
+        case BJSON_MAP: {
+            const bjson_map_t* map = value->map_val;
+            bjson_bin_container_t c = bin_begin_container(w, BJSON_TAG_MAP, map->count, 1);
+            for (size_t i = 0; i < map->count && !w->failed; i++) {
+                bin_mark_member(w, &c, i);
+                bin_encode_value(w, map->keys[i]);
+                bin_encode_value(w, map->values[i]);
+            }
+            bin_end_container(w, &c);
+            break;
+        }
+        case BJSON_DATE:
+            writer_byte(w, BJSON_TAG_DATE);
+            bin_put_varint(w, zigzag_encode(pack_date(&value->date_val)));
+            break;
+        case BJSON_DATETIME: {
+            const bjson_value_ext_t* ext = bjson_value_ext(value);
+            writer_byte(w, BJSON_TAG_INSTANT);
+            bin_put_varint(w, zigzag_encode(value->datetime_val.epoch_ms));
+            bin_put_varint(w, zigzag_encode(value->datetime_val.offset_minutes));
+            bin_put_cstring(w, ext ? ext->timezone : NULL);
+            break;
+        }
+        case BJSON_DURATION:
+            writer_byte(w, BJSON_TAG_DURATION);
+            bin_put_varint(w, zigzag_encode(value->duration_val.months));
+            bin_put_varint(w, zigzag_encode(value->duration_val.milliseconds));
+            break;
+        case BJSON_BYTES:
+            writer_byte(w, BJSON_TAG_BYTES);
+            bin_put_blob(w, value->bytes_val.data, value->bytes_val.length);
+            break;
+        case BJSON_REGEX:
+            writer_byte(w, BJSON_TAG_REGEX);
+            bin_put_cstring(w, value->regex_val.pattern);
+            bin_put_cstring(w, value->regex_val.flags);
+            break;
+        case BJSON_REFERENCE:
+            writer_byte(w, BJSON_TAG_REFERENCE);
+            bin_put_cstring(w, value->ref_val.path);
+            break;
+        case BJSON_CUSTOM: {
+            const bjson_custom_type_t* type = &custom_types[value->custom_type];
+            size_t length;
+            const uint8_t* payload = bjson_custom_payload(value, &length);
+            writer_byte(w, BJSON_TAG_CUSTOM);
+            bin_put_blob(w, type->name, type->length);
+            if (!type->hooks.encode) {
+                bin_put_blob(w, payload, length);
+                break;
+            }
+            
+            bjson_writer_t encoded = {0};
+            if (type->hooks.encode(type->hooks.user, payload, length, writer_sink, &encoded)) encoded.failed = 1;
+            if (encoded.failed) {
+                w->failed = 1;
+            } else {
+                bin_put_blob(w, encoded.data, encoded.length);
+            }
+            free(encoded.data);
+            break;
+        }
+    }
+}
+
+// Encode a value tree as a BJSON-BIN-1.2 buffer; *length receives its size
+uint8_t* bjson_binary_encode(const bjson_value_t* value, size_t* length) {
+    if (!value) return NULL;
+    
+    bjson_writer_t w = {0};
+    writer_put(&w, BJSON_BINARY_MAGIC "\x01\x02\x00", BJSON_BINARY_HEADER_SIZE);
+    bin_encode_value(&w, value);
+    
+    if (w.failed) {
+        free(w.data);
+        return NULL;
+    }
+    if (length) *length = w.length;
+    return (uint8_t*)w.data;
+}
+
+static int bin_fail(bjson_parser_t* parser, const char* what) {
+    snprintf(parser->error_msg, sizeof(parser->error_msg), 
+            "%s at binary offset %zu", what, parser->pos);
+    return 0;
+}
+
+static int bin_read_varint(bjson_parser_t* parser, uint64_t* out) {
+    const uint8_t* p = (const uint8_t*)parser->input;
+    uint64_t v = 0;
+    
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (parser->pos >= parser->length) return bin_fail(parser, "Truncated varint");
+        uint8_t byte = p[parser->pos++];
+        v |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *out = v;
+            return 1;
+        }
+    }
+    return bin_fail(parser, "Overlong varint");
+}
+
+// Read a varint-length blob, leaving *data pointing into the input
+static int bin_read_blob(bjson_parser_t* parser, const char** data, size_t* length) {
+    uint64_t n;
+    if (!bin_read_varint(parser, &n)) return 0;
+    if (n > parser->length - parser->pos) return bin_fail(parser, "Truncated string");
+    
+    *data = parser->input + parser->pos;
+    *length = (size_t)n;
+    parser->pos += (size_t)n;
+    return 1;
+}
+
+// Copy a blob into a NUL-terminated buffer from the parser's allocation source
+static char* bin_read_cstring(bjson_parser_t* parser) {
+    const char* data;
+    size_t length;
+    if (!bin_read_blob(parser, &data, &length)) return NULL;
+    
+    char* copy = parser_alloc(parser, length + 1);
+    if (!copy) {
+        snprintf(parser->error_msg, sizeof(parser->error_msg), "Out of memory");
+        return NULL;
+    }
+    memcpy(copy, data, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+static void unpack_date(int64_t packed, bjson_date_t* date) {
+    date->day = (int)(packed & 31);
+    date->month = (int)((packed >> 5) & 15);
+    date->year = (int)((packed - (packed & 511)) / 512);
+}
+
+// Read a container header; the body must fit in the input and every member
+// takes at least min_member bytes, which bounds the count before allocating
+static int bin_read_container(bjson_parser_t* parser, size_t min_member, size_t* count, size_t* end) {
+    if (parser->length - parser->pos < 4) return bin_fail(parser, "Truncated container");
+    size_t body = load_u32_le((const uint8_t*)parser->input + parser->pos);
+    parser->pos += 4;
+    if (body > parser->length - parser->pos) return bin_fail(parser, "Truncated container");
+    *end = parser->pos + body;
+    
+    uint64_t n;
+    if (!bin_read_varint(parser, &n)) return 0;
+    if (parser->pos > *end || n > (*end - parser->pos) / min_member) return bin_fail(parser, "Corrupt container count");
+    *count = (size_t)n;
+    return 1;
+}
+
+static bjson_value_t* bin_decode_value(bjson_parser_t* parser, int depth);
+
+// Decode member i of an object or map, checking it starts where the offset
+// table says and stays inside the container
+static int bin_decode_pair(bjson_parser_t* parser, const uint8_t* table, size_t members_at, size_t i,
+                           size_t end, int depth, bjson_value_t** key, bjson_value_t** value) {
+    if (load_u32_le(table + 4 * i) != parser->pos - members_at) return bin_fail(parser, "Corrupt offset table");
+    
+    *key = bin_decode_value(parser, depth + 1);
+    if (!*key) return 0;
+    if (parser->pos >= end) {
+        bjson_free_value(*key);
+        return bin_fail(parser, "Container overruns its size");
+    }
+    
+    *value = bin_decode_value(parser, depth + 1);
+    if (!*value || parser->pos > end) {
+        if (*value) bin_fail(parser, "Container overruns its size");
+        bjson_free_value(*key);
+        bjson_free_value(*value);
+        return 0;
+    }
+    return 1;
+}
+
+static bjson_value_t* bin_decode_value(bjson_parser_t* parser, int depth) {
+    if (depth > BJSON_BINARY_MAX_DEPTH) {
+        bin_fail(parser, "Nesting too deep");
+        return NULL;
+    }
+    if (parser->pos >= parser->length) {
+        bin_fail(parser, "Truncated value");
+        return NULL;
+    }
+    
+    const uint8_t tag = (uint8_t)parser->input[parser->pos++];
+    bjson_value_t* value = NULL;
+    
+    switch (tag) {
+        case BJSON_TAG_NULL:
+            return parser_create_value(parser, BJSON_NULL);
+        case BJSON_TAG_FALSE:
+        case BJSON_TAG_TRUE:
+            value = parser_create_value(parser, BJSON_BOOL);
+            if (value) value->bool_val = tag == BJSON_TAG_TRUE;
+            return value;
+        case BJSON_TAG_INT: {
+            uint64_t v;
+            if (!bin_read_varint(parser, &v)) return NULL;
+            value = parser_create_value(parser, BJSON_INT);
+            if (value) value->int_val = zigzag_decode(v);
+            return value;
+        }
+        case BJSON_TAG_DOUBLE: {
+            if (parser->length - parser->pos < 8) {
+                bin_fail(parser, "Truncated double");
+                return NULL;
+            }
+            const uint8_t* p = (const uint8_t*)parser->input + parser->pos;
+            uint64_t bits = load_u32_le(p) | (uint64_t)load_u32_le(p + 4) << 32;
+            parser->pos += 8;
+            value = parser_create_value(parser, BJSON_DOUBLE);
+            if (value) memcpy(&value->double_val, &bits, sizeof(bits));
+            return value;
+        }
+        case BJSON_TAG_STRING:
+        case BJSON_TAG_DECIMAL: {
+            const char* data;
+            size_t length;
+            if (!bin_read_blob(parser, &data, &length)) return NULL;
+            value = parser_create_value(parser, tag == BJSON_TAG_STRING ? BJSON_STRING : BJSON_DECIMAL);
+            if (!value) break;
+            value->string_val.length = length;
+            if (parser->flags & BJSON_PARSE_BORROW_STRINGS) {
+                value->string_val.data = (char*)data;
+                value->flags |= BJSON_VALUE_BORROWED;
+            } else {
+                value->string_val.data = parser_alloc(parser, length + 1);
+                if (!value->string_val.data) {
+                    bjson_free_value(value);
+                    value = NULL;
+                    break;
+                }
+                memcpy(value->string_val.data, data, length);
+                value->string_val.data[length] = '\0';
+            }
+            return value;
+        }
+        case BJSON_TAG_ARRAY:
+        case BJSON_TAG_SET: {
+            size_t count, end;
+            if (!bin_read_container(parser, 1, &count, &end)) return NULL;
+            bjson_value_t* array = parser_create_value(parser, BJSON_ARRAY);
+            if (!array || !reserve_array(parser, array, count)) {
+                bjson_free_value(array);
+                break;
+            }
+            while (array->array_val.count < count) {
+                bjson_value_t* item = bin_decode_value(parser, depth + 1);
+                if (!item || parser->pos > end) {
+                    if (item) bin_fail(parser, "Container overruns its size");
+                    bjson_free_value(item);
+                    bjson_free_value(array);
+                    return NULL;
+                }
+                array->array_val.items[array->array_val.count++] = item;
+            }
+            if (parser->pos != end) {
+                bjson_free_value(array);
+                bin_fail(parser, "Container size mismatch");
+                return NULL;
+            }
+            if (tag == BJSON_TAG_ARRAY) return array;
+            
+            // Sets reuse the array path and then move the items over
+            value = parser_create_value(parser, BJSON_SET);
+            size_t i = 0;
+            if (value) {
+                for (; i < count; i++) {
+                    int added = set_insert(parser->arena, value->set_val, array->array_val.items[i]);
+                    if (added < 0) break;
+                    if (added == 0) bjson_free_value(array->array_val.items[i]);
+                }
+            }
+            if (!value || i < count) {
+                for (; i < count; i++) bjson_free_value(array->array_val.items[i]);
+                bjson_free_value(value);
+                value = NULL;
+            }
+            release_array_shell(array);
+            if (!value) break;
+            return value;
+        }
+        case BJSON_TAG_OBJECT:
+        case BJSON_TAG_MAP: {
+            size_t count, end;
+            if (!bin_read_container(parser, 6, &count, &end)) return NULL;
+            const uint8_t* table = (const uint8_t*)parser->input + parser->pos;
+            parser->pos += 4 * count;
+            size_t members_at = parser->pos;
+            
+            value = parser_create_value(parser, tag == BJSON_TAG_OBJECT ? BJSON_OBJECT : BJSON_MAP);
+            if (!value || (tag == BJSON_TAG_OBJECT && !reserve_object(parser, value->object_val, count))) {
+                bjson_free_value(value);
+                value = NULL;
+                break;
+            }
+            
+            for (size_t i = 0; i < count; i++) {
+                bjson_value_t* key;
+                bjson_value_t* member;
+                if (!bin_decode_pair(parser, table, members_at, i, end, depth, &key, &member)) {
+                    bjson_free_value(value);
+                    return NULL;
+                }
+                
+                if (tag == BJSON_TAG_MAP) {
+                    if (map_insert(parser->arena, value->map_val, key, member) < 0) {
+                        bjson_free_value(key);
+                        bjson_free_value(member);
+                        bjson_free_value(value);
+                        snprintf(parser->error_msg, sizeof(parser->error_msg), "Out of memory");
+                        return NULL;
+                    }
+                    continue;
+                }
+                
+                if (key->type == BJSON_STRING) {
+                    key->string_hash = key_hash(key->string_val.data, key->string_val.length);
+                    key->flags |= BJSON_VALUE_HASHED;
+                }
+                bjson_object_t* obj = value->object_val;
+                obj->keys[obj->count] = key;
+                obj->values[obj->count] = member;
+                obj->count++;
+            }
+            
+            if (parser->pos != end) {
+                bjson_free_value(value);
+                bin_fail(parser, "Container size mismatch");
+                return NULL;
+            }
+            if (tag == BJSON_TAG_OBJECT && count >= BJSON_OBJECT_INDEX_THRESHOLD &&
+                !build_object_index(parser, value->object_val)) {
+                bjson_free_value(value);
+                value = NULL;
+                break;
+            }
+            return value;
+        }
+        case BJSON_TAG_DATE: {
+            uint64_t packed;
+            if (!bin_read_varint(parser, &packed)) return NULL;
+            if (llabs(zigzag_decode(packed)) >= BJSON_BINARY_MAX_PACKED_DATE) {
+                bin_fail(parser, "Invalid date");
+                return NULL;
+            }
+            value = parser_create_value(parser, BJSON_DATE);
+            if (value) unpack_date(zigzag_decode(packed), &value->date_val);
+            return value;
+        }
+        case BJSON_TAG_DATETIME:
+        case BJSON_TAG_INSTANT: {
+            uint64_t first, second;
+            const char* tz;
+            size_t tz_length;
+            if (!bin_read_varint(parser, &first) || !bin_read_varint(parser, &second) ||
+                !bin_read_blob(parser, &tz, &tz_length)) {
+                return NULL;
+            }
+            bjson_datetime_packed_t packed;
+            if (tag == BJSON_TAG_DATETIME) {
+                bjson_date_t date;
+                if (second >= BJSON_MS_PER_DAY) {
+                    bin_fail(parser, "Invalid time of day");
+                    return NULL;
+                }
+                if (llabs(zigzag_decode(first)) >= BJSON_BINARY_MAX_PACKED_DATE) {
+                    bin_fail(parser, "Invalid date");
+                    return NULL;
+                }
+                unpack_date(zigzag_decode(first), &date);
+                packed.epoch_ms = days_from_civil(&date) * BJSON_MS_PER_DAY + (int64_t)second;
+                packed.offset_minutes = BJSON_OFFSET_NONE;
+            } else {
+                int64_t offset = zigzag_decode(second);
+                packed.epoch_ms = zigzag_decode(first);
+                if (offset != BJSON_OFFSET_NONE && (offset <= -24 * 60 || offset >= 24 * 60)) {
+                    bin_fail(parser, "Invalid UTC offset");
+                    return NULL;
+                }
+                if (packed.epoch_ms > BJSON_BINARY_MAX_EPOCH_MS || packed.epoch_ms < -BJSON_BINARY_MAX_EPOCH_MS) {
+                    bin_fail(parser, "Invalid datetime");
+                    return NULL;
+                }
+                packed.offset_minutes = (int32_t)offset;
+            }
+            value = tz_length ? parser_create_extended(parser, BJSON_DATETIME)
+                              : parser_create_value(parser, BJSON_DATETIME);
+            if (!value) break;
+            value->datetime_val = packed;
+            if (tz_length) {
+                char* timezone = parser_alloc(parser, tz_length + 1);
+                if (!timezone) {
+                    bjson_free_value(value);
+                    value = NULL;
+                    break;
+                }
+                memcpy(timezone, tz, tz_length);
+                timezone[tz_length] = '\0';
+                bjson_value_ext(value)->timezone = timezone;
+            }
+            return value;
+        }
+        case BJSON_TAG_BYTES: {
+            const char* data;
+            size_t length;
+            if (!bin_read_blob(parser, &data, &length)) return NULL;
+            value = parser_create_value(parser, BJSON_BYTES);
+            if (!value) break;
+            value->bytes_val.length = length;
+            value->bytes_val.data = parser_alloc(parser, length ? length : 1);
+            if (!value->bytes_val.data) {
+                bjson_free_value(value);
+                value = NULL;
+                break;
+            }
+            memcpy(value->bytes_val.data, data, length);
+            return value;
+        }
+        case BJSON_TAG_REGEX:
+            value = parser_create_value(parser, BJSON_REGEX);
+            if (!value) break;
+            value->regex_val.pattern = bin_read_cstring(parser);
+            value->regex_val.flags = value->regex_val.pattern ? bin_read_cstring(parser) : NULL;
+            if (!value->regex_val.flags) {
+                bjson_free_value(value);
+                return NULL;
+            }
+            if (!parser_bind_regex(parser, value)) break;
+            return value;
+        case BJSON_TAG_CUSTOM: {
+            const char* name;
+            const char* data;
+            size_t name_length, length;
+            if (!bin_read_blob(parser, &name, &name_length) || !bin_read_blob(parser, &data, &length)) return NULL;
+            const bjson_custom_type_t* type = custom_type_find(name, name_length);
+            if (!type || !type->hooks.parse) {
+                bin_fail(parser, "Unknown custom type");
+                return NULL;
+            }
+            
+            uint8_t local[256];
+            const uint8_t* payload = (const uint8_t*)data;
+            if (type->hooks.decode) {
+                payload = custom_payload(&type->hooks, 1, data, length, local, sizeof(local), &length);
+                if (!payload) {
+                    bin_fail(parser, "Invalid custom payload");
+                    return NULL;
+                }
+            }
+            value = custom_value_alloc(parser->arena, (unsigned)(type - custom_types), payload, length);
+            if (payload != (const uint8_t*)data && payload != local) free((void*)payload);
+            if (!value) break;
+            return value;
+        }
+        case BJSON_TAG_DURATION: {
+            uint64_t months, milliseconds;
+            if (!bin_read_varint(parser, &months) || !bin_read_varint(parser, &milliseconds)) return NULL;
+            if (zigzag_decode(months) != (int32_t)zigzag_decode(months)) {
+                bin_fail(parser, "Invalid duration");
+                return NULL;
+            }
+            value = parser_create_value(parser, BJSON_DURATION);
+            if (!value) break;
+            value->duration_val.months = (int32_t)zigzag_decode(months);
+            value->duration_val.milliseconds = zigzag_decode(milliseconds);
+            return value;
+        }
+        case BJSON_TAG_REFERENCE:
+            value = parser_create_value(parser, BJSON_REFERENCE);
+            if (!value) break;
+            value->ref_val.path = bin_read_cstring(parser);
+            if (!value->ref_val.path) {
+                bjson_free_value(value);
+                return NULL;
+            }
+            return value;
+        default:
+            parser->pos--;
+            snprintf(parser->error_msg, sizeof(parser->error_msg), 
+                    "Unknown binary tag 0x%02x at binary offset %zu", tag, parser->pos);
+            return NULL;
+    }
+    
+    snprintf(parser->error_msg, sizeof(parser->error_msg), "Out of memory");
+    return NULL;
+}
+
+// Decode one encoded value (no header), e.g. a member found with
+// bjson_binary_object_get. BJSON_PARSE_ARENA and BJSON_PARSE_BORROW_STRINGS
+// apply as for text; borrowed strings point into data, which must then
+// outlive the document.
+bjson_document_t* bjson_binary_decode_value(const uint8_t* value, size_t length, unsigned flags, bjson_error_t* error) {
+    bjson_document_t* doc = document_create(flags, error);
+    if (!doc) return NULL;
+    
+    bjson_parser_t parser = {0};
+    parser.input = (const char*)value;
+    parser.length = length;
+    parser.arena = doc->arena;
+    parser.flags = flags;
+    
+    doc->root = bin_decode_value(&parser, 0);
+    if (doc->root && parser.pos != length) {
+        bin_fail(&parser, "Trailing bytes");
+        if (!doc->arena) bjson_free_value(doc->root);
+        doc->root = NULL;
+    }
+    
+    if (!doc->root) {
+        if (error) *error = BJSON_ERROR_SYNTAX;
+        set_error_message(parser.error_msg);
+        bjson_document_free(doc);
+        return NULL;
+    }
+    
+    if (error) *error = BJSON_SUCCESS;
+    return doc;
+}
+
+// Decode a BJSON-BIN-1.x buffer produced by bjson_binary_encode
+bjson_document_t* bjson_binary_decode(const uint8_t* data, size_t length, unsigned flags, bjson_error_t* error) {
+    if (length < BJSON_BINARY_HEADER_SIZE || memcmp(data, BJSON_BINARY_MAGIC, 5) != 0 || data[5] != 1) {
+        if (error) *error = BJSON_ERROR_TYPE;
+        set_error_message("Not a BJSON-BIN-1.x buffer");
+        return NULL;
+    }
+    
+    return bjson_binary_decode_value(data + BJSON_BINARY_HEADER_SIZE, length - BJSON_BINARY_HEADER_SIZE,
+                                     flags, error);
+}
+
+// Find a string key in an encoded object (object points at its tag) through
+// the offset table, stepping over member values without decoding them.
+// Returns the encoded member value and its size, or NULL.
+const uint8_t* bjson_binary_object_get(const uint8_t* object, size_t length, const char* key,
+                                       size_t key_length, size_t* value_length) {
+    if (length < 1 || object[0] != BJSON_TAG_OBJECT) return NULL;
+    
+    bjson_parser_t parser = {0};
+    parser.input = (const char*)object;
+    parser.length = length;
+    parser.pos = 1;
+    
+    size_t count, end;
+    if (!bin_read_container(&parser, 6, &count, &end)) return NULL;
+    const uint8_t* table = object + parser.pos;
+    size_t members_at = parser.pos + 4 * count;
+    
+    for (size_t i = 0; i < count; i++) {
+        parser.pos = members_at + load_u32_le(table + 4 * i);
+        size_t next = i + 1 < count ? members_at + load_u32_le(table + 4 * (i + 1)) : end;
+        if (parser.pos >= next || next > end) return NULL;
+        if (object[parser.pos++] != BJSON_TAG_STRING) continue;
+        
+        const char* data;
+        size_t n;
+        parser.length = next;
+        if (!bin_read_blob(&parser, &data, &n)) return NULL;
+        parser.length = length;
+        if (n == key_length && memcmp(data, key, n) == 0 && parser.pos < next) {
+            if (value_length) *value_length = next - parser.pos;
+            return object + parser.pos;
+        }
+    }
+    return NULL;
+}
+
+// Tape documents: an immutable, flat alternative to the pointer tree. Each
+// value is a 64-bit word with its type in the top byte and a 56-bit
+// payload, plus one more word for ints, doubles, datetimes, durations,
+// regexes and custom values. Text (strings, decimal digits, bytes, patterns,
+// paths, timezones and custom payloads) lives in a side buffer as a 64-bit length, the bytes and a
+// NUL, and is referenced by offset. A container opens with a word holding its member
+// count and the position just past its closing word, so skipping a subtree
+// is one load; object and map members alternate key and value. Sets and
+// maps keep their members as written: duplicates are only dropped when a
+// tree is built. Node metadata (type hints, comments, ids) is not kept.
+
+#define BJSON_TAPE_END 0xFF                    // Tag of a container's closing word
+#define BJSON_TAPE_PAYLOAD ((1ULL << 56) - 1)
+#define BJSON_TAPE_MAX_COUNT 0xFFFFFF          // Member counts saturate here
+
+static inline uint64_t tape_word(int tag, uint64_t payload) {
+    return (uint64_t)tag << 56 | (payload & BJSON_TAPE_PAYLOAD);
+}
+
+static inline int tape_tag(const bjson_tape_t* tape, size_t at) {
+    return (int)(tape->words[at] >> 56);
+}
+
+static inline uint64_t tape_payload(const bjson_tape_t* tape, size_t at) {
+    return tape->words[at] & BJSON_TAPE_PAYLOAD;
+}
+
+// Text record at offset in the side buffer
+static const char* tape_text(const bjson_tape_t* tape, uint64_t offset, size_t* length) {
+    uint64_t n;
+    memcpy(&n, tape->text + offset, sizeof(n));
+    if (length) *length = (size_t)n;
+    return tape->text + offset + sizeof(n);
+}
+
+// Appends words and text to a tape; containers still open are on the stack
+typedef struct {
+    bjson_tape_t* tape;
+    size_t* open;
+    size_t depth;
+    size_t capacity;
+} bjson_tape_builder_t;
+
+// Append a word; returns nonzero (stop) when out of memory or past the 4G
+// words that container positions can address
+static int tape_put(bjson_tape_builder_t* b, uint64_t word) {
+    bjson_tape_t* tape = b->tape;
+    if (tape->count == tape->capacity) {
+        if (tape->count >= UINT32_MAX) return 1;
+        size_t capacity = tape->capacity ? tape->capacity * 2 : 256;
+        if (capacity > UINT32_MAX) capacity = UINT32_MAX;
+        uint64_t* words = realloc(tape->words, capacity * sizeof(uint64_t));
+        if (!words) return 1;
+        tape->words = words;
+        tape->capacity = capacity;
+    }
+    tape->words[tape->count++] = word;
+    return 0;
+}
+
+// Copy text into the side buffer; *offset receives its record offset
+static int tape_put_text(bjson_tape_builder_t* b, const void* data, size_t length, uint64_t* offset) {
+    bjson_tape_t* tape = b->tape;
+    size_t need = sizeof(uint64_t) + length + 1;
+    if (tape->text_capacity - tape->text_length < need) {
+        size_t capacity = tape->text_capacity ? tape->text_capacity : 1024;
+        while (capacity - tape->text_length < need) capacity *= 2;
+        char* text = realloc(tape->text, capacity);
+        if (!text) return 1;
+        tape->text = text;
+        tape->text_capacity = capacity;
+    }
+    
+    uint64_t n = length;
+    char* out = tape->text + tape->text_length;
+    memcpy(out, &n, sizeof(n));
+    if (length) memcpy(out + sizeof(n), data, length);
+    out[sizeof(n) + length] = '\0';
+    *offset = tape->text_length;
+    tape->text_length += need;
+    return 0;
+}
+
+static int tape_put_tagged_text(bjson_tape_builder_t* b, int tag, const void* data, size_t length) {
+    uint64_t offset;
+    return tape_put_text(b, data, length, &offset) || tape_put(b, tape_word(tag, offset));
+}
+
+static int tape_open(bjson_tape_builder_t* b, bjson_type_t type) {
+    if (b->depth == b->capacity) {
+        size_t capacity = grow_capacity(b->capacity, b->depth + 1);
+        size_t* open = realloc(b->open, capacity * sizeof(size_t));
+        if (!open) return 1;
+        b->open = open;
+        b->capacity = capacity;
+    }
+    b->open[b->depth++] = b->tape->count;
+    return tape_put(b, tape_word(type, 0));
+}
+
+// Close the innermost container: the closing word points back at the
+// opening one, which learns its count and the position past the close
+static int tape_close(bjson_tape_builder_t* b, size_t count) {
+    size_t open = b->open[--b->depth];
+    if (tape_put(b, tape_word(BJSON_TAPE_END, open))) return 1;
+    
+    bjson_tape_t* tape = b->tape;
+    uint64_t saturated = count < BJSON_TAPE_MAX_COUNT ? count : BJSON_TAPE_MAX_COUNT;
+    tape->words[open] = tape_word(tape_tag(tape, open), saturated << 32 | tape->count);
+    return 0;
+}
+
+static int tape_start_object(void* ctx) { return tape_open(ctx, BJSON_OBJECT); }
+static int tape_start_array(void* ctx) { return tape_open(ctx, BJSON_ARRAY); }
+static int tape_start_set(void* ctx) { return tape_open(ctx, BJSON_SET); }
+static int tape_start_map(void* ctx) { return tape_open(ctx, BJSON_MAP); }
+static int tape_end(void* ctx, size_t count) { return tape_close(ctx, count); }
+
+static int tape_string(void* ctx, const char* data, size_t length) {
+    return tape_put_tagged_text(ctx, BJSON_STRING, data, length);
+}
+
+static int tape_decimal(void* ctx, const char* digits, size_t length) {
+    return tape_put_tagged_text(ctx, BJSON_DECIMAL, digits, length);
+}
+
+static int tape_null(void* ctx) {
+    return tape_put(ctx, tape_word(BJSON_NULL, 0));
+}
+
+static int tape_bool(void* ctx, int value) {
+    return tape_put(ctx, tape_word(BJSON_BOOL, value != 0));
+}
+
+static int tape_int(void* ctx, long long value) {
+    return tape_put(ctx, tape_word(BJSON_INT, 0)) || tape_put(ctx, (uint64_t)value);
+}
+
+static int tape_double(void* ctx, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return tape_put(ctx, tape_word(BJSON_DOUBLE, 0)) || tape_put(ctx, bits);
+}
+
+static int tape_date(void* ctx, const bjson_date_t* date) {
+    return tape_put(ctx, tape_word(BJSON_DATE, zigzag_encode(pack_date(date))));
+}
+
+// Payload: timezone record offset + 1 (0 without a timezone) above the
+// 16-bit UTC offset; the second word holds the epoch milliseconds
+static int tape_datetime(void* ctx, const bjson_datetime_t* datetime) {
+    uint64_t tz = 0;
+    if (datetime->timezone) {
+        if (tape_put_text(ctx, datetime->timezone, strlen(datetime->timezone), &tz)) return 1;
+        tz++;
+    }
+    bjson_datetime_packed_t packed = pack_datetime(datetime);
+    uint64_t payload = tz << 16 | (uint16_t)packed.offset_minutes;
+    return tape_put(ctx, tape_word(BJSON_DATETIME, payload)) || tape_put(ctx, (uint64_t)packed.epoch_ms);
+}
+
+// Payload: zigzag months; the second word holds the milliseconds
+static int tape_duration(void* ctx, const bjson_duration_t* duration) {
+    return tape_put(ctx, tape_word(BJSON_DURATION, zigzag_encode(duration->months))) ||
+           tape_put(ctx, (uint64_t)duration->milliseconds);
+}
+
+static int tape_bytes(void* ctx, const uint8_t* data, size_t length) {
+    return tape_put_tagged_text(ctx, BJSON_BYTES, data, length);
+}
+
+// Payload: pattern record; the second word: flags record
+static int tape_regex(void* ctx, const char* pattern, const char* flags) {
+    uint64_t p, f;
+    if (tape_put_text(ctx, pattern, strlen(pattern), &p)) return 1;
+    if (tape_put_text(ctx, flags ? flags : "", flags ? strlen(flags) : 0, &f)) return 1;
+    return tape_put(ctx, tape_word(BJSON_REGEX, p)) || tape_put(ctx, f);
+}
+
+static int tape_ref(void* ctx, const char* path) {
+    return tape_put_tagged_text(ctx, BJSON_REFERENCE, path, strlen(path));
+}
+
+// Payload: payload record; the second word: custom type slot
+static int tape_custom(void* ctx, unsigned type, const uint8_t* payload, size_t length) {
+    return tape_put_tagged_text(ctx, BJSON_CUSTOM, payload, length) || tape_put(ctx, type);
+}
+
+static const bjson_sax_handler_t bjson_tape_writer = {
+    tape_start_object, tape_end, tape_start_array, tape_end,
+    tape_start_set, tape_end, tape_start_map, tape_end,
+    tape_string, tape_null, tape_bool, tape_int, tape_double, tape_decimal, tape_string,
+    tape_date, tape_datetime, tape_bytes, tape_regex, tape_ref, tape_duration, tape_custom
+};
+
+static bjson_tape_t* tape_finish(bjson_tape_builder_t* b, int ok) {
+    free(b->open);
+    if (!ok) {
+        bjson_tape_free(b->tape);
+        return NULL;
+    }
+    return b->tape;
+}
+
+// Parse text straight into a tape, without building a tree
+bjson_tape_t* bjson_tape_parse(const char* input, size_t length, unsigned flags, bjson_error_t* error) {
+    bjson_tape_builder_t b = {0};
+    b.tape = calloc(1, sizeof(bjson_tape_t));
+    if (!b.tape) {
+        if (error) *error = BJSON_ERROR_MEMORY;
+        return NULL;
+    }
+    
+    bjson_error_t status = bjson_parse_sax(input, length, flags, &bjson_tape_writer, &b);
+    // The writer only stops when it runs out of memory
+    if (status == BJSON_ERROR_PARTIAL) status = BJSON_ERROR_MEMORY;
+    if (error) *error = status;
+    return tape_finish(&b, status == BJSON_SUCCESS);
+}
+
+static int tape_put_value(bjson_tape_builder_t* b, const bjson_value_t* value) {
+    switch (value->type) {
+        case BJSON_NULL: return tape_null(b);
+        case BJSON_BOOL: return tape_bool(b, value->bool_val);
+        case BJSON_INT: return tape_int(b, value->int_val);
+        case BJSON_DOUBLE: return tape_double(b, value->double_val);
+        case BJSON_STRING: return tape_string(b, value->string_val.data, value->string_val.length);
+        case BJSON_DECIMAL: return tape_decimal(b, value->string_val.data, value->string_val.length);
+        case BJSON_DATE: return tape_date(b, &value->date_val);
+        case BJSON_DATETIME: {
+            bjson_datetime_t datetime;
+            bjson_value_datetime(value, &datetime);
+            return tape_datetime(b, &datetime);
+        }
+        case BJSON_DURATION: return tape_duration(b, &value->duration_val);
+        case BJSON_BYTES: return tape_bytes(b, value->bytes_val.data, value->bytes_val.length);
+        case BJSON_REGEX: return tape_regex(b, value->regex_val.pattern, value->regex_val.flags);
+        case BJSON_REFERENCE: return tape_ref(b, value->ref_val.path);
+        case BJSON_CUSTOM: {
+            size_t length;
+            const uint8_t* payload = bjson_custom_payload(value, &length);
+            return tape_custom(b, value->custom_type, payload, length);
+        }
+        case BJSON_ARRAY:
+            if (tape_open(b, BJSON_ARRAY)) return 1;
+            for (size_t i = 0; i < value->array_val.count; i++) {
+                if (tape_put_value(b, value->array_val.items[i])) return 1;
+            }
+            return tape_close(b, value->array_val.count);
+        case BJSON_SET:
+            if (tape_open(b, BJSON_SET)) return 1;
+            for (size_t i = 0; i < value->set_val->count; i++) {
+                if (tape_put_value(b, value->set_val->values[i])) return 1;
+            }
+            return tape_close(b, value->set_val->count);
+        case BJSON_OBJECT: {
+            const bjson_object_t* obj = value->object_val;
+            if (tape_open(b, BJSON_OBJECT)) return 1;
+            for (size_t i = 0; i < obj->count; i++) {
+                if (tape_put_value(b, obj->keys[i]) || tape_put_value(b, obj->values[i])) return 1;
+            }
+            return tape_close(b, obj->count);
+        }
+        case BJSON_MAP:
+            if (tape_open(b, BJSON_MAP)) return 1;
+            for (size_t i = 0; i < value->map_val->count; i++) {
+                if (tape_put_value(b, value->map_val->keys[i]) || tape_put_value(b, value->map_val->values[i])) return 1;
+            }
+            return tape_close(b, value->map_val->count);
+    }
+    return 1;
+}
+
+// Lay out a value tree as a tape; NULL when out of memory
+bjson_tape_t* bjson_tape_from_value(const bjson_value_t* value) {
+    if (!value) return NULL;
+    
+    bjson_tape_builder_t b = {0};
+    b.tape = calloc(1, sizeof(bjson_tape_t));
+    if (!b.tape) return NULL;
+    return tape_finish(&b, !tape_put_value(&b, value));
+}
+
+void bjson_tape_free(bjson_tape_t* tape) {
+    if (!tape) return;
+    
+    free(tape->words);
+    free(tape->text);
+    free(tape);
+}
+
+// Type of the value at position at (the root is at 0, the first member of
+// a container right after it)
+bjson_type_t bjson_tape_type(const bjson_tape_t* tape, size_t at) {
+    return (bjson_type_t)tape_tag(tape, at);
+}
+
+// Position just past the value at position at; containers are skipped whole
+size_t bjson_tape_next(const bjson_tape_t* tape, size_t at) {
+    switch (tape_tag(tape, at)) {
+        case BJSON_ARRAY:
+        case BJSON_OBJECT:
+        case BJSON_SET:
+        case BJSON_MAP:
+            return (size_t)(tape_payload(tape, at) & 0xFFFFFFFF);
+        case BJSON_INT:
+        case BJSON_DOUBLE:
+        case BJSON_DATETIME:
+        case BJSON_DURATION:
+        case BJSON_REGEX:
+        case BJSON_CUSTOM:
+            return at + 2;
+        default:
+            return at + 1;
+    }
+}
+
+// Position of a container's closing word: members run from at + 1 up to it
+size_t bjson_tape_end(const bjson_tape_t* tape, size_t at) {
+    return bjson_tape_next(tape, at) - 1;
+}
+
+// Member count of a container (pairs for objects and maps)
+size_t bjson_tape_count(const bjson_tape_t* tape, size_t at) {
+    size_t count = (size_t)(tape_payload(tape, at) >> 32);
+    if (count < BJSON_TAPE_MAX_COUNT) return count;
+    
+    // Saturated: count by skipping
+    int keyed = tape_tag(tape, at) == BJSON_OBJECT || tape_tag(tape, at) == BJSON_MAP;
+    size_t end = bjson_tape_end(tape, at);
+    count = 0;
+    for (size_t i = at + 1; i < end; i = bjson_tape_next(tape, i)) count++;
+    return keyed ? count / 2 : count;
+}
+
+// Position of the value of the first member whose key is the given string,
+// in an object or map, or BJSON_TAPE_NONE
+size_t bjson_tape_find(const bjson_tape_t* tape, size_t object, const char* key, size_t length) {
+    int tag = tape_tag(tape, object);
+    if (tag != BJSON_OBJECT && tag != BJSON_MAP) return BJSON_TAPE_NONE;
+    
+    size_t end = bjson_tape_end(tape, object);
+    for (size_t i = object + 1; i < end; ) {
+        size_t value = bjson_tape_next(tape, i);
+        if (tape_tag(tape, i) == BJSON_STRING) {
+            size_t n;
+            const char* text = tape_text(tape, tape_payload(tape, i), &n);
+            if (n == length && memcmp(text, key, length) == 0) return value;
+        }
+        i = bjson_tape_next(tape, value);
+    }
+    return BJSON_TAPE_NONE;
+}
+
+int bjson_tape_bool(const bjson_tape_t* tape, size_t at) {
+    return tape_tag(tape, at) == BJSON_BOOL && tape_payload(tape, at) != 0;
+}
+
+long long bjson_tape_int(const bjson_tape_t* tape, size_t at) {
+    return tape_tag(tape, at) == BJSON_INT ? (long long)tape->words[at + 1] : 0;
+}
+
+// Doubles, and ints converted
+double bjson_tape_double(const bjson_tape_t* tape, size_t at) {
+    if (tape_tag(tape, at) == BJSON_INT) return (double)(long long)tape->words[at + 1];
+    if (tape_tag(tape, at) != BJSON_DOUBLE) return 0.0;
+    
+    double value;
+    memcpy(&value, &tape->words[at + 1], sizeof(value));
+    return value;
+}
+
+// Text of a string, decimal, bytes value, regex pattern, reference path or
+// custom payload, NUL-terminated and valid as long as the tape; NULL for
+// other types
+const char* bjson_tape_string(const bjson_tape_t* tape, size_t at, size_t* length) {
+    switch (tape_tag(tape, at)) {
+        case BJSON_STRING:
+        case BJSON_DECIMAL:
+        case BJSON_BYTES:
+        case BJSON_REGEX:
+        case BJSON_REFERENCE:
+        case BJSON_CUSTOM:
+            return tape_text(tape, tape_payload(tape, at), length);
+        default:
+            return NULL;
+    }
+}
+
+// Replay the value at position at as events; returns 0 when the handler stopped
+static int tape_emit(bjson_parser_t* parser, const bjson_tape_t* tape, size_t at, int is_key) {
+    uint64_t payload = tape_payload(tape, at);
+    size_t length;
+    const char* text;
+    
+    switch (tape_tag(tape, at)) {
+        case BJSON_NULL:
+            return BJSON_SAX_CALL(parser, null_value, (parser->sax_ctx));
+        case BJSON_BOOL:
+            return BJSON_SAX_CALL(parser, bool_value, (parser->sax_ctx, (int)payload));
+        case BJSON_INT:
+            return BJSON_SAX_CALL(parser, int_value, (parser->sax_ctx, bjson_tape_int(tape, at)));
+        case BJSON_DOUBLE:
+            return BJSON_SAX_CALL(parser, double_value, (parser->sax_ctx, bjson_tape_double(tape, at)));
+        case BJSON_STRING:
+            text = tape_text(tape, payload, &length);
+            if (is_key) return BJSON_SAX_CALL(parser, key, (parser->sax_ctx, text, length));
+            return BJSON_SAX_CALL(parser, string_value, (parser->sax_ctx, text, length));
+        case BJSON_DECIMAL:
+            text = tape_text(tape, payload, &length);
+            return BJSON_SAX_CALL(parser, decimal_value, (parser->sax_ctx, text, length));
+        case BJSON_BYTES:
+            text = tape_text(tape, payload, &length);
+            return BJSON_SAX_CALL(parser, bytes_value, (parser->sax_ctx, (const uint8_t*)text, length));
+        case BJSON_REGEX:
+            text = tape_text(tape, payload, NULL);
+            return BJSON_SAX_CALL(parser, regex_value, (parser->sax_ctx, text, tape_text(tape, tape->words[at + 1], NULL)));
+        case BJSON_REFERENCE:
+            return BJSON_SAX_CALL(parser, ref_value, (parser->sax_ctx, tape_text(tape, payload, NULL)));
+        case BJSON_CUSTOM:
+            text = tape_text(tape, payload, &length);
+            return BJSON_SAX_CALL(parser, custom_value, (parser->sax_ctx, (unsigned)tape->words[at + 1],
+                                                         (const uint8_t*)text, length));
+        case BJSON_DATE: {
+            bjson_date_t date;
+            unpack_date(zigzag_decode(payload), &date);
+            return BJSON_SAX_CALL(parser, date_value, (parser->sax_ctx, &date));
+        }
+        case BJSON_DATETIME: {
+            bjson_datetime_t dt;
+            bjson_datetime_packed_t packed;
+            uint64_t tz = payload >> 16;
+            packed.epoch_ms = (int64_t)tape->words[at + 1];
+            packed.offset_minutes = (int16_t)(uint16_t)payload;
+            unpack_datetime(&packed, tz ? (char*)tape_text(tape, tz - 1, NULL) : NULL, &dt);
+            return BJSON_SAX_CALL(parser, datetime_value, (parser->sax_ctx, &dt));
+        }
+        case BJSON_DURATION: {
+            bjson_duration_t duration;
+            duration.months = (int32_t)zigzag_decode(payload);
+            duration.milliseconds = (int64_t)tape->words[at + 1];
+            return BJSON_SAX_CALL(parser, duration_value, (parser->sax_ctx, &duration));
+        }
+        default:
+            break;
+    }
+    
+    int tag = tape_tag(tape, at);
+    int keyed = tag == BJSON_OBJECT || tag == BJSON_MAP;
+    int ok;
+    switch (tag) {
+        case BJSON_OBJECT: ok = BJSON_SAX_CALL(parser, start_object, (parser->sax_ctx)); break;
+        case BJSON_ARRAY: ok = BJSON_SAX_CALL(parser, start_array, (parser->sax_ctx)); break;
+        case BJSON_SET: ok = BJSON_SAX_CALL(parser, start_set, (parser->sax_ctx)); break;
+        default: ok = BJSON_SAX_CALL(parser, start_map, (parser->sax_ctx)); break;
+    }
+    if (!ok) return 0;
+    
+    size_t end = bjson_tape_end(tape, at);
+    size_t members = 0;
+    for (size_t i = at + 1; i < end; i = bjson_tape_next(tape, i)) {
+        if (!tape_emit(parser, tape, i, keyed && members % 2 == 0)) return 0;
+        members++;
+    }
+    if (keyed) members /= 2;
+    switch (tag) {
+        case BJSON_OBJECT: return BJSON_SAX_CALL(parser, end_object, (parser->sax_ctx, members));
+        case BJSON_ARRAY: return BJSON_SAX_CALL(parser, end_array, (parser->sax_ctx, members));
+        case BJSON_SET: return BJSON_SAX_CALL(parser, end_set, (parser->sax_ctx, members));
+        default: return BJSON_SAX_CALL(parser, end_map, (parser->sax_ctx, members));
+    }
+}
+
+// Build a tree from the value at position at. BJSON_PARSE_ARENA and
+// BJSON_PARSE_BORROW_STRINGS apply as for text; borrowed strings point into
+// the tape, which must then outlive the document.
+bjson_document_t* bjson_tape_to_document(const bjson_tape_t* tape, size_t at, unsigned flags, bjson_error_t* error) {
+    if (!tape || at >= tape->count || tape_tag(tape, at) == BJSON_TAPE_END) {
+        if (error) *error = BJSON_ERROR_TYPE;
+        return NULL;
+    }
+    bjson_document_t* doc = document_create(flags, error);
+    if (!doc) return NULL;
+    
+    bjson_parser_t parser = {0};
+    parser.input = tape->text;
+    parser.length = tape->text_length;
+    parser.arena = doc->arena;
+    parser.intern = doc->intern;
+    parser.flags = flags;
+    
+    bjson_builder_t builder = {0};
+    builder.parser = &parser;
+    parser.sax = &bjson_tree_builder;
+    parser.sax_ctx = &builder;
+    if (!tape_emit(&parser, tape, at, 0)) build_discard(&builder);
+    free(builder.stack);
+    free(builder.members);
+    doc->root = builder.root;
+    
+    if (!doc->root) {
+        if (error) *error = BJSON_ERROR_MEMORY;
+        bjson_document_free(doc);
+        return NULL;
+    }
+    if (error) *error = BJSON_SUCCESS;
+    return doc;
+}
+
+// Benchmarks (run with --bench)
+
+static int bench_count_key(void* ctx, const char* data, size_t length) {
+    (void)data;
+    (void)length;
+    (*(size_t*)ctx)++;
+    return 0;
+}
+
+static int bench_count_sink(void* ctx, const char* data, size_t length) {
+    (void)data;
+    *(size_t*)ctx += length;
+    return 0;
+}
+
+static int bench_count_record(void* ctx, const bjson_record_t* record) {
+    *(size_t*)ctx += record->value != NULL;
+    return 0;
+}
+
+// Sink checking streamed output against an expected text
+typedef struct {
+    const char* expected;
+    size_t length;
+    size_t at;
+} bench_compare_t;
+
+static int bench_compare_sink(void* ctx, const char* data, size_t length) {
+    bench_compare_t* compare = ctx;
+    if (length > compare->length - compare->at || memcmp(compare->expected + compare->at, data, length) != 0) return 1;
+    compare->at += length;
+    return 0;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Number of separate heap blocks a malloc-mode tree is made of
+static size_t bench_count_allocations(const bjson_value_t* value) {
+    size_t count = 1;
+    
+    switch (value->type) {
+        case BJSON_STRING:
+        case BJSON_DECIMAL:
+            if (!(value->flags & BJSON_VALUE_BORROWED)) count++;
+            break;
+        case BJSON_ARRAY:
+            if (value->array_val.items) count++;
+            for (size_t i = 0; i < value->array_val.count; i++) {
+                count += bench_count_allocations(value->array_val.items[i]);
+            }
+            break;
+        case BJSON_OBJECT:
+            // Shaped objects own only their values; the shape is the document's
+            count += value->object_val->shape ? 2 : value->object_val->keys ? 2 : 1;
+            if (value->object_val->index && !value->object_val->shape) count++;
+            for (size_t i = 0; i < value->object_val->count; i++) {
+                count += bench_count_allocations(value->object_val->keys[i]);
+                count += bench_count_allocations(value->object_val->values[i]);
+            }
+            break;
+        case BJSON_SET:
+            count += value->set_val->values ? 3 : 1;
+            for (size_t i = 0; i < value->set_val->count; i++) {
+                count += bench_count_allocations(value->set_val->values[i]);
+            }
+            break;
+        case BJSON_MAP:
+            count += value->map_val->keys ? 4 : 1;
+            for (size_t i = 0; i < value->map_val->count; i++) {
+                count += bench_count_allocations(value->map_val->keys[i]);
+                count += bench_count_allocations(value->map_val->values[i]);
+            }
+            break;
+        case BJSON_BYTES:
+            count++;
+            break;
+        case BJSON_CUSTOM:
+            count += value->custom_length > BJSON_CUSTOM_INLINE;
+            break;
+        case BJSON_REGEX:
+            count += 2;
+            break;
+        case BJSON_REFERENCE:
+            count++;
+            break;
+        case BJSON_DATETIME:
+            if (bjson_value_ext(value) && bjson_value_ext(value)->timezone) count++;
+            break;
+        default:
+            break;
+    }
+    
+    return count;
+}
+
+// Sum the ints of a tree, counting its values
+static long long bench_sum_tree(const bjson_value_t* value, size_t* values) {
+    long long sum = 0;
+    (*values)++;
+    switch (value->type) {
+        case BJSON_INT:
+            return value->int_val;
+        case BJSON_ARRAY:
+            for (size_t i = 0; i < value->array_val.count; i++) {
+                sum += bench_sum_tree(value->array_val.items[i], values);
+            }
+            break;
+        case BJSON_OBJECT:
+            for (size_t i = 0; i < value->object_val->count; i++) {
+                sum += bench_sum_tree(value->object_val->keys[i], values);
+                sum += bench_sum_tree(value->object_val->values[i], values);
+            }
+            break;
+        default:
             break;
-        }
     }
+    return sum;
 }
 
-// Parse a string value
-static bjson_value_t* parse_string(bjson_parser_t* parser) {
-    if (parser->pos >= parser->length || parser->input[parser->pos] != '"') {
-        snprintf(parser->error_msg, sizeof(parser->error_msg), 
-                "Expected '\"' at line %d, column %d", parser->line, parser->column);
-        return NULL;
-    }
-    
-    parser->pos++; // Skip opening quote
-    size_t start = parser->pos;
-    size_t len = 0;
-    
-    // Find end of string and calculate length
-    while (parser->pos < parser->length && parser->input[parser->pos] != '"') {
-        if (parser->input[parser->pos] == '\\') {
-            parser->pos++; // Skip escape character
-            if (parser->pos >= parser->length) break;
+// The same over a tape: one linear pass, stepping into containers
+static long long bench_sum_tape(const bjson_tape_t* tape, size_t* values) {
+    long long sum = 0;
+    for (size_t i = 0; i < tape->count; ) {
+        bjson_type_t type = bjson_tape_type(tape, i);
+        if ((int)type == BJSON_TAPE_END) {
+            i++;
+            continue;
         }
-        parser->pos++;
-        len++;
-    }
-    
-    if (parser->pos >= parser->length) {
-        snprintf(parser->error_msg, sizeof(parser->error_msg), 
-                "Unterminated string at line %d", parser->line);
-        return NULL;
+        (*values)++;
+        if (type == BJSON_INT) sum += bjson_tape_int(tape, i);
+        int container = type == BJSON_ARRAY || type == BJSON_OBJECT || type == BJSON_SET || type == BJSON_MAP;
+        i = container ? i + 1 : bjson_tape_next(tape, i);
     }
-    
-    bjson_value_t* value = bjson_create_value(BJSON_STRING);
-    if (!value) return NULL;
-    
-    value->string_val = malloc(len + 1);
-    if (!value->string_val) {
-        bjson_free_value(value);
-        return NULL;
+    return sum;
+}
+
+// Append formatted text to a growable benchmark buffer
+static void bench_append(char** buf, size_t* len, size_t* cap, const char* text) {
+    size_t n = strlen(text);
+    if (*len + n + 1 > *cap) {
+        while (*len + n + 1 > *cap) *cap *= 2;
+        *buf = realloc(*buf, *cap);
     }
+    memcpy(*buf + *len, text, n + 1);
+    *len += n;
+}
+
+// Config-style document: batches of service groups of records
+static char* bench_make_document(int batches, size_t* length) {
+    size_t len = 0, cap = 4096;
+    char* buf = malloc(cap);
+    char record[512];
     
-    // Copy and unescape string
-    size_t j = 0;
-    for (size_t i = start; i < parser->pos; i++) {
-        if (parser->input[i] == '\\' && i + 1 < parser->pos) {
-            i++;
-            switch (parser->input[i]) {
-                case 'n': value->string_val[j++] = '\n'; break;
-                case 't': value->string_val[j++] = '\t'; break;
-                case 'r': value->string_val[j++] = '\r'; break;
-                case '\\': value->string_val[j++] = '\\'; break;
-                case '"': value->string_val[j++] = '"'; break;
-                default: value->string_val[j++] = parser->input[i]; break;
+    buf[0] = '\0';
+    bench_append(&buf, &len, &cap, "[\n");
+    for (int b = 0; b < batches; b++) {
+        bench_append(&buf, &len, &cap, "  {\n");
+        for (int g = 0; g < 10; g++) {
+            snprintf(record, sizeof(record),
+                    "    // Service group %d\n"
+                    "    /* Records are regenerated nightly;\n"
+                    "       edit the source inventory instead. */\n"
+                    "    \"group_%d\": [\n", g, g);
+            bench_append(&buf, &len, &cap, record);
+            for (int r = 0; r < 100; r++) {
+                int id = (b * 10 + g) * 100 + r;
+                snprintf(record, sizeof(record),
+                        "      {\"id\": %d, \"name\": \"service-%d\", \"enabled\": %s, "
+                        "\"weight\": %d.%02d, \"tags\": [\"alpha\", \"beta\", \"gamma\"], "
+                        "\"limits\": {\"cpu\": %d, \"memory\": %d}, \"owner\": null},\n",
+                        id, id, (id % 3) ? "true" : "false", id % 7, id % 100, 1 + id % 8, 256 * (1 + id % 16));
+                bench_append(&buf, &len, &cap, record);
             }
-        } else {
-            value->string_val[j++] = parser->input[i];
+            bench_append(&buf, &len, &cap, "    ],\n");
         }
+        bench_append(&buf, &len, &cap, "  },\n");
     }
-    value->string_val[j] = '\0';
-    
-    parser->pos++; // Skip closing quote
-    parser->column += len + 2;
+    bench_append(&buf, &len, &cap, "]\n");
     
-    return value;
+    *length = len;
+    return buf;
 }
 
-// Parse extended types like @date(...), @bytes(...), etc.
-static bjson_value_t* parse_extended_type(bjson_parser_t* parser, const char* type_name) {
-    if (strcmp(type_name, "date") == 0) {
-        // Parse @date(2024-01-15)
-        bjson_value_t* value = bjson_create_value(BJSON_DATE);
-        // Implementation would parse the date format
-        // For brevity, using placeholder
-        value->date_val.year = 2024;
-        value->date_val.month = 1;
-        value->date_val.day = 15;
-        return value;
-    } else if (strcmp(type_name, "bytes") == 0) {
-        // Parse @bytes(base64:SGVsbG8gV29ybGQ=)
-        bjson_value_t* value = bjson_create_value(BJSON_BYTES);
-        // Implementation would decode base64
-        const char* hello = "Hello World";
-        value->bytes_val.length = strlen(hello);
-        value->bytes_val.data = malloc(value->bytes_val.length);
-        memcpy(value->bytes_val.data, hello, value->bytes_val.length);
-        return value;
-    } else if (strcmp(type_name, "regex") == 0) {
-        // Parse @regex(/pattern/flags)
-        bjson_value_t* value = bjson_create_value(BJSON_REGEX);
-        value->regex_val.pattern = strdup(".*");
-        value->regex_val.flags = strdup("i");
-        return value;
-    } else if (strcmp(type_name, "ref") == 0) {
-        // Parse @ref($.path.to.value)
-        bjson_value_t* value = bjson_create_value(BJSON_REFERENCE);
-        value->ref_val.path = strdup("$.example.path");
-        return value;
+// Copy text to buf with every '#' replaced by number
+static void bench_append_numbered(char** buf, size_t* len, size_t* cap, const char* text, int number) {
+    char digits[16];
+    snprintf(digits, sizeof(digits), "%d", number);
+    char* copy = malloc(strlen(text) + 1);
+    strcpy(copy, text);
+    char* piece = copy;
+    for (char* hash; (hash = strchr(piece, '#')) != NULL; piece = hash + 1) {
+        *hash = '\0';
+        bench_append(buf, len, cap, piece);
+        bench_append(buf, len, cap, digits);
     }
-    
-    snprintf(parser->error_msg, sizeof(parser->error_msg), 
-            "Unknown extended type: %s", type_name);
-    return NULL;
+    bench_append(buf, len, cap, piece);
+    free(copy);
 }
 
-// Main parsing function (simplified for brevity)
-bjson_value_t* bjson_parse(const char* input, bjson_error_t* error) {
-    bjson_parser_t parser = {0};
-    parser.input = input;
-    parser.length = strlen(input);
-    parser.line = 1;
-    parser.column = 1;
+// README.bjson-shaped document of about the same size (13 KB): commented
+// sections of one-off objects with extended types and non-string keys,
+// leaving out the constructs README.bjson itself cannot parse (comment-only
+// values, @type hints, @encrypted and unit-suffixed @bytes)
+static char* bench_make_readme_document(size_t* length) {
+    static const char* const section =
+        "    /* ==========================================\n"
+        "     * SECTION #\n"
+        "     * ========================================== */\n"
+        "    \n"
+        "    \"section#\": {\n"
+        "        \"project#\": {\n"
+        "            \"name\": \"Better JSON\",\n"
+        "            \"version\": \"1.#.0\",\n"
+        "            \"description\": \"Extended JSON format with comments, extended types and flexible keys\",\n"
+        "            \"license\": \"MIT\",\n"
+        "            \"created\": @date(2024-01-15),\n"
+        "        },\n"
+        "        \"extendedTypes#\": {\n"
+        "            // Binary data, collections, patterns and references\n"
+        "            \"birthDate\": @date(1990-05-15),\n"
+        "            \"profilePicture\": @bytes(base64:iVBORw0KGgoAAAANSUhEUgAAAAEAAAABCAYAAAAfFcSJAAAADUlEQVR42mNk+M9QDwADhgGAWjR9awAAAABJRU5ErkJggg==),\n"
+        "            \"secretKey\": @bytes(hex:deadbeef),\n"
+        "            \"uniqueIds\": @set([1, 2, 3, 2, 1]), // deduplicates to [1, 2, 3]\n"
+        "            \"preferences\": @map({\"theme\": \"dark\", \"language\": \"en\", 42: \"answer\", true: \"yes\",}),\n"
+        "            \"emailValidator\": @regex(/^[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\\.[a-zA-Z]{2,}$/i),\n"
+        "            \"userProfile\": @ref($.users[\"john_doe\"]),\n"
+        "        },\n"
+        "        \"flexibleKeys#\": {\n"
+        "            \"userName\": \"john_doe\",\n"
+        "            404: \"Not Found\",\n"
+        "            true: \"Enabled features\",\n"
+        "            {\"type\": \"error\", \"code\": 500}: \"Server error configuration\",\n"
+        "        },\n"
+        "        \"users#\": [\n"
+        "            {\"$id\": \"user_#_1\", \"name\": \"Alice Johnson\", \"email\": \"alice@example.com\",\n"
+        "             \"birthDate\": @date(1985-03-22), \"permissions\": @set([\"read\", \"write\", \"admin\"])},\n"
+        "            {\"$id\": \"user_#_2\", \"name\": \"Bob Smith\", \"email\": \"bob@example.com\",\n"
+        "             \"manager\": @ref($.users[0]), \"permissions\": @set([\"read\", \"write\"])},\n"
+        "        ],\n"
+        "        \"database#\": {\"host\": \"localhost\", \"port\": 5432, \"ssl\": true,\n"
+        "                      \"pool\": {\"min\": 5, \"max\": 20}, \"patterns\": @map({\"error\": @regex(/ERROR|FATAL/i)})},\n"
+        "        \"features#\": [\"Recursive descent parser\", \"Error recovery\", \"Memory efficient\", \"Thread safe\",],\n"
+        "    },\n";
+    size_t len = 0, cap = 16384;
+    char* buf = malloc(cap);
+    buf[0] = '\0';
+    bench_append(&buf, &len, &cap, "{\n    // README-shaped memory fixture\n");
+    for (int i = 0; len < 12 * 1024; i++) bench_append_numbered(&buf, &len, &cap, section, i);
+    bench_append(&buf, &len, &cap, "}\n");
+    *length = len;
+    return buf;
+}
+
+// Heap bytes in use, or 0 where the C library cannot tell
+static size_t bench_heap_in_use(void) {
+#if BJSON_HAVE_MALLINFO2
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// Compare parse+free time and allocation counts of the malloc and arena paths
+static int bjson_benchmark(void) {
+    const int iterations = 200;
+    size_t length;
+    char* input = bench_make_document(1, &length);
     
-    skip_whitespace_and_comments(&parser);
-    bjson_value_t* result = parse_value(&parser);
+    printf("=== Better JSON Benchmark ===\n");
+    printf("Document: %zu bytes, %d iterations\n\n", length, iterations);
     
-    if (!result && error) {
-        *error = BJSON_ERROR_SYNTAX;
-        printf("Parse error: %s\n", parser.error_msg);
-    } else if (error) {
-        *error = BJSON_SUCCESS;
+    const unsigned modes[] = {
+        BJSON_PARSE_DEFAULT,
+        BJSON_PARSE_ARENA,
+        BJSON_PARSE_BORROW_STRINGS,
+        BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS,
+        BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS | BJSON_PARSE_PRESIZE,
+        BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS | BJSON_PARSE_TWO_STAGE,
+        BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS | BJSON_PARSE_SHARE_KEYS
+    };
+    const char* names[] = { "malloc", "arena", "borrow", "arena+borrow", "presized", "two-stage", "shared keys" };
+    
+    for (int m = 0; m < 7; m++) {
+        bjson_error_t error;
+        bjson_document_t* doc = bjson_parse_document(input, length, modes[m], &error);
+        if (!doc) {
+            printf("%-12s parse failed\n", names[m]);
+            free(input);
+            return 1;
+        }
+        
+        // Every allocation path also pays for the document struct
+        size_t allocations = doc->arena ? doc->arena->chunk_count + 2
+                                        : bench_count_allocations(doc->root) + 1;
+        size_t arena_bytes = doc->arena ? doc->arena->bytes_used : 0;
+        bjson_document_free(doc);
+        
+        double start = bench_now();
+        for (int i = 0; i < iterations; i++) {
+            doc = bjson_parse_document(input, length, modes[m], &error);
+            bjson_document_free(doc);
+        }
+        double elapsed = bench_now() - start;
+        
+        printf("%-12s allocations/parse: %8zu   arena bytes: %8zu   parse+free: %8.3f ms   %7.1f MB/s\n",
+               names[m], allocations, arena_bytes, elapsed * 1000.0 / iterations,
+               (double)length * iterations / elapsed / (1024.0 * 1024.0));
     }
     
-    return result;
-}
-
-// Simplified parse_value function
-static bjson_value_t* parse_value(bjson_parser_t* parser) {
-    skip_whitespace_and_comments(parser);
+    // Memory report: tree bytes per value and per GB of input
+    bjson_error_t mem_error;
+    bjson_document_t* mem_doc = bjson_parse_document(input, length, BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS,
+                                                     &mem_error);
+    if (mem_doc) {
+        size_t values = 0;
+        bench_sum_tree(mem_doc->root, &values);
+        printf("memory       node: %zu bytes (+%zu extended)   %zu values   %5.1f bytes/value   %5.2f GB per GB of input\n",
+               sizeof(bjson_value_t), sizeof(bjson_value_ext_t), values,
+               (double)mem_doc->arena->bytes_used / values, (double)mem_doc->arena->bytes_used / length);
+    }
+    bjson_document_free(mem_doc);
     
-    if (parser->pos >= parser->length) return NULL;
+    // The same for a small document of one-off objects: heap bytes a
+    // malloc-mode tree keeps, and arena bytes used
+    size_t readme_length;
+    char* readme = bench_make_readme_document(&readme_length);
+    // A first parse warms the shared regex cache, which outlives documents
+    bjson_document_free(bjson_parse_document(readme, readme_length, BJSON_PARSE_DEFAULT, &mem_error));
+    size_t heap_before = bench_heap_in_use();
+    mem_doc = bjson_parse_document(readme, readme_length, BJSON_PARSE_DEFAULT, &mem_error);
+    size_t heap_tree = bench_heap_in_use() - heap_before;
+    bjson_document_free(mem_doc);
+    const unsigned readme_modes[] = {
+        BJSON_PARSE_ARENA,
+        BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS,
+        BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS | BJSON_PARSE_SHARE_KEYS
+    };
+    size_t readme_arena[3] = {0, 0, 0};
+    for (int m = 0; m < 3; m++) {
+        mem_doc = bjson_parse_document(readme, readme_length, readme_modes[m], &mem_error);
+        if (mem_doc) readme_arena[m] = mem_doc->arena->bytes_used;
+        bjson_document_free(mem_doc);
+    }
+    printf("memory       README-shaped %.1f KB: heap %.1f KB   arena %.1f KB   arena+borrow %.1f KB   "
+           "shared keys %.1f KB\n", readme_length / 1024.0, heap_tree / 1024.0, readme_arena[0] / 1024.0,
+           readme_arena[1] / 1024.0, readme_arena[2] / 1024.0);
+    free(readme);
     
-    char c = parser->input[parser->pos];
+    // Stage 1 of the two-stage parser on its own
+    bjson_parser_t indexer = {0};
+    indexer.input = input;
+    indexer.length = length;
+    size_t positions = 0;
+    double index_start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        if (build_structural_index(&indexer) == BJSON_SUCCESS) positions = indexer.index_count;
+        free((void*)indexer.index);
+        indexer.index = NULL;
+    }
+    double index_elapsed = bench_now() - index_start;
+    printf("%-12s positions/parse:    %8zu   structural index only:  %8.3f ms   %7.1f MB/s\n", "stage 1", positions,
+           index_elapsed * 1000.0 / iterations, (double)length * iterations / index_elapsed / (1024.0 * 1024.0));
     
-    switch (c) {
-        case '"':
-            return parse_string(parser);
-        case '[':
-            return parse_array(parser);
-        case '{':
-            return parse_object(parser);
-        case '@': {
-            // Extended type syntax: @type(...)
-            parser->pos++;
-            size_t start = parser->pos;
-            while (parser->pos < parser->length && 
-                   (isalnum(parser->input[parser->pos]) || parser->input[parser->pos] == '_')) {
-                parser->pos++;
+    // On-demand: index once, then build only four fields of the last record
+    const char* fields[] = { "id", "name", "enabled", "weight" };
+    size_t built = 0;
+    double ondemand_start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        bjson_error_t error;
+        bjson_ondemand_t* od = bjson_ondemand_parse(input, length, BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS, &error);
+        bjson_cursor_t root = bjson_ondemand_root(od), batch, group, record, field;
+        if (bjson_cursor_at(&root, 0, &batch) && bjson_cursor_find(&batch, "group_9", &group) &&
+            bjson_cursor_at(&group, 99, &record)) {
+            for (int f = 0; f < 4; f++) {
+                if (bjson_cursor_find(&record, fields[f], &field) && bjson_cursor_value(&field)) built++;
             }
-            
-            char type_name[32];
-            size_t len = parser->pos - start;
-            if (len >= sizeof(type_name)) len = sizeof(type_name) - 1;
-            strncpy(type_name, &parser->input[start], len);
-            type_name[len] = '\0';
-            
-            return parse_extended_type(parser, type_name);
         }
-        case 't':
-            if (strncmp(&parser->input[parser->pos], "true", 4) == 0) {
-                bjson_value_t* value = bjson_create_value(BJSON_BOOL);
-                value->bool_val = 1;
-                parser->pos += 4;
-                return value;
-            }
-            break;
-        case 'f':
-            if (strncmp(&parser->input[parser->pos], "false", 5) == 0) {
-                bjson_value_t* value = bjson_create_value(BJSON_BOOL);
-                value->bool_val = 0;
-                parser->pos += 5;
-                return value;
-            }
-            break;
-        case 'n':
-            if (strncmp(&parser->input[parser->pos], "null", 4) == 0) {
-                bjson_value_t* value = bjson_create_value(BJSON_NULL);
-                parser->pos += 4;
-                return value;
-            }
-            break;
-        default:
-            if (isdigit(c) || c == '-') {
-                return parse_number(parser);
-            }
-            break;
+        bjson_ondemand_free(od);
     }
+    double ondemand_elapsed = bench_now() - ondemand_start;
+    printf("%-12s values/parse:       %8zu   index + 4 lookups:      %8.3f ms   %7.1f MB/s\n", "on-demand", built / iterations,
+           ondemand_elapsed * 1000.0 / iterations, (double)length * iterations / ondemand_elapsed / (1024.0 * 1024.0));
     
-    snprintf(parser->error_msg, sizeof(parser->error_msg), 
-            "Unexpected character '%c' at line %d, column %d", c, parser->line, parser->column);
-    return NULL;
-}
-
-// Simplified array parsing
-static bjson_value_t* parse_array(bjson_parser_t* parser) {
-    if (parser->pos >= parser->length || parser->input[parser->pos] != '[') {
-        return NULL;
+    // Event stream only: count the keys, no nodes built
+    bjson_sax_handler_t counter = {0};
+    counter.key = bench_count_key;
+    size_t keys = 0;
+    double sax_start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        bjson_parse_sax(input, length, BJSON_PARSE_DEFAULT, &counter, &keys);
     }
+    double sax_elapsed = bench_now() - sax_start;
+    printf("%-12s keys/parse:         %8zu   no nodes built:         %8.3f ms   %7.1f MB/s\n", "sax", keys / iterations,
+           sax_elapsed * 1000.0 / iterations, (double)length * iterations / sax_elapsed / (1024.0 * 1024.0));
     
-    bjson_value_t* array = bjson_create_value(BJSON_ARRAY);
-    parser->pos++; // Skip '['
-    
-    skip_whitespace_and_comments(parser);
-    
-    if (parser->pos < parser->length && parser->input[parser->pos] == ']') {
-        parser->pos++; // Empty array
-        return array;
+    // The same events through the push parser, fed in 4 KB chunks
+    size_t push_keys = 0;
+    double push_start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        bjson_push_parser_t* push = bjson_push_parser_create(BJSON_PARSE_DEFAULT, &counter, &push_keys);
+        for (size_t pos = 0; pos < length; pos += 4096) {
+            bjson_parser_feed(push, input + pos, length - pos < 4096 ? length - pos : 4096);
+        }
+        bjson_parser_finish(push, NULL);
+        bjson_push_parser_free(push);
     }
+    double push_elapsed = bench_now() - push_start;
+    printf("%-12s keys/parse:         %8zu   4 KB chunks:            %8.3f ms   %7.1f MB/s\n", "push", push_keys / iterations,
+           push_elapsed * 1000.0 / iterations, (double)length * iterations / push_elapsed / (1024.0 * 1024.0));
     
-    while (parser->pos < parser->length) {
-        bjson_value_t* item = parse_value(parser);
-        if (!item) {
-            bjson_free_value(array);
-            return NULL;
+    // Whitespace/comment skipping in isolation: stop on every token byte
+    void (*skips[])(bjson_parser_t*) = {
+        skip_whitespace_and_comments_scalar,
+        skip_whitespace_and_comments
+    };
+    const char* skip_names[] = { "scalar", "dispatched" };
+    
+    printf("\n");
+    for (size_t k = 0; k < sizeof(skips) / sizeof(skips[0]); k++) {
+        double start = bench_now();
+        for (int i = 0; i < iterations; i++) {
+            bjson_parser_t parser = {0};
+            parser.input = input;
+            parser.length = length;
+            parser.line = 1;
+            parser.column = 1;
+            while (parser.pos < parser.length) {
+                skips[k](&parser);
+                parser.pos++;
+            }
         }
+        double elapsed = bench_now() - start;
         
-        // Add to array (simplified - should resize if needed)
-        if (array->array_val.count < array->array_val.capacity) {
-            array->array_val.items[array->array_val.count++] = item;
+        printf("skip %-10s %8.3f ms   %7.1f MB/s\n", skip_names[k], elapsed * 1000.0 / iterations,
+               (double)length * iterations / elapsed / (1024.0 * 1024.0));
+    }
+    
+    // Number conversion: metrics-style doubles and integers, against strtod
+    size_t numbers_len = 0, numbers_cap = 4096;
+    char* numbers = malloc(numbers_cap);
+    char number[64];
+    numbers[0] = '\0';
+    for (int i = 0; i < 100000; i++) {
+        if (i % 2) {
+            snprintf(number, sizeof(number), "%d,", i * 7919);
+        } else {
+            snprintf(number, sizeof(number), "%.*f,", 1 + i % 9, (i * 0.61803398875) - 20000.0);
         }
-        
-        skip_whitespace_and_comments(parser);
-        
-        if (parser->pos >= parser->length) break;
-        
-        if (parser->input[parser->pos] == ']') {
-            parser->pos++;
-            break;
-        } else if (parser->input[parser->pos] == ',') {
-            parser->pos++;
-            skip_whitespace_and_comments(parser);
-            // Allow trailing comma
-            if (parser->pos < parser->length && parser->input[parser->pos] == ']') {
-                parser->pos++;
-                break;
+        bench_append(&numbers, &numbers_len, &numbers_cap, number);
+    }
+    
+    double number_times[2];
+    double checksum[2] = {0.0, 0.0};
+    for (int k = 0; k < 2; k++) {
+        double start = bench_now();
+        for (int i = 0; i < 20; i++) {
+            bjson_parser_t parser = {0};
+            parser.input = numbers;
+            parser.length = numbers_len;
+            parser.line = 1;
+            while (parser.pos < parser.length) {
+                if (k == 0) {
+                    char* endptr;
+                    checksum[k] += strtod(numbers + parser.pos, &endptr);
+                    parser.pos = (size_t)(endptr - numbers);
+                } else {
+                    bjson_number_t value;
+                    scan_number(&parser, &value);
+                    checksum[k] += value.type == BJSON_INT ? (double)value.int_val : value.double_val;
+                }
+                parser.pos++; // Skip ','
             }
         }
+        number_times[k] = bench_now() - start;
     }
+    printf("\nnumbers strtod      %8.3f ms\nnumbers scan_number %8.3f ms   (checksums %s)\n",
+           number_times[0] * 1000.0 / 20, number_times[1] * 1000.0 / 20,
+           checksum[0] == checksum[1] ? "match" : "DIFFER");
+    free(numbers);
     
-    return array;
-}
-
-// Simplified object parsing
-static bjson_value_t* parse_object(bjson_parser_t* parser) {
-    if (parser->pos >= parser->length || parser->input[parser->pos] != '{') {
-        return NULL;
+    // Key lookup in a feature-flag style object, indexed vs plain scan
+    size_t flags_len = 0, flags_cap = 4096;
+    char* flags_doc = malloc(flags_cap);
+    flags_doc[0] = '\0';
+    bench_append(&flags_doc, &flags_len, &flags_cap, "{");
+    for (int i = 0; i < 500; i++) {
+        snprintf(number, sizeof(number), "\"feature.flag_%d\": %s,", i, (i % 2) ? "true" : "false");
+        bench_append(&flags_doc, &flags_len, &flags_cap, number);
     }
+    bench_append(&flags_doc, &flags_len, &flags_cap, "}");
     
-    bjson_value_t* object = bjson_create_value(BJSON_OBJECT);
-    parser->pos++; // Skip '{'
+    bjson_error_t flags_error;
+    bjson_document_t* flags = bjson_parse_document(flags_doc, flags_len, BJSON_PARSE_ARENA, &flags_error);
+    if (flags) {
+        double lookup_times[2];
+        size_t found[2] = {0, 0};
+        bjson_object_t unindexed = *flags->root->object_val;
+        unindexed.index = NULL;
+        for (int k = 0; k < 2; k++) {
+            double start = bench_now();
+            for (int i = 0; i < 200000; i++) {
+                int len = snprintf(number, sizeof(number), "feature.flag_%d", (i * 7) % 500);
+                found[k] += k ? bjson_object_get_n(flags->root, number, (size_t)len) != NULL
+                              : object_find(&unindexed, number, (size_t)len) >= 0;
+            }
+            lookup_times[k] = bench_now() - start;
+        }
+        printf("\nlookup 500 keys scan  %8.1f ns   (%zu found)\nlookup 500 keys index %8.1f ns   (%zu found)\n",
+               lookup_times[0] * 1e9 / 200000, found[0], lookup_times[1] * 1e9 / 200000, found[1]);
+        bjson_document_free(flags);
+    }
+    free(flags_doc);
     
-    skip_whitespace_and_comments(parser);
+    // One field of every record, looked up per object and through a
+    // shape cache (the records share one shape)
+    bjson_document_t* shared = bjson_parse_document(input, length, BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS |
+                                                    BJSON_PARSE_SHARE_KEYS, &flags_error);
+    if (shared) {
+        const bjson_value_t* batch = shared->root->array_val.items[0];
+        double field_times[2];
+        double weights[2] = {0.0, 0.0};
+        for (int k = 0; k < 2; k++) {
+            bjson_key_cache_t cache = {0};
+            double start = bench_now();
+            for (int it = 0; it < iterations; it++) {
+                for (size_t g = 0; g < batch->object_val->count; g++) {
+                    const bjson_value_t* group = batch->object_val->values[g];
+                    for (size_t r = 0; r < group->array_val.count; r++) {
+                        const bjson_value_t* record = group->array_val.items[r];
+                        const bjson_value_t* weight = k ? bjson_object_get_cached(record, "weight", 6, &cache)
+                                                        : bjson_object_get_n(record, "weight", 6);
+                        weights[k] += weight->double_val;
+                    }
+                }
+            }
+            field_times[k] = bench_now() - start;
+        }
+        printf("\nfield of 1000 records get_n    %8.1f ns/record\nfield of 1000 records cached   %8.1f ns/record   (sums %s)\n",
+               field_times[0] * 1e9 / (iterations * 1000.0), field_times[1] * 1e9 / (iterations * 1000.0),
+               weights[0] == weights[1] ? "match" : "DIFFER");
+        bjson_document_free(shared);
+    }
     
-    if (parser->pos < parser->length && parser->input[parser->pos] == '}') {
-        parser->pos++; // Empty object
-        return object;
+    // Deduplicating a large permission set: 20000 entries, 5000 distinct
+    size_t perms_len = 0, perms_cap = 4096;
+    char* perms_doc = malloc(perms_cap);
+    perms_doc[0] = '\0';
+    bench_append(&perms_doc, &perms_len, &perms_cap, "@set([");
+    for (int i = 0; i < 20000; i++) {
+        snprintf(number, sizeof(number), "\"perm.resource_%d:read\",", (i * 7919) % 5000);
+        bench_append(&perms_doc, &perms_len, &perms_cap, number);
     }
+    bench_append(&perms_doc, &perms_len, &perms_cap, "])");
     
-    while (parser->pos < parser->length) {
-        // Parse key (can be string, number, or boolean in Better JSON)
-        bjson_value_t* key = parse_value(parser);
-        if (!key) {
-            bjson_free_value(object);
-            return NULL;
-        }
-        
-        skip_whitespace_and_comments(parser);
-        
-        if (parser->pos >= parser->length || parser->input[parser->pos] != ':') {
-            bjson_free_value(key);
-            bjson_free_value(object);
-            return NULL;
-        }
-        parser->pos++; // Skip ':'
-        
-        skip_whitespace_and_comments(parser);
-        
-        bjson_value_t* value = parse_value(parser);
-        if (!value) {
-            bjson_free_value(key);
-            bjson_free_value(object);
-            return NULL;
-        }
-        
-        // Add to object (simplified)
-        if (object->object_val->count < object->object_val->capacity) {
-            object->object_val->pairs[object->object_val->count].key = key;
-            object->object_val->pairs[object->object_val->count].value = value;
-            object->object_val->count++;
+    double start = bench_now();
+    bjson_error_t perms_error;
+    bjson_document_t* perms = bjson_parse_document(perms_doc, perms_len, BJSON_PARSE_ARENA, &perms_error);
+    if (perms) {
+        printf("\n@set dedup 20000 -> %zu  %8.3f ms\n", perms->root->set_val->count, (bench_now() - start) * 1000.0);
+        bjson_document_free(perms);
+    }
+    free(perms_doc);
+    
+    // Serialization of the benchmark document: buffer (compact, pretty) and sink
+    bjson_error_t ser_error;
+    bjson_document_t* ser_doc = bjson_parse_document(input, length, BJSON_PARSE_ARENA, &ser_error);
+    if (ser_doc) {
+        printf("\n");
+        for (int mode = 0; mode < 3; mode++) {
+            size_t out_bytes = 0;
+            start = bench_now();
+            for (int i = 0; i < iterations; i++) {
+                if (mode < 2) {
+                    char* out = bjson_serialize(ser_doc->root, mode);
+                    out_bytes = strlen(out);
+                    free(out);
+                } else {
+                    out_bytes = 0;
+                    bjson_serialize_to(ser_doc->root, 0, bench_count_sink, &out_bytes);
+                }
+            }
+            double elapsed = bench_now() - start;
+            printf("serialize %-8s %8.3f ms   %7.1f MB/s   (%zu bytes)\n",
+                   mode == 0 ? "compact" : mode == 1 ? "pretty" : "sink", elapsed * 1000.0 / iterations,
+                   (double)out_bytes * iterations / elapsed / (1024.0 * 1024.0), out_bytes);
         }
+        bjson_document_free(ser_doc);
+    }
+    
+    // Binary round trip of the benchmark document against the text parse
+    ser_doc = bjson_parse_document(input, length, BJSON_PARSE_DEFAULT, &ser_error);
+    size_t bin_length = 0;
+    uint8_t* bin = ser_doc ? bjson_binary_encode(ser_doc->root, &bin_length) : NULL;
+    if (bin) {
+        start = bench_now();
+        for (int i = 0; i < iterations; i++) free(bjson_binary_encode(ser_doc->root, &bin_length));
+        double encode_time = bench_now() - start;
         
-        skip_whitespace_and_comments(parser);
-        
-        if (parser->pos >= parser->length) break;
-        
-        if (parser->input[parser->pos] == '}') {
-            parser->pos++;
-            break;
-        } else if (parser->input[parser->pos] == ',') {
-            parser->pos++;
-            skip_whitespace_and_comments(parser);
-            // Allow trailing comma
-            if (parser->pos < parser->length && parser->input[parser->pos] == '}') {
-                parser->pos++;
-                break;
+        printf("\nbinary encode       %8.3f ms   (%zu bytes, text %zu)\n",
+               encode_time * 1000.0 / iterations, bin_length, length);
+        for (int m = 0; m < 2; m++) {
+            unsigned flags = m ? BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS : BJSON_PARSE_DEFAULT;
+            start = bench_now();
+            for (int i = 0; i < iterations; i++) {
+                bjson_document_free(bjson_binary_decode(bin, bin_length, flags, &ser_error));
             }
+            printf("binary decode %-5s %8.3f ms\n", m ? "arena" : "heap",
+                   (bench_now() - start) * 1000.0 / iterations);
         }
+        free(bin);
     }
+    bjson_document_free(ser_doc);
     
-    return object;
-}
-
-// Simplified number parsing
-static bjson_value_t* parse_number(bjson_parser_t* parser) {
-    size_t start = parser->pos;
-    
-    if (parser->input[parser->pos] == '-') {
-        parser->pos++;
+    // Tape layout against the arena tree: memory, parse time and a full traversal
+    bjson_document_t* tree = bjson_parse_document(input, length, BJSON_PARSE_ARENA, &ser_error);
+    bjson_tape_t* tape = bjson_tape_parse(input, length, BJSON_PARSE_DEFAULT, &ser_error);
+    if (tree && tape) {
+        size_t tree_values = 0, tape_values = 0;
+        long long tree_sum = 0, tape_sum = 0;
+        start = bench_now();
+        for (int i = 0; i < iterations; i++) tree_sum += bench_sum_tree(tree->root, &tree_values);
+        double tree_walk = bench_now() - start;
+        start = bench_now();
+        for (int i = 0; i < iterations; i++) tape_sum += bench_sum_tape(tape, &tape_values);
+        double tape_walk = bench_now() - start;
+        start = bench_now();
+        for (int i = 0; i < iterations; i++) bjson_tape_free(bjson_tape_parse(input, length, BJSON_PARSE_DEFAULT, &ser_error));
+        double tape_parse = bench_now() - start;
+        
+        size_t tape_bytes = tape->count * sizeof(uint64_t) + tape->text_length;
+        tree_values /= iterations;
+        printf("\ntree (arena)  %8zu bytes  %5.1f bytes/value   traverse %7.3f ms\n", tree->arena->bytes_used,
+               (double)tree->arena->bytes_used / tree_values, tree_walk * 1000.0 / iterations);
+        printf("tape          %8zu bytes  %5.1f bytes/value   traverse %7.3f ms   parse %7.3f ms%s\n", tape_bytes,
+               (double)tape_bytes / tree_values, tape_walk * 1000.0 / iterations, tape_parse * 1000.0 / iterations,
+               tree_sum == tape_sum && tree_values == tape_values / iterations ? "" : "   MISMATCH");
     }
+    bjson_tape_free(tape);
+    bjson_document_free(tree);
     
-    while (parser->pos < parser->length && isdigit(parser->input[parser->pos])) {
-        parser->pos++;
+    // File parsing: read into a heap buffer then parse, against parsing the mapping
+    size_t file_length;
+    char* file_input = bench_make_document(20, &file_length);
+    char file_path[] = "/tmp/bjson-bench-XXXXXX";
+    int fd = mkstemp(file_path);
+    if (fd >= 0 && write(fd, file_input, file_length) == (ssize_t)file_length) {
+        const unsigned file_flags = BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS;
+        double file_times[2];
+        for (int k = 0; k < 2; k++) {
+            start = bench_now();
+            for (int i = 0; i < 10; i++) {
+                bjson_error_t file_error;
+                if (k) {
+                    bjson_document_free(bjson_parse_file(file_path, file_flags, &file_error));
+                    continue;
+                }
+                FILE* fp = fopen(file_path, "rb");
+                char* copy = malloc(file_length + 1);
+                size_t got = fread(copy, 1, file_length, fp);
+                fclose(fp);
+                copy[got] = '\0';
+                bjson_document_t* doc = bjson_parse_document(copy, strlen(copy), file_flags, &file_error);
+                bjson_document_free(doc);
+                free(copy);
+            }
+            file_times[k] = bench_now() - start;
+        }
+        printf("\nfile %zu bytes: read+parse %8.3f ms   mmap parse %8.3f ms\n", file_length,
+               file_times[0] * 100.0, file_times[1] * 100.0);
     }
+    if (fd >= 0) {
+        close(fd);
+        unlink(file_path);
+    }
+    free(file_input);
     
-    int is_float = 0;
-    if (parser->pos < parser->length && parser->input[parser->pos] == '.') {
-        is_float = 1;
-        parser->pos++;
-        while (parser->pos < parser->length && isdigit(parser->input[parser->pos])) {
-            parser->pos++;
+    // Record streams: many small lines, one parse per line against the stream
+    const size_t record_count = 200000;
+    size_t records_capacity = record_count * 96;
+    char* records = malloc(records_capacity);
+    size_t records_length = 0;
+    for (size_t r = 0; records && r < record_count; r++) {
+        records_length += (size_t)snprintf(records + records_length, records_capacity - records_length,
+                                           "{\"id\": %zu, \"user\": \"u%zu\", \"tags\": [\"a\", \"b\"], \"score\": %zu.5, \"ok\": true}\n",
+                                           r, r % 977, r % 100);
+    }
+    if (records) {
+        printf("\n");
+        for (int k = 0; k < 5; k++) {
+            unsigned flags = (k & 1) ? BJSON_PARSE_ARENA | BJSON_PARSE_BORROW_STRINGS : BJSON_PARSE_DEFAULT;
+            size_t parsed = 0;
+            start = bench_now();
+            if (k < 2) {
+                for (size_t pos = 0; pos < records_length;) {
+                    const char* newline = memchr(records + pos, '\n', records_length - pos);
+                    size_t line_length = (size_t)(newline - records) - pos;
+                    bjson_error_t record_error;
+                    bjson_document_t* doc = bjson_parse_document(records + pos, line_length, flags, &record_error);
+                    parsed += doc != NULL;
+                    bjson_document_free(doc);
+                    pos += line_length + 1;
+                }
+            } else if (k == 4) {
+                bjson_parse_records_parallel(records, records_length, flags, 0, bench_count_record, &parsed);
+            } else {
+                bjson_record_stream_t* stream = bjson_record_stream_open(records, records_length, flags);
+                bjson_record_t record;
+                while (bjson_record_stream_next(stream, &record)) parsed += record.value != NULL;
+                bjson_record_stream_close(stream);
+            }
+            double elapsed = bench_now() - start;
+            printf("records %-6s %-5s %8zu   %7.1f ns/record   %7.1f MB/s\n", k < 2 ? "split" : k < 4 ? "stream" : "pool",
+                   (k & 1) || k == 4 ? "arena" : "heap", parsed, elapsed * 1e9 / record_count,
+                   (double)records_length / elapsed / (1024.0 * 1024.0));
         }
+        free(records);
     }
     
-    char* endptr;
-    bjson_value_t* value;
+    // Shortest round-trip double formatting against printf("%.17g")
+    double format_times[2];
+    size_t format_bytes[2] = {0, 0};
+    for (int k = 0; k < 2; k++) {
+        bjson_writer_t w = {0};
+        start = bench_now();
+        for (int i = 0; i < 200000; i++) {
+            double d = (double)(i * 7919 % 100003) / 1024.0 + i * 1e-7;
+            if (k) {
+                write_double(&w, d);
+            } else {
+                char* out = writer_reserve(&w, 32);
+                if (out) w.length += (size_t)snprintf(out, 32, "%.17g", d);
+            }
+            format_bytes[k] += w.length;
+            w.length = 0;
+        }
+        format_times[k] = bench_now() - start;
+        free(w.data);
+    }
+    printf("\ndoubles %%.17g       %8.1f ns   (%zu bytes)\ndoubles shortest    %8.1f ns   (%zu bytes)\n",
+           format_times[0] * 1e9 / 200000, format_bytes[0], format_times[1] * 1e9 / 200000, format_bytes[1]);
     
-    if (is_float) {
-        value = bjson_create_value(BJSON_DOUBLE);
-        value->double_val = strtod(&parser->input[start], &endptr);
-    } else {
-        value = bjson_create_value(BJSON_INT);
-        value->int_val = strtoll(&parser->input[start], &endptr, 10);
+    // Datetime payloads: SWAR field decoding against sscanf, both to epoch ms
+    char stamps[64][32];
+    for (int i = 0; i < 64; i++) {
+        snprintf(stamps[i], sizeof(stamps[i]), "%04d-%02d-%02dT%02d:%02d:%02d.%03d%c%02d:00",
+                 1990 + i % 40, 1 + i % 12, 1 + i % 28, i % 24, i % 60, (i * 7) % 60, i * 13 % 1000,
+                 i & 1 ? '+' : '-', i % 12);
     }
+    double stamp_times[2];
+    int64_t stamp_sums[2] = {0, 0};
+    for (int k = 0; k < 2; k++) {
+        start = bench_now();
+        for (int i = 0; i < 200000; i++) {
+            const char* text = stamps[i & 63];
+            bjson_datetime_t dt;
+            if (k) {
+                if (!scan_datetime(text, text + strlen(text), &dt)) continue;
+            } else {
+                char sign;
+                int offset_hours, offset_minutes;
+                if (sscanf(text, "%4d-%2d-%2dT%2d:%2d:%2d.%3d%c%2d:%2d", &dt.date.year, &dt.date.month, &dt.date.day,
+                           &dt.hour, &dt.minute, &dt.second, &dt.millisecond, &sign,
+                           &offset_hours, &offset_minutes) != 10) {
+                    continue;
+                }
+                dt.offset_minutes = (sign == '-' ? -1 : 1) * (offset_hours * 60 + offset_minutes);
+            }
+            stamp_sums[k] += pack_datetime(&dt).epoch_ms;
+        }
+        stamp_times[k] = bench_now() - start;
+    }
+    printf("\ndatetimes sscanf     %8.1f ns\ndatetimes SWAR       %8.1f ns   (%s)\n", stamp_times[0] * 1e9 / 200000,
+           stamp_times[1] * 1e9 / 200000, stamp_sums[0] == stamp_sums[1] ? "epochs match" : "EPOCHS DIFFER");
     
-    return value;
-}
-
-// Serialization function
-char* bjson_serialize(bjson_value_t* value, int pretty) {
-    if (!value) return NULL;
+    // Base64 @bytes payloads: scalar code against the dispatched SIMD codec
+    size_t blob_length = 4 << 20;
+    uint8_t* blob = malloc(blob_length);
+    char* blob_text = malloc((blob_length + 2) / 3 * 4);
+    uint8_t* blob_out = malloc(blob_length);
+    if (blob && blob_text && blob_out) {
+        for (size_t i = 0; i < blob_length; i++) blob[i] = (uint8_t)(i * 2654435761u >> 13);
+        size_t text_length = base64_encode_scalar(blob, blob_length, blob_text);
+        size_t decoded_length;
+        double codec_times[4];
+        int codec_ok = base64_measure(blob_text, &text_length, &decoded_length) && decoded_length == blob_length;
+        for (int k = 0; k < 4; k++) {
+            start = bench_now();
+            for (int i = 0; i < 10; i++) {
+                if (k == 0) base64_encode_scalar(blob, blob_length, blob_text);
+                if (k == 1) base64_encode(blob, blob_length, blob_text);
+                if (k == 2) codec_ok &= base64_decode_scalar(blob_text, text_length, blob_out);
+                if (k == 3) codec_ok &= base64_decode(blob_text, text_length, blob_out);
+            }
+            codec_times[k] = (bench_now() - start) / 10;
+        }
+        codec_ok &= memcmp(blob, blob_out, blob_length) == 0;
+        printf("\nbase64 encode scalar %8.1f MB/s\nbase64 encode SIMD   %8.1f MB/s\n"
+               "base64 decode scalar %8.1f MB/s\nbase64 decode SIMD   %8.1f MB/s   (%s)\n",
+               blob_length / codec_times[0] / (1024.0 * 1024.0), blob_length / codec_times[1] / (1024.0 * 1024.0),
+               blob_length / codec_times[2] / (1024.0 * 1024.0), blob_length / codec_times[3] / (1024.0 * 1024.0),
+               codec_ok ? "bytes match" : "BYTES DIFFER");
+        
+        // The same payload as @bytes streamed through a sink, far past one
+        // writer chunk, against the buffered serializer
+        bjson_value_t bytes = {0};
+        bytes.type = BJSON_BYTES;
+        bytes.bytes_val.data = blob;
+        bytes.bytes_val.length = blob_length;
+        char* expected = bjson_serialize(&bytes, 0);
+        if (expected) {
+            bench_compare_t compare = { expected, strlen(expected), 0 };
+            start = bench_now();
+            bjson_error_t streamed = bjson_serialize_to(&bytes, 0, bench_compare_sink, &compare);
+            double elapsed = bench_now() - start;
+            printf("@bytes sink stream   %8.1f MB/s   (%s)\n", blob_length / elapsed / (1024.0 * 1024.0),
+                   streamed == BJSON_SUCCESS && compare.at == compare.length ? "output matches" : "OUTPUT DIFFERS");
+            free(expected);
+        }
+    }
+    free(blob);
+    free(blob_text);
+    free(blob_out);
     
-    // Simplified serialization - would need full implementation
-    switch (value->type) {
-        case BJSON_NULL:
-            return strdup("null");
-        case BJSON_BOOL:
-            return strdup(value->bool_val ? "true" : "false");
-        case BJSON_STRING: {
-            size_t len = strlen(value->string_val) + 3;
-            char* result = malloc(len);
-            snprintf(result, len, "\"%s\"", value->string_val);
-            return result;
+    // Extended type names: copy and strcmp chain against the length and
+    // first-byte switch
+    static const char* const type_names[] = {"date", "datetime", "bytes", "set", "map", "regex", "ref", "duration"};
+    double dispatch_times[2];
+    long dispatch_sums[2] = {0, 0};
+    for (int k = 0; k < 2; k++) {
+        start = bench_now();
+        for (int i = 0; i < 4000000; i++) {
+            const char* name = type_names[(i * 5) & 7];
+            size_t length = strlen(name);
+            if (k) {
+                dispatch_sums[k] += builtin_type(name, length);
+                continue;
+            }
+            char copy[32];
+            memcpy(copy, name, length);
+            copy[length] = '\0';
+            static const struct { const char* name; bjson_type_t type; } chain[] = {
+                {"set", BJSON_SET}, {"map", BJSON_MAP}, {"date", BJSON_DATE}, {"datetime", BJSON_DATETIME},
+                {"duration", BJSON_DURATION}, {"bytes", BJSON_BYTES}, {"regex", BJSON_REGEX},
+                {"ref", BJSON_REFERENCE}
+            };
+            for (size_t j = 0; j < sizeof(chain) / sizeof(chain[0]); j++) {
+                if (strcmp(copy, chain[j].name) == 0) {
+                    dispatch_sums[k] += chain[j].type;
+                    break;
+                }
+            }
         }
-        case BJSON_DATE: {
-            char* result = malloc(32);
-            snprintf(result, 32, "@date(%04d-%02d-%02d)", 
-                    value->date_val.year, value->date_val.month, value->date_val.day);
-            return result;
+        dispatch_times[k] = bench_now() - start;
+    }
+    printf("\ntype names strcmp    %8.1f ns\ntype names switch    %8.1f ns   (%s)\n", dispatch_times[0] * 1e9 / 4000000,
+           dispatch_times[1] * 1e9 / 4000000, dispatch_sums[0] == dispatch_sums[1] ? "types match" : "TYPES DIFFER");
+    
+    // Reloading a logging config and matching each pattern once: compiling
+    // per match against the shared regex cache
+    const char* patterns_text = "{\"error\": @regex(/ERROR|FATAL/i), \"warning\": @regex(/WARN/i), "
+                                "\"request\": @regex(/^\\[[0-9:]+\\] (GET|POST) \\/api\\/v[0-9]+\\//), "
+                                "\"slow\": @regex(/took [(]?[0-9]+ms[)]?, warning: \"?slow/), "
+                                "\"quoted\": @regex(/it's|'[a-z]+'/)}";
+    const char* log_line = "[12:00:01] GET /api/v2/users took 12ms, warning: slow";
+    double regex_times[2];
+    int regex_matches[2] = {0, 0};
+    for (int k = 0; k < 2; k++) {
+        start = bench_now();
+        for (int i = 0; i < 2000; i++) {
+            bjson_document_t* config = bjson_parse_document(patterns_text, strlen(patterns_text),
+                                                            BJSON_PARSE_ARENA, NULL);
+            if (!config) break;
+            for (size_t j = 0; j < config->root->object_val->count; j++) {
+                const bjson_value_t* regex = config->root->object_val->values[j];
+                if (k) {
+                    regex_matches[k] += bjson_regex_match(regex, log_line) == 1;
+                    continue;
+                }
+                char* translated = regex_translate(regex->regex_val.pattern, NULL);
+                regex_t compiled;
+                int cflags = REG_EXTENDED | REG_NOSUB | (strchr(regex->regex_val.flags, 'i') ? REG_ICASE : 0);
+                if (translated && regcomp(&compiled, translated, cflags) == 0) {
+                    regex_matches[k] += regexec(&compiled, log_line, 0, NULL, 0) == 0;
+                    regfree(&compiled);
+                }
+                free(translated);
+            }
+            bjson_document_free(config);
         }
-        case BJSON_BYTES:
-            return strdup("@bytes(base64:SGVsbG8gV29ybGQ=)");
-        case BJSON_REGEX:
-            return strdup("@regex(/pattern/flags)");
-        case BJSON_REFERENCE: {
-            size_t len = strlen(value->ref_val.path) + 8;
-            char* result = malloc(len);
-            snprintf(result, len, "@ref(%s)", value->ref_val.path);
-            return result;
+        regex_times[k] = bench_now() - start;
+    }
+    
+    // The text parser, the structural index and the push lexer must end
+    // each @regex payload at the same byte, quotes and parentheses included
+    char* pattern_forms[3] = {NULL, NULL, NULL};
+    size_t patterns_length = strlen(patterns_text);
+    for (int k = 0; k < 3; k++) {
+        bjson_document_t* config = NULL;
+        if (k < 2) {
+            config = bjson_parse_document(patterns_text, patterns_length, k ? BJSON_PARSE_TWO_STAGE : 0, NULL);
+        } else {
+            bjson_push_parser_t* push = bjson_push_parser_create(BJSON_PARSE_DEFAULT, NULL, NULL);
+            for (size_t pos = 0; pos < patterns_length; pos += 3) {
+                bjson_parser_feed(push, patterns_text + pos, patterns_length - pos < 3 ? patterns_length - pos : 3);
+            }
+            bjson_parser_finish(push, &config);
+            bjson_push_parser_free(push);
         }
-        default:
-            return strdup("{}");
+        if (config) pattern_forms[k] = bjson_serialize(config->root, 0);
+        bjson_document_free(config);
     }
+    int payloads_agree = pattern_forms[0] && pattern_forms[1] && pattern_forms[2] &&
+                         strcmp(pattern_forms[0], pattern_forms[1]) == 0 && strcmp(pattern_forms[0], pattern_forms[2]) == 0;
+    for (int k = 0; k < 3; k++) free(pattern_forms[k]);
+    printf("\nregex compile/match  %8.1f us\nregex cached match   %8.1f us   (%s, %s)\n", regex_times[0] * 1e6 / 2000,
+           regex_times[1] * 1e6 / 2000, regex_matches[0] == regex_matches[1] ? "matches agree" : "MATCHES DIFFER",
+           payloads_agree ? "payloads agree" : "PAYLOADS DIFFER");
+    
+    free(input);
+    return 0;
 }
 
 // Example usage and demonstration
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return bjson_benchmark();
+    }
+    
     printf("=== Better JSON Parser Demo ===\n\n");
     
     // Example 1: Basic Better JSON with comments and trailing commas
@@ -718,6 +10818,9 @@ int main() {
         "    \"lastLogin\": @datetime(2024-01-15T14:30:00Z),\n"
         "    \"avatar\": @bytes(base64:SGVsbG8gV29ybGQ=),\n"
         "    \"emailPattern\": @regex(/^[\\w\\.-]+@[\\w\\.-]+\\.[a-zA-Z]{2,}$/i),\n"
+        "    \"quotePattern\": @regex(/it's \"[^\"]*\"/),\n"
+        "    \"parenPattern\": @regex(/^[(][0-9]+[)]$/),\n"
+        "    \"classPattern\": @regex(/^[\\w\\s\\-\\]]+$/),\n"
         "    \"profileRef\": @ref($.users.profiles[\"user123\"]),\n"
         "}\n";
     
@@ -726,9 +10829,26 @@ int main() {
     bjson_value_t* parsed2 = bjson_parse(example2, &error);
     if (parsed2) {
         printf("✓ Extended types parsed successfully!\n");
+        // Quotes and parentheses inside a pattern are part of it
+        int quote_match = bjson_regex_match(bjson_object_get(parsed2, "quotePattern"), "it's \"here\"");
+        int paren_match = bjson_regex_match(bjson_object_get(parsed2, "parenPattern"), "(42)");
+        printf("%s @regex payloads with quotes and parentheses match\n",
+               quote_match == 1 && paren_match == 1 ? "✓" : "✗");
+        // Class escapes inside brackets keep their meaning
+        const bjson_value_t* class_pattern = bjson_object_get(parsed2, "classPattern");
+        int class_match = bjson_regex_match(class_pattern, "well-known words]") == 1 &&
+                          bjson_regex_match(class_pattern, "a+b") == 0;
+        printf("%s [\\w\\s\\-\\]] inside brackets matches as in JavaScript\n", class_match ? "✓" : "✗");
         bjson_free_value(parsed2);
     }
     
+    // A bracket expression has no form for \D, \S or \W, so they are refused
+    const char* negated = "@regex(/[\\S]+/)";
+    bjson_sax_handler_t ignore = {0};
+    if (bjson_parse_sax(negated, strlen(negated), BJSON_PARSE_DEFAULT, &ignore, NULL) != BJSON_SUCCESS) {
+        printf("✓ %s rejected: %s\n", negated, bjson_error_message());
+    }
+    
     printf("\n");
     
     // Example 3: Flexible keys